@@ -0,0 +1,119 @@
+// Copyright 2025 Sara Saad
+
+/**
+ * @file : AccountIndexBench.cpp
+ * @brief: Compares AccountIndex against the std::unordered_map lookup that
+ * Portfolio used before it.
+ *
+ * Usage: AccountIndexBench [accounts...]   (default: 1000000)
+ * e.g.   AccountIndexBench 1000000 10000000 50000000
+ *
+ * For every size it reports the time to build the lookup table and the
+ * average cost of random hits and misses, in nanoseconds per lookup.
+ *
+ */
+/*************************** include part ****************************** */
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "../Inc/AccountIndex.hpp"
+///////////////////////////////////////////////////////////////////////////////////////////////////////
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+double SecondsSince(Clock::time_point start) {
+  return (std::chrono::duration<double>(Clock::now() - start).count());
+}
+
+std::string MakeId(const char *prefix, size_t n) {
+  char buf[32];
+  std::snprintf(buf, sizeof(buf), "%s-%08zu", prefix, n);
+  return (buf);
+}
+
+template <typename Lookup>
+double NsPerLookup(const std::vector<std::string> &keys,
+                   const std::vector<uint32_t> &order, Lookup lookup,
+                   uint64_t *sink) {
+  auto start = Clock::now();
+  uint64_t acc = 0;
+  for (uint32_t i : order) {
+    acc += lookup(keys[i]);
+  }
+  *sink += acc;
+  return (SecondsSince(start) * 1e9 / order.size());
+}
+
+void RunSize(size_t count) {
+  std::vector<std::string> ids(count);
+  std::vector<std::string> misses(count);
+  for (size_t i = 0; i < count; i++) {
+    ids[i] = MakeId("CHK", i);
+    misses[i] = MakeId("SAV", i);
+  }
+
+  const size_t lookups = std::min<size_t>(count, 10000000);
+  std::mt19937 rng(42);
+  std::uniform_int_distribution<uint32_t> pick(0, count - 1);
+  std::vector<uint32_t> order(lookups);
+  for (auto &o : order) {
+    o = pick(rng);
+  }
+
+  uint64_t sink = 0;
+
+  auto start = Clock::now();
+  std::unordered_map<std::string, uint32_t> map;
+  for (size_t i = 0; i < count; i++) {
+    map[ids[i]] = static_cast<uint32_t>(i);
+  }
+  double map_build = SecondsSince(start);
+  auto map_find = [&](const std::string &id) -> uint64_t {
+    auto it = map.find(id);
+    return (it == map.end() ? 0 : it->second);
+  };
+  double map_hit = NsPerLookup(ids, order, map_find, &sink);
+  double map_miss = NsPerLookup(misses, order, map_find, &sink);
+  map.clear();
+  map.rehash(0);
+
+  start = Clock::now();
+  AccountIndex index;
+  index.Reserve(count);
+  for (size_t i = 0; i < count; i++) {
+    index.Insert(ids[i], static_cast<uint32_t>(i));
+  }
+  double idx_build = SecondsSince(start);
+  auto idx_find = [&](const std::string &id) -> uint64_t {
+    return (index.Find(id));
+  };
+  double idx_hit = NsPerLookup(ids, order, idx_find, &sink);
+  double idx_miss = NsPerLookup(misses, order, idx_find, &sink);
+
+  std::printf("%10zu accounts | build s: map %7.3f index %7.3f | "
+              "hit ns: map %6.1f index %6.1f | miss ns: map %6.1f index "
+              "%6.1f | %llu\n",
+              count, map_build, idx_build, map_hit, idx_hit, map_miss,
+              idx_miss, static_cast<unsigned long long>(sink & 1));
+}
+
+}  // namespace
+
+int main(int argc, char *argv[]) {
+  if (argc < 2) {
+    RunSize(1000000);
+  }
+  for (int i = 1; i < argc; i++) {
+    RunSize(std::strtoull(argv[i], nullptr, 10));
+  }
+  return (0);
+}
@@ -0,0 +1,144 @@
+// Copyright 2025 Sara Saad
+
+/**
+ * @file : AuditExportBench.cpp
+ * @brief: Audit export as row-by-row CSV versus the columnar archive.
+ *
+ * Usage: AuditExportBench [accounts] [records_per_account] [partitions]
+ *        (default: 100000 50 4)
+ *
+ * The baseline walks every account's GetAudit() and prints one CSV line per
+ * record, the way an ad-hoc export would; the archive run is
+ * Portfolio::ExportAudit(). The run reports time and bytes of both, and the
+ * time to decode the archive back into columns.
+ *
+ */
+/*************************** include part ****************************** */
+#include <chrono>
+#include <cinttypes>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "../Inc/AuditArchive.hpp"
+#include "../Inc/Portfolio.hpp"
+///////////////////////////////////////////////////////////////////////////////////////////////////////
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+double SecondsSince(Clock::time_point start) {
+  return (std::chrono::duration<double>(Clock::now() - start).count());
+}
+
+std::string MakeId(size_t n) {
+  char buf[32];
+  std::snprintf(buf, sizeof(buf), "ACC-%08zu", n);
+  return (buf);
+}
+
+}  // namespace
+
+int main(int argc, char *argv[]) {
+  const size_t accounts =
+      argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 100000;
+  const size_t per_account =
+      argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 50;
+  const size_t partitions = argc > 3 ? std::strtoull(argv[3], nullptr, 10) : 4;
+  if (accounts == 0 || partitions == 0) {
+    return (1);
+  }
+
+  std::mt19937_64 rng(3);
+  AccountBatch batch;
+  for (size_t i = 0; i < accounts; i++) {
+    batch.ids.push_back(MakeId(i));
+    batch.types.push_back(AccountType::KCHECKING);
+    batch.aprs.push_back(0.0);
+    batch.fees_cents.push_back(0);
+    batch.opening_balances.push_back(100000000);
+  }
+  Portfolio portfolio;
+  portfolio.AddAccounts(batch, DuplicatePolicy::KREJECT);
+
+  const char *notes[] = {"card", "atm", "payroll", "online", "branch"};
+  const int64_t start_ts = 1700000000;
+  std::vector<TxRecord> txs;
+  txs.reserve(accounts * per_account);
+  for (size_t round = 0; round < per_account; round++) {
+    for (size_t i = 0; i < accounts; i++) {
+      const uint64_t r = rng();
+      txs.push_back({r & 1 ? TxKind::KDEPOSIT : TxKind::KWITHDRAWAL,
+                     static_cast<int64_t>((r >> 8) % 100000),
+                     start_ts + static_cast<int64_t>(round * 3600 + r % 600),
+                     notes[(r >> 40) % 5], batch.ids[i]});
+    }
+  }
+  portfolio.ApplyAll(txs);
+  portfolio.DrainBatchAudit();
+  txs.clear();
+  txs.shrink_to_fit();
+
+  const std::string csv_path = "audit_bench.csv";
+  auto start = Clock::now();
+  FILE *csv = std::fopen(csv_path.c_str(), "w");
+  if (!csv) {
+    return (1);
+  }
+  size_t csv_rows = 0;
+  for (size_t i = 0; i < accounts; i++) {
+    IAccount *acc = portfolio.GetAccount(batch.ids[i]);
+    for (const TxRecord &rec : acc->GetAudit()) {
+      std::fprintf(csv, "%s,%d,%" PRId64 ",%" PRId64 ",%s,%" PRIu64 "\n",
+                   acc->GetId().c_str(), static_cast<int>(rec.kind),
+                   rec.amount_cents, rec.timestamp, rec.note ? rec.note : "",
+                   rec.idempotency_key);
+      csv_rows++;
+    }
+  }
+  const long csv_bytes = std::ftell(csv);
+  std::fclose(csv);
+  const double csv_seconds = SecondsSince(start);
+  std::remove(csv_path.c_str());
+  std::printf("csv rows %zu seconds %.3f mib %.1f\n", csv_rows, csv_seconds,
+              csv_bytes / (1024.0 * 1024.0));
+
+  AuditExportSummary summary;
+  start = Clock::now();
+  if (!portfolio.ExportAudit({"audit_bench.rba", partitions, 0}, &summary)) {
+    return (1);
+  }
+  const double archive_seconds = SecondsSince(start);
+  std::printf("archive rows %zu seconds %.3f mib %.1f\n", summary.rows,
+              archive_seconds, summary.bytes / (1024.0 * 1024.0));
+  std::printf("speedup %.1fx size_ratio %.1fx\n",
+              csv_seconds / archive_seconds,
+              static_cast<double>(csv_bytes) / summary.bytes);
+
+  start = Clock::now();
+  size_t read_rows = 0;
+  int64_t amount_sum = 0;
+  AuditColumns columns;
+  for (const std::string &file : summary.files) {
+    FILE *in = std::fopen(file.c_str(), "rb");
+    if (!in) {
+      return (1);
+    }
+    AuditArchiveReader reader(in);
+    while (reader.Next(&columns)) {
+      read_rows += columns.amounts.size();
+      for (int64_t amount : columns.amounts) {
+        amount_sum += amount;
+      }
+    }
+    std::fclose(in);
+    std::remove(file.c_str());
+  }
+  std::printf("read rows %zu seconds %.3f amount_sum %lld\n", read_rows,
+              SecondsSince(start), static_cast<long long>(amount_sum));
+  return (0);
+}
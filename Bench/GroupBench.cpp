@@ -0,0 +1,168 @@
+// Copyright 2025 Sara Saad
+
+/**
+ * @file : GroupBench.cpp
+ * @brief: Per-group exposure by scanning the book versus rolled-up groups.
+ *
+ * Usage: GroupBench [accounts] [records_per_account] [branches]
+ *        (default: 200000 10 200)
+ *
+ * Accounts are spread over customers (4 accounts each) within branches
+ * within 10 regions. The baseline computes the exposure of every branch by
+ * walking all accounts, the way callers do without groups; the grouped run
+ * reads the same numbers with GroupExposure(). The run also reports what the
+ * hierarchy costs ApplyAll() (best of three alternating runs) and how long
+ * moving 1% of the customers to other branches takes.
+ *
+ */
+/*************************** include part ****************************** */
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "../Inc/Portfolio.hpp"
+///////////////////////////////////////////////////////////////////////////////////////////////////////
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+double SecondsSince(Clock::time_point start) {
+  return (std::chrono::duration<double>(Clock::now() - start).count());
+}
+
+std::string MakeId(size_t n) {
+  char buf[32];
+  std::snprintf(buf, sizeof(buf), "ACC-%08zu", n);
+  return (buf);
+}
+
+/// Group names: R<n> regions, B<n> branches, C<n> customers.
+std::string GroupName(char level, size_t n) {
+  char buf[32];
+  std::snprintf(buf, sizeof(buf), "%c%zu", level, n);
+  return (buf);
+}
+
+std::unique_ptr<Portfolio> MakeBook(const std::vector<std::string> &ids) {
+  AccountBatch batch;
+  for (const std::string &id : ids) {
+    batch.ids.push_back(id);
+    batch.types.push_back(AccountType::KCHECKING);
+    batch.aprs.push_back(0.0);
+    batch.fees_cents.push_back(0);
+    batch.opening_balances.push_back(100000000);
+  }
+  auto portfolio = std::make_unique<Portfolio>();
+  portfolio->AddAccounts(batch, DuplicatePolicy::KREJECT);
+  return (portfolio);
+}
+
+}  // namespace
+
+int main(int argc, char *argv[]) {
+  const size_t accounts =
+      argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 200000;
+  const size_t per_account =
+      argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 10;
+  const size_t branches = argc > 3 ? std::strtoull(argv[3], nullptr, 10) : 200;
+  if (accounts == 0 || branches == 0) {
+    return (1);
+  }
+
+  std::vector<std::string> ids;
+  std::vector<size_t> branch_of;
+  for (size_t i = 0; i < accounts; i++) {
+    ids.push_back(MakeId(i));
+    branch_of.push_back((i / 4) % branches);
+  }
+  std::mt19937_64 rng(11);
+  std::vector<TxRecord> txs;
+  txs.reserve(accounts * per_account);
+  for (size_t round = 0; round < per_account; round++) {
+    for (size_t i = 0; i < accounts; i++) {
+      const uint64_t r = rng();
+      txs.push_back({r & 1 ? TxKind::KDEPOSIT : TxKind::KWITHDRAWAL,
+                     static_cast<int64_t>((r >> 8) % 100000),
+                     static_cast<int64_t>(1700000000 + round), nullptr,
+                     ids[i]});
+    }
+  }
+
+  // Same book without and with the region > branch > customer hierarchy.
+  std::unique_ptr<Portfolio> flat = MakeBook(ids);
+  std::unique_ptr<Portfolio> grouped = MakeBook(ids);
+  for (size_t r = 0; r < 10; r++) {
+    grouped->AddGroup("branch", GroupName('R', r), "");
+  }
+  for (size_t b = 0; b < branches; b++) {
+    grouped->AddGroup("branch", GroupName('B', b),
+                      GroupName('R', b % 10));
+  }
+  std::vector<GroupAssignment> moves;
+  for (size_t i = 0; i < accounts; i += 4) {
+    const std::string customer = GroupName('C', i / 4);
+    grouped->AddGroup("branch", customer, GroupName('B', branch_of[i]));
+    for (size_t k = i; k < i + 4 && k < accounts; k++) {
+      moves.push_back({ids[k], customer});
+    }
+  }
+  grouped->Regroup("branch", moves);
+
+  // Alternate the two books and keep the best of three runs of each.
+  double flat_apply = 1e9;
+  double grouped_apply = 1e9;
+  Clock::time_point start;
+  for (int run = 0; run < 3; run++) {
+    start = Clock::now();
+    flat->ApplyAll(txs);
+    flat_apply = std::min(flat_apply, SecondsSince(start));
+    flat->DrainBatchAudit();
+    start = Clock::now();
+    grouped->ApplyAll(txs);
+    grouped_apply = std::min(grouped_apply, SecondsSince(start));
+    grouped->DrainBatchAudit();
+  }
+  std::printf("apply records %zu flat %.3f s grouped %.3f s overhead %.1f%%\n",
+              txs.size(), flat_apply, grouped_apply,
+              (grouped_apply / flat_apply - 1.0) * 100.0);
+
+  start = Clock::now();
+  std::vector<int64_t> scanned(branches, 0);
+  for (size_t i = 0; i < accounts; i++) {
+    scanned[branch_of[i]] += flat->GetAccount(ids[i])->GetBalance();
+  }
+  const double scan_seconds = SecondsSince(start);
+
+  start = Clock::now();
+  std::vector<int64_t> rolled(branches, 0);
+  for (size_t b = 0; b < branches; b++) {
+    GroupTotal total;
+    grouped->GroupExposure("branch", GroupName('B', b), &total);
+    rolled[b] = total.exposure;
+  }
+  const double read_seconds = SecondsSince(start);
+  size_t differ = 0;
+  for (size_t b = 0; b < branches; b++) {
+    differ += scanned[b] != rolled[b];
+  }
+  std::printf("branch exposure scan %.6f s groups %.6f s speedup %.0fx "
+              "differ %zu\n",
+              scan_seconds, read_seconds, scan_seconds / read_seconds, differ);
+
+  // Move 1% of the customers to another branch.
+  start = Clock::now();
+  size_t moved = 0;
+  for (size_t c = 0; c < accounts / 4; c += 100) {
+    moved += grouped->MoveGroup("branch", GroupName('C', c),
+                                GroupName('B', (c + 1) % branches));
+  }
+  std::printf("regroup customers %zu seconds %.6f\n", moved,
+              SecondsSince(start));
+  return (differ == 0 ? 0 : 1);
+}
@@ -0,0 +1,147 @@
+// Copyright 2025 Sara Saad
+
+/**
+ * @file : HotPathBench.cpp
+ * @brief: Compares the virtual, out-of-line IAccount::Apply() against the
+ * header-only HotPath<Account, Policy>::Apply().
+ *
+ * Usage: HotPathBench [accounts] [transactions]   (default: 10000 2000000)
+ *
+ * Each variant runs the same transaction stream over fresh copies of the
+ * book (best of three), and the final balances are checked to be identical.
+ * Reported in nanoseconds per transaction.
+ *
+ */
+/*************************** include part ****************************** */
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "../Inc/HotPath.hpp"
+#include "../Inc/IAccount.hpp"
+///////////////////////////////////////////////////////////////////////////////////////////////////////
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+struct Book {
+  std::vector<std::unique_ptr<IAccount>> accounts;
+};
+
+Book MakeBook(size_t count) {
+  Book book;
+  book.accounts.reserve(count);
+  for (size_t i = 0; i < count; i++) {
+    if (i % 3 == 0) {
+      book.accounts.push_back(std::make_unique<SavingAccount>(
+          "SAV-" + std::to_string(i), 0.02 + (i % 10) * 0.001, 100000));
+    } else {
+      book.accounts.push_back(std::make_unique<CheckingAccount>(
+          "CHK-" + std::to_string(i), 150, 100000));
+    }
+  }
+  return (book);
+}
+
+/**
+ * @brief: Best time of three runs, each on a fresh book; *balances receives
+ * the final balances of the last run.
+ */
+template <typename Run>
+double NsPerTx(size_t accounts, const std::vector<TxRecord> &txs,
+               const std::vector<uint32_t> &targets, Run run,
+               std::vector<int64_t> *balances) {
+  double best = 0;
+  for (int rep = 0; rep < 3; rep++) {
+    Book book = MakeBook(accounts);
+    auto start = Clock::now();
+    for (size_t i = 0; i < txs.size(); i++) {
+      run(book.accounts[targets[i]].get(), txs[i], targets[i]);
+    }
+    double ns = std::chrono::duration<double, std::nano>(Clock::now() - start)
+                    .count() /
+                txs.size();
+    best = (rep == 0 || ns < best) ? ns : best;
+
+    balances->clear();
+    for (const auto &acc : book.accounts) {
+      balances->push_back(acc->GetBalance());
+    }
+  }
+  return (best);
+}
+
+}  // namespace
+
+int main(int argc, char *argv[]) {
+  const size_t accounts =
+      argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 10000;
+  const size_t transactions =
+      argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 2000000;
+  if (accounts == 0) {
+    return (1);
+  }
+
+  std::mt19937_64 rng(11);
+  std::vector<TxRecord> txs(transactions);
+  std::vector<uint32_t> targets(transactions);
+  for (size_t i = 0; i < transactions; i++) {
+    const uint64_t r = rng();
+    txs[i].kind = static_cast<TxKind>(r % 4);
+    txs[i].amount_cents = static_cast<int64_t>((r >> 8) % 5000);
+    if (txs[i].kind == TxKind::KINTEREST) {
+      txs[i].amount_cents = 1 + static_cast<int64_t>((r >> 8) % 30);
+    }
+    txs[i].timestamp = static_cast<int64_t>(i);
+    txs[i].note = "bench";
+    targets[i] = static_cast<uint32_t>((r >> 32) % accounts);
+  }
+
+  // The account type is known per handle, as in Portfolio's dispatch table.
+  auto hot = [](IAccount *acc, const TxRecord &tx, uint32_t handle) {
+    if (handle % 3 == 0) {
+      HotPath<SavingAccount>::Apply(static_cast<SavingAccount *>(acc), tx);
+    } else {
+      HotPath<CheckingAccount>::Apply(static_cast<CheckingAccount *>(acc), tx);
+    }
+  };
+  auto hot_balance_only = [](IAccount *acc, const TxRecord &tx,
+                             uint32_t handle) {
+    if (handle % 3 == 0) {
+      HotPath<SavingAccount, BalanceOnlyPolicy>::Apply(
+          static_cast<SavingAccount *>(acc), tx);
+    } else {
+      HotPath<CheckingAccount, BalanceOnlyPolicy>::Apply(
+          static_cast<CheckingAccount *>(acc), tx);
+    }
+  };
+  auto virt = [](IAccount *acc, const TxRecord &tx, uint32_t) {
+    acc->Apply(tx);
+  };
+
+  std::vector<int64_t> virtual_balances, hot_balances, balance_balances;
+  double virtual_ns = NsPerTx(accounts, txs, targets, virt, &virtual_balances);
+  double hot_ns = NsPerTx(accounts, txs, targets, hot, &hot_balances);
+  double balance_ns =
+      NsPerTx(accounts, txs, targets, hot_balance_only, &balance_balances);
+
+  std::printf("%zu accounts, %zu transactions\n", accounts, transactions);
+  std::printf("IAccount::Apply (virtual)     %7.1f ns/tx\n", virtual_ns);
+  std::printf("HotPath, AuditedPolicy        %7.1f ns/tx  %.2fx\n", hot_ns,
+              virtual_ns / hot_ns);
+  std::printf("HotPath, BalanceOnlyPolicy    %7.1f ns/tx  %.2fx\n", balance_ns,
+              virtual_ns / balance_ns);
+
+  if (virtual_balances != hot_balances ||
+      virtual_balances != balance_balances) {
+    std::printf("balances differ\n");
+    return (1);
+  }
+  return (0);
+}
@@ -0,0 +1,129 @@
+// Copyright 2025 Sara Saad
+
+/**
+ * @file : PortfolioBench.cpp
+ * @brief: End-to-end Portfolio workload, used to compare build configurations
+ * and as the training run of the profile-guided build.
+ *
+ * Usage: PortfolioBench [accounts] [transactions]   (default: 200000 2000000)
+ *
+ * The run onboards a mixed book, applies a stream of deposits, withdrawals,
+ * fees and interest, performs transfers, sweeps fees, accrues interest and
+ * reads exposure and digests. Each phase is timed; the last line,
+ * "total_seconds <t>", is what scripts/compare_builds.sh parses.
+ *
+ */
+/*************************** include part ****************************** */
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "../Inc/Portfolio.hpp"
+///////////////////////////////////////////////////////////////////////////////////////////////////////
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+double SecondsSince(Clock::time_point start) {
+  return (std::chrono::duration<double>(Clock::now() - start).count());
+}
+
+std::string MakeId(const char *prefix, size_t n) {
+  char buf[32];
+  std::snprintf(buf, sizeof(buf), "%s-%08zu", prefix, n);
+  return (buf);
+}
+
+}  // namespace
+
+int main(int argc, char *argv[]) {
+  const size_t accounts =
+      argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 200000;
+  const size_t transactions =
+      argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 2000000;
+  if (accounts == 0) {
+    return (1);
+  }
+
+  std::mt19937_64 rng(7);
+  AccountBatch batch;
+  for (size_t i = 0; i < accounts; i++) {
+    const bool saving = (i % 3 == 0);
+    batch.ids.push_back(MakeId(saving ? "SAV" : "CHK", i));
+    batch.types.push_back(saving ? AccountType::KSAVINGS
+                                 : AccountType::KCHECKING);
+    batch.aprs.push_back(saving ? 0.01 + (i % 50) * 0.001 : 0.0);
+    batch.fees_cents.push_back(saving ? 0 : 100 + i % 400);
+    batch.opening_balances.push_back(static_cast<int64_t>(rng() % 1000000));
+  }
+
+  std::vector<TxRecord> txs;
+  txs.reserve(transactions);
+  for (size_t i = 0; i < transactions; i++) {
+    const uint64_t r = rng();
+    TxRecord tx;
+    tx.kind = static_cast<TxKind>(r % 4);
+    tx.amount_cents = static_cast<int64_t>((r >> 8) % 50000);
+    if (tx.kind == TxKind::KINTEREST) {
+      tx.amount_cents = 1 + static_cast<int64_t>((r >> 8) % 30);
+    }
+    tx.timestamp = 1700000000 + static_cast<int64_t>(i);
+    tx.note = "bench";
+    tx.account_id = batch.ids[(r >> 32) % accounts];
+    txs.push_back(std::move(tx));
+  }
+
+  const size_t transfers = transactions / 10;
+  std::vector<TransferRecord> moves;
+  moves.reserve(transfers);
+  for (size_t i = 0; i < transfers; i++) {
+    const uint64_t r = rng();
+    moves.push_back({batch.ids[r % accounts], batch.ids[(r >> 32) % accounts],
+                     static_cast<int64_t>((r >> 16) % 10000),
+                     1800000000 + static_cast<int64_t>(i), "transfer"});
+  }
+
+  Portfolio portfolio;
+  auto total_start = Clock::now();
+
+  auto start = Clock::now();
+  portfolio.AddAccounts(batch, DuplicatePolicy::KREJECT);
+  std::printf("onboard_seconds %.4f\n", SecondsSince(start));
+
+  start = Clock::now();
+  portfolio.ApplyAll(txs);
+  std::printf("apply_seconds %.4f\n", SecondsSince(start));
+
+  start = Clock::now();
+  size_t done = 0;
+  for (auto &move : moves) {
+    done += portfolio.Transfer(std::move(move)) ? 1 : 0;
+  }
+  std::printf("transfer_seconds %.4f\n", SecondsSince(start));
+
+  start = Clock::now();
+  FeeSweepSummary fees = portfolio.SweepFees(1900000000, "sweep", 8);
+  portfolio.SetAccrualPolicy({true, false, 0}, 1900000000);
+  portfolio.AccrueAll(1900000000 + 90 * Calculator::kSecondsPerDay);
+  std::printf("sweep_accrue_seconds %.4f\n", SecondsSince(start));
+
+  start = Clock::now();
+  int64_t exposure = 0;
+  for (int i = 0; i < 20; i++) {
+    exposure += portfolio.TotalExposure();
+  }
+  uint64_t digest = portfolio.Checksum().Root();
+  std::printf("read_seconds %.4f\n", SecondsSince(start));
+
+  std::printf("checks %zu %lld %lld %llu\n", done,
+              static_cast<long long>(fees.total_fees_cents),
+              static_cast<long long>(exposure),
+              static_cast<unsigned long long>(digest));
+  std::printf("total_seconds %.4f\n", SecondsSince(total_start));
+  return (0);
+}
@@ -0,0 +1,162 @@
+// Copyright 2025 Sara Saad
+
+/**
+ * @file : ReconcileBench.cpp
+ * @brief: Reconciliation as an in-memory hash join versus the partitioned
+ * sort-merge of Portfolio::Reconcile(), in memory and spilling.
+ *
+ * Usage: ReconcileBench [accounts] [records_per_account] [partitions]
+ *        (default: 100000 50 4)
+ *
+ * The external side is the book itself with one record in a thousand
+ * dropped and one in a thousand altered. The baseline loads the whole book
+ * into a hash map keyed by (account, timestamp, kind, amount) and probes it
+ * with every external record. Reconcile() then runs with an unlimited
+ * memory budget and with a budget of a tenth of the data.
+ *
+ */
+/*************************** include part ****************************** */
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "../Inc/Portfolio.hpp"
+#include "../Inc/Reconciler.hpp"
+///////////////////////////////////////////////////////////////////////////////////////////////////////
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+double SecondsSince(Clock::time_point start) {
+  return (std::chrono::duration<double>(Clock::now() - start).count());
+}
+
+std::string MakeId(size_t n) {
+  char buf[32];
+  std::snprintf(buf, sizeof(buf), "ACC-%08zu", n);
+  return (buf);
+}
+
+std::string Key(const std::string &id, const TxRecord &rec) {
+  return (id + "|" + std::to_string(rec.timestamp) + "|" +
+          std::to_string(static_cast<int>(rec.kind)) + "|" +
+          std::to_string(rec.amount_cents));
+}
+
+/// Counts only, safe for concurrent partitions.
+class CountingSink : public IReconcileSink {
+ public:
+  void OnMatched(size_t, const ReconEntry &) override {}
+  void OnMissingFromBook(size_t, const ReconEntry &) override {}
+  void OnMissingFromExternal(size_t, const ReconEntry &) override {}
+  void OnMismatched(size_t, const ReconEntry &, const ReconEntry &) override {}
+};
+
+}  // namespace
+
+int main(int argc, char *argv[]) {
+  const size_t accounts =
+      argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 100000;
+  const size_t per_account =
+      argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 50;
+  const size_t partitions = argc > 3 ? std::strtoull(argv[3], nullptr, 10) : 4;
+  if (accounts == 0 || partitions == 0) {
+    return (1);
+  }
+
+  std::mt19937_64 rng(5);
+  AccountBatch batch;
+  for (size_t i = 0; i < accounts; i++) {
+    batch.ids.push_back(MakeId(i));
+    batch.types.push_back(AccountType::KCHECKING);
+    batch.aprs.push_back(0.0);
+    batch.fees_cents.push_back(0);
+    batch.opening_balances.push_back(100000000);
+  }
+  Portfolio portfolio;
+  portfolio.AddAccounts(batch, DuplicatePolicy::KREJECT);
+
+  const int64_t start_ts = 1700000000;
+  std::vector<TxRecord> txs;
+  txs.reserve(accounts * per_account);
+  for (size_t round = 0; round < per_account; round++) {
+    for (size_t i = 0; i < accounts; i++) {
+      const uint64_t r = rng();
+      txs.push_back({r & 1 ? TxKind::KDEPOSIT : TxKind::KWITHDRAWAL,
+                     static_cast<int64_t>((r >> 8) % 100000),
+                     start_ts + static_cast<int64_t>(round * 3600 + r % 600),
+                     nullptr, batch.ids[i]});
+    }
+  }
+  portfolio.ApplyAll(txs);
+  portfolio.DrainBatchAudit();
+
+  std::vector<TxRecord> external;
+  external.reserve(txs.size());
+  for (size_t i = 0; i < txs.size(); i++) {
+    if (i % 1000 == 7) {
+      continue;
+    }
+    external.push_back(txs[i]);
+    if (i % 1000 == 500) {
+      external.back().amount_cents += 1;
+    }
+  }
+  txs.clear();
+  txs.shrink_to_fit();
+
+  auto start = Clock::now();
+  std::unordered_map<std::string, size_t> book;
+  for (size_t i = 0; i < accounts; i++) {
+    for (const TxRecord &rec : portfolio.GetAccount(batch.ids[i])->GetAudit()) {
+      book[Key(batch.ids[i], rec)]++;
+    }
+  }
+  size_t hash_matched = 0;
+  for (const TxRecord &rec : external) {
+    auto it = book.find(Key(rec.account_id, rec));
+    if (it != book.end() && it->second > 0) {
+      it->second--;
+      hash_matched++;
+    }
+  }
+  const double hash_seconds = SecondsSince(start);
+  std::printf("hash_join records %zu matched %zu seconds %.3f\n",
+              external.size(), hash_matched, hash_seconds);
+  book.clear();
+
+  const size_t data_bytes = external.size() * 2 * 64;
+  for (size_t budget : {SIZE_MAX, data_bytes / 10}) {
+    size_t next = 0;
+    CountingSink sink;
+    ReconcileSummary summary;
+    start = Clock::now();
+    const bool ok = portfolio.Reconcile(
+        {start_ts, INT64_MAX, partitions, budget},
+        [&](TxRecord *rec) {
+          if (next == external.size()) {
+            return (false);
+          }
+          *rec = external[next++];
+          return (true);
+        },
+        &sink, &summary);
+    if (!ok) {
+      return (1);
+    }
+    std::printf(
+        "sort_merge budget_mib %.0f matched %zu mismatched %zu missing %zu/%zu "
+        "runs %zu merges %zu spilled_mib %.1f seconds %.3f\n",
+        budget == SIZE_MAX ? -1.0 : budget / (1024.0 * 1024.0),
+        summary.matched, summary.mismatched, summary.missing_from_book,
+        summary.missing_from_external, summary.runs_spilled,
+        summary.merge_passes, summary.bytes_spilled / (1024.0 * 1024.0), SecondsSince(start));
+  }
+  return (0);
+}
@@ -0,0 +1,141 @@
+// Copyright 2025 Sara Saad
+
+/**
+ * @file : ReplicationBench.cpp
+ * @brief: Cost of hot-standby replication on the primary's apply path, and
+ * the follower's replay throughput and lag.
+ *
+ * Usage: ReplicationBench [accounts] [transactions]   (default: 100000 2000000)
+ *
+ * The same stream is applied twice on fresh books: once without replication
+ * and once publishing to a ring replayed by a forked follower process. The
+ * output reports the primary thread's CPU time for both applies and the
+ * overhead in percent, the
+ * follower's catch-up time, its replay rate, the producer stalls, and
+ * whether the follower's book checksum matches the primary's.
+ *
+ */
+/*************************** include part ****************************** */
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "../Inc/Replication.hpp"
+///////////////////////////////////////////////////////////////////////////////////////////////////////
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+double SecondsSince(Clock::time_point start) {
+  return (std::chrono::duration<double>(Clock::now() - start).count());
+}
+
+/// CPU time of the calling thread: the primary's own cost, even when the
+/// follower shares its core.
+double ThreadCpuSeconds() {
+  struct timespec ts;
+  clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+  return (ts.tv_sec + ts.tv_nsec * 1e-9);
+}
+
+std::string MakeId(size_t n) {
+  char buf[32];
+  std::snprintf(buf, sizeof(buf), "ACC-%08zu", n);
+  return (buf);
+}
+
+}  // namespace
+
+int main(int argc, char *argv[]) {
+  const size_t accounts =
+      argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 100000;
+  const size_t transactions =
+      argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 2000000;
+  if (accounts == 0) {
+    return (1);
+  }
+
+  std::mt19937_64 rng(3);
+  AccountBatch batch;
+  for (size_t i = 0; i < accounts; i++) {
+    batch.ids.push_back(MakeId(i));
+    batch.types.push_back(AccountType::KCHECKING);
+    batch.aprs.push_back(0.0);
+    batch.fees_cents.push_back(100);
+    batch.opening_balances.push_back(static_cast<int64_t>(rng() % 1000000));
+  }
+  std::vector<TxRecord> txs;
+  txs.reserve(transactions);
+  for (size_t i = 0; i < transactions; i++) {
+    const uint64_t r = rng();
+    txs.push_back({r & 1 ? TxKind::KDEPOSIT : TxKind::KWITHDRAWAL,
+                   static_cast<int64_t>((r >> 8) % 50000),
+                   1700000000 + static_cast<int64_t>(i), "bench",
+                   batch.ids[(r >> 32) % accounts]});
+  }
+
+  double plain_seconds = 0.0;
+  {
+    Portfolio primary;
+    primary.AddAccounts(batch, DuplicatePolicy::KREJECT);
+    const double cpu = ThreadCpuSeconds();
+    primary.ApplyAll(txs);
+    plain_seconds = ThreadCpuSeconds() - cpu;
+  }
+
+  std::unique_ptr<ReplicationRing> ring = ReplicationRing::Create(64 << 20);
+  int fds[2];
+  if (!ring || pipe(fds) != 0) {
+    return (1);
+  }
+  const pid_t pid = fork();
+  if (pid == 0) {
+    ThreadPool pool(1);
+    Portfolio standby(&pool);
+    ReplicationFollower follower(ring.get(), &standby);
+    follower.Run();
+    const uint64_t root = standby.Checksum().Root();
+    _exit(write(fds[1], &root, sizeof(root)) == sizeof(root) ? 0 : 1);
+  }
+
+  Portfolio primary;
+  ReplicationPublisher publisher(ring.get());
+  primary.SetReplicationSink(&publisher);
+  primary.AddAccounts(batch, DuplicatePolicy::KREJECT);
+  auto start = Clock::now();
+  const double cpu = ThreadCpuSeconds();
+  primary.ApplyAll(txs);
+  const double replicated_seconds = ThreadCpuSeconds() - cpu;
+  const ReplicationStats at_end = ring->Stats();
+  ring->Close();
+
+  uint64_t standby_root = 0;
+  const bool got = read(fds[0], &standby_root, sizeof(standby_root)) ==
+                   static_cast<ssize_t>(sizeof(standby_root));
+  const double catch_up_seconds = SecondsSince(start);
+  waitpid(pid, nullptr, 0);
+  const ReplicationStats stats = ring->Stats();
+
+  std::printf("apply_cpu_seconds_plain %.4f\n", plain_seconds);
+  std::printf("apply_cpu_seconds_replicated %.4f\n", replicated_seconds);
+  std::printf("overhead_percent %.1f\n",
+              100.0 * (replicated_seconds - plain_seconds) / plain_seconds);
+  std::printf("lag_entries_at_end %llu\n",
+              static_cast<unsigned long long>(at_end.lag_entries));
+  std::printf("follower_seconds %.4f replay_per_s %.0f\n", catch_up_seconds,
+              stats.applied / catch_up_seconds);
+  std::printf("stalls %llu match %d\n",
+              static_cast<unsigned long long>(stats.stalls),
+              got && standby_root == primary.Checksum().Root() ? 1 : 0);
+  return (0);
+}
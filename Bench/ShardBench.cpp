@@ -0,0 +1,113 @@
+// Copyright 2025 Sara Saad
+
+/**
+ * @file : ShardBench.cpp
+ * @brief: Throughput of a ShardedPortfolio by shard count.
+ *
+ * Usage: ShardBench [accounts] [transactions] [max_shards]
+ *        (default: 100000 2000000 8)
+ *
+ * For 1, 2, 4, ... max_shards worker processes the same book is onboarded,
+ * the transaction stream is applied in batches of kBatch records, and a
+ * series of transfers (mostly cross-shard) is run. One line per shard count:
+ *   shards <n> apply_tx_per_s <r> transfer_per_s <r> speedup <s>
+ * where speedup is the apply rate relative to one shard. Scaling is bounded
+ * by the cores of the machine and by the router, which encodes every batch.
+ *
+ */
+/*************************** include part ****************************** */
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "../Inc/ShardedPortfolio.hpp"
+///////////////////////////////////////////////////////////////////////////////////////////////////////
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+constexpr size_t kBatch = 1 << 16;
+
+double SecondsSince(Clock::time_point start) {
+  return (std::chrono::duration<double>(Clock::now() - start).count());
+}
+
+std::string MakeId(size_t n) {
+  char buf[32];
+  std::snprintf(buf, sizeof(buf), "ACC-%08zu", n);
+  return (buf);
+}
+
+}  // namespace
+
+int main(int argc, char *argv[]) {
+  const size_t accounts =
+      argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 100000;
+  const size_t transactions =
+      argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 2000000;
+  const size_t max_shards =
+      argc > 3 ? std::strtoull(argv[3], nullptr, 10) : 8;
+  if (accounts == 0 || max_shards == 0) {
+    return (1);
+  }
+
+  std::mt19937_64 rng(5);
+  AccountBatch batch;
+  for (size_t i = 0; i < accounts; i++) {
+    batch.ids.push_back(MakeId(i));
+    batch.types.push_back(AccountType::KCHECKING);
+    batch.aprs.push_back(0.0);
+    batch.fees_cents.push_back(100);
+    batch.opening_balances.push_back(static_cast<int64_t>(rng() % 1000000));
+  }
+  std::vector<TxRecord> txs;
+  txs.reserve(transactions);
+  for (size_t i = 0; i < transactions; i++) {
+    const uint64_t r = rng();
+    txs.push_back({r & 1 ? TxKind::KDEPOSIT : TxKind::KWITHDRAWAL,
+                   static_cast<int64_t>((r >> 8) % 50000),
+                   1700000000 + static_cast<int64_t>(i), "bench",
+                   batch.ids[(r >> 32) % accounts]});
+  }
+  const size_t transfers = std::max<size_t>(transactions / 100, 1);
+
+  double base_rate = 0.0;
+  for (size_t shards = 1; shards <= max_shards; shards *= 2) {
+    ShardedPortfolio book;
+    if (!book.Start(shards) ||
+        book.AddAccounts(batch, DuplicatePolicy::KREJECT) != accounts) {
+      std::fprintf(stderr, "shard start failed\n");
+      return (1);
+    }
+
+    auto start = Clock::now();
+    for (size_t at = 0; at < txs.size(); at += kBatch) {
+      const size_t end = std::min(at + kBatch, txs.size());
+      std::vector<TxRecord> part(txs.begin() + at, txs.begin() + end);
+      book.ApplyAll(part, nullptr);
+    }
+    const double apply_rate = txs.size() / SecondsSince(start);
+
+    start = Clock::now();
+    for (size_t i = 0; i < transfers; i++) {
+      const uint64_t r = rng();
+      book.Transfer({batch.ids[r % accounts], batch.ids[(r >> 32) % accounts],
+                     1, 1800000000 + static_cast<int64_t>(i), "t"});
+    }
+    const double transfer_rate = transfers / SecondsSince(start);
+
+    if (shards == 1) {
+      base_rate = apply_rate;
+    }
+    std::printf("shards %zu apply_tx_per_s %.0f transfer_per_s %.0f "
+                "speedup %.2f\n",
+                shards, apply_rate, transfer_rate, apply_rate / base_rate);
+  }
+  return (0);
+}
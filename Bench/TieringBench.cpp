@@ -0,0 +1,143 @@
+// Copyright 2025 Sara Saad
+
+/**
+ * @file : TieringBench.cpp
+ * @brief: Resident memory of a mostly dormant book, before and after
+ * demoting idle accounts to the cold tier.
+ *
+ * Usage: TieringBench [accounts] [active_percent]   (default: 200000 5)
+ *
+ * Every account gets a month of history (20 transactions), then only
+ * active_percent of them keep trading. The run reports the resident set size
+ * after the history and after DemoteIdle(), and the time to promote a
+ * dormant account back with its next transaction. Linux/glibc only.
+ *
+ */
+/*************************** include part ****************************** */
+#include <malloc.h>
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "../Inc/Portfolio.hpp"
+///////////////////////////////////////////////////////////////////////////////////////////////////////
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+double SecondsSince(Clock::time_point start) {
+  return (std::chrono::duration<double>(Clock::now() - start).count());
+}
+
+/// Resident set size of this process in MiB, from /proc/self/statm, after
+/// handing freed heap pages back to the kernel.
+double ResidentMiB() {
+  malloc_trim(0);
+  FILE *statm = std::fopen("/proc/self/statm", "r");
+  if (!statm) {
+    return (0.0);
+  }
+  unsigned long size = 0;
+  unsigned long resident = 0;
+  if (std::fscanf(statm, "%lu %lu", &size, &resident) != 2) {
+    resident = 0;
+  }
+  std::fclose(statm);
+  return (resident * 4096.0 / (1024.0 * 1024.0));
+}
+
+std::string MakeId(size_t n) {
+  char buf[32];
+  std::snprintf(buf, sizeof(buf), "ACC-%08zu", n);
+  return (buf);
+}
+
+}  // namespace
+
+int main(int argc, char *argv[]) {
+  const size_t accounts =
+      argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 200000;
+  const size_t active_percent =
+      argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 5;
+  if (accounts == 0) {
+    return (1);
+  }
+
+  std::mt19937_64 rng(11);
+  AccountBatch batch;
+  for (size_t i = 0; i < accounts; i++) {
+    const bool saving = (i % 3 == 0);
+    batch.ids.push_back(MakeId(i));
+    batch.types.push_back(saving ? AccountType::KSAVINGS
+                                 : AccountType::KCHECKING);
+    batch.aprs.push_back(saving ? 0.02 : 0.0);
+    batch.fees_cents.push_back(saving ? 0 : 250);
+    batch.opening_balances.push_back(static_cast<int64_t>(rng() % 1000000));
+  }
+
+  Portfolio portfolio;
+  portfolio.AddAccounts(batch, DuplicatePolicy::KREJECT);
+
+  const int64_t month_start = 1700000000;
+  std::vector<TxRecord> txs;
+  txs.reserve(accounts * 20);
+  for (size_t round = 0; round < 20; round++) {
+    for (size_t i = 0; i < accounts; i++) {
+      const uint64_t r = rng();
+      txs.push_back({r & 1 ? TxKind::KDEPOSIT : TxKind::KWITHDRAWAL,
+                     static_cast<int64_t>((r >> 8) % 5000),
+                     month_start + static_cast<int64_t>(round * 3600),
+                     r & 1 ? "card" : "atm", batch.ids[i]});
+    }
+  }
+  portfolio.ApplyAll(txs);
+  portfolio.DrainBatchAudit();
+  txs.clear();
+  txs.shrink_to_fit();
+  const double hot_mib = ResidentMiB();
+  std::printf("resident_mib_all_hot %.1f\n", hot_mib);
+
+  // The active accounts trade again two weeks later.
+  const int64_t later = month_start + 14 * 86400;
+  std::vector<TxRecord> active;
+  for (size_t i = 0; i < accounts; i++) {
+    if (i % 100 < active_percent) {
+      active.push_back({TxKind::KDEPOSIT, 100, later, "card", batch.ids[i]});
+    }
+  }
+  portfolio.ApplyAll(active);
+  portfolio.DrainBatchAudit();
+
+  auto start = Clock::now();
+  const size_t demoted = portfolio.DemoteIdle(later, 7 * 86400);
+  std::printf("demote_seconds %.4f\n", SecondsSince(start));
+  const double tiered_mib = ResidentMiB();
+  TieringStats stats = portfolio.TierStats();
+  std::printf("demoted %zu resident %zu cold_mib %.1f\n", demoted,
+              stats.resident, stats.cold_bytes / (1024.0 * 1024.0));
+  std::printf("resident_mib_tiered %.1f\n", tiered_mib);
+
+  // Touch a different slice of dormant accounts: each one is promoted.
+  std::vector<TxRecord> wake;
+  for (size_t i = 0; i < accounts; i += 100) {
+    wake.push_back({TxKind::KDEPOSIT, 1, later + 60, "card",
+                    batch.ids[i + active_percent < accounts
+                                  ? i + active_percent
+                                  : i]});
+  }
+  start = Clock::now();
+  portfolio.ApplyAll(wake);
+  const double wake_seconds = SecondsSince(start);
+  std::printf("promote_us_per_account %.2f\n",
+              wake.empty() ? 0.0 : wake_seconds * 1e6 / wake.size());
+  std::printf("exposure %lld promotions %llu\n",
+              static_cast<long long>(portfolio.TotalExposure()),
+              static_cast<unsigned long long>(portfolio.TierStats().promotions));
+  return (0);
+}
@@ -0,0 +1,123 @@
+// Copyright 2025 Sara Saad
+
+/**
+ * @file : AccountIndex.hpp
+ * @brief: Flat open-addressing hash index from account IDs to account handles.
+ *
+ * The AccountIndex replaces the node-based std::unordered_map lookup used by
+ * Portfolio. Slots live in one contiguous array and are probed in groups of 16
+ * through a parallel array of one-byte control tags (SSE2 when available).
+ * Short IDs such as "CHK-001" are stored inline in the slot together with
+ * their precomputed hash, so a successful lookup touches one control group
+ * and one slot without chasing any pointer.
+ *
+ */
+#ifndef _HOME_SARA_DOCUMENTS_ROBOBANKPORTFOLIO_INC_ACCOUNTINDEX_HPP_
+#define _HOME_SARA_DOCUMENTS_ROBOBANKPORTFOLIO_INC_ACCOUNTINDEX_HPP_
+
+/*************************** include part ****************************** */
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+///////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/************************************ Class Part
+ * ************************************* */
+/**
+ * @class: AccountIndex
+ * @brief: Maps account IDs to dense uint32_t handles.
+ *
+ * Handles are chosen by the owner (Portfolio uses the position of the account
+ * in its dense storage). The index never owns accounts. It is not thread-safe
+ * for concurrent modification; concurrent Find() calls are safe.
+ *
+ */
+class AccountIndex {
+ public:
+  static constexpr uint32_t kNotFound = UINT32_MAX;  ///< Find() miss result
+  static constexpr size_t kInlineKey = 19;  ///< Longest ID stored inline
+
+  /**
+   * @brief   : Hash an account ID the way the index does.
+   * @param id: The account ID.
+   * @return  : uint64_t The hash, usable with the Find() overload below.
+   */
+  static uint64_t Hash(std::string_view id);
+
+  /**
+   * @brief      : Size the table so that count IDs fit without rehashing.
+   * @param count: Number of IDs expected.
+   */
+  void Reserve(size_t count);
+
+  /**
+   * @brief   : Look up an account ID.
+   * @param id: The account ID.
+   * @return  : uint32_t The handle stored for id, or kNotFound.
+   */
+  uint32_t Find(std::string_view id) const;
+
+  /**
+   * @brief     : Look up an account ID whose hash is already known.
+   * @param id  : The account ID.
+   * @param hash: Hash(id), computed once by the caller.
+   * @return    : uint32_t The handle stored for id, or kNotFound.
+   */
+  uint32_t Find(std::string_view id, uint64_t hash) const;
+
+  /**
+   * @brief       : Insert a new ID.
+   * @param id    : The account ID.
+   * @param handle: The handle to associate with id.
+   * @return      : bool False (and nothing changes) if id is already present.
+   */
+  bool Insert(std::string_view id, uint32_t handle);
+
+  /**
+   * @brief       : Change the handle of an ID that is already present.
+   * @return      : bool False if id is not present.
+   */
+  bool Assign(std::string_view id, uint32_t handle);
+
+  /**
+   * @brief   : Remove an ID.
+   * @return  : bool False if id was not present.
+   */
+  bool Erase(std::string_view id);
+
+  size_t Size() const;  ///< Number of IDs stored
+  void Clear();         ///< Remove every ID and release the table
+
+ private:
+  /**
+   * @struct: Slot
+   * @brief : One table entry, 32 bytes.
+   * IDs up to kInlineKey bytes are kept in key; longer IDs set length to
+   * kLongKey and keep an index into long_keys_ in the first bytes of key.
+   */
+  struct Slot {
+    uint64_t hash;
+    uint32_t handle;
+    uint8_t length;
+    char key[kInlineKey];
+  };
+
+  static constexpr uint8_t kLongKey = 0xFF;
+  static constexpr size_t kGroupWidth = 16;
+
+  std::vector<int8_t> ctrl_;  ///< One control tag per slot
+  std::vector<Slot> slots_;   ///< Slot storage, same length as ctrl_
+  std::vector<std::string> long_keys_;  ///< IDs longer than kInlineKey
+  size_t size_ = 0;                     ///< Live entries
+  size_t tombstones_ = 0;               ///< Erased entries still in ctrl_
+
+  size_t FindSlot(std::string_view id, uint64_t hash) const;
+  bool KeyEquals(const Slot &slot, std::string_view id) const;
+  void Rehash(size_t capacity);
+  void Place(uint64_t hash, const Slot &slot);
+  void EncodeKey(Slot *slot, std::string_view id);
+};
+
+#endif  // _HOME_SARA_DOCUMENTS_ROBOBANKPORTFOLIO_INC_ACCOUNTINDEX_HPP_
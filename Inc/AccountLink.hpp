@@ -0,0 +1,68 @@
+// Copyright 2025 Sara Saad
+
+/**
+ * @file : AccountLink.hpp
+ * @brief: How an account is attached to the Portfolio that owns it.
+ *
+ * Accounts mutate their own balances, but several Portfolio-level structures
+ * (epoch snapshots, the book checksum, ...) must follow every change. When an
+ * account is added, the Portfolio hands it an AccountLink; from then on the
+ * account stamps each balance change with the Portfolio's epoch and reports
+ * it to the Portfolio's IBalanceListener, whichever path made the change.
+ * When velocity statistics are enabled, the link also names the tracker that
+ * counts every audit record the account writes.
+ *
+ */
+#ifndef _HOME_SARA_DOCUMENTS_ROBOBANKPORTFOLIO_INC_ACCOUNTLINK_HPP_
+#define _HOME_SARA_DOCUMENTS_ROBOBANKPORTFOLIO_INC_ACCOUNTLINK_HPP_
+
+/*************************** include part ****************************** */
+#include <cstdint>
+
+#include "../Inc/BalanceVersion.hpp"
+
+class VelocityTracker;
+///////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/************************************ Class Part
+ * ************************************* */
+/**
+ * @class: IBalanceListener
+ * @brief: Receives every balance change of the accounts it is linked to.
+ *
+ * Callbacks run on the thread that changed the balance, possibly on several
+ * threads at once for different accounts, so implementations must be
+ * thread-safe.
+ *
+ */
+class IBalanceListener {
+ public:
+  virtual ~IBalanceListener();
+
+  /**
+   * @brief           : Called after an account balance changed.
+   * @param handle    : Handle of the account inside its Portfolio.
+   * @param old_cents : Balance before the change.
+   * @param new_cents : Balance after the change.
+   * @param timestamp : Timestamp of the transaction that caused it.
+   */
+  virtual void OnBalanceChange(uint32_t handle, int64_t old_cents,
+                               int64_t new_cents, int64_t timestamp) = 0;
+};
+
+/**
+ * @struct: AccountLink
+ * @brief : Everything an account needs to know about its owning Portfolio.
+ *
+ */
+struct AccountLink {
+  const EpochClock *clock;  ///< Epoch source for balance versions
+
+  IBalanceListener *listener;  ///< Notified of every balance change
+
+  uint32_t handle;  ///< Position of the account in the Portfolio
+
+  VelocityTracker *velocity;  ///< Counts audit records; nullptr if disabled
+};
+
+#endif  // _HOME_SARA_DOCUMENTS_ROBOBANKPORTFOLIO_INC_ACCOUNTLINK_HPP_
@@ -0,0 +1,91 @@
+// Copyright 2025 Sara Saad
+
+/**
+ * @file : AsyncPortfolio.hpp
+ * @brief: Awaitable (C++20 coroutine) front end for a Portfolio.
+ *
+ * AsyncPortfolio lets a coroutine-based service keep thousands of client
+ * requests in flight over a handful of threads. Mutating operations are
+ * queued on a Strand, so they run one at a time on the pool without a lock
+ * and without a thread per request. TotalExposureAsync() reads a lock-free
+ * snapshot directly on the pool, so it never waits behind writers. When an
+ * operation completes, the awaiting coroutine resumes on a pool worker, never
+ * on the strand.
+ *
+ */
+#ifndef _HOME_SARA_DOCUMENTS_ROBOBANKPORTFOLIO_INC_ASYNCPORTFOLIO_HPP_
+#define _HOME_SARA_DOCUMENTS_ROBOBANKPORTFOLIO_INC_ASYNCPORTFOLIO_HPP_
+
+/*************************** include part ****************************** */
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+#include "../Inc/Portfolio.hpp"
+#include "../Inc/Task.hpp"
+#include "../Inc/ThreadPool.hpp"
+///////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/************************************ Class Part
+ * ************************************* */
+/**
+ * @class: AsyncPortfolio
+ * @brief: Coroutine API over a Portfolio, backed by a ThreadPool.
+ *
+ * While an AsyncPortfolio is in use, the wrapped Portfolio must only be
+ * mutated through it.
+ *
+ */
+class AsyncPortfolio {
+ public:
+  /**
+   * @brief: Durable sink for journal flushes. It is called on a pool worker
+   * with the drained records and returns once they are durable.
+   */
+  using JournalSink = std::function<void(const std::vector<TxRecord> &)>;
+
+  /**
+   * @brief          : Wrap a portfolio.
+   * @param portfolio: The portfolio to drive; it must outlive this object.
+   * @param pool     : The pool the operations run on.
+   * @param sink     : Where FlushJournalAsync() writes the batch audit.
+   */
+  AsyncPortfolio(Portfolio *portfolio, ThreadPool *pool, JournalSink sink);
+
+  /**
+   * @brief    : Awaitable Portfolio::ApplyAll().
+   * @param txs: Transactions to apply; moved into the coroutine frame.
+   */
+  Task<void> ApplyAllAsync(std::vector<TxRecord> txs);
+
+  /**
+   * @brief    : Awaitable Portfolio::Transfer().
+   * @return   : Task<bool> Resolves to the result of the transfer.
+   */
+  Task<bool> TransferAsync(TransferRecord txr);
+
+  /**
+   * @brief : Awaitable Portfolio::TotalExposure(), read off the strand.
+   */
+  Task<int64_t> TotalExposureAsync();
+
+  /**
+   * @brief : Drain the batch audit and wait until the sink made it durable.
+   * @return: Task<size_t> Resolves to the number of records flushed.
+   *
+   * @details:
+   * Only the drain runs on the strand; the sink write runs on a pool worker,
+   * so ingestion continues while the flush is in progress.
+   *
+   */
+  Task<size_t> FlushJournalAsync();
+
+ private:
+  Portfolio *portfolio_;  ///< The wrapped book
+  ThreadPool *pool_;      ///< Workers for every operation
+  Strand writer_;         ///< Serializes the mutating operations
+  JournalSink sink_;      ///< Destination of journal flushes
+};
+
+#endif  // _HOME_SARA_DOCUMENTS_ROBOBANKPORTFOLIO_INC_ASYNCPORTFOLIO_HPP_
@@ -0,0 +1,162 @@
+// Copyright 2025 Sara Saad
+
+/**
+ * @file : AuditArchive.hpp
+ * @brief: Compressed columnar files of audit history, for analytics export.
+ *
+ * An AuditArchiveWriter appends the audit trails of many accounts to one
+ * file as row groups of up to group_rows records. Each row group stores every
+ * field as its own column, encoded for what it holds:
+ *   accounts   the distinct account IDs of the group (dictionary) and the run
+ *              of consecutive rows of each (audit trails are contiguous)
+ *   kinds      3 bits per row, bit-packed
+ *   timestamps zigzag varint deltas from the previous row
+ *   amounts    zigzag varints
+ *   notes      the distinct notes of the group (dictionary) and one varint
+ *              id per row, 0 for no note
+ *   keys       the rows with a non-zero idempotency key, as varint pairs
+ *              (row gap, key)
+ * Portfolio::ExportAudit() runs one writer per partition of the book on the
+ * thread pool. An AuditArchiveReader decodes the file one row group at a
+ * time straight into column vectors.
+ *
+ * File layout (host byte order, both ends are this library):
+ *   "RBAUDIT1"
+ *   per group: u32 rows, u32 byte size of each of the 6 columns, columns
+ *   u32 0 (end)
+ *
+ */
+#ifndef _HOME_SARA_DOCUMENTS_ROBOBANKPORTFOLIO_INC_AUDITARCHIVE_HPP_
+#define _HOME_SARA_DOCUMENTS_ROBOBANKPORTFOLIO_INC_AUDITARCHIVE_HPP_
+
+/*************************** include part ****************************** */
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "../Inc/Types.hpp"
+///////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/************************************ Class Part
+ * ************************************* */
+/**
+ * @struct: AuditColumns
+ * @brief : One decoded row group.
+ *
+ */
+struct AuditColumns {
+  std::vector<std::string> accounts;   ///< Account of each run, in order
+  std::vector<uint32_t> account_rows;  ///< Rows in each run
+  std::vector<TxKind> kinds;           ///< Per row
+  std::vector<int64_t> timestamps;     ///< Per row
+  std::vector<int64_t> amounts;        ///< Per row, in cents
+  std::vector<std::string> notes;      ///< Note dictionary of the group
+  std::vector<uint32_t> note_ids;      ///< Per row: 0 none, else notes[id - 1]
+  std::vector<uint64_t> idempotency_keys;  ///< Per row, 0 for none
+};
+
+/**
+ * @class: AuditArchiveWriter
+ * @brief: Encodes audit trails into one archive file.
+ *
+ */
+class AuditArchiveWriter {
+ public:
+  static constexpr size_t kDefaultGroupRows = 65536;  ///< Rows per group
+
+  /**
+   * @brief           : Start an archive; the file header is written at once.
+   * @param file      : Open output file; not closed by the writer.
+   * @param group_rows: Rows per row group (at least 1024 are used).
+   */
+  AuditArchiveWriter(FILE *file, size_t group_rows);
+
+  /**
+   * @brief      : Append the audit trail of one account.
+   * @param id   : The account ID.
+   * @param audit: Its records, oldest first; account_id is not stored.
+   */
+  void Add(const std::string &id, const std::vector<TxRecord> &audit);
+
+  /**
+   * @brief : Write the last row group and the end marker.
+   * @return: bool False if any write failed.
+   */
+  bool Finish();
+
+  size_t Rows() const;     ///< Records written
+  uint64_t Bytes() const;  ///< Bytes handed to the file
+
+ private:
+  static constexpr size_t kColumns = 6;
+
+  FILE *file_;        ///< Destination
+  size_t group_rows_;  ///< Rows per group
+  size_t rows_;        ///< Rows in the open group
+  size_t total_rows_;  ///< Rows written in closed groups
+  uint64_t bytes_;     ///< Bytes written so far
+  bool ok_;            ///< No write has failed
+
+  // Columns of the open group.
+  std::vector<uint8_t> columns_[kColumns];
+  uint32_t run_rows_;       ///< Rows of the current account run
+  uint64_t kind_bits_;      ///< Kind bits not yet flushed to the column
+  unsigned kind_nbits_;     ///< Valid bits in kind_bits_
+  int64_t last_ts_;         ///< Previous timestamp of the group
+  size_t last_key_row_;     ///< Row of the previous idempotency key
+  uint64_t keyed_rows_;     ///< Rows with an idempotency key
+  std::vector<std::string> account_dict_;  ///< Accounts of the group
+  std::vector<uint32_t> account_runs_;     ///< Rows per account
+  std::vector<std::string> note_dict_;     ///< Notes of the group
+  std::unordered_map<std::string, uint32_t> note_ids_;  ///< Note to id
+  std::unordered_map<const char *, uint32_t> note_ptrs_;  ///< Fast path
+
+  uint32_t NoteId(const char *note);
+  void CloseRun();
+  void FlushGroup();
+  void Write(const void *data, size_t n);
+};
+
+/**
+ * @class: AuditArchiveReader
+ * @brief: Decodes an archive file row group by row group.
+ *
+ */
+class AuditArchiveReader {
+ public:
+  /**
+   * @brief     : Open an archive; the file header is checked at once.
+   * @param file: Open input file; not closed by the reader.
+   */
+  explicit AuditArchiveReader(FILE *file);
+
+  /**
+   * @brief        : Decode the next row group.
+   * @param columns: Receives it; its vectors are reused.
+   * @return       : bool False at the end of the archive or on an error;
+   * Ok() tells the two apart.
+   */
+  bool Next(AuditColumns *columns);
+
+  bool Ok() const;  ///< No malformed or truncated input so far
+
+  /**
+   * @brief        : Rebuild the records of a decoded group.
+   * @param columns: The group; notes point into it, so it must outlive the
+   * records.
+   * @param records: Receives one record per row, account_id filled in.
+   */
+  static void ToRecords(const AuditColumns &columns,
+                        std::vector<TxRecord> *records);
+
+ private:
+  FILE *file_;                  ///< Source
+  std::vector<uint8_t> buffer_;  ///< Columns of the current group
+  bool ok_;                     ///< No error so far
+  bool done_;                   ///< End marker seen
+};
+
+#endif  // _HOME_SARA_DOCUMENTS_ROBOBANKPORTFOLIO_INC_AUDITARCHIVE_HPP_
@@ -0,0 +1,211 @@
+// Copyright 2025 Sara Saad
+
+/**
+ * @file : BalanceHistory.hpp
+ * @brief: Time-partitioned store of every balance change, for as-of queries.
+ *
+ * A Portfolio with history enabled forwards each balance change here. Recent
+ * changes are kept per account in an append-only tail. Once time has moved
+ * past the end of a segment (a fixed span of seconds), its changes are sealed
+ * into an immutable, compact Segment: per account, a run of varint-encoded
+ * (time offset, balance delta) pairs, with a checkpoint (absolute balance and
+ * byte position) every kCheckpointEvery changes, plus the book-wide exposure
+ * at every distinct change time. A point query is a binary search for the
+ * segment, for the account and for the checkpoint, followed by the decoding
+ * of at most kCheckpointEvery changes; nothing is replayed from the
+ * beginning. Book exposure after the sealed horizon comes from a time-ordered
+ * log of the unsealed changes, folded in lazily from the accounts changed
+ * since the last exposure query.
+ *
+ */
+#ifndef _HOME_SARA_DOCUMENTS_ROBOBANKPORTFOLIO_INC_BALANCEHISTORY_HPP_
+#define _HOME_SARA_DOCUMENTS_ROBOBANKPORTFOLIO_INC_BALANCEHISTORY_HPP_
+
+/*************************** include part ****************************** */
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+#include "../Inc/Types.hpp"
+///////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/************************************ Class Part
+ * ************************************* */
+/**
+ * @class: BalanceHistory
+ * @brief: Checkpoints plus delta log of every account, queryable as of any
+ * time.
+ *
+ * Record() may be called concurrently for different accounts. Every other
+ * method requires that no Record() runs at the same time; the const methods
+ * may run concurrently with each other.
+ *
+ * Changes of one account are kept in time order: a change stamped earlier
+ * than the account's previous change, or earlier than the sealed horizon, is
+ * recorded at that later time instead.
+ *
+ */
+class BalanceHistory {
+ public:
+  static constexpr uint32_t kCheckpointEvery = 16;  ///< Changes per checkpoint
+
+  /**
+   * @brief                : Create an empty history.
+   * @param segment_seconds: Span of one segment, in (0, 2^32) seconds.
+   */
+  explicit BalanceHistory(int64_t segment_seconds);
+
+  /**
+   * @brief              : Start tracking a new handle (handles are dense).
+   * @param handle       : Must equal the number of accounts tracked so far.
+   * @param opening_cents: The balance it has held since before any recorded
+   * time.
+   */
+  void AddAccount(uint32_t handle, int64_t opening_cents);
+
+  /**
+   * @brief      : Forget the accounts with handle >= count (batch rollback).
+   * Only accounts without recorded changes may be removed.
+   */
+  void Truncate(size_t count);
+
+  /**
+   * @brief          : Record one balance change.
+   * @param handle   : The account.
+   * @param new_cents: Balance after the change.
+   * @param ts       : Time of the change.
+   */
+  void Record(uint32_t handle, int64_t new_cents, int64_t ts);
+
+  /**
+   * @brief : Seal every segment that ended before the latest recorded time.
+   * Cheap when there is nothing to seal, so writers call it after each
+   * operation.
+   */
+  void Seal();
+
+  /**
+   * @brief       : Balance of an account at a point in time.
+   * @param handle: The account.
+   * @param ts    : Changes stamped at or before ts are included.
+   * @return      : int64_t The balance in cents.
+   */
+  int64_t BalanceAt(uint32_t handle, int64_t ts) const;
+
+  /**
+   * @brief       : Balance of an account over a time range.
+   * @param handle: The account.
+   * @param from  : Start of the range.
+   * @param to    : End of the range, inclusive.
+   * @param out   : Receives the balance at from, then one point per change in
+   * (from, to], in time order.
+   */
+  void BalancesBetween(uint32_t handle, int64_t from, int64_t to,
+                       std::vector<BalancePoint> *out) const;
+
+  /**
+   * @brief   : Sum of all balances at a point in time.
+   * @param ts: Changes stamped at or before ts are included.
+   * @return  : int64_t The exposure in cents.
+   *
+   * @details:
+   * Logarithmic in the number of changes. The first query after new changes
+   * first folds them into the unsealed exposure log: a sort of those changes,
+   * plus a merge with the log's later entries when they are stamped earlier
+   * than its end.
+   *
+   */
+  int64_t ExposureAt(int64_t ts) const;
+
+  size_t SealedSegments() const;  ///< Number of sealed segments
+  size_t SealedBytes() const;     ///< Memory held by sealed segments
+
+ private:
+  /**
+   * @struct: Change
+   * @brief : One unsealed change: its time and the balance after it.
+   */
+  struct Change {
+    int64_t ts;
+    int64_t balance;
+  };
+
+  /**
+   * @struct: ExposureStep
+   * @brief : Net change of the book from its opening up to and including ts.
+   */
+  struct ExposureStep {
+    int64_t ts;
+    int64_t delta;
+  };
+
+  /**
+   * @struct: Segment
+   * @brief : All changes in [start, start + segment_seconds_), sealed.
+   *
+   * Checkpoint groups are stored account after account; group g's changes
+   * are bytes [ck_pos[g], ck_pos[g + 1]) (bytes.size() for the last group),
+   * each one varint(time since the previous change of the group, the first
+   * measured from ck_offset[g]) followed by zigzag varint(balance delta).
+   *
+   */
+  struct Segment {
+    int64_t start;                    ///< First second covered
+    int64_t delta_open;               ///< Net change of the book before it
+    std::vector<uint32_t> handles;    ///< Accounts with changes, ascending
+    std::vector<uint32_t> first_ck;   ///< Per account + sentinel: first group
+    std::vector<uint32_t> ck_offset;  ///< Per group: time of its first change
+    std::vector<uint32_t> ck_pos;     ///< Per group: first byte
+    std::vector<int64_t> ck_balance;  ///< Per group: balance before it
+    std::vector<uint8_t> bytes;       ///< Encoded changes
+    std::vector<uint32_t> exp_offset;  ///< Distinct change times, ascending
+    std::vector<int64_t> exp_delta;    ///< Net change of the book up to each
+
+    size_t GroupEnd(size_t group) const;
+  };
+
+  int64_t segment_seconds_;              ///< Span of a segment
+  int64_t horizon_;                      ///< Everything before is sealed
+  std::atomic<int64_t> latest_ts_;       ///< Latest change time seen
+  std::vector<int64_t> opening_;         ///< Per handle: initial balance
+  std::vector<int64_t> settled_;         ///< Per handle: balance at horizon_
+  std::vector<std::vector<Change>> tail_;  ///< Per handle: unsealed changes
+  std::vector<std::vector<int64_t>> touched_;  ///< Per handle: segment starts
+  std::vector<Segment> segments_;        ///< Sealed, ascending by start
+  int64_t opening_exposure_;             ///< Sum of opening_
+  int64_t sealed_delta_;                 ///< Net change up to horizon_
+
+  mutable std::vector<uint8_t> dirty_;        ///< Per handle: not folded
+  mutable std::vector<uint32_t> dirty_list_;  ///< Handles with dirty_ set
+  mutable std::vector<uint32_t> folded_;      ///< Per handle: tail folded
+  mutable std::vector<ExposureStep> exposure_;  ///< Unsealed, ascending ts
+  std::mutex dirty_mutex_;         ///< Guards dirty_list_ in Record()
+  mutable std::mutex fold_mutex_;  ///< Serializes Fold() of readers
+
+  /**
+   * @brief: Balance of an account at offset t of a sealed segment.
+   */
+  static int64_t SegmentBalance(const Segment &seg, size_t run, int64_t t);
+
+  /**
+   * @brief: Index of the last segment with start <= ts, or -1.
+   */
+  ptrdiff_t SegmentAt(int64_t ts) const;
+
+  /**
+   * @brief: Move the tail changes of the dirty accounts into exposure_. The
+   * caller holds fold_mutex_ or runs alone.
+   */
+  void Fold() const;
+
+  /**
+   * @brief: Call emit(ts, balance) for every change of an account in a
+   * sealed segment, in time order.
+   */
+  template <typename Emit>
+  static void DecodeRun(const Segment &seg, size_t run, Emit emit);
+};
+
+#endif  // _HOME_SARA_DOCUMENTS_ROBOBANKPORTFOLIO_INC_BALANCEHISTORY_HPP_
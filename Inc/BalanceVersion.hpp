@@ -0,0 +1,159 @@
+// Copyright 2025 Sara Saad
+
+/**
+ * @file : BalanceVersion.hpp
+ * @brief: Multi-version balance storage for lock-free point-in-time reads.
+ *
+ * Reporting threads may read balances while ApplyAll() or Transfer() are
+ * running. Instead of a lock, every account keeps its latest balance plus the
+ * last balance of the previous epoch, guarded by a per-account seqlock, and
+ * the Portfolio advances a global EpochClock whenever a reader opens a
+ * snapshot. A reader of epoch S sees, for each account, the value it had at
+ * the end of epoch S. Writers never wait; they pay two atomic increments per
+ * Portfolio operation and a seqlock bump per balance change.
+ *
+ */
+#ifndef _HOME_SARA_DOCUMENTS_ROBOBANKPORTFOLIO_INC_BALANCEVERSION_HPP_
+#define _HOME_SARA_DOCUMENTS_ROBOBANKPORTFOLIO_INC_BALANCEVERSION_HPP_
+
+/*************************** include part ****************************** */
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+///////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/************************************ Class Part
+ * ************************************* */
+/**
+ * @class: EpochClock
+ * @brief: Global epoch shared by a Portfolio and all of its accounts.
+ *
+ * Writers register in the current epoch for the duration of one Portfolio
+ * operation (see WriteScope), so that both legs of a transfer carry the same
+ * epoch. OpenSnapshot() closes the current epoch and waits until every
+ * operation registered in it has finished; the writers themselves never wait.
+ * Snapshots are opened one at a time: while a reader drains epoch S the
+ * current epoch stays at S + 1, so new writers register under the other
+ * parity and cannot keep the reader waiting.
+ *
+ */
+class EpochClock {
+ public:
+  /**
+   * @class: WriteScope
+   * @brief: RAII registration of the calling thread as a writer.
+   * Nested scopes on the same clock reuse the outer registration.
+   */
+  class WriteScope {
+   public:
+    explicit WriteScope(EpochClock *clock);
+    ~WriteScope();
+    WriteScope(const WriteScope &) = delete;
+    WriteScope &operator=(const WriteScope &) = delete;
+
+   private:
+    EpochClock *clock_;  ///< nullptr when nested inside another scope
+    uint64_t epoch_;     ///< Epoch this scope is registered in
+    const EpochClock *outer_clock_;  ///< Scope of another clock, if any
+    uint64_t outer_epoch_;           ///< Epoch of that outer scope
+  };
+
+  /**
+   * @brief : Epoch that a balance change made now must be stamped with.
+   * @return: uint64_t The epoch of the caller's WriteScope on this clock, or
+   * the current epoch when the caller is not inside one.
+   */
+  uint64_t WriteEpoch() const;
+
+  /**
+   * @brief : Close the current epoch and return it as a snapshot epoch.
+   * @return: uint64_t The snapshot epoch S. Every write stamped with an epoch
+   * <= S has completed when this returns. Concurrent callers are
+   * serialized.
+   */
+  uint64_t OpenSnapshot();
+
+ private:
+  std::atomic<uint64_t> epoch_{1};           ///< Current write epoch
+  std::atomic<int64_t> active_[2] = {0, 0};  ///< Writers per epoch parity
+  std::mutex snapshot_mutex_;  ///< Held while a snapshot epoch drains
+
+  /// WriteScope open on the calling thread, and the epoch it registered in.
+  static inline thread_local const EpochClock *t_write_clock = nullptr;
+  static inline thread_local uint64_t t_write_epoch = 0;
+};
+
+/**
+ * @class: VersionedBalance
+ * @brief: An account balance with one retained previous version.
+ *
+ * Only one thread may write a given account at a time; any number of threads
+ * may read it concurrently.
+ *
+ */
+class VersionedBalance {
+ public:
+  explicit VersionedBalance(int64_t cents);
+
+  /**
+   * @brief : Latest balance in cents (a single atomic load).
+   */
+  int64_t Load() const;
+
+  /**
+   * @brief      : Publish a new balance.
+   * @param cents: The new balance in cents.
+   * @param epoch: The epoch the change belongs to.
+   */
+  void Store(int64_t cents, uint64_t epoch);
+
+  /**
+   * @brief      : Read the balance as of the end of a snapshot epoch.
+   * @param epoch: The snapshot epoch.
+   * @param cents: Receives the balance.
+   * @return     : bool False if that version has already been overwritten
+   * (the caller should retry with a newer snapshot).
+   */
+  bool LoadAsOf(uint64_t epoch, int64_t *cents) const;
+
+ private:
+  std::atomic<uint32_t> seq_{0};          ///< Seqlock, odd while writing
+  std::atomic<int64_t> current_;          ///< Latest balance
+  std::atomic<uint64_t> current_epoch_;   ///< Epoch of current_
+  std::atomic<int64_t> previous_;         ///< Last balance of an older epoch
+  std::atomic<uint64_t> previous_epoch_;  ///< Epoch of previous_
+};
+
+/************************************ Inline Part
+ * ************************************* */
+// Called for every balance change, so kept inlinable.
+
+inline uint64_t EpochClock::WriteEpoch() const {
+  if (t_write_clock == this) {
+    return (t_write_epoch);
+  }
+  return (epoch_.load(std::memory_order_acquire));
+}
+
+inline int64_t VersionedBalance::Load() const {
+  return (current_.load(std::memory_order_acquire));
+}
+
+inline void VersionedBalance::Store(int64_t cents, uint64_t epoch) {
+  uint32_t seq = seq_.load(std::memory_order_relaxed);
+  seq_.store(seq + 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+
+  uint64_t current_epoch = current_epoch_.load(std::memory_order_relaxed);
+  if (epoch != current_epoch) {
+    previous_.store(current_.load(std::memory_order_relaxed),
+                    std::memory_order_relaxed);
+    previous_epoch_.store(current_epoch, std::memory_order_relaxed);
+    current_epoch_.store(epoch, std::memory_order_relaxed);
+  }
+  current_.store(cents, std::memory_order_release);
+
+  seq_.store(seq + 2, std::memory_order_release);
+}
+
+#endif  // _HOME_SARA_DOCUMENTS_ROBOBANKPORTFOLIO_INC_BALANCEVERSION_HPP_
@@ -0,0 +1,101 @@
+// Copyright 2025 Sara Saad
+
+/**
+ * @file : BookChecksum.hpp
+ * @brief: Incrementally maintained, order-independent checksum of a book.
+ *
+ * Every account contributes a hash of (account ID, balance) to one of
+ * kShards leaf sums, chosen by its ID hash. Sums are order-independent, so
+ * two replicas that hold the same balances agree regardless of insertion
+ * order or of which thread applied what, and a balance change updates a
+ * single leaf with one atomic add. A Merkle tree built over the leaves lets
+ * two replicas compare their roots in O(1) and descend to the divergent
+ * shards in O(log kShards) steps per shard.
+ *
+ */
+#ifndef _HOME_SARA_DOCUMENTS_ROBOBANKPORTFOLIO_INC_BOOKCHECKSUM_HPP_
+#define _HOME_SARA_DOCUMENTS_ROBOBANKPORTFOLIO_INC_BOOKCHECKSUM_HPP_
+
+/*************************** include part ****************************** */
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+///////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/************************************ Class Part
+ * ************************************* */
+/**
+ * @class: BookDigest
+ * @brief: Merkle tree over the shard sums of a book at one point in time.
+ *
+ * Nodes use heap layout: node 1 is the root, node k has children 2k and
+ * 2k + 1, and leaf i is node kShards + i.
+ *
+ */
+class BookDigest {
+ public:
+  static constexpr size_t kShards = 256;  ///< Leaves of the tree
+
+  /**
+   * @brief       : Build the tree over a set of shard sums.
+   * @param leaves: The kShards leaf sums.
+   */
+  explicit BookDigest(const std::array<uint64_t, kShards> &leaves);
+
+  uint64_t Root() const;  ///< Checksum of the whole book
+
+  /**
+   * @brief       : One node of the tree, for remote step-by-step descent.
+   * @param index : Heap index in [1, 2 * kShards).
+   */
+  uint64_t Node(size_t index) const;
+
+  /**
+   * @brief       : Find the shards whose sums differ from another digest.
+   * @param other : Digest of the other replica.
+   * @return      : std::vector<size_t> Divergent shard numbers, ascending.
+   */
+  std::vector<size_t> DivergentShards(const BookDigest &other) const;
+
+ private:
+  std::array<uint64_t, 2 * kShards> nodes_;  ///< nodes_[0] is unused
+};
+
+/**
+ * @class: BookChecksum
+ * @brief: Live shard sums, updated on every balance change.
+ *
+ * All updates are single relaxed atomic additions, so accounts in the same
+ * shard may be updated from different threads.
+ *
+ */
+class BookChecksum {
+ public:
+  BookChecksum();
+
+  /**
+   * @brief         : Shard an account belongs to.
+   * @param id_hash : AccountIndex::Hash() of the account ID.
+   */
+  static size_t ShardOf(uint64_t id_hash);
+
+  void Add(uint64_t id_hash, int64_t balance);     ///< Account joins the book
+  void Remove(uint64_t id_hash, int64_t balance);  ///< Account leaves the book
+
+  /**
+   * @brief          : Replace the contribution of one account.
+   * @param id_hash  : AccountIndex::Hash() of the account ID.
+   * @param old_cents: Balance before the change.
+   * @param new_cents: Balance after the change.
+   */
+  void Update(uint64_t id_hash, int64_t old_cents, int64_t new_cents);
+
+  BookDigest Digest() const;  ///< Build the Merkle tree over current sums
+
+ private:
+  std::array<std::atomic<uint64_t>, BookDigest::kShards> leaves_;
+};
+
+#endif  // _HOME_SARA_DOCUMENTS_ROBOBANKPORTFOLIO_INC_BOOKCHECKSUM_HPP_
@@ -32,11 +32,21 @@ instantiated.
 balance.
 *
 */
+#include <cmath>
 #include <cstdint>
 #include <string>
 
 class Calculator {
  public:
+  /**
+   * @brief: Day-count convention used everywhere interest is computed.
+   * Interest runs on actual elapsed days over a 365-day year; a posting that
+   * does not say how many days it covers covers kInterestPeriodDays.
+   */
+  static constexpr int32_t kDayCountBasis = 365;
+  static constexpr int32_t kInterestPeriodDays = 30;
+  static constexpr int64_t kSecondsPerDay = 86400;
+
   /**
    * @brief: Calculate the new balance after a deposit.
    * @param balance: The current balance in cents.
@@ -102,7 +112,9 @@ class Calculator {
   * The resulting interest is added to the balance, and the total is returned as
   cents.
   * All values are handled in integer arithmetic (cents), so precision is
-  limited accordingly.
+  limited accordingly. The apr is rounded to 1e-9 and the interest is then
+  computed exactly and truncated toward zero, so the result does not depend
+  on floating-point evaluation order.
   * @example:
   // For 10000 cents (100.00 USD), 5% APR, 30 days, 360 day basis:
   // Interest = 10000 * (0.05 * 30 / 360) = 10000 * 0.0041667 ≈ 41.67 cents
@@ -114,4 +126,38 @@ class Calculator {
                             int32_t basis);
 };
 
+/**
+ * @struct: InlineCalculator
+ * @brief : The arithmetic behind Calculator, defined in the header.
+ *
+ * Calculator's methods are out-of-line and simply forward here. Hot paths
+ * (see HotPath.hpp) call InlineCalculator directly so that the compiler can
+ * fold the arithmetic into the caller without link-time optimization.
+ *
+ */
+struct InlineCalculator {
+  static constexpr int64_t Deposit(int64_t balance, int64_t amount) {
+    return (balance + amount);
+  }
+
+  static constexpr int64_t Withdraw(int64_t balance, int64_t amount) {
+    return (balance - amount);
+  }
+
+  static constexpr int64_t Fee(int64_t balance, int64_t fee_amount) {
+    return (balance - fee_amount);
+  }
+
+  static int64_t Interest(int64_t balance, double apr, int32_t days,
+                          int32_t basis) {
+    // The rate is rounded once to nano-units and the rest is exact integer
+    // math, so replays produce byte-identical interest on any platform.
+    __int128 rate_nano = std::llround(apr * 1e9);
+    __int128 numerator = static_cast<__int128>(balance) * rate_nano * days;
+    __int128 denominator = static_cast<__int128>(basis) * 1000000000;
+
+    return (static_cast<int64_t>(numerator / denominator));
+  }
+};
+
 #endif  // _HOME_SARA_DOCUMENTS_ROBOBANKPORTFOLIO_INC_CALCULATOR_HPP_
@@ -0,0 +1,191 @@
+// Copyright 2025 Sara Saad
+
+/**
+ * @file : ColdStore.hpp
+ * @brief: Compact encoded form of dormant checking and saving accounts.
+ *
+ * A resident account costs its object (vtable pointer, id string, settings,
+ * versioned balance, accrual state) plus an audit trail of up to 1000
+ * TxRecords of 72 bytes each. Portfolio::DemoteIdle() freezes accounts with no
+ * recent activity into one byte blob each and drops the object; the next
+ * transaction or GetAccount() thaws it back, so tiering is invisible to the
+ * callers.
+ *
+ * Blob layout:
+ *   u8 type, u8 accrual flags, i32 fee cycle days, i64 interest anchor,
+ *   i64 fee anchor, u16 audit count, i64 last record ts
+ *                                       (fixed, so accrual can patch it)
+ *   f64 apr, zigzag fee, varint id_len, id
+ *   then per audit record:
+ *     u8 kind, zigzag amount, zigzag ts delta, varint note id,
+ *     varint account_id len, account_id, varint idempotency key
+ * Notes are kept as pointers (the audit's own contract), numbered in a
+ * dictionary shared by every blob, so a record usually takes 6 to 10 bytes.
+ * Accrue() posts lazy interest and fees of a frozen account by appending to
+ * its blob, so a book-wide accrual does not thaw the dormant accounts.
+ *
+ * The balance of a cold account is kept outside the blob, in a column tagged
+ * with the epoch of its last accrual, so snapshot readers can read it while a
+ * writer accrues or thaws the account.
+ *
+ */
+#ifndef _HOME_SARA_DOCUMENTS_ROBOBANKPORTFOLIO_INC_COLDSTORE_HPP_
+#define _HOME_SARA_DOCUMENTS_ROBOBANKPORTFOLIO_INC_COLDSTORE_HPP_
+
+/*************************** include part ****************************** */
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "../Inc/IAccount.hpp"
+#include "../Inc/Types.hpp"
+///////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/************************************ Class Part
+ * ************************************* */
+/**
+ * @class: ColdStore
+ * @brief: Frozen accounts of a Portfolio, indexed by handle.
+ *
+ * Freeze() may run for different handles on several threads at once, and so
+ * may Accrue(), Copy() and promotions; the two groups must not overlap.
+ * Accrue(), Copy() and a promotion (Claim(), Thaw(), Release()) of the same
+ * handle serialize on its cold flag, so const readers of a Portfolio may
+ * promote an account while others read it.
+ *
+ */
+class ColdStore {
+ public:
+  ColdStore();
+
+  /**
+   * @brief      : Track count handles; new handles start resident.
+   * @param count: The number of handles of the Portfolio.
+   */
+  void Resize(size_t count);
+
+  void Reserve(size_t count);  ///< Pre-size the per-handle columns
+
+  /**
+   * @brief       : Whether an account is frozen. Safe to call concurrently
+   * with Thaw() and Release() of the same handle.
+   */
+  bool IsCold(uint32_t handle) const;
+
+  /**
+   * @brief       : Balance of a frozen account.
+   */
+  int64_t Balance(uint32_t handle) const;
+
+  /**
+   * @brief       : Balance of a frozen account as of the end of a snapshot
+   * epoch, as VersionedBalance::LoadAsOf().
+   * @return      : bool False if it was accrued after that epoch (the caller
+   * should retry with a newer snapshot).
+   */
+  bool BalanceAsOf(uint32_t handle, uint64_t epoch, int64_t *cents) const;
+
+  /**
+   * @brief       : Encode a checking or saving account (its exact type, not a
+   * subclass) and mark the handle cold. The caller then drops the object.
+   * @param handle: The account's handle.
+   * @param acc   : The account.
+   */
+  void Freeze(uint32_t handle, const BaseAccount &acc);
+
+  /**
+   * @brief       : Take a frozen handle for a promotion, waiting while another
+   * thread holds it.
+   * @return      : bool False once the handle is resident; its account is
+   * then visible to the caller.
+   */
+  bool Claim(uint32_t handle) const;
+
+  /**
+   * @brief       : Rebuild a frozen account; the handle stays cold. The
+   * caller holds the handle (see Claim()).
+   * @return      : std::unique_ptr<IAccount> An unattached account equal to
+   * the one frozen, including its audit trail and accrual state.
+   */
+  std::unique_ptr<IAccount> Thaw(uint32_t handle) const;
+
+  /**
+   * @brief       : Thaw() a frozen account for reading, holding the handle
+   * meanwhile.
+   * @return      : std::unique_ptr<IAccount> The account, or nullptr if the
+   * handle is resident.
+   */
+  std::unique_ptr<IAccount> Copy(uint32_t handle) const;
+
+  /**
+   * @brief       : Drop the blob of a handle and mark it resident.
+   */
+  void Release(uint32_t handle);
+
+  /**
+   * @brief       : Post the lazy interest and fees of a frozen account up to
+   * ts, as IAccount::AccrueTo() would, without thawing it: the balance column,
+   * the anchors and the audit trail in the blob are updated in place, and
+   * every change is reported through the link.
+   * @param link  : The handle, and the clock, listener and velocity tracker
+   * the account would be attached to.
+   * @param ts    : The time to accrue to.
+   * @return      : bool False if the handle is resident; nothing was done.
+   */
+  bool Accrue(const AccountLink &link, int64_t ts);
+
+  /**
+   * @brief       : Charge a fee to a frozen account, as IAccount::ChargeFee()
+   * would, without thawing it: Accrue() to ts, then post the fee.
+   * @param link  : As Accrue().
+   * @param fee_cents: The fee in cents.
+   * @param ts    : Timestamp of the posting.
+   * @param note  : Note of the posting.
+   * @param id    : Receives the account's ID.
+   * @return      : bool False if the handle is resident; nothing was done.
+   */
+  bool ChargeFee(const AccountLink &link, int64_t fee_cents, int64_t ts,
+                 const char *note, std::string *id);
+
+  /**
+   * @brief          : Change the accrual settings of a frozen account, as
+   * IAccount::SetAccrual() would.
+   */
+  void SetAccrual(uint32_t handle, const AccrualPolicy &policy,
+                  int64_t anchor_ts);
+
+  size_t ColdCount() const;  ///< Accounts frozen
+  size_t Bytes() const;      ///< Blob and note dictionary bytes
+
+ private:
+  std::vector<uint8_t> cold_;      ///< 1 if frozen, 2 if held; atomic_ref
+  std::vector<int64_t> balance_;   ///< Balance while frozen; atomic_ref
+  std::vector<uint64_t> epoch_;    ///< Epoch of the last accrual, 0 if none
+  std::vector<std::unique_ptr<uint8_t[]>> blobs_;  ///< Encoded accounts
+  std::vector<uint32_t> sizes_;    ///< Blob length per handle
+  std::atomic<size_t> cold_count_;
+  std::atomic<size_t> blob_bytes_;
+
+  std::vector<const char *> notes_;  ///< Note id to pointer; 0 is nullptr
+  std::unordered_map<const char *, uint32_t> note_ids_;
+  /// Guards notes_ and note_ids_: shared while decoding records, exclusive
+  /// while NoteId() adds a note (which may reallocate notes_).
+  mutable std::shared_mutex note_mutex_;
+
+  uint32_t NoteId(const char *note);
+  bool Post(const AccountLink &link, int64_t ts, const TxRecord *fee,
+            std::string *id);
+  void Unclaim(uint32_t handle) const;
+  void PutRecords(std::vector<uint8_t> *out, const TxRecord *begin,
+                  const TxRecord *end, int64_t *prev_ts);
+  /// Decode one record; the caller holds note_mutex_ shared.
+  TxRecord GetRecord(const uint8_t **p, int64_t *ts) const;
+};
+
+#endif  // _HOME_SARA_DOCUMENTS_ROBOBANKPORTFOLIO_INC_COLDSTORE_HPP_
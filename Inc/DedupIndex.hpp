@@ -0,0 +1,112 @@
+// Copyright 2025 Sara Saad
+
+/**
+ * @file : DedupIndex.hpp
+ * @brief: Time-windowed set of idempotency keys for duplicate rejection.
+ *
+ * Keys are remembered in two generations, each covering window_seconds of
+ * transaction time: the current one and the one before it, so a key is
+ * retained for at least one and at most two windows after it was first seen.
+ * When time passes the end of the current window the older generation is
+ * cleared in place and reused, so the steady state allocates nothing. A
+ * record stamped more than one window past the current generation advances
+ * it by one window only and is counted in DedupStats::clamped_jumps: a single
+ * mis-stamped record must not forget every retained key at once. Time that
+ * really moved on catches up by one window per record.
+ *
+ * Each generation is an exact open-addressing hash set of the keys plus a
+ * blocked Bloom filter (all probe bits of a key in one 64-byte block). A new
+ * key is inserted into the current set, which is also the duplicate check
+ * against the current window; the older window's exact set is only probed
+ * when its filter reports a possible match, so a fresh key costs one probe
+ * sequence and one cache line.
+ *
+ */
+#ifndef _HOME_SARA_DOCUMENTS_ROBOBANKPORTFOLIO_INC_DEDUPINDEX_HPP_
+#define _HOME_SARA_DOCUMENTS_ROBOBANKPORTFOLIO_INC_DEDUPINDEX_HPP_
+
+/*************************** include part ****************************** */
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "../Inc/Types.hpp"
+///////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/************************************ Class Part
+ * ************************************* */
+/**
+ * @class: DedupIndex
+ * @brief: Admits each idempotency key once per retention window.
+ *
+ * Not thread-safe; the Portfolio calls it from the sequential part of its
+ * write operations.
+ *
+ */
+class DedupIndex {
+ public:
+  static constexpr int64_t kDefaultWindowSeconds = 86400;
+  static constexpr size_t kDefaultExpectedKeys = 1 << 16;
+
+  /**
+   * @brief              : Create an empty index; memory is allocated on the
+   * first key.
+   * @param window_seconds: Span of one generation, > 0.
+   * @param expected_keys : Keys per window the filter is sized for; more are
+   * accepted at a higher false-positive rate.
+   */
+  DedupIndex(int64_t window_seconds = kDefaultWindowSeconds,
+             size_t expected_keys = kDefaultExpectedKeys);
+
+  /**
+   * @brief    : Check a key and remember it.
+   * @param key: Idempotency key, not 0.
+   * @param ts : Transaction time, used to advance the window.
+   * @return   : bool True if the key was not seen within the retention
+   * window (the record should be applied), false for a duplicate.
+   */
+  bool Admit(uint64_t key, int64_t ts);
+
+  /**
+   * @brief    : Forget an admitted key, e.g. because the operation it was
+   * admitted for failed and may be retried.
+   * @param key: Idempotency key; nothing happens if it is not remembered.
+   */
+  void Forget(uint64_t key);
+
+  DedupStats Stats() const;  ///< Counters and memory use
+
+ private:
+  /**
+   * @struct: Generation
+   * @brief : Keys first seen in one window.
+   */
+  struct Generation {
+    int64_t start = 0;              ///< First second of the window
+    size_t size = 0;                ///< Keys stored
+    std::vector<uint64_t> slots;    ///< Open addressing, 0 = empty
+    std::vector<uint64_t> filter;   ///< Blocked Bloom filter, 8 words/block
+
+    bool MayContain(uint64_t hash) const;
+    bool Contains(uint64_t key, uint64_t hash) const;
+    bool Insert(uint64_t key, uint64_t hash);  ///< False if already present
+    bool Erase(uint64_t key, uint64_t hash);   ///< False if not present
+    void Grow();
+    void Clear(int64_t new_start);
+  };
+
+  int64_t window_seconds_;  ///< Span of a generation
+  size_t expected_keys_;    ///< Filter sizing
+  bool started_;            ///< A key has been admitted
+  Generation current_;      ///< Window containing the latest time
+  Generation previous_;     ///< The window before it
+  uint64_t admitted_;       ///< Counter for Stats()
+  uint64_t duplicates_;     ///< Counter for Stats()
+  uint64_t filter_skips_;   ///< Counter for Stats()
+  uint64_t clamped_jumps_;  ///< Counter for Stats()
+
+  void Start(int64_t ts);
+  void Advance(int64_t ts);
+};
+
+#endif  // _HOME_SARA_DOCUMENTS_ROBOBANKPORTFOLIO_INC_DEDUPINDEX_HPP_
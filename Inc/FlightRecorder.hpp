@@ -0,0 +1,288 @@
+// Copyright 2025 Sara Saad
+
+/**
+ * @file : FlightRecorder.hpp
+ * @brief: Always-on trace of what the Portfolio did last, per thread.
+ *
+ * Every thread that touches the apply path records compact 24-byte events
+ * (operation, phase, account handle, amount, detail, TSC timestamp) into a
+ * ring of its own: no lock, no shared cache line, one timestamp read and one
+ * release store per event. Rings are allocated once per thread (and reused
+ * by later threads when their owner exits), so the recorder can stay enabled
+ * under full load; only the last kRingEvents events of each thread are kept.
+ * A reused ring keeps its old events; the new owner starts with a KTHREAD
+ * event, and LoadTrace() splits the ring there.
+ *
+ * Dump() writes every ring to a file on demand; InstallCrashHandler() makes a
+ * fatal signal do the same before the process dies (the dump only uses
+ * async-signal-safe calls). LoadTrace() reads a dump back and TraceSpans()
+ * pairs begin/end events into timed operations; the robobank_trace tool
+ * prints both as a timeline and a latency table.
+ *
+ * Dump layout (host byte order):
+ *   "RBTRACE1", u64 start tsc, u64 start ns, u64 dump tsc, u64 dump ns
+ *   (the ns clock is CLOCK_MONOTONIC), u32 rings,
+ *   per ring: u32 ring index, u32 thread id, u32 events, TraceEvent[events]
+ *   oldest first.
+ *
+ */
+#ifndef _HOME_SARA_DOCUMENTS_ROBOBANKPORTFOLIO_INC_FLIGHTRECORDER_HPP_
+#define _HOME_SARA_DOCUMENTS_ROBOBANKPORTFOLIO_INC_FLIGHTRECORDER_HPP_
+
+/*************************** include part ****************************** */
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#else
+#include <time.h>
+#endif
+///////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/************************************ Types Part
+ * ************************************* */
+/**
+ * @enum : TraceOp
+ * @brief: The operation an event belongs to.
+ */
+enum class TraceOp : uint8_t {
+  KAPPLYALL = 0,      ///< Portfolio::ApplyAll(); amount = records
+  KAPPLYPARTITIONED,  ///< Portfolio::ApplyPartitioned(); amount = records
+  KAPPLYSHARD,        ///< One partition of it; handle = partition
+  KAPPLYTX,           ///< One record applied; detail = TxKind
+  KDUPLICATE,         ///< One record skipped as a repeated key
+  KTRANSFER,          ///< Portfolio::Transfer(); handle = source, end:
+                      ///< amount = destination, detail = 1 if applied
+  KSWEEPFEES,         ///< Portfolio::SweepFees(); amount on end = charged
+  KACCRUEALL,         ///< Portfolio::AccrueAll()
+  KDEMOTEIDLE,        ///< Portfolio::DemoteIdle(); amount on end = demoted
+  KPROMOTE,           ///< A cold account was promoted
+  KTHREAD,            ///< The ring passed to a new thread; handle = its
+                      ///< thread id, amount = the previous owner's
+};
+
+/**
+ * @enum : TracePhase
+ * @brief: Where in its operation an event was recorded.
+ */
+enum class TracePhase : uint8_t {
+  KBEGIN = 0,  ///< Start of a timed operation
+  KEND,        ///< End of the innermost open operation of the same kind
+  KPOINT,      ///< A single step
+};
+
+/**
+ * @struct: TraceEvent
+ * @brief : One recorded event, exactly as stored in rings and dumps.
+ */
+struct TraceEvent {
+  uint64_t tsc;      ///< Time stamp counter (ns on non-x86 targets)
+  int64_t amount;    ///< Amount in cents, or a count
+  uint32_t handle;   ///< Account handle (or partition)
+  TraceOp op;        ///< Operation
+  TracePhase phase;  ///< Phase
+  uint16_t detail;   ///< Operation-specific
+};
+static_assert(sizeof(TraceEvent) == 24, "TraceEvent is a fixed 24 bytes");
+
+/**
+ * @struct: TraceThread
+ * @brief : The events one owner of a ring left in a dump.
+ */
+struct TraceThread {
+  uint32_t ring;                   ///< Ring index
+  uint32_t thread_id;              ///< OS thread id of that owner
+  std::vector<TraceEvent> events;  ///< Oldest first
+};
+
+/**
+ * @struct: TraceDump
+ * @brief : A dump read back by LoadTrace().
+ */
+struct TraceDump {
+  double ticks_per_ns;               ///< TSC rate over the recorded period
+  uint64_t start_tsc;                ///< TSC when recording started
+  std::vector<TraceThread> threads;  ///< One per ring and owner
+};
+
+/**
+ * @struct: TraceSpan
+ * @brief : A begin/end pair, timed.
+ */
+struct TraceSpan {
+  TraceOp op;           ///< Operation
+  uint32_t thread_id;   ///< Thread it ran on
+  double begin_ns;      ///< Start, relative to TraceDump::start_tsc
+  double duration_ns;   ///< End minus start
+  uint32_t handle;      ///< From the begin event
+  int64_t amount;       ///< From the begin event
+  int64_t result;       ///< Amount of the end event
+  uint16_t detail;      ///< Detail of the end event
+};
+
+/************************************ Class Part
+ * ************************************* */
+/**
+ * @class: FlightRecorder
+ * @brief: The process-wide set of per-thread trace rings.
+ *
+ */
+class FlightRecorder {
+ public:
+  static constexpr size_t kRingEvents = 4096;  ///< Events kept per thread
+  static constexpr size_t kMaxRings = 256;     ///< Threads traced at once
+
+  /**
+   * @brief        : Turn recording on or off for every thread (on by
+   * default).
+   */
+  static void SetEnabled(bool enabled);
+  static bool Enabled();
+
+  /**
+   * @brief       : Record one event on the calling thread's ring. Does
+   * nothing when disabled or when kMaxRings threads already hold a ring.
+   */
+  static void Record(TraceOp op, TracePhase phase, uint32_t handle,
+                     int64_t amount, uint16_t detail);
+
+  /**
+   * @brief     : Write every ring to a file.
+   * @param path: The dump file, replaced if it exists.
+   * @return    : bool False if it could not be written.
+   *
+   * @details:
+   * Threads keep recording while the dump runs; a ring that wraps during the
+   * dump may show a few of its newest events in place of its oldest.
+   *
+   */
+  static bool Dump(const char *path);
+
+  /**
+   * @brief     : Dump to path when the process gets SIGSEGV, SIGBUS,
+   * SIGFPE, SIGILL or SIGABRT, then die of the signal as before.
+   * @param path: The dump file; at most 255 bytes.
+   * @return    : bool False if the path is too long or a handler could not
+   * be installed.
+   */
+  static bool InstallCrashHandler(const char *path);
+
+ private:
+  /**
+   * @struct: Ring
+   * @brief : Events of one thread; only its owner writes to it.
+   */
+  struct Ring {
+    std::atomic<uint64_t> head;      ///< Events ever recorded
+    std::atomic<bool> in_use;        ///< Held by a live thread
+    uint32_t index;                  ///< Position in rings_
+    uint32_t thread_id;              ///< OS thread id of the owner
+    TraceEvent events[kRingEvents];  ///< head % kRingEvents is next
+  };
+
+  static std::atomic<bool> enabled_;
+  static std::atomic<Ring *> rings_[kMaxRings];  ///< Never freed
+  static std::atomic<size_t> ring_count_;         ///< Rings allocated
+  static std::atomic<uint64_t> start_tsc_;        ///< First Attach()
+  static std::atomic<uint64_t> start_ns_;         ///< Same, CLOCK_MONOTONIC
+  static inline thread_local Ring *ring_ = nullptr;  ///< Calling thread's
+
+  /// Hands the calling thread's ring back when the thread exits.
+  struct Lease {
+    bool held = false;
+    ~Lease();
+  };
+  static thread_local Lease lease_;
+  static thread_local bool exiting_;  ///< Lease already released
+
+  static uint64_t Now();
+  static Ring *Attach();
+  static bool DumpTo(int fd);
+};
+
+/**
+ * @class: TraceScope
+ * @brief: Records the begin event of an operation now and its end event
+ * when the scope closes.
+ *
+ */
+class TraceScope {
+ public:
+  TraceScope(TraceOp op, uint32_t handle, int64_t amount)
+      : op_(op), handle_(handle), result_(0), detail_(0) {
+    FlightRecorder::Record(op, TracePhase::KBEGIN, handle, amount, 0);
+  }
+
+  ~TraceScope() {
+    FlightRecorder::Record(op_, TracePhase::KEND, handle_, result_, detail_);
+  }
+
+  TraceScope(const TraceScope &) = delete;
+  TraceScope &operator=(const TraceScope &) = delete;
+
+  /**
+   * @brief       : What the end event reports.
+   */
+  void Result(int64_t amount, uint16_t detail) {
+    result_ = amount;
+    detail_ = detail;
+  }
+
+ private:
+  TraceOp op_;
+  uint32_t handle_;
+  int64_t result_;
+  uint16_t detail_;
+};
+
+/**
+ * @brief     : Read a dump written by FlightRecorder.
+ * @param path: The dump file.
+ * @param dump: Receives its rings, split at every KTHREAD event so that each
+ * TraceThread holds the events of a single thread.
+ * @return    : bool False if the file is missing, truncated or not a dump.
+ */
+bool LoadTrace(const std::string &path, TraceDump *dump);
+
+/**
+ * @brief     : Pair the begin and end events of every thread.
+ * @param dump: A loaded dump.
+ * @return    : std::vector<TraceSpan> The completed operations, by start
+ * time; operations whose begin or end fell out of the ring, or that were
+ * open when the ring changed threads, are left out.
+ */
+std::vector<TraceSpan> TraceSpans(const TraceDump &dump);
+
+/************************************ Inline Part
+ * ************************************* */
+inline uint64_t FlightRecorder::Now() {
+#if defined(__x86_64__) || defined(__i386__)
+  return (__rdtsc());
+#else
+  timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (static_cast<uint64_t>(now.tv_sec) * 1000000000ull +
+          static_cast<uint64_t>(now.tv_nsec));
+#endif
+}
+
+inline void FlightRecorder::Record(TraceOp op, TracePhase phase,
+                                   uint32_t handle, int64_t amount,
+                                   uint16_t detail) {
+  if (!enabled_.load(std::memory_order_relaxed)) {
+    return;
+  }
+  Ring *ring = ring_ ? ring_ : Attach();
+  if (!ring) {
+    return;
+  }
+  const uint64_t pos = ring->head.load(std::memory_order_relaxed);
+  ring->events[pos & (kRingEvents - 1)] =
+      TraceEvent{Now(), amount, handle, op, phase, detail};
+  ring->head.store(pos + 1, std::memory_order_release);
+}
+
+#endif  // _HOME_SARA_DOCUMENTS_ROBOBANKPORTFOLIO_INC_FLIGHTRECORDER_HPP_
@@ -0,0 +1,121 @@
+// Copyright 2025 Sara Saad
+
+/**
+ * @file : GroupTree.hpp
+ * @brief: One hierarchy of account groups (e.g. region > branch > customer)
+ * with balances rolled up incrementally.
+ *
+ * Every group keeps the sum of the balances and the number of the accounts
+ * in its subtree. An account belongs to at most one group of a hierarchy;
+ * each of its balance changes is added to that group and to every ancestor,
+ * so reading the total of any group is a single load. Moving an account, or a
+ * whole subgroup, only adjusts the totals along the old and the new path to
+ * the root: regrouping costs the depth of the tree per move, never a pass
+ * over the book.
+ *
+ */
+#ifndef _HOME_SARA_DOCUMENTS_ROBOBANKPORTFOLIO_INC_GROUPTREE_HPP_
+#define _HOME_SARA_DOCUMENTS_ROBOBANKPORTFOLIO_INC_GROUPTREE_HPP_
+
+/*************************** include part ****************************** */
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "../Inc/Types.hpp"
+///////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/************************************ Class Part
+ * ************************************* */
+/**
+ * @class: GroupTree
+ * @brief: Groups of one hierarchy, their parents and rolled-up totals.
+ *
+ * Apply() may run concurrently with itself and with Total(); every other
+ * method requires that no Apply() runs.
+ *
+ */
+class GroupTree {
+ public:
+  static constexpr uint32_t kNone = UINT32_MAX;  ///< No group / the root
+
+  /**
+   * @param name: The hierarchy's name, e.g. "branch".
+   */
+  explicit GroupTree(const std::string &name);
+
+  const std::string &Name() const;
+
+  /**
+   * @brief       : Add an empty group.
+   * @param group : Its name, unique within the hierarchy.
+   * @param parent: The parent group, kNone for a top-level group.
+   * @return      : uint32_t The new group, or kNone if the name is taken or
+   * the parent does not exist.
+   */
+  uint32_t AddGroup(const std::string &group, uint32_t parent);
+
+  uint32_t Find(const std::string &group) const;  ///< kNone if unknown
+
+  /**
+   * @brief       : Track account handles [0, count); handles at or past
+   * count must not be in any group.
+   */
+  void Resize(size_t count);
+
+  /**
+   * @brief        : Put an account in a group, taking it out of its
+   * previous one.
+   * @param handle : The account.
+   * @param group  : Its new group, or kNone to ungroup it.
+   * @param balance: Its current balance.
+   */
+  void Assign(uint32_t handle, uint32_t group, int64_t balance);
+
+  /**
+   * @brief       : Roll one balance change up the account's path.
+   * @param handle: The account; nothing happens if it is in no group.
+   * @param delta : New balance minus old balance.
+   */
+  void Apply(uint32_t handle, int64_t delta) {
+    for (uint32_t g = group_of_[handle]; g != kNone; g = nodes_[g].parent) {
+      std::atomic_ref<int64_t>(nodes_[g].total)
+          .fetch_add(delta, std::memory_order_relaxed);
+    }
+  }
+
+  /**
+   * @brief           : Give a group, with its subtree, a new parent.
+   * @param group     : The group.
+   * @param new_parent: Its new parent, or kNone to make it top-level.
+   * @return          : bool False if new_parent is the group itself or one of
+   * its descendants.
+   */
+  bool Move(uint32_t group, uint32_t new_parent);
+
+  GroupTotal Total(uint32_t group) const;  ///< Rolled-up subtree totals
+
+ private:
+  /**
+   * @struct: Node
+   * @brief : One group.
+   */
+  struct Node {
+    int64_t total;      ///< Balance of the subtree, in cents; atomic_ref
+    uint32_t parent;    ///< kNone for a top-level group
+    uint32_t accounts;  ///< Accounts in the subtree
+  };
+
+  std::string name_;
+  std::vector<Node> nodes_;  ///< By group
+  std::unordered_map<std::string, uint32_t> names_;  ///< Group name to group
+  std::vector<uint32_t> group_of_;  ///< Group per account handle, or kNone
+
+  /// Add a balance and an account count to a group and its ancestors.
+  void AddToPath(uint32_t group, int64_t balance, int64_t accounts);
+};
+
+#endif  // _HOME_SARA_DOCUMENTS_ROBOBANKPORTFOLIO_INC_GROUPTREE_HPP_
@@ -0,0 +1,164 @@
+// Copyright 2025 Sara Saad
+
+/**
+ * @file : HotPath.hpp
+ * @brief: Header-only, statically dispatched transaction apply.
+ *
+ * IAccount::Apply() goes through a virtual call per mutator and an
+ * out-of-line Calculator call per balance change. When the concrete account
+ * type is known, HotPath<Account, Policy>::Apply() does the same work with
+ * everything visible to the compiler, so a whole Apply folds into one
+ * straight-line switch: the calculator arithmetic, the seqlock store and the
+ * audit append are all inlined, and type-specific work is removed at compile
+ * time (a CheckingAccount never computes interest). The results, the audit
+ * records and the balance notifications are identical to BaseAccount::Apply().
+ *
+ */
+#ifndef _HOME_SARA_DOCUMENTS_ROBOBANKPORTFOLIO_INC_HOTPATH_HPP_
+#define _HOME_SARA_DOCUMENTS_ROBOBANKPORTFOLIO_INC_HOTPATH_HPP_
+
+/*************************** include part ****************************** */
+#include <cstdint>
+#include <type_traits>
+
+#include "../Inc/Calculator.hpp"
+#include "../Inc/IAccount.hpp"
+#include "../Inc/Types.hpp"
+///////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/************************************ Policy Part
+ * ************************************* */
+/**
+ * @struct: AuditedPolicy
+ * @brief : Default policy: inline arithmetic, every change is audited.
+ *
+ * A policy supplies the calculator type (Calc) and whether the account's audit
+ * trail is written (kAudit).
+ *
+ */
+struct AuditedPolicy {
+  using Calc = InlineCalculator;
+  static constexpr bool kAudit = true;
+};
+
+/**
+ * @struct: BalanceOnlyPolicy
+ * @brief : Updates balances without writing the per-account audit trail.
+ * Meant for scratch books (what-if runs, benchmarks) whose history is kept
+ * elsewhere or not needed.
+ */
+struct BalanceOnlyPolicy {
+  using Calc = InlineCalculator;
+  static constexpr bool kAudit = false;
+};
+
+/**
+ * @struct: HotAccountTraits
+ * @brief : Compile-time facts about a concrete account type.
+ */
+template <typename Account>
+struct HotAccountTraits {
+  static constexpr bool kEarnsInterest = true;  ///< apr may be non-zero
+};
+
+template <>
+struct HotAccountTraits<CheckingAccount> {
+  static constexpr bool kEarnsInterest = false;  ///< apr is always 0
+};
+
+/************************************ Class Part
+ * ************************************* */
+/**
+ * @class: HotPath
+ * @brief: Inlinable Apply for one concrete account type.
+ *
+ * @tparam Account: CheckingAccount, SavingAccount or another BaseAccount
+ * subclass that does not override the mutators.
+ * @tparam Policy : See AuditedPolicy.
+ *
+ */
+template <typename Account, typename Policy = AuditedPolicy>
+class HotPath {
+  static_assert(std::is_base_of_v<BaseAccount, Account>,
+                "HotPath needs a BaseAccount");
+
+ public:
+  /**
+   * @brief    : Same effect as acc->Apply(tx).
+   * @param acc: The account; its dynamic type must be exactly Account.
+   * @param tx : The transaction to apply.
+   */
+  static void Apply(Account *acc, const TxRecord &tx) {
+    using Calc = typename Policy::Calc;
+    BaseAccount &a = *acc;
+
+    // The out-of-line accrual walk is only reached when accrual is enabled.
+    if (a.accrual_.lazy_interest || a.accrual_.lazy_fees) {
+      a.BaseAccount::AccrueTo(tx.timestamp);
+    }
+
+    const int64_t balance = a.balance_cent_.Load();
+    switch (tx.kind) {
+      case TxKind::KDEPOSIT:
+        Post(&a, Calc::Deposit(balance, tx.amount_cents), TxKind::KDEPOSIT,
+             tx.amount_cents, tx);
+        break;
+
+      case TxKind::KWITHDRAWAL:
+        Post(&a, Calc::Withdraw(balance, tx.amount_cents), TxKind::KWITHDRAWAL,
+             tx.amount_cents, tx);
+        break;
+
+      case TxKind::KFEE:
+        // As BaseAccount::ChargeFee(): lazy cycle fees replace explicit ones.
+        if (a.LazyFees()) {
+          break;
+        }
+        Post(&a, Calc::Fee(balance, tx.amount_cents), TxKind::KFEE,
+             tx.amount_cents, tx);
+        break;
+
+      case TxKind::KINTEREST: {
+        if (a.accrual_.lazy_interest) {
+          break;
+        }
+        int64_t interest = 0;
+        if constexpr (HotAccountTraits<Account>::kEarnsInterest) {
+          // amount_cents carries the number of days, 0 means one period.
+          interest = Calc::Interest(
+              balance, a.setting_.apr,
+              tx.amount_cents > 0 ? static_cast<int32_t>(tx.amount_cents)
+                                  : Calculator::kInterestPeriodDays,
+              Calculator::kDayCountBasis);
+        }
+        Post(&a, Calc::Deposit(balance, interest), TxKind::KINTEREST,
+             interest, tx);
+        break;
+      }
+
+      case TxKind::KTRANSFERIN:
+        Post(&a, Calc::Deposit(balance, tx.amount_cents), TxKind::KTRANSFERIN,
+             tx.amount_cents, tx);
+        break;
+
+      case TxKind::KTRANSFEROUT:
+        Post(&a, Calc::Withdraw(balance, tx.amount_cents),
+             TxKind::KTRANSFEROUT, tx.amount_cents, tx);
+        break;
+
+      default:
+        break;
+    }
+  }
+
+ private:
+  static void Post(BaseAccount *a, int64_t cents, TxKind kind,
+                   int64_t amount_cents, const TxRecord &tx) {
+    a->StoreBalance(cents, tx.timestamp);
+    if constexpr (Policy::kAudit) {
+      a->Record(TxRecord{kind, amount_cents, tx.timestamp, tx.note});
+    }
+  }
+};
+
+#endif  // _HOME_SARA_DOCUMENTS_ROBOBANKPORTFOLIO_INC_HOTPATH_HPP_
@@ -20,8 +20,11 @@
 #include <string>
 #include <vector>
 
+#include "AccountLink.hpp"
+#include "BalanceVersion.hpp"
 #include "Calculator.hpp"
 #include "Types.hpp"
+#include "VelocityTracker.hpp"
 /////////////////////////////////////////////////////////////////////////////////////////////////////////
 
 /*********************************************** Macros Part
@@ -71,6 +74,34 @@ class IAccount {
    */
   virtual int64_t GetBalance() const = 0;
 
+  /**
+   * @brief      : Get the balance as it was at the end of a snapshot epoch.
+   * @param epoch: Snapshot epoch returned by EpochClock::OpenSnapshot().
+   * @param cents: Receives the balance in cents.
+   * @return     : bool False if that version is no longer retained.
+   */
+  virtual bool GetBalanceAsOf(uint64_t epoch, int64_t *cents) const = 0;
+
+  /**
+   * @brief     : Attach the account to the Portfolio that owns it.
+   * @param link: Epoch clock, balance listener and handle to use from now on.
+   */
+  virtual void Attach(const AccountLink &link) = 0;
+
+  /**
+   * @brief          : Enable or change lazy accrual of interest and fees.
+   * @param policy   : What to accrue lazily.
+   * @param anchor_ts: Time from which accrual starts; a negative value anchors
+   * on the first transaction or read that reaches the account.
+   */
+  virtual void SetAccrual(const AccrualPolicy &policy, int64_t anchor_ts) = 0;
+
+  /**
+   * @brief   : Post all interest and fees accrued up to a point in time.
+   * @param ts: The time to accrue to. Earlier times are ignored.
+   */
+  virtual void AccrueTo(int64_t ts) = 0;
+
   /**
    * @brief : Get the audit log of all transactions.
    * @return: const std::vector& Vector of transaction records.
@@ -102,6 +133,11 @@ class IAccount {
    * @param ts       : Timestamp of the transaction.
    * @param note     : Optional note or description for the transaction.
    *
+   * @details:
+   * With lazy fees (a policy with lazy_fees and a fee cycle) the account's
+   * fees are the cycle fees posted by AccrueTo(); an explicit fee is then
+   * skipped after accruing, so the same period is never charged twice.
+   *
    */
   virtual void ChargeFee(int64_t fee_cents, int64_t ts, const char *note) = 0;
 
@@ -112,6 +148,10 @@ class IAccount {
    * @param ts   : Timestamp of the transaction.
    * @param note : Optional note or description for the transaction.
    *
+   * @details:
+   * With lazy interest, AccrueTo() has already credited every elapsed day;
+   * an explicit posting is then skipped after accruing.
+   *
    */
   virtual void PostSimpleInterest(int32_t days, int32_t basis, int64_t ts,
                                   const char *note) = 0;
@@ -123,6 +163,10 @@ class IAccount {
   virtual void Apply(const TxRecord &tx) = 0;
 };
 
+template <typename Account, typename Policy>
+class HotPath;
+class ColdStore;
+
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////
 /**
     * @class: BaseAccount
@@ -132,12 +176,20 @@ class IAccount {
    concreteaccount types like CheckingAccount and SavingAccount.
     */
 class BaseAccount : public IAccount {
+  template <typename Account, typename Policy>
+  friend class HotPath;
+  friend class ColdStore;
+
  protected:
   std::string id_;               ///< Unique account identifier
   AccountSettings setting_;      ///< Account configuration/settings
-  int64_t balance_cent_;         ///< Current balance in cents
+  VersionedBalance balance_cent_;  ///< Current balance in cents
+  AccountLink link_;               ///< Owning Portfolio, empty if unbound
   std::vector<TxRecord> audit_;  ///< List of transaction records
   int32_t audit_count_;          ///< Count of audits stored (up to MAX_AUDIT)
+  AccrualPolicy accrual_;        ///< Lazy accrual settings
+  int64_t interest_anchor_ts_;   ///< Interest accrued up to this time
+  int64_t fee_anchor_ts_;        ///< Last fee cycle boundary charged
 
   /**
    * @brief    : Record a transaction into the audit log.
@@ -149,9 +201,50 @@ class BaseAccount : public IAccount {
   /**
    * @brief: Update the account balance.
    * @param cents: The amount in cents to add (can be negative).
+   * @param ts   : Timestamp of the transaction.
+   *
+   */
+    void UpdateBalance(int64_t cents, int64_t ts);
+
+  /**
+   * @brief: Publish a new balance, stamped with the current write epoch, and
+   * report the change to the owning Portfolio.
+   * @param cents: The new balance in cents.
+   * @param ts   : Timestamp of the transaction.
    *
    */
-    void UpdateBalance(int64_t cents);
+  void StoreBalance(int64_t cents, int64_t ts);
+
+  /**
+   * @brief: Charge a fee without accruing first.
+   *
+   */
+  void PostFee(int64_t fee_cents, int64_t ts, const char *note);
+
+  /**
+   * @brief: Post simple interest without accruing first.
+   *
+   */
+  void PostInterest(int32_t days, int32_t basis, int64_t ts, const char *note);
+
+  /**
+   * @brief          : Walk the interest and fee postings due up to ts in time
+   * order, advancing the anchors. Shared by AccrueTo() and by ColdStore,
+   * which accrues frozen accounts without thawing them.
+   * @param balance  : Running balance, updated after every posting.
+   * @param post     : Called as post(rec, new_cents) for every posting.
+   *
+   */
+  template <typename Post>
+  static void WalkAccrual(const AccrualPolicy &policy,
+                          const AccountSettings &setting,
+                          int64_t *interest_anchor, int64_t *fee_anchor,
+                          int64_t ts, int64_t *balance, Post post);
+
+  /// Fees are posted per cycle by AccrueTo(), not explicitly.
+  bool LazyFees() const {
+    return (accrual_.lazy_fees && accrual_.fee_cycle_days > 0);
+  }
 
  public:
 
@@ -166,6 +259,10 @@ class BaseAccount : public IAccount {
 
   std::string GetId();
   int64_t GetBalance() const;
+  bool GetBalanceAsOf(uint64_t epoch, int64_t *cents) const;
+  void Attach(const AccountLink &link);
+  void SetAccrual(const AccrualPolicy &policy, int64_t anchor_ts);
+  void AccrueTo(int64_t ts);
   AccountSettings GetSetting();
   const std::vector<TxRecord> &GetAudit();
 
@@ -255,4 +352,80 @@ class SavingAccount : public BaseAccount {
 
 };
 
+/********************************************* Inline Part
+ * ***************************************** */
+// Shared by the out-of-line mutators and by HotPath.
+
+inline void BaseAccount::Record(const TxRecord &rec) {
+  if (audit_.size() >= 1000) {
+    audit_.erase(audit_.begin());
+  }
+
+  audit_.push_back(rec);
+  if (link_.velocity) {
+    link_.velocity->Record(link_.handle, rec);
+  }
+}
+
+inline void BaseAccount::StoreBalance(int64_t cents, int64_t ts) {
+  const int64_t old_cents = balance_cent_.Load();
+  balance_cent_.Store(cents, link_.clock ? link_.clock->WriteEpoch() : 0);
+  if (link_.listener) {
+    link_.listener->OnBalanceChange(link_.handle, old_cents, cents, ts);
+  }
+}
+
+template <typename Post>
+void BaseAccount::WalkAccrual(const AccrualPolicy &policy,
+                              const AccountSettings &setting,
+                              int64_t *interest_anchor, int64_t *fee_anchor,
+                              int64_t ts, int64_t *balance, Post post) {
+  if (!policy.lazy_interest && !policy.lazy_fees) {
+    return;
+  }
+  if (*interest_anchor < 0) {
+    *interest_anchor = ts;
+    *fee_anchor = ts;
+    return;
+  }
+
+  const int64_t cycle =
+      static_cast<int64_t>(policy.fee_cycle_days) * Calculator::kSecondsPerDay;
+  const bool fees = policy.lazy_fees && cycle > 0 &&
+                    setting.fee_flat_cents != 0;
+
+  // Walk the fee boundaries in time order so that interest is earned on the
+  // balance as it was between two fees.
+  int64_t until = ts;
+  for (;;) {
+    if (fees && *fee_anchor + cycle <= ts) {
+      until = *fee_anchor + cycle;
+    } else {
+      until = ts;
+    }
+
+    if (policy.lazy_interest && setting.apr != 0.0) {
+      int64_t days = (until - *interest_anchor) / Calculator::kSecondsPerDay;
+      if (days > 0) {
+        *interest_anchor += days * Calculator::kSecondsPerDay;
+        const int64_t interest =
+            Calculator::Interest(*balance, setting.apr,
+                                 static_cast<int32_t>(days),
+                                 Calculator::kDayCountBasis);
+        *balance = Calculator::Deposit(*balance, interest);
+        post(TxRecord{TxKind::KINTEREST, interest, *interest_anchor,
+                      "Accrued interest"},
+             *balance);
+      }
+    }
+    if (until == ts) {
+      break;
+    }
+    *fee_anchor = until;
+    *balance = Calculator::Fee(*balance, setting.fee_flat_cents);
+    post(TxRecord{TxKind::KFEE, setting.fee_flat_cents, until, "Cycle fee"},
+         *balance);
+  }
+}
+
 #endif  // _HOME_SARA_DOCUMENTS_ROBOBANKPORTFOLIO_INC_IACCOUNT_HPP_
@@ -0,0 +1,46 @@
+// Copyright 2025 Sara Saad
+
+/**
+ * @file : NotePool.hpp
+ * @brief: Interned transaction notes with a stable address.
+ *
+ * TxRecord keeps its note as a plain const char*, so a note built at run time
+ * (e.g. the "Transfer Out!" suffix added by Transfer()) must outlive every
+ * audit record that points at it. NotePool stores each distinct note once for
+ * the lifetime of the pool and hands out a pointer that never moves.
+ *
+ */
+#ifndef _HOME_SARA_DOCUMENTS_ROBOBANKPORTFOLIO_INC_NOTEPOOL_HPP_
+#define _HOME_SARA_DOCUMENTS_ROBOBANKPORTFOLIO_INC_NOTEPOOL_HPP_
+
+/*************************** include part ****************************** */
+#include <cstddef>
+#include <mutex>
+#include <string>
+#include <unordered_set>
+///////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/************************************ Class Part
+ * ************************************* */
+/**
+ * @class: NotePool
+ * @brief: Thread-safe set of notes.
+ *
+ */
+class NotePool {
+ public:
+  /**
+   * @brief     : Store a note, or find the copy stored earlier.
+   * @param note: The note text.
+   * @return    : const char* Valid until the pool is destroyed.
+   */
+  const char *Intern(const std::string &note);
+
+  size_t Size() const;  ///< Number of distinct notes
+
+ private:
+  mutable std::mutex mutex_;               ///< Guards notes_
+  std::unordered_set<std::string> notes_;  ///< Nodes never move
+};
+
+#endif  // _HOME_SARA_DOCUMENTS_ROBOBANKPORTFOLIO_INC_NOTEPOOL_HPP_
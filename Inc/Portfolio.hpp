@@ -21,14 +21,26 @@
 
 /**************************************************** include Part
  * ******************************************** */
+#include <atomic>
 #include <cstdint>
 #include <memory>
 #include <string>
-#include <unordered_map>
 #include <vector>
 
+#include "../Inc/AccountIndex.hpp"
+#include "../Inc/AccountLink.hpp"
+#include "../Inc/BalanceHistory.hpp"
+#include "../Inc/BookChecksum.hpp"
+#include "../Inc/ColdStore.hpp"
+#include "../Inc/DedupIndex.hpp"
+#include "../Inc/GroupTree.hpp"
+#include "../Inc/NotePool.hpp"
+#include "../Inc/Reconciler.hpp"
+#include "../Inc/ReplicationSink.hpp"
+#include "../Inc/ThreadPool.hpp"
 #include "../Inc/IAccount.hpp"
 #include "../Inc/Types.hpp"
+#include "../Inc/VelocityTracker.hpp"
 
 //////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
@@ -51,15 +63,39 @@
    across accounts).
         - Maintain an internal audit log for batch operations.
     *
-    * The accounts are stored in an unordered_map for fast lookup by account
-   ID,and each account is owned via a std::unique_ptr for safe memory
-   management.
+    * The accounts are owned via std::unique_ptr in a dense vector, and an
+   AccountIndex maps each account ID to its position (its handle) in that
+   vector for fast lookup.
     *
     */
-class Portfolio {
+class Portfolio : private IBalanceListener {
  private:
-  std::unordered_map<std::string, std::unique_ptr<IAccount>>
-      accounts_;  ///< Map of account IDs to account instances.
+  std::vector<std::unique_ptr<IAccount>>
+      accounts_;        ///< Account instances, indexed by handle; empty
+                        ///< while the account is cold.
+  AccountIndex index_;  ///< Account ID to handle lookup.
+  std::vector<uint64_t> id_hashes_;  ///< AccountIndex::Hash() per handle.
+  std::vector<int64_t> fees_cents_;  ///< Flat fee per handle, 0 if none.
+
+  /// How ApplyToAccount() reaches an account: through the IAccount vtable,
+  /// or through the inlined HotPath of its exact type.
+  enum class Dispatch : uint8_t { KVIRTUAL = 0, KCHECKING, KSAVING };
+  std::vector<Dispatch> dispatch_;  ///< Dispatch per handle.
+  mutable EpochClock clock_;  ///< Epochs for lock-free snapshot reads.
+  BookChecksum checksum_;     ///< Shard sums over (id, balance).
+  AccrualPolicy accrual_{false, false, 0};  ///< Lazy accrual of new accounts.
+  int64_t accrual_anchor_ts_ = -1;          ///< Their accrual start time.
+  ThreadPool *pool_;  ///< Runs every bulk operation; not owned.
+  std::unique_ptr<BalanceHistory> history_;  ///< As-of store, if enabled.
+  NotePool notes_;  ///< Notes built by the portfolio (e.g. transfer legs).
+  DedupIndex dedup_;  ///< Idempotency keys already applied.
+  ColdStore cold_;    ///< Demoted accounts, by handle.
+  std::vector<int64_t> last_active_;  ///< Latest balance change per handle.
+  uint64_t demotions_ = 0;               ///< For TierStats()
+  std::atomic<uint64_t> promotions_{0};  ///< For TierStats()
+  IReplicationSink *sink_ = nullptr;  ///< Replication stream; not owned.
+  std::unique_ptr<VelocityTracker> velocity_;  ///< Velocity, if enabled.
+  std::vector<std::unique_ptr<GroupTree>> groups_;  ///< Group hierarchies.
   std::vector<TxRecord>
       batch_audit_;  ///< Internal log of batch-applied transactions.
   /**
@@ -75,19 +111,142 @@ class Portfolio {
    */
   void ApplyTx(const TxRecord &tx);
 
+  /**
+   * @brief     : Allocate the handle of a new account ID.
+   * @param id  : The account ID.
+   * @param hash: AccountIndex::Hash(id).
+   * @return    : uint32_t The new handle; its account slot is still empty.
+   *
+   */
+  uint32_t NewSlot(const std::string &id, uint64_t hash);
+
+  /**
+   * @brief       : Store an account under a handle and link it to the
+   * portfolio, replacing (and unlinking) any account already stored there.
+   *
+   */
+  void Install(uint32_t handle, std::unique_ptr<IAccount> acc);
+
+  /**
+   * @brief: Keeps the book checksum and the group totals in step with every
+   * balance change.
+   *
+   */
+  void OnBalanceChange(uint32_t handle, int64_t old_cents, int64_t new_cents,
+                       int64_t timestamp) override;
+
+  /**
+   * @brief       : Apply one transaction to an account that is already
+   * resolved. Checking and saving accounts take the inlined HotPath.
+   * @param handle: The target account's handle.
+   * @param tx    : The transaction record to apply.
+   *
+   */
+  void ApplyToAccount(uint32_t handle, const TxRecord &tx);
+
+  /**
+   * @brief       : The account object of a handle, thawing it first if it
+   * is cold. Distinct handles may be promoted from several threads at once.
+   *
+   */
+  IAccount *Resident(uint32_t handle);
+
+  /**
+   * @brief       : Current balance of a handle, hot or cold.
+   *
+   */
+  int64_t BalanceOf(uint32_t handle) const;
+
+  /// The hierarchy with this name, or nullptr.
+  GroupTree *Hierarchy(const std::string &name) const;
+
+  /**
+   * @brief       : Report the account stored under a handle to the sink.
+   *
+   */
+  void PublishAccount(uint32_t handle);
+
+  /**
+   * @brief       : Read every balance as of the end of one snapshot epoch.
+   * @param out   : Receives the balance per handle, or nullptr to only sum.
+   * @param total : Receives the sum of the balances.
+   * @return      : uint64_t The snapshot epoch that was read.
+   *
+   */
+  uint64_t ReadConsistent(std::vector<int64_t> *out, int64_t *total) const;
+
+  /**
+   * @brief: Seal the history segments that time has moved past, if history
+   * is enabled. Called at the end of every mutating operation.
+   *
+   */
+  void SealHistory();
+
  public:
+  /**
+   * @brief: Construct an empty portfolio on the shared ThreadPool.
+   *
+   */
+  Portfolio();
+
+  /**
+   * @brief     : Construct an empty portfolio on an injected ThreadPool.
+   * @param pool: Pool for all bulk operations; it must outlive the
+   * portfolio. Portfolios sharing a pool never oversubscribe the machine.
+   *
+   */
+  explicit Portfolio(ThreadPool *pool);
+
   /**
    * @brief    : Add a new account to the portfolio.
    * @param acc: Unique pointer to the account to be added.
    *
    * @details:
    * Ownership of the account is transferred to the Portfolio.
-   * The account is stored internally in the accounts_ map using its ID as the
-   * key. If an account with the same ID already exists, behavior is undefined
-   * (likely overwritten).
+   * The account is appended to accounts_ and its ID is registered in the
+   * lookup index. If an account with the same ID already exists it is replaced; use the
+   * overload taking a DuplicatePolicy to choose another behavior.
    *
    */
   void AddAccount(std::unique_ptr<IAccount> acc);
+
+  /**
+   * @brief       : Add a new account with explicit duplicate-ID handling.
+   * @param acc   : Unique pointer to the account to be added.
+   * @param policy: What to do if the ID is already in use.
+   * @return      : bool True if the account was stored, false if it was
+   * dropped because of a duplicate ID (KSKIP or KREJECT).
+   *
+   */
+  bool AddAccount(std::unique_ptr<IAccount> acc, DuplicatePolicy policy);
+
+  /**
+   * @brief           : Pre-size the account storage.
+   * @param count_hint: Total number of accounts expected in the portfolio.
+   *
+   * @details:
+   * Reserving up front avoids the repeated rehashing caused by growing the
+   * lookup table one insertion at a time.
+   *
+   */
+  void Reserve(size_t count_hint);
+
+  /**
+   * @brief       : Onboard a columnar batch of accounts in one pass.
+   * @param batch : Columns of (id, type, apr, fee, opening balance).
+   * @param policy: How duplicate IDs are handled, both against accounts
+   * already in the portfolio and within the batch itself.
+   * @return      : size_t The number of accounts inserted or replaced.
+   *
+   * @details:
+   * The storage is sized once for the whole batch before any account is
+   * built. With DuplicatePolicy::KREJECT the batch is all-or-nothing: on the
+   * first duplicate every account inserted by this call is removed again and
+   * 0 is returned. A batch whose columns have different lengths is rejected
+   * and 0 is returned.
+   *
+   */
+  size_t AddAccounts(const AccountBatch &batch, DuplicatePolicy policy);
   /**
    * @brief : Get the number of accounts currently managed in the portfolio.
    * @return: size_t The count of accounts.
@@ -107,6 +266,21 @@ class Portfolio {
    */
   void ApplyAll(const std::vector<TxRecord> &txs);
 
+  /**
+   * @brief           : Apply a list of transactions in parallel by account.
+   * @param txs       : Vector of transaction records to apply.
+   * @param partitions: Number of account partitions (shards) to use.
+   *
+   * @details:
+   * Accounts are split into shards of contiguous handles, run as affine
+   * tasks on the portfolio's ThreadPool, and each shard applies
+   * its own transactions in stream order, so every account ends in exactly
+   * the state ApplyAll() would produce. The batch audit is appended in stream
+   * order once all partitions are done.
+   *
+   */
+  void ApplyPartitioned(const std::vector<TxRecord> &txs, size_t partitions);
+
   /**
 
   * @brief: Apply a series of transactions from structured ledger data.
@@ -147,8 +321,367 @@ class Portfolio {
    * "Exposure" typically refers to the total balance or risk-weighted value of
    * all accounts in the portfolio. This method sums up the balances (or another
    * exposure metric) from all managed accounts.
+   * It is safe to call while another thread runs ApplyAll() or Transfer(): the
+   * sum is taken over one consistent snapshot, so a transfer is either fully
+   * counted or not at all, and the writer is never blocked.
    *
    */
   int64_t TotalExposure() const;
+
+  /**
+   * @brief : Take a consistent point-in-time view of every balance.
+   * @return: BookSnapshot Balances per account handle and their sum.
+   *
+   * @details:
+   * Lock-free with respect to writers: ApplyAll() and Transfer() keep running
+   * while the snapshot is read. Only operations going through the Portfolio
+   * are atomic in the snapshot; adding accounts must not run concurrently.
+   *
+   */
+  BookSnapshot Snapshot() const;
+
+  /**
+   * @brief : Fingerprint every account of the portfolio.
+   * @return: std::vector<AccountDigest> One digest per account, sorted by
+   * account ID so that the result does not depend on insertion order.
+   *
+   */
+  std::vector<AccountDigest> Digest() const;
+
+  /**
+   * @brief : Get the incrementally maintained checksum of the book.
+   * @return: BookDigest Merkle tree over the account shards.
+   *
+   * @details:
+   * The checksum follows every balance change made through the apply and
+   * transfer paths or directly on an account, so reading it costs a fixed
+   * BookDigest::kShards sums instead of a scan of the book. Two replicas
+   * agree iff their Root() values match; DivergentShards() names the shards
+   * to inspect when they do not. Take it when no writer is running to
+   * compare exact points in time.
+   *
+   */
+  BookDigest Checksum() const;
+
+  /**
+   * @brief          : Switch lazy interest and fee accrual on or off.
+   * @param policy   : The policy for every current and future account.
+   * @param anchor_ts: Time from which accrual starts; negative anchors each
+   * account on the first transaction, BalanceAt() or AccrueAll() that
+   * reaches it.
+   *
+   * @details:
+   * With lazy accrual there is no month-end pass over the book: each account
+   * posts its interest (actual days, Calculator::kDayCountBasis) and its cycle
+   * fees when a transaction reaches it or its balance is read with
+   * BalanceAt(). Explicit postings of what is accrued lazily (KINTEREST and
+   * KFEE records, SweepFees(), ApplyInterest(), ApplyFee()) are then skipped,
+   * so no period is credited or charged twice. GetBalance(), TotalExposure(),
+   * Snapshot() and GroupExposure() do not accrue; call AccrueAll() first when
+   * they must reflect interest and fees up to a given time.
+   *
+   */
+  void SetAccrualPolicy(const AccrualPolicy &policy, int64_t anchor_ts);
+
+  /**
+   * @brief      : Read a balance as of a point in time, accruing first.
+   * @param id   : The account ID.
+   * @param ts   : The time of the read.
+   * @param cents: Receives the balance in cents.
+   * @return     : bool False if the account does not exist.
+   *
+   */
+  bool BalanceAt(const std::string &id, int64_t ts, int64_t *cents);
+
+  /**
+   * @brief   : Bring every account up to date, e.g. before a statement run.
+   * @param ts: The time to accrue to.
+   *
+   */
+  void AccrueAll(int64_t ts);
+
+  /**
+   * @brief           : Charge the flat monthly fee of every checking account.
+   * @param ts        : Timestamp of the fee postings.
+   * @param note      : Note recorded on every posting.
+   * @param partitions: Number of shards the book is split into.
+   * @return          : FeeSweepSummary Totals, overall and per worker.
+   *
+   * @details:
+   * One pass over the contiguous per-handle fee column picks the accounts to
+   * charge; each shard (a contiguous range of handles, run on the
+   * portfolio's ThreadPool) charges its accounts and collects
+   * its audit entries locally, and the batch audit is appended in one bulk
+   * insert at the end, in handle order. This is the eager counterpart of
+   * lazy fees (SetAccrualPolicy): with lazy fees on, the accounts charge
+   * their own cycle fees and the sweep charges nothing. Cold accounts are
+   * charged inside the cold tier and stay cold.
+   *
+   */
+  FeeSweepSummary SweepFees(int64_t ts, const char *note, size_t partitions);
+
+  /**
+   * @brief : Hand over the batch audit accumulated so far.
+   * @return: std::vector<TxRecord> Every batch-applied transaction since the
+   * previous drain, in application order; the internal log is left empty.
+   *
+   */
+  std::vector<TxRecord> DrainBatchAudit();
+
+  /**
+   * @brief                : Start recording every balance change, so that
+   * balances and exposure can be queried as of past times.
+   * @param segment_seconds: Span of one history segment (e.g. 86400).
+   *
+   * @details:
+   * The balances held when history is enabled (and the opening balances of
+   * accounts added later) count as held since the beginning of time. Calling
+   * it again has no effect. Queries must not run concurrently with writes.
+   *
+   */
+  void EnableHistory(int64_t segment_seconds);
+
+  /**
+   * @brief      : Balance of an account as of a past time.
+   * @param id   : The account ID.
+   * @param ts   : Changes stamped at or before ts are included.
+   * @param cents: Receives the balance in cents.
+   * @return     : bool False if the account does not exist or history is
+   * not enabled.
+   *
+   */
+  bool BalanceAsOf(const std::string &id, int64_t ts, int64_t *cents) const;
+
+  /**
+   * @brief      : Balance of an account over a time range.
+   * @param id   : The account ID.
+   * @param from : Start of the range.
+   * @param to   : End of the range, inclusive.
+   * @param out  : Receives the balance at from, then every change in
+   * (from, to].
+   * @return     : bool False if the account does not exist or history is
+   * not enabled.
+   *
+   */
+  bool BalanceHistoryBetween(const std::string &id, int64_t from, int64_t to,
+                             std::vector<BalancePoint> *out) const;
+
+  /**
+   * @brief      : Exposure as of a past time, e.g. the end of a day.
+   * @param ts   : Changes stamped at or before ts are included.
+   * @param cents: Receives the sum of all balances.
+   * @return     : bool False if history is not enabled.
+   *
+   */
+  bool ExposureAsOf(int64_t ts, int64_t *cents) const;
+
+  /**
+   * @brief        : Write the statement of every account for one period.
+   * @param request: Period, format, output files and buffer size.
+   * @param summary: Receives the counts and the files written.
+   * @return       : bool False if an output file could not be opened or
+   * written.
+   *
+   * @details:
+   * The book is split into request.partitions contiguous handle ranges, each
+   * formatted by its own StatementWriter on the pool into its own file,
+   * <path_prefix>.<partition>, with one buffer of request.buffer_bytes per
+   * writer. Balances are derived from the audit trails, which keep the last
+   * 1000 records of each account; a statement whose period may start before
+   * its account's oldest retained record is flagged partial (see
+   * StatementWriter::Write()) and counted in summary->partial. Must not run
+   * concurrently with writes.
+   *
+   */
+  bool WriteStatements(const StatementRequest &request,
+                       StatementSummary *summary) const;
+
+  /**
+   * @brief        : Export the audit trail of every account as compressed
+   * columnar archives (see AuditArchive.hpp), one file per partition of the
+   * book, written in parallel.
+   * @param request: Output prefix, partitions and row group size.
+   * @param summary: Receives the counts and the file names.
+   * @return       : bool False if a file could not be opened or written.
+   *
+   * @details:
+   * Accounts appear in handle order within a file; cold accounts are read
+   * without being promoted. Must not run concurrently with writes.
+   *
+   */
+  bool ExportAudit(const AuditExportRequest &request,
+                   AuditExportSummary *summary) const;
+
+  /**
+   * @brief         : Reconcile an external transaction stream (a bank
+   * statement feed, a ledger export) against the audit trails of the book.
+   * @param request : Time window, partitions and memory budget.
+   * @param external: Yields the external records, in any order.
+   * @param sink    : Receives every matched, missing and mismatched record.
+   * @param summary : Receives the counts.
+   * @return        : bool False if a spill file could not be written or read.
+   *
+   * @details:
+   * A sort-merge join (see Reconciler.hpp): both sides are partitioned by
+   * account, sorted and spilled to temporary files in parallel whenever they
+   * outgrow request.memory_bytes, then merged and joined per partition on the
+   * pool. Spilled runs are merged request.merge_fan_in at a time as they pile
+   * up, so the open files stay logarithmic in the spills. Cold accounts are read without being promoted. Only what the audit
+   * trails still hold can be matched: each keeps its last 1000
+   * records. Must not run concurrently with writes.
+   *
+   */
+  bool Reconcile(const ReconcileRequest &request,
+                 const Reconciler::ExternalSource &external,
+                 IReconcileSink *sink, ReconcileSummary *summary) const;
+
+  /**
+   * @brief               : Resize the idempotency window. Keys remembered so
+   * far are forgotten.
+   * @param window_seconds: A key is rejected as a duplicate for at least this
+   * long (and at most twice this long, unless a record was stamped more than
+   * a window ahead; see DedupIndex) in transaction time after it was first
+   * applied. Default DedupIndex::kDefaultWindowSeconds.
+   * @param expected_keys : Keyed records expected per window.
+   *
+   * @details:
+   * Records and transfers with a non-zero idempotency_key are applied once:
+   * ApplyAll() and ApplyPartitioned() skip repeats (they are neither applied
+   * nor added to the batch audit) and Transfer() returns false for them.
+   *
+   */
+  void SetDedupWindow(int64_t window_seconds, size_t expected_keys);
+
+  DedupStats DeduplicationStats() const;  ///< Idempotency index counters
+
+  /**
+   * @brief             : Move dormant accounts to the compact cold tier.
+   * @param now         : The current transaction time.
+   * @param idle_seconds: Accounts whose balance has not changed since
+   * now - idle_seconds (or ever, since they were added) are demoted.
+   * @return            : size_t The number of accounts demoted.
+   *
+   * @details:
+   * Only exact CheckingAccount and SavingAccount objects are demoted. A cold
+   * account is promoted back transparently by the next transaction, transfer
+   * or fee that reaches it and by BalanceAt() and GetAccount(), which const
+   * callers may race on safely; AccrueAll() and SweepFees() post to it in
+   * place. Snapshot(),
+   * TotalExposure(), Digest(), EnableHistory() and WriteStatements() read it
+   * without promoting it. Pointers returned by GetAccount() are invalidated
+   * when their account is demoted. Must not run concurrently with other
+   * operations.
+   *
+   */
+  size_t DemoteIdle(int64_t now, int64_t idle_seconds);
+
+  TieringStats TierStats() const;  ///< Hot/cold split and cold memory
+
+  /**
+   * @brief     : Report every operation that changes the book to a sink,
+   * e.g. a ReplicationPublisher feeding a hot standby.
+   * @param sink: The sink, or nullptr to stop; it must outlive its use.
+   *
+   * @details:
+   * The accounts already in the book are reported first, with their current
+   * balance (not their audit trail). From then on account additions, applied
+   * records, transfers, fee sweeps and accruals are reported in apply order.
+   * Changes made directly on an account obtained from GetAccount() are not.
+   *
+   */
+  void SetReplicationSink(IReplicationSink *sink);
+
+  /**
+   * @brief: Start counting every audit record per account, kind and trailing
+   * window (minute, hour, day), for Velocity().
+   *
+   * @details:
+   * Records written before the call are not counted. Calling it again has no
+   * effect.
+   *
+   */
+  void EnableVelocity();
+
+  /**
+   * @brief       : Activity of an account in a trailing window, in constant
+   * time, e.g. to check a limit before applying a transaction.
+   * @param id    : The account ID.
+   * @param kind  : Which records to count.
+   * @param window: The window, ending at now.
+   * @param now   : The current transaction time.
+   * @param stat  : Receives the count and the sum of the amounts; the window
+   * may reach back by less than one bucket further (see VelocityTracker).
+   * @return      : bool False if the account does not exist or velocity is
+   * not enabled.
+   *
+   * @details:
+   * Must not run concurrently with writes to the same account.
+   *
+   */
+  bool Velocity(const std::string &id, TxKind kind, VelocityWindow window,
+                int64_t now, VelocityStat *stat) const;
+
+  /**
+   * @brief          : Add a group to a hierarchy of account groups, e.g.
+   * customers within branches within regions.
+   * @param hierarchy: The hierarchy, e.g. "branch" or "product"; created by
+   * its first group.
+   * @param group    : The group's name, unique within the hierarchy.
+   * @param parent   : The parent group, or empty for a top-level group.
+   * @return         : bool False if the group exists or the parent does not.
+   *
+   * @details:
+   * Every group keeps the balance and the account count of its subtree up to
+   * date as balances change, so GroupExposure() is a constant-time read. Each
+   * hierarchy adds one walk up its tree to every balance change of a grouped
+   * account. Group structure must not change concurrently with writes.
+   *
+   */
+  bool AddGroup(const std::string &hierarchy, const std::string &group,
+                const std::string &parent);
+
+  /**
+   * @brief          : Move accounts to other groups of a hierarchy.
+   * @param hierarchy: The hierarchy.
+   * @param moves    : Account and new group; an empty group ungroups the
+   * account. Later moves of the same account win.
+   * @return         : size_t The moves applied; those naming an unknown
+   * account or group are skipped.
+   *
+   * @details:
+   * Only the totals on the old and the new path of each account change.
+   * Must not run concurrently with writes.
+   *
+   */
+  size_t Regroup(const std::string &hierarchy,
+                 const std::vector<GroupAssignment> &moves);
+
+  /**
+   * @brief           : Give a group, with its subgroups and accounts, a new
+   * parent.
+   * @param hierarchy : The hierarchy.
+   * @param group     : The group.
+   * @param new_parent: Its new parent, or empty to make it top-level.
+   * @return          : bool False if a group is unknown or new_parent lies in
+   * the group's own subtree. Must not run concurrently with writes.
+   */
+  bool MoveGroup(const std::string &hierarchy, const std::string &group,
+                 const std::string &new_parent);
+
+  /**
+   * @brief          : Rolled-up totals of a group, in constant time.
+   * @param hierarchy: The hierarchy.
+   * @param group    : The group.
+   * @param total    : Receives the exposure and the account count of the
+   * group and all its subgroups.
+   * @return         : bool False if the hierarchy or the group is unknown.
+   *
+   * @details:
+   * May run concurrently with writes; a group read while a batch is applied
+   * reflects an unspecified subset of the batch's changes.
+   *
+   */
+  bool GroupExposure(const std::string &hierarchy, const std::string &group,
+                     GroupTotal *total) const;
 };
 #endif  // _HOME_SARA_DOCUMENTS_ROBOBANKPORTFOLIO_INC_PORTOFILO_HPP_
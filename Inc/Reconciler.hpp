@@ -0,0 +1,154 @@
+// Copyright 2025 Sara Saad
+
+/**
+ * @file : Reconciler.hpp
+ * @brief: Sort-merge reconciliation of an external transaction stream
+ * against the book's audit trails, in bounded memory.
+ *
+ * Both sides are routed by AccountIndex::Hash() of the account into
+ * partitions and buffered. Whenever the buffers outgrow the memory budget,
+ * every partition sorts its buffers on the thread pool and spills them as
+ * sorted runs to temporary files. Run() then lets each partition, in
+ * parallel, merge its runs and what is left in memory into one sorted stream
+ * per side and join the two streams on (account, timestamp, kind, amount).
+ *
+ * Every run is an open temporary file, so runs are merged on disk as they
+ * pile up: once the merge fan-in F newest runs of a side were produced by
+ * the same number of merges, they are merged into one. A side thus holds at
+ * most F - 1 runs per level, and the levels grow with log_F of the spills;
+ * before the join, Run() merges each side down to at most F runs. Each
+ * record is rewritten once per level.
+ *
+ * Records of one account at one timestamp form a group. Within a group,
+ * records equal on both sides are matched; the remaining records are paired
+ * in (kind, amount) order as mismatched; whatever is still unpaired is
+ * missing from the other side. Only a group is ever held in memory during
+ * the join, plus one read buffer per run.
+ *
+ * Run layout: per record u8 kind, u16 account length, account, i64
+ * timestamp, i64 amount (host byte order, the files never leave the
+ * process).
+ *
+ */
+#ifndef _HOME_SARA_DOCUMENTS_ROBOBANKPORTFOLIO_INC_RECONCILER_HPP_
+#define _HOME_SARA_DOCUMENTS_ROBOBANKPORTFOLIO_INC_RECONCILER_HPP_
+
+/*************************** include part ****************************** */
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "../Inc/ThreadPool.hpp"
+#include "../Inc/Types.hpp"
+///////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/************************************ Class Part
+ * ************************************* */
+/**
+ * @struct: ReconEntry
+ * @brief : One transaction as reconciled: its join key.
+ *
+ */
+struct ReconEntry {
+  std::string account_id;  ///< Account
+  int64_t timestamp;       ///< When it happened
+  TxKind kind;             ///< What it was
+  int64_t amount_cents;    ///< How much
+};
+
+/**
+ * @class: IReconcileSink
+ * @brief: Receives the outcome of every reconciled record.
+ *
+ * Calls for one partition come from one thread, in key order; calls for
+ * different partitions may run concurrently.
+ *
+ */
+class IReconcileSink {
+ public:
+  virtual ~IReconcileSink();
+
+  virtual void OnMatched(size_t partition, const ReconEntry &entry) = 0;
+
+  /// In the external stream only.
+  virtual void OnMissingFromBook(size_t partition,
+                                 const ReconEntry &external) = 0;
+
+  /// In the book only.
+  virtual void OnMissingFromExternal(size_t partition,
+                                     const ReconEntry &book) = 0;
+
+  /// Same account and timestamp, different kind or amount.
+  virtual void OnMismatched(size_t partition, const ReconEntry &external,
+                            const ReconEntry &book) = 0;
+};
+
+/**
+ * @class: Reconciler
+ * @brief: Partitioned external sort and merge join of the two sides.
+ *
+ * Feed both sides with AddExternal() and AddBook(), then call Run() once.
+ * Not thread-safe; the parallelism is in the spills and in Run().
+ *
+ */
+class Reconciler {
+ public:
+  /// Pulls the next external record; returns false at the end.
+  using ExternalSource = std::function<bool(TxRecord *)>;
+
+  /**
+   * @brief        : Prepare an empty reconciliation.
+   * @param request: Time window, partitions and memory budget.
+   * @param pool   : Runs the spills and the joins; not owned.
+   */
+  Reconciler(const ReconcileRequest &request, ThreadPool *pool);
+  ~Reconciler();
+
+  Reconciler(const Reconciler &) = delete;
+  Reconciler &operator=(const Reconciler &) = delete;
+
+  /**
+   * @brief    : Add one external record; records outside the window are
+   * ignored.
+   * @param rec: The record; account_id names the account.
+   */
+  void AddExternal(const TxRecord &rec);
+
+  /**
+   * @brief      : Add the audit trail of one book account; records outside
+   * the window are ignored.
+   * @param id   : The account ID.
+   * @param audit: Its records.
+   */
+  void AddBook(const std::string &id, const std::vector<TxRecord> &audit);
+
+  /**
+   * @brief        : Join the two sides and report every record to the sink.
+   * @param sink   : Receives the outcome.
+   * @param summary: Receives the counts.
+   * @return       : bool False if a spill file could not be written or read
+   * back.
+   */
+  bool Run(IReconcileSink *sink, ReconcileSummary *summary);
+
+ private:
+  struct Partition;
+
+  ReconcileRequest request_;
+  ThreadPool *pool_;
+  std::vector<Partition> partitions_;
+  size_t buffered_bytes_;  ///< Estimate of the memory held by the buffers
+  size_t fan_in_;          ///< Runs merged per pass
+  size_t runs_;            ///< Runs spilled
+  uint64_t spilled_bytes_;  ///< Bytes spilled and merged
+  size_t merges_;           ///< Merge passes on disk
+  bool ok_;                 ///< No spill or merge has failed
+
+  void Add(int side, const std::string &id, const TxRecord &rec);
+  void Spill();
+};
+
+#endif  // _HOME_SARA_DOCUMENTS_ROBOBANKPORTFOLIO_INC_RECONCILER_HPP_
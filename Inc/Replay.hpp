@@ -0,0 +1,110 @@
+// Copyright 2025 Sara Saad
+
+/**
+ * @file : Replay.hpp
+ * @brief: Deterministic, parallel re-execution of a recorded transaction day.
+ *
+ * Auditors reproduce end-of-day balances by replaying the day's TxRecord
+ * stream over the opening book. The ReplayEngine rebuilds the opening book,
+ * re-executes the stream partitioned by account on several threads, and
+ * checks every account's final balance and audit against a recorded
+ * ReplayManifest. Interest is computed with exact integer math and digests
+ * are taken in account-ID order, so the result is byte-identical across runs
+ * regardless of thread count or hash-table layout.
+ *
+ */
+#ifndef _HOME_SARA_DOCUMENTS_ROBOBANKPORTFOLIO_INC_REPLAY_HPP_
+#define _HOME_SARA_DOCUMENTS_ROBOBANKPORTFOLIO_INC_REPLAY_HPP_
+
+/*************************** include part ****************************** */
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "../Inc/Portfolio.hpp"
+#include "../Inc/Types.hpp"
+///////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/**
+ * @struct: ReplayManifest
+ * @brief : Recorded end-of-day state that a replay must reproduce.
+ *
+ */
+struct ReplayManifest {
+  std::vector<AccountDigest> accounts;  ///< Per-account digests, ID order
+
+  uint64_t book_digest;  ///< Checksum over all of accounts
+};
+
+/**
+ * @struct: ReplayReport
+ * @brief : Outcome of one replay.
+ * When matched is false, the divergence fields describe the first account (in
+ * ID order) whose balance or audit differs, or that exists on only one side.
+ *
+ */
+struct ReplayReport {
+  bool matched;  ///< True if every account reproduced exactly
+
+  uint64_t book_digest;  ///< Checksum of the replayed book
+
+  size_t transactions;  ///< Number of transactions re-executed
+
+  std::string divergent_id;  ///< First divergent account ID
+
+  int64_t expected_balance;  ///< Recorded balance of divergent_id
+
+  int64_t actual_balance;  ///< Replayed balance of divergent_id
+
+  size_t last_tx_index;  ///< Last stream position touching divergent_id,
+                         ///< SIZE_MAX if the stream never touches it
+};
+
+/**
+ * @class: ReplayEngine
+ * @brief: Re-executes a recorded stream and verifies it against a manifest.
+ *
+ */
+class ReplayEngine {
+ public:
+  /**
+   * @brief           : Construct a replay engine.
+   * @param partitions: Number of account partitions replayed in parallel.
+   */
+  explicit ReplayEngine(size_t partitions);
+
+  /**
+   * @brief          : Record the manifest of a live portfolio.
+   * @param portfolio: The book to fingerprint, typically at end of day.
+   * @return         : ReplayManifest The digests a replay must reproduce.
+   */
+  static ReplayManifest Record(const Portfolio &portfolio);
+
+  /**
+   * @brief         : Checksum over a list of account digests.
+   * @param accounts: Digests sorted by account ID.
+   * @return        : uint64_t The combined checksum.
+   */
+  static uint64_t BookDigest(const std::vector<AccountDigest> &accounts);
+
+  /**
+   * @brief         : Replay a day and compare it against its manifest.
+   * @param opening : The opening book.
+   * @param stream  : The recorded transactions, in their original order.
+   * @param expected: The recorded end-of-day manifest.
+   * @return        : ReplayReport Whether the replay matched, and if not, the
+   * first divergence. A stream that names an account missing from the
+   * opening book is not replayed: the report carries that ID, its recorded
+   * balance (0 if the manifest lacks it too), no transactions and, as
+   * last_tx_index, the first stream position naming it.
+   */
+  ReplayReport Run(const AccountBatch &opening,
+                   const std::vector<TxRecord> &stream,
+                   const ReplayManifest &expected) const;
+
+ private:
+  size_t partitions_;  ///< Parallelism of the re-execution
+};
+
+#endif  // _HOME_SARA_DOCUMENTS_ROBOBANKPORTFOLIO_INC_REPLAY_HPP_
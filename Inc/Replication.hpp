@@ -0,0 +1,209 @@
+// Copyright 2025 Sara Saad
+
+/**
+ * @file : Replication.hpp
+ * @brief: Hot-standby replication of a Portfolio through shared memory.
+ *
+ * The primary's Portfolio reports its operations to a ReplicationPublisher
+ * (an IReplicationSink), which encodes each one into a ReplicationRing: a
+ * single-producer, single-consumer byte ring in a shared mapping, created
+ * before fork() so that a follower process sees the same memory. The
+ * ReplicationFollower in the other process decodes the entries and replays
+ * them on its own Portfolio; Promote() drains what is left and the follower's
+ * book can take over at once.
+ *
+ * Publishing costs the primary one encode into the ring and one release
+ * store per operation, with no lock and no system call. The primary only
+ * waits when the ring is full (the follower fell behind by its whole
+ * capacity); those waits are counted as stalls.
+ *
+ * Entry layout: u32 size (header included, 8-byte aligned), u8 type, 3 bytes
+ * padding, u64 publish time (CLOCK_MONOTONIC_COARSE, ns), payload. An entry
+ * never wraps; the space left at the end of the ring is skipped with a
+ * padding entry.
+ *
+ */
+#ifndef _HOME_SARA_DOCUMENTS_ROBOBANKPORTFOLIO_INC_REPLICATION_HPP_
+#define _HOME_SARA_DOCUMENTS_ROBOBANKPORTFOLIO_INC_REPLICATION_HPP_
+
+/*************************** include part ****************************** */
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "../Inc/NotePool.hpp"
+#include "../Inc/Portfolio.hpp"
+#include "../Inc/ReplicationSink.hpp"
+#include "../Inc/Types.hpp"
+///////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/************************************ Class Part
+ * ************************************* */
+/**
+ * @class: ReplicationRing
+ * @brief: Lock-free SPSC ring of variable-size entries in shared memory.
+ *
+ * One process (or thread) produces with Reserve()/Commit(), one consumes
+ * with Peek()/Release(). Each side keeps its cursor in process-local memory
+ * and caches the other side's, so the shared cache lines are only touched
+ * when the cached view runs out.
+ *
+ */
+class ReplicationRing {
+ public:
+  /**
+   * @brief               : Map a new ring.
+   * @param capacity_bytes: Data capacity, rounded up to a power of two
+   * (at least 64 KiB).
+   * @return              : std::unique_ptr<ReplicationRing> The ring, or
+   * nullptr if the mapping failed. Processes forked afterwards share it.
+   */
+  static std::unique_ptr<ReplicationRing> Create(size_t capacity_bytes);
+
+  ~ReplicationRing();
+
+  ReplicationRing(const ReplicationRing &) = delete;
+  ReplicationRing &operator=(const ReplicationRing &) = delete;
+
+  size_t MaxEntry() const;  ///< Largest payload one entry can carry
+
+  /**
+   * @brief  : Room for one entry of up to n payload bytes; waits while the
+   * ring is full.
+   * @return : uint8_t* Where to write the payload, or nullptr (counted as
+   * oversized) if n exceeds MaxEntry(): such an entry could never fit.
+   */
+  uint8_t *Reserve(size_t n);
+
+  /**
+   * @brief     : Publish the entry written after Reserve().
+   * @param type: Entry type, not 0 (reserved for padding).
+   * @param n   : Payload bytes actually written, at most the reserved size.
+   */
+  void Commit(uint8_t type, size_t n);
+
+  /**
+   * @brief     : The oldest unconsumed entry, if any.
+   * @param type: Receives its type.
+   * @param data: Receives its payload.
+   * @param n   : Receives its payload size (rounded up to 8 bytes).
+   * @return    : bool False if the ring is empty.
+   */
+  bool Peek(uint8_t *type, const uint8_t **data, size_t *n);
+
+  void Release();  ///< Consume the entry returned by Peek()
+
+  void Close();         ///< Producer: no more entries will come
+  bool Closed() const;  ///< Consumer: Close() was called
+
+  ReplicationStats Stats() const;  ///< Counters of both sides
+
+ private:
+  struct Shared;
+
+  ReplicationRing(Shared *shared, uint8_t *data, size_t capacity,
+                  size_t mapped);
+
+  Shared *shared_;    ///< Cursors and counters, in the mapping
+  uint8_t *data_;     ///< Entry area, in the mapping
+  size_t capacity_;   ///< Bytes in data_, a power of two
+  size_t mapped_;     ///< Bytes mapped
+
+  // Producer-local state.
+  uint64_t head_;         ///< Next byte to write
+  uint64_t cached_tail_;  ///< Last tail seen
+  uint64_t reserved_at_;  ///< Position of the entry being written
+  uint64_t published_;    ///< Entries published
+
+  // Consumer-local state.
+  uint64_t tail_;         ///< Next byte to read
+  uint64_t cached_head_;  ///< Last head seen
+  uint64_t peeked_size_;  ///< Size of the entry returned by Peek()
+  uint64_t peeked_ns_;    ///< Publish time of that entry
+  uint64_t applied_;      ///< Entries consumed
+};
+
+/**
+ * @class: ReplicationPublisher
+ * @brief: Encodes a Portfolio's operations into a ring.
+ *
+ * Install it with Portfolio::SetReplicationSink().
+ *
+ * Every entry must fit in MaxEntry() bytes. Notes are cut short to fit; an
+ * operation whose account IDs alone do not fit is not published at all (the
+ * standby then misses it) and is counted in ReplicationStats::oversized.
+ *
+ */
+class ReplicationPublisher : public IReplicationSink {
+ public:
+  explicit ReplicationPublisher(ReplicationRing *ring);
+
+  void OnAccountAdded(const AccountSettings &settings, const std::string &id,
+                      int64_t balance) override;
+  void OnApplied(const TxRecord &tx) override;
+  void OnTransfer(const TransferRecord &txr) override;
+  void OnAccrualPolicy(const AccrualPolicy &policy,
+                       int64_t anchor_ts) override;
+  void OnAccrue(const std::string &id, int64_t ts) override;
+  void OnAccrueAll(int64_t ts) override;
+
+ private:
+  ReplicationRing *ring_;  ///< Not owned
+
+  /// Bytes of a note that still fit next to fixed payload bytes.
+  size_t NoteRoom(size_t fixed, size_t note_len) const;
+};
+
+/**
+ * @class: ReplicationFollower
+ * @brief: Replays a ring on a standby Portfolio.
+ *
+ */
+class ReplicationFollower {
+ public:
+  /**
+   * @brief          : Follow a ring.
+   * @param ring     : The ring the primary publishes to; not owned.
+   * @param portfolio: The standby book, equal to the primary's book when
+   * publishing started; not owned. Its dedup window should match the
+   * primary's.
+   */
+  ReplicationFollower(ReplicationRing *ring, Portfolio *portfolio);
+
+  /**
+   * @brief            : Replay what has been published, without waiting.
+   * @param max_entries: Upper bound on the entries consumed.
+   * @return           : size_t The number of entries replayed.
+   */
+  size_t Poll(size_t max_entries);
+
+  /**
+   * @brief : Replay until the primary closes the ring (and it is drained).
+   *
+   */
+  void Run();
+
+  /**
+   * @brief : Replay everything published so far and stop following; the
+   * standby Portfolio is then ready to serve as the primary.
+   * @return: size_t The number of entries replayed by the final drain.
+   */
+  size_t Promote();
+
+  bool Promoted() const;  ///< Promote() was called
+
+ private:
+  ReplicationRing *ring_;
+  Portfolio *portfolio_;
+  NotePool notes_;  ///< Notes of replayed records
+  std::vector<TxRecord> pending_;  ///< Consecutive records, applied at once
+  bool promoted_;
+
+  void Flush();
+  void Replay(uint8_t type, const uint8_t *data, size_t n);
+};
+
+#endif  // _HOME_SARA_DOCUMENTS_ROBOBANKPORTFOLIO_INC_REPLICATION_HPP_
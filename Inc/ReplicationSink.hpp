@@ -0,0 +1,73 @@
+// Copyright 2025 Sara Saad
+
+/**
+ * @file : ReplicationSink.hpp
+ * @brief: Stream of the state changes a Portfolio makes, for replication.
+ *
+ * A Portfolio with a sink reports every operation that changes its book, in
+ * the order the operations are applied, so that a follower replaying the
+ * calls on an equal book ends in the same state. Operations are reported,
+ * not balance deltas: replaying them is deterministic.
+ *
+ */
+#ifndef _HOME_SARA_DOCUMENTS_ROBOBANKPORTFOLIO_INC_REPLICATIONSINK_HPP_
+#define _HOME_SARA_DOCUMENTS_ROBOBANKPORTFOLIO_INC_REPLICATIONSINK_HPP_
+
+/*************************** include part ****************************** */
+#include <cstdint>
+#include <string>
+
+#include "../Inc/Types.hpp"
+///////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/************************************ Class Part
+ * ************************************* */
+/**
+ * @class: IReplicationSink
+ * @brief: Receives the operations of one Portfolio.
+ *
+ * Callbacks run on the Portfolio's writer thread, one at a time.
+ *
+ */
+class IReplicationSink {
+ public:
+  virtual ~IReplicationSink();
+
+  /**
+   * @brief         : An account was stored (new or replacing one).
+   * @param settings: Type, APR and flat fee of the account.
+   * @param id      : The account ID.
+   * @param balance : Its balance when stored.
+   */
+  virtual void OnAccountAdded(const AccountSettings &settings,
+                              const std::string &id, int64_t balance) = 0;
+
+  /**
+   * @brief   : A transaction record was applied (also each posting of a fee
+   * sweep). Records rejected as duplicates are not reported.
+   */
+  virtual void OnApplied(const TxRecord &tx) = 0;
+
+  /**
+   * @brief    : A transfer succeeded.
+   */
+  virtual void OnTransfer(const TransferRecord &txr) = 0;
+
+  /**
+   * @brief          : The lazy accrual policy changed.
+   */
+  virtual void OnAccrualPolicy(const AccrualPolicy &policy,
+                               int64_t anchor_ts) = 0;
+
+  /**
+   * @brief   : One account was accrued up to ts (Portfolio::BalanceAt()).
+   */
+  virtual void OnAccrue(const std::string &id, int64_t ts) = 0;
+
+  /**
+   * @brief   : Every account was accrued up to ts.
+   */
+  virtual void OnAccrueAll(int64_t ts) = 0;
+};
+
+#endif  // _HOME_SARA_DOCUMENTS_ROBOBANKPORTFOLIO_INC_REPLICATIONSINK_HPP_
@@ -0,0 +1,166 @@
+// Copyright 2025 Sara Saad
+
+/**
+ * @file : ShardedPortfolio.hpp
+ * @brief: A book hash-partitioned over several Portfolio worker processes.
+ *
+ * ShardedPortfolio is the router of a sharded deployment: Start() forks one
+ * worker process per shard, each owning a Portfolio of the accounts whose
+ * AccountIndex::Hash() falls into its shard, and talks to it over a Unix
+ * socket pair. Batches are split by shard and written to every worker before
+ * any reply is read, so the shards apply their parts in parallel, each in its
+ * own address space and on its own core.
+ *
+ * A transfer within one shard is a plain Portfolio::Transfer() on that worker.
+ * A transfer across shards is a two-phase commit coordinated by the router:
+ * both workers are asked to prepare their leg (the account must exist and
+ * must not be part of another prepared transfer), and only if both vote yes
+ * are both legs committed; otherwise the prepared leg is aborted and neither
+ * balance changes. There is no durable coordinator log, so a worker that
+ * dies between the two phases is not recovered.
+ *
+ * Requests and replies on a socket must stay in step. A shard whose socket
+ * fails in the middle of an exchange is therefore marked broken, and every
+ * later call to it fails at once. The router never reads a stale reply as the
+ * answer to a newer request. When some shards fail in a fan-out, the others
+ * still have their replies read.
+ *
+ * Frames on the socket are a u32 payload length, a u8 opcode (requests) or
+ * status (replies), and the payload in host byte order; both ends are the
+ * same binary.
+ *
+ */
+#ifndef _HOME_SARA_DOCUMENTS_ROBOBANKPORTFOLIO_INC_SHARDEDPORTFOLIO_HPP_
+#define _HOME_SARA_DOCUMENTS_ROBOBANKPORTFOLIO_INC_SHARDEDPORTFOLIO_HPP_
+
+/*************************** include part ****************************** */
+#include <sys/types.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "../Inc/DedupIndex.hpp"
+#include "../Inc/Types.hpp"
+///////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/************************************ Class Part
+ * ************************************* */
+/**
+ * @class: ShardedPortfolio
+ * @brief: Router in front of per-shard Portfolio worker processes.
+ *
+ * Not thread-safe: one thread drives the router, the parallelism is in the
+ * workers.
+ *
+ */
+class ShardedPortfolio {
+ public:
+  ShardedPortfolio();
+  ~ShardedPortfolio();
+
+  ShardedPortfolio(const ShardedPortfolio &) = delete;
+  ShardedPortfolio &operator=(const ShardedPortfolio &) = delete;
+
+  /**
+   * @brief       : Fork the worker processes.
+   * @param shards: Number of workers, at least 1.
+   * @return      : bool False if a socket or process could not be created
+   * (the workers already started are stopped again) or if already started.
+   */
+  bool Start(size_t shards);
+
+  /**
+   * @brief: Shut every worker down and wait for it. Called by the destructor.
+   *
+   */
+  void Stop();
+
+  size_t Shards() const;  ///< Number of workers, 0 if not started
+
+  /**
+   * @brief   : The shard an account ID lives on.
+   * @param id: The account ID.
+   * @return  : size_t AccountIndex::Hash(id) modulo Shards().
+   */
+  size_t ShardOf(const std::string &id) const;
+
+  /**
+   * @brief       : Onboard accounts, each on its own shard.
+   * @param batch : Columns of (id, type, apr, fee, opening balance).
+   * @param policy: Duplicate handling as in Portfolio::AddAccounts(); with
+   * KREJECT every shard accepts or rejects its own part of the batch.
+   * @return      : size_t The number of accounts stored; 0 if a worker failed.
+   */
+  size_t AddAccounts(const AccountBatch &batch, DuplicatePolicy policy);
+
+  /**
+   * @brief        : Apply transactions on their accounts' shards.
+   * @param txs    : Transactions in stream order; the order is kept per
+   * account.
+   * @param applied: Receives the number applied; records for accounts that
+   * do not exist are skipped, as are repeated idempotency keys. May be
+   * nullptr.
+   * @return       : bool False if a worker failed.
+   */
+  bool ApplyAll(const std::vector<TxRecord> &txs, size_t *applied);
+
+  /**
+   * @brief    : Move funds between two accounts, on one shard or two.
+   * @param txr: The transfer; a non-zero idempotency_key is admitted once by
+   * the router. The key is used up only by a transfer that commits, so a
+   * transfer that aborted (unknown account, a leg locked by another
+   * transfer) can be retried with the same key.
+   * @return   : bool True if both legs were applied.
+   */
+  bool Transfer(const TransferRecord &txr);
+
+  /**
+   * @brief     : Look up an account on its shard.
+   * @param id  : The account ID.
+   * @param view: Receives a copy of the account's state.
+   * @return    : bool False if the account does not exist or its worker
+   * failed.
+   */
+  bool GetAccount(const std::string &id, AccountView *view);
+
+  /**
+   * @brief      : Sum of the balances of every shard.
+   * @param cents: Receives the total.
+   * @return     : bool False if a worker failed.
+   */
+  bool TotalExposure(int64_t *cents);
+
+  /**
+   * @brief: Counters of the two-phase transfers coordinated so far.
+   *
+   */
+  uint64_t CrossShardCommits() const;
+  uint64_t CrossShardAborts() const;
+
+ private:
+  /**
+   * @struct: Worker
+   * @brief : One shard's process and the router's end of its socket.
+   */
+  struct Worker {
+    pid_t pid;
+    int fd;
+    bool broken;  ///< The socket failed mid-exchange; no more calls
+  };
+
+  std::vector<Worker> workers_;  ///< Indexed by shard
+  DedupIndex transfer_keys_;     ///< Idempotency keys of transfers
+  uint64_t next_txid_;           ///< Two-phase transaction ids
+  uint64_t commits_;             ///< Cross-shard transfers committed
+  uint64_t aborts_;              ///< Cross-shard transfers aborted
+
+  /// Both mark the shard broken when its socket fails.
+  bool Send(size_t shard, uint8_t op, const std::vector<uint8_t> &payload);
+  bool Receive(size_t shard, uint8_t *status, std::vector<uint8_t> *payload);
+  bool Call(size_t shard, uint8_t op, const std::vector<uint8_t> &payload,
+            uint8_t *status, std::vector<uint8_t> *reply);
+};
+
+#endif  // _HOME_SARA_DOCUMENTS_ROBOBANKPORTFOLIO_INC_SHARDEDPORTFOLIO_HPP_
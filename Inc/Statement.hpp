@@ -0,0 +1,121 @@
+// Copyright 2025 Sara Saad
+
+/**
+ * @file : Statement.hpp
+ * @brief: Streaming, buffered formatter for account statements.
+ *
+ * A StatementWriter formats statements straight out of an account's audit
+ * trail into one preallocated buffer and hands the buffer to fwrite() only
+ * when it is full, so a statement run needs no per-account copies, no
+ * iostreams and one large write per buffer. Portfolio::WriteStatements()
+ * runs one writer per partition of the book on the thread pool; memory is
+ * bounded by partitions * buffer_bytes regardless of the book size.
+ *
+ * Text layout (one line each, fields right-aligned and space-padded):
+ *   S <id:24, left-aligned> <from:12> <to:12> <opening:16>
+ *   T <ts:12> <kind:3> <amount:16> <balance:16> <note:24, truncated>
+ *   E <id:24, left-aligned> <count:8> <closing:16>
+ *
+ * Binary layout (little-endian, no padding):
+ *   'S' u8 id_len, id, i64 from, i64 to, i64 opening
+ *   'T' u8 kind, i64 ts, i64 amount, i64 balance, u8 note_len, note
+ *   'E' u32 count, i64 closing
+ * with id and note cut to 255 and kNoteWidth bytes.
+ *
+ * A statement whose period may reach back past the account's retained audit
+ * trail is written with a 'P' (partial) header instead of 'S', in both
+ * layouts; see StatementWriter::Write().
+ *
+ */
+#ifndef _HOME_SARA_DOCUMENTS_ROBOBANKPORTFOLIO_INC_STATEMENT_HPP_
+#define _HOME_SARA_DOCUMENTS_ROBOBANKPORTFOLIO_INC_STATEMENT_HPP_
+
+/*************************** include part ****************************** */
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "../Inc/Types.hpp"
+///////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/************************************ Class Part
+ * ************************************* */
+/**
+ * @class: StatementWriter
+ * @brief: Formats statements of many accounts into one output file.
+ *
+ */
+class StatementWriter {
+ public:
+  static constexpr size_t kIdWidth = 24;    ///< Text id column
+  static constexpr size_t kNoteWidth = 24;  ///< Note column / binary limit
+  static constexpr size_t kAuditCapacity = 1000;  ///< Records an account keeps
+
+  /**
+   * @brief             : Prepare a writer; nothing is written yet.
+   * @param file        : Open output file; not closed by the writer.
+   * @param format      : Text or binary.
+   * @param buffer_bytes: Size of the write buffer (at least 4 KiB is used).
+   */
+  StatementWriter(FILE *file, StatementFormat format, size_t buffer_bytes);
+
+  /**
+   * @brief        : Append the statement of one account.
+   * @param id     : The account ID.
+   * @param balance: The account's current balance.
+   * @param audit  : The account's audit trail, oldest first.
+   * @param from   : First second of the period.
+   * @param to     : Last second of the period, inclusive.
+   * @return       : bool False if the statement was flagged partial.
+   *
+   * @details:
+   * The opening and closing balances are derived from the current balance
+   * by backing out the audited changes after the period, so the audit trail
+   * must still hold everything from the start of the period onwards. An
+   * account keeps only its last kAuditCapacity records: when the trail is
+   * full and its oldest record is not older than from, earlier records of
+   * the period may have been dropped. The statement is then still written,
+   * from what is retained, but with a 'P' header: its opening balance is the
+   * one before the oldest retained record and lines may be missing.
+   *
+   */
+  bool Write(const std::string &id, int64_t balance,
+             const std::vector<TxRecord> &audit, int64_t from, int64_t to);
+
+  /**
+   * @brief : Write out what is left in the buffer.
+   * @return: bool False if any write failed.
+   */
+  bool Finish();
+
+  size_t Transactions() const;  ///< Transaction lines written
+  size_t Partial() const;       ///< Statements flagged partial
+  uint64_t Bytes() const;       ///< Bytes handed to the file
+
+ private:
+  FILE *file_;               ///< Destination
+  StatementFormat format_;   ///< Layout
+  std::vector<char> buffer_;  ///< Preallocated output buffer
+  size_t used_;              ///< Bytes pending in buffer_
+  uint64_t bytes_;           ///< Bytes written so far
+  size_t transactions_;      ///< Transaction lines so far
+  size_t partial_;           ///< Statements flagged partial so far
+  bool ok_;                  ///< No write has failed
+
+  /**
+   * @brief  : Room for n more bytes, flushing first if needed.
+   * @return : char* Where to write them; Commit() the bytes used.
+   */
+  char *Reserve(size_t n);
+  void Commit(char *end);
+  void Flush();
+
+  void WriteHeader(char tag, const std::string &id, int64_t from, int64_t to,
+                   int64_t opening);
+  void WriteLine(const TxRecord &rec, int64_t balance);
+  void WriteFooter(const std::string &id, uint32_t count, int64_t closing);
+};
+
+#endif  // _HOME_SARA_DOCUMENTS_ROBOBANKPORTFOLIO_INC_STATEMENT_HPP_
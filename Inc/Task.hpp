@@ -0,0 +1,173 @@
+// Copyright 2025 Sara Saad
+
+/**
+ * @file : Task.hpp
+ * @brief: Minimal C++20 coroutine task type used by the asynchronous API.
+ *
+ * A Task<T> is lazy: its body starts when it is first awaited, and when it
+ * finishes it resumes its awaiter directly (symmetric transfer), so chains of
+ * awaits do not grow the stack. SyncWait() runs a task to completion from
+ * ordinary blocking code such as main() or a unit test. Like the rest of the
+ * library, tasks do not use exceptions: an escaping exception terminates.
+ *
+ */
+#ifndef _HOME_SARA_DOCUMENTS_ROBOBANKPORTFOLIO_INC_TASK_HPP_
+#define _HOME_SARA_DOCUMENTS_ROBOBANKPORTFOLIO_INC_TASK_HPP_
+
+/*************************** include part ****************************** */
+#include <coroutine>
+#include <exception>
+#include <latch>
+#include <optional>
+#include <type_traits>
+#include <utility>
+///////////////////////////////////////////////////////////////////////////////////////////////////////
+
+template <typename T>
+class Task;
+
+/************************************ Promise Part
+ * ************************************* */
+/**
+ * @struct: TaskPromiseBase
+ * @brief : Parts of the promise shared by every Task<T>.
+ *
+ */
+struct TaskPromiseBase {
+  std::coroutine_handle<> continuation;  ///< Awaiter to resume when done
+
+  struct FinalAwaiter {
+    bool await_ready() const noexcept { return (false); }
+
+    template <typename Promise>
+    std::coroutine_handle<> await_suspend(
+        std::coroutine_handle<Promise> done) noexcept {
+      std::coroutine_handle<> next = done.promise().continuation;
+      return (next ? next : std::noop_coroutine());
+    }
+
+    void await_resume() const noexcept {}
+  };
+
+  std::suspend_always initial_suspend() const noexcept { return {}; }
+  FinalAwaiter final_suspend() const noexcept { return {}; }
+  void unhandled_exception() const noexcept { std::terminate(); }
+};
+
+template <typename T>
+struct TaskPromise : TaskPromiseBase {
+  std::optional<T> value;  ///< Result, set by co_return
+
+  Task<T> get_return_object();
+  void return_value(T result) { value.emplace(std::move(result)); }
+  T Take() { return (std::move(*value)); }
+};
+
+template <>
+struct TaskPromise<void> : TaskPromiseBase {
+  Task<void> get_return_object();
+  void return_void() const noexcept {}
+  void Take() const noexcept {}
+};
+
+/************************************ Class Part
+ * ************************************* */
+/**
+ * @class: Task
+ * @brief: Awaitable result of an asynchronous Portfolio operation.
+ *
+ */
+template <typename T>
+class Task {
+ public:
+  using promise_type = TaskPromise<T>;
+  using Handle = std::coroutine_handle<promise_type>;
+
+  explicit Task(Handle handle) : handle_(handle) {}
+  Task(Task &&other) noexcept : handle_(std::exchange(other.handle_, {})) {}
+  Task(const Task &) = delete;
+  Task &operator=(const Task &) = delete;
+  ~Task() {
+    if (handle_) {
+      handle_.destroy();
+    }
+  }
+
+  bool await_ready() const noexcept { return (false); }
+
+  std::coroutine_handle<> await_suspend(std::coroutine_handle<> caller) {
+    handle_.promise().continuation = caller;
+    return (handle_);
+  }
+
+  T await_resume() { return (handle_.promise().Take()); }
+
+ private:
+  Handle handle_;  ///< The coroutine frame, owned by the task
+};
+
+template <typename T>
+Task<T> TaskPromise<T>::get_return_object() {
+  return (Task<T>(Task<T>::Handle::from_promise(*this)));
+}
+
+inline Task<void> TaskPromise<void>::get_return_object() {
+  return (Task<void>(Task<void>::Handle::from_promise(*this)));
+}
+
+/************************************ Function Part
+ * ************************************* */
+namespace task_detail {
+
+/**
+ * @struct: Detached
+ * @brief : Eagerly started, self-destroying coroutine used by SyncWait().
+ */
+struct Detached {
+  struct promise_type {
+    Detached get_return_object() const noexcept { return {}; }
+    std::suspend_never initial_suspend() const noexcept { return {}; }
+    std::suspend_never final_suspend() const noexcept { return {}; }
+    void return_void() const noexcept {}
+    void unhandled_exception() const noexcept { std::terminate(); }
+  };
+};
+
+template <typename T>
+Detached RunAndSignal(Task<T> *task, std::optional<T> *out,
+                      std::latch *done) {
+  out->emplace(co_await *task);
+  done->count_down();
+}
+
+inline Detached RunAndSignal(Task<void> *task, std::optional<bool> *out,
+                             std::latch *done) {
+  co_await *task;
+  out->emplace(true);
+  done->count_down();
+}
+
+}  // namespace task_detail
+
+/**
+ * @brief     : Block the calling thread until a task has completed.
+ * @param task: The task to run.
+ * @return    : T The value the task returned.
+ *
+ */
+template <typename T>
+T SyncWait(Task<T> task) {
+  std::latch done(1);
+  if constexpr (std::is_void_v<T>) {
+    std::optional<bool> ignored;
+    task_detail::RunAndSignal(&task, &ignored, &done);
+    done.wait();
+  } else {
+    std::optional<T> result;
+    task_detail::RunAndSignal(&task, &result, &done);
+    done.wait();
+    return (std::move(*result));
+  }
+}
+
+#endif  // _HOME_SARA_DOCUMENTS_ROBOBANKPORTFOLIO_INC_TASK_HPP_
@@ -0,0 +1,171 @@
+// Copyright 2025 Sara Saad
+
+/**
+ * @file : ThreadPool.hpp
+ * @brief: Shared work-stealing thread pool and serializing strand.
+ *
+ * One ThreadPool is shared by every parallel operation of the library (batch
+ * apply, accrual, fee sweeps, scans, snapshots, the async API) so that
+ * overlapping bulk jobs never oversubscribe the machine. Each worker owns a
+ * job queue; a job posted with an affinity key (the account shard) always
+ * lands on the same worker, which keeps that shard's accounts warm in its
+ * cache, and idle workers steal from the others. Workers can be pinned to
+ * CPUs grouped by NUMA node, so that neighbouring shards share a node.
+ * A Strand runs the jobs posted to it one at a time, in order, on the pool.
+ *
+ */
+#ifndef _HOME_SARA_DOCUMENTS_ROBOBANKPORTFOLIO_INC_THREADPOOL_HPP_
+#define _HOME_SARA_DOCUMENTS_ROBOBANKPORTFOLIO_INC_THREADPOOL_HPP_
+
+/*************************** include part ****************************** */
+#include <atomic>
+#include <condition_variable>
+#include <coroutine>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+///////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/************************************ Class Part
+ * ************************************* */
+/**
+ * @class: ThreadPool
+ * @brief: Work-stealing pool with per-shard task affinity.
+ *
+ */
+class ThreadPool {
+ public:
+  /**
+   * @brief            : Start the workers.
+   * @param threads    : Number of workers; 0 means one per hardware thread.
+   * @param pin_workers: Pin worker i to a CPU, CPUs ordered by NUMA node
+   * (Linux only; ignored elsewhere).
+   */
+  explicit ThreadPool(size_t threads, bool pin_workers = false);
+
+  /**
+   * @brief: Finish every queued job, then stop and join the workers.
+   */
+  ~ThreadPool();
+
+  ThreadPool(const ThreadPool &) = delete;
+  ThreadPool &operator=(const ThreadPool &) = delete;
+
+  /**
+   * @brief : The process-wide pool used by default by every Portfolio.
+   */
+  static ThreadPool *Shared();
+
+  /**
+   * @brief    : Queue a job. From a worker it goes to that worker's own queue,
+   * otherwise the queues are used round-robin.
+   * @param job: The job to run on some worker.
+   */
+  void Post(std::function<void()> job);
+
+  /**
+   * @brief         : Queue a job on the worker that owns an affinity key.
+   * @param job     : The job to run.
+   * @param affinity: Typically the shard number; key % Size() picks the queue.
+   */
+  void Post(std::function<void()> job, size_t affinity);
+
+  /**
+   * @brief      : Run body(shard) for every shard in [0, count) and wait.
+   * @param count: Number of shards.
+   * @param body : Work for one shard. Shard s runs with affinity s.
+   *
+   * @details:
+   * The calling thread helps run queued jobs while it waits, so ParallelFor
+   * may be called from inside a pool job (e.g. from a Strand) without
+   * deadlocking.
+   *
+   */
+  void ParallelFor(size_t count, const std::function<void(size_t)> &body);
+
+  size_t Size() const;  ///< Number of workers
+
+  /**
+   * @struct: ScheduleAwaiter
+   * @brief : co_await pool.Schedule() resumes the coroutine on a worker.
+   */
+  struct ScheduleAwaiter {
+    ThreadPool *pool;
+    bool await_ready() const noexcept { return (false); }
+    void await_suspend(std::coroutine_handle<> handle) const {
+      pool->Post([handle]() { handle.resume(); });
+    }
+    void await_resume() const noexcept {}
+  };
+
+  ScheduleAwaiter Schedule() { return (ScheduleAwaiter{this}); }
+
+ private:
+  /**
+   * @struct: Queue
+   * @brief : Jobs of one worker. The owner pops from the back, thieves take
+   * from the front.
+   */
+  struct Queue {
+    std::mutex mutex;
+    std::deque<std::function<void()>> jobs;
+  };
+
+  std::vector<std::unique_ptr<Queue>> queues_;  ///< One per worker
+  std::vector<std::thread> workers_;            ///< Worker threads
+  std::atomic<size_t> pending_{0};              ///< Jobs queued, all queues
+  std::atomic<size_t> next_{0};                 ///< Round-robin cursor
+  std::mutex sleep_mutex_;                      ///< Guards sleeping/stopping_
+  std::condition_variable wake_;                ///< Signals new jobs
+  bool stopping_ = false;                       ///< Set by the destructor
+
+  void Push(size_t queue, std::function<void()> job);
+  bool TryRunOne(size_t home);
+  void WorkerLoop(size_t index);
+  static void PinToCpu(size_t index);
+};
+
+/**
+ * @class: Strand
+ * @brief: Runs the jobs posted to it one at a time, in posting order.
+ *
+ */
+class Strand {
+ public:
+  explicit Strand(ThreadPool *pool);
+
+  /**
+   * @brief    : Queue a job behind every job already posted to this strand.
+   * @param job: The job to run.
+   */
+  void Post(std::function<void()> job);
+
+  /**
+   * @struct: EnterAwaiter
+   * @brief : co_await strand.Enter() resumes the coroutine on the strand.
+   */
+  struct EnterAwaiter {
+    Strand *strand;
+    bool await_ready() const noexcept { return (false); }
+    void await_suspend(std::coroutine_handle<> handle) const {
+      strand->Post([handle]() { handle.resume(); });
+    }
+    void await_resume() const noexcept {}
+  };
+
+  EnterAwaiter Enter() { return (EnterAwaiter{this}); }
+
+ private:
+  ThreadPool *pool_;                        ///< Where the jobs run
+  std::deque<std::function<void()>> jobs_;  ///< Jobs not yet run
+  std::mutex mutex_;                        ///< Guards jobs_ and running_
+  bool running_ = false;                    ///< A drain job is on the pool
+
+  void Drain();
+};
+
+#endif  // _HOME_SARA_DOCUMENTS_ROBOBANKPORTFOLIO_INC_THREADPOOL_HPP_
@@ -30,6 +30,7 @@
  * ​***************************************** */
 #include <cstdint>
 #include <string>
+#include <vector>
 
 #include "../Inc/Calculator.hpp"
 /******************************************** Macros Part
@@ -98,6 +99,25 @@ struct AccountSettings {
   int64_t fee_flat_cents;  ///< Flat fee amount in cents
 };
 
+/**
+ * @struct: AccrualPolicy
+ * @brief : Controls lazy accrual of interest and fees.
+ * With lazy accrual an account remembers when it last accrued and posts the
+ * interest for the whole days elapsed since then and one fee per full fee
+ * cycle, in time order, when a transaction reaches it or when the Portfolio
+ * is asked for BalanceAt() or AccrueAll(). Plain reads (GetBalance(),
+ * TotalExposure(), Snapshot(), GroupExposure()) do not accrue and return the
+ * balance as of the last accrual. No periodic pass over the book is needed.
+ *
+ */
+struct AccrualPolicy {
+  bool lazy_interest;  ///< Accrue interest at apr on actual elapsed days
+
+  bool lazy_fees;  ///< Charge fee_flat_cents once per elapsed fee cycle
+
+  int32_t fee_cycle_days;  ///< Length of a fee cycle in days
+};
+
 /**
  * @struct: TxRecord
  * @brief : Represents a single financial transaction performed on an account.
@@ -117,6 +137,8 @@ struct TxRecord {
 
   std::string account_id;  ///< The unique identifier of the account involved in
                            ///< the transaction.
+
+  uint64_t idempotency_key = 0;  ///< Upstream transaction ID; 0 means none.
 };
 
 /**
@@ -139,6 +161,279 @@ struct TransferRecord {
 
   std::string note;  ///< Optional note describing the purpose or details of the
                      ///< transfer.
+
+  uint64_t idempotency_key = 0;  ///< Upstream transfer ID; 0 means none.
+};
+
+/**
+ * @enum : DuplicatePolicy
+ * @brief: Tells the Portfolio what to do when an account ID is already in use.
+ *
+ */
+enum class DuplicatePolicy {
+  KREPLACE = 0,  ///< The new account replaces the existing one.
+
+  KSKIP,  ///< The new account is dropped and the existing one is kept.
+
+  KREJECT  ///< The whole operation fails and nothing is inserted.
+};
+
+/**
+ * @struct: AccountBatch
+ * @brief : Columnar description of many accounts to be onboarded at once.
+ * Every column must have the same length; row i of each column describes one
+ * account. The apr column is only used by savings accounts and the fee column
+ * only by checking accounts.
+ *
+ */
+struct AccountBatch {
+  std::vector<std::string> ids;  ///< Unique account identifiers
+
+  std::vector<AccountType> types;  ///< Type of each account
+
+  std::vector<double> aprs;  ///< Annual Percentage Rate of each account
+
+  std::vector<int64_t> fees_cents;  ///< Flat fee of each account in cents
+
+  std::vector<int64_t> opening_balances;  ///< Opening balance in cents
+};
+
+/**
+ * @struct: BookSnapshot
+ * @brief : Consistent point-in-time view of every balance in a Portfolio.
+ * balances[h] is the balance of the account with handle h (its position in
+ * the Portfolio), as of the end of the snapshot epoch.
+ *
+ */
+struct BookSnapshot {
+  uint64_t epoch;  ///< Snapshot epoch the view was taken at
+
+  std::vector<int64_t> balances;  ///< Balance per account handle, in cents
+
+  int64_t exposure;  ///< Sum of balances, in cents
+};
+
+/**
+ * @struct: AccountDigest
+ * @brief : Fingerprint of one account: final balance and a hash of its audit.
+ * Used to compare a replayed book against a recorded one.
+ *
+ */
+struct AccountDigest {
+  std::string account_id;  ///< The account the digest belongs to
+
+  int64_t balance_cents;  ///< Balance in cents
+
+  uint64_t audit_digest;  ///< Hash of (kind, amount, timestamp) of the audit
+};
+
+/**
+ * @struct: BalancePoint
+ * @brief : Balance of an account from a point in time on.
+ */
+struct BalancePoint {
+  int64_t timestamp;      ///< Time of the change (or start of a range)
+  int64_t balance_cents;  ///< Balance from then on
+};
+
+/**
+ * @enum : StatementFormat
+ * @brief: Layout of generated statements.
+ */
+enum class StatementFormat {
+  KTEXT = 0,  ///< Fixed-width text lines
+
+  KBINARY,  ///< Little-endian records
+};
+
+/**
+ * @struct: StatementRequest
+ * @brief : What Portfolio::WriteStatements() produces and where.
+ *
+ */
+struct StatementRequest {
+  int64_t from_ts;  ///< First second of the statement period
+  int64_t to_ts;    ///< Last second of the statement period, inclusive
+  StatementFormat format;   ///< Output layout
+  std::string path_prefix;  ///< Output files are <prefix>.<partition>
+  size_t partitions;        ///< Output files / parallel writers, >= 1
+  size_t buffer_bytes;      ///< Write buffer per writer
+};
+
+/**
+ * @struct: StatementSummary
+ * @brief : Result of a statement run.
+ *
+ */
+struct StatementSummary {
+  size_t accounts;                 ///< Statements written
+  size_t transactions;             ///< Transaction lines written
+  uint64_t bytes;                  ///< Total bytes written
+  std::vector<std::string> files;  ///< Files written, one per partition
+  size_t partial;                  ///< Statements flagged partial ('P')
+};
+
+/**
+ * @struct: AuditExportRequest
+ * @brief : Where Portfolio::ExportAudit() writes the audit archive.
+ *
+ */
+struct AuditExportRequest {
+  std::string path_prefix;  ///< Output files are <prefix>.<partition>
+  size_t partitions;        ///< Output files / parallel writers, >= 1
+  size_t group_rows;        ///< Rows per row group (0 for the default)
+};
+
+/**
+ * @struct: AuditExportSummary
+ * @brief : Result of an audit export.
+ *
+ */
+struct AuditExportSummary {
+  size_t accounts;                 ///< Accounts exported
+  size_t rows;                     ///< Audit records written
+  uint64_t bytes;                  ///< Total bytes written
+  std::vector<std::string> files;  ///< Files written, one per partition
+};
+
+/**
+ * @struct: ReconcileRequest
+ * @brief : What Portfolio::Reconcile() compares and with what resources.
+ *
+ */
+struct ReconcileRequest {
+  int64_t from_ts;      ///< First second of the window
+  int64_t to_ts;        ///< Last second of the window, inclusive
+  size_t partitions;    ///< Parallel sort-merge partitions, >= 1
+  size_t memory_bytes;  ///< Buffered records spill to disk beyond this
+  size_t merge_fan_in;  ///< Runs merged per pass, >= 2; 0 for the default
+};
+
+/**
+ * @struct: ReconcileSummary
+ * @brief : Result of a reconciliation.
+ *
+ */
+struct ReconcileSummary {
+  size_t matched;                ///< Records equal on both sides
+  size_t missing_from_book;      ///< External records without a counterpart
+  size_t missing_from_external;  ///< Book records without a counterpart
+  size_t mismatched;             ///< Pairs differing in kind or amount
+  size_t runs_spilled;           ///< Sorted runs written to disk
+  uint64_t bytes_spilled;        ///< Bytes written to disk, merges included
+  size_t merge_passes;           ///< Runs merged into one on disk
+};
+
+/**
+ * @struct: GroupAssignment
+ * @brief : One account moved by Portfolio::Regroup().
+ *
+ */
+struct GroupAssignment {
+  std::string account_id;  ///< The account
+  std::string group;       ///< Its new group; empty to ungroup it
+};
+
+/**
+ * @struct: GroupTotal
+ * @brief : Rolled-up totals of an account group and its subgroups.
+ *
+ */
+struct GroupTotal {
+  int64_t exposure;  ///< Sum of balances, in cents
+  size_t accounts;   ///< Accounts in the group and its subgroups
+};
+
+/**
+ * @struct: DedupStats
+ * @brief : Counters of the Portfolio's idempotency index.
+ *
+ */
+struct DedupStats {
+  uint64_t admitted;        ///< Keyed records seen for the first time
+  uint64_t duplicates;      ///< Keyed records rejected as repeats
+  uint64_t filter_skips;    ///< Older-window probes avoided by the filter
+  size_t keys_retained;     ///< Keys currently remembered
+  size_t memory_bytes;      ///< Memory held by the index
+  uint64_t clamped_jumps;   ///< Records stamped more than a window ahead
+};
+
+/**
+ * @struct: AccountView
+ * @brief : Copy of an account's state, for callers that cannot hold the
+ * account itself (e.g. the router of a ShardedPortfolio).
+ *
+ */
+struct AccountView {
+  std::string account_id;    ///< The account ID
+  AccountSettings settings;  ///< Type, APR and flat fee
+  int64_t balance_cents;     ///< Balance in cents
+  size_t audit_size;         ///< Records in the audit trail
+};
+
+/**
+ * @struct: ReplicationStats
+ * @brief : Progress of a replication ring, from both of its sides.
+ *
+ */
+struct ReplicationStats {
+  uint64_t published;       ///< Entries published by the primary
+  uint64_t published_bytes; ///< Ring bytes written, headers included
+  uint64_t applied;         ///< Entries replayed by the follower
+  uint64_t lag_entries;     ///< Published but not yet replayed
+  uint64_t lag_bytes;       ///< Ring bytes not yet replayed
+  uint64_t stalls;          ///< Times the primary found the ring full
+  uint64_t oversized;       ///< Entries over MaxEntry(), not published
+  uint64_t last_lag_ns;     ///< Publish-to-replay delay of the last entry
+};
+
+/**
+ * @struct: TieringStats
+ * @brief : Hot/cold split of a Portfolio's accounts.
+ *
+ */
+struct TieringStats {
+  size_t resident;      ///< Accounts held as objects
+  size_t cold;          ///< Accounts held in encoded form
+  size_t cold_bytes;    ///< Memory held by the encoded accounts
+  uint64_t demotions;   ///< Accounts frozen so far
+  uint64_t promotions;  ///< Accounts thawed so far
+};
+
+/**
+ * @enum : VelocityWindow
+ * @brief: Trailing windows of the per-account velocity statistics.
+ *
+ */
+enum class VelocityWindow {
+  KMINUTE = 0,  ///< The last 60 seconds
+
+  KHOUR,  ///< The last 3600 seconds
+
+  KDAY,  ///< The last 86400 seconds
+};
+
+/**
+ * @struct: VelocityStat
+ * @brief : Activity of one account of one kind within a trailing window.
+ *
+ */
+struct VelocityStat {
+  uint32_t count;     ///< Records in the window
+  int64_t sum_cents;  ///< Sum of their amounts
+};
+
+/**
+ * @struct: FeeSweepSummary
+ * @brief : Result of a portfolio-wide fee sweep.
+ *
+ */
+struct FeeSweepSummary {
+  int64_t total_fees_cents;  ///< Sum of all fees charged
+
+  size_t accounts_charged;  ///< Number of accounts charged a fee
+
+  std::vector<int64_t> fees_per_thread;  ///< Fees collected by each worker
 };
 
 #endif  // _HOME_SARA_DOCUMENTS_ROBOBANKPORTFOLIO_INC_TYPES_HPP_
@@ -0,0 +1,109 @@
+// Copyright 2025 Sara Saad
+
+/**
+ * @file : VelocityTracker.hpp
+ * @brief: Sliding-window activity counters per account, for inline risk
+ * checks.
+ *
+ * Every record an account writes to its audit trail is also counted here, per
+ * transaction kind, in three rings of time buckets: 7 buckets of 10 s for the
+ * minute window, 7 of 10 min for the hour window and 13 of 2 h for the day
+ * window. A bucket is a 16-byte cell stamped with the time slot it counts; a
+ * record landing on a cell that still holds an older slot restarts it, so
+ * nothing ever has to be expired in the background. A record updates one
+ * cell per ring, and a query sums the 7 or 13 adjacent cells of one ring
+ * whose slot lies within the window: a fixed, small amount of work,
+ * independent of how many records the account has.
+ *
+ * Windows are bucket-aligned: a window of W seconds reports the records of
+ * the last W seconds plus those of the older part of its oldest bucket, so
+ * it may over-count by less than one bucket and never under-counts, which is
+ * the safe side for a limit check.
+ *
+ */
+#ifndef _HOME_SARA_DOCUMENTS_ROBOBANKPORTFOLIO_INC_VELOCITYTRACKER_HPP_
+#define _HOME_SARA_DOCUMENTS_ROBOBANKPORTFOLIO_INC_VELOCITYTRACKER_HPP_
+
+/*************************** include part ****************************** */
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "../Inc/Types.hpp"
+///////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/************************************ Class Part
+ * ************************************* */
+/**
+ * @class: VelocityTracker
+ * @brief: Time-bucketed count and sum per account, kind and window.
+ *
+ * The rings of an (account, kind) pair are allocated on its first record, so
+ * an account costs one pointer per kind plus 432 bytes per kind it uses. Record() may be called concurrently for
+ * different accounts; Get() must not run concurrently with a Record() of the
+ * same account, and the other methods require that no Record() runs.
+ *
+ */
+class VelocityTracker {
+ public:
+  static constexpr size_t kKinds = 6;  ///< TxKind values
+
+  /**
+   * @brief       : Track handles [0, count); handles at or past count are
+   * forgotten.
+   */
+  void Resize(size_t count);
+
+  /**
+   * @brief       : Forget the activity of one account (it was replaced).
+   */
+  void Reset(uint32_t handle);
+
+  /**
+   * @brief       : Count one audit record.
+   * @param handle: The account that wrote it.
+   * @param rec   : The record; its timestamp picks the buckets. Records older
+   * than a window are not counted in it. Time slots are 32-bit, which covers
+   * timestamps up to the year 2600.
+   */
+  void Record(uint32_t handle, const TxRecord &rec);
+
+  /**
+   * @brief       : Activity of one account in a trailing window.
+   * @param handle: The account.
+   * @param kind  : Which records to count.
+   * @param window: The window, ending at now.
+   * @param now   : The current time; records stamped after it are included.
+   * @return      : VelocityStat Count and sum of the amounts.
+   */
+  VelocityStat Get(uint32_t handle, TxKind kind, VelocityWindow window,
+                   int64_t now) const;
+
+  size_t Bytes() const;  ///< Memory held by the counters
+
+ private:
+  static constexpr size_t kBuckets = 27;  ///< Cells of all three rings
+
+  /**
+   * @struct: Cell
+   * @brief : One time slot of one ring.
+   */
+  struct Cell {
+    int32_t slot;    ///< Time slot counted, INT32_MIN if unused
+    uint32_t count;  ///< Records in the slot
+    int64_t sum;     ///< Sum of their amounts
+  };
+
+  /**
+   * @struct: Rings
+   * @brief : The three rings of one account and kind.
+   */
+  struct Rings {
+    Cell cells[kBuckets];
+  };
+
+  std::vector<std::unique_ptr<Rings>> rings_;  ///< By handle * kKinds + kind
+};
+
+#endif  // _HOME_SARA_DOCUMENTS_ROBOBANKPORTFOLIO_INC_VELOCITYTRACKER_HPP_
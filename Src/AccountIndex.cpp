@@ -0,0 +1,243 @@
+// Copyright 2025 Sara Saad
+
+/******************************************* INCLUDE PART
+ * **************************************** */
+#include "../Inc/AccountIndex.hpp"
+
+#include <cstring>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+namespace {
+
+constexpr int8_t kEmpty = -128;   ///< Slot never used
+constexpr int8_t kDeleted = -2;   ///< Slot erased, probing continues past it
+
+inline int8_t H2(uint64_t hash) { return static_cast<int8_t>(hash & 0x7F); }
+
+/**
+ * @brief: Bitmask of the bytes of a 16-byte control group equal to tag.
+ */
+inline uint32_t MatchGroup(const int8_t *group, int8_t tag) {
+#if defined(__SSE2__)
+  __m128i ctrl = _mm_loadu_si128(reinterpret_cast<const __m128i *>(group));
+  return static_cast<uint32_t>(
+      _mm_movemask_epi8(_mm_cmpeq_epi8(ctrl, _mm_set1_epi8(tag))));
+#else
+  uint32_t mask = 0;
+  for (uint32_t i = 0; i < 16; i++) {
+    if (group[i] == tag) {
+      mask |= (1u << i);
+    }
+  }
+  return (mask);
+#endif
+}
+
+/**
+ * @brief: Bitmask of the empty or deleted bytes of a control group.
+ */
+inline uint32_t MatchFree(const int8_t *group) {
+#if defined(__SSE2__)
+  // Full tags are 0..127, both free tags have the sign bit set.
+  __m128i ctrl = _mm_loadu_si128(reinterpret_cast<const __m128i *>(group));
+  return static_cast<uint32_t>(_mm_movemask_epi8(ctrl));
+#else
+  uint32_t mask = 0;
+  for (uint32_t i = 0; i < 16; i++) {
+    if (group[i] < 0) {
+      mask |= (1u << i);
+    }
+  }
+  return (mask);
+#endif
+}
+
+inline uint32_t LowestBit(uint32_t mask) {
+  return static_cast<uint32_t>(__builtin_ctz(mask));
+}
+
+}  // namespace
+
+uint64_t AccountIndex::Hash(std::string_view id) {
+  // FNV-1a followed by the MurmurHash3 finalizer so that the low 7 bits (the
+  // control tag) and the high bits (the group) are both well mixed.
+  uint64_t h = 1469598103934665603ULL;
+  for (char c : id) {
+    h ^= static_cast<uint8_t>(c);
+    h *= 1099511628211ULL;
+  }
+  h ^= h >> 33;
+  h *= 0xff51afd7ed558ccdULL;
+  h ^= h >> 33;
+  h *= 0xc4ceb9fe1a85ec53ULL;
+  h ^= h >> 33;
+  return (h);
+}
+
+bool AccountIndex::KeyEquals(const Slot &slot, std::string_view id) const {
+  if (slot.length == kLongKey) {
+    uint32_t pos;
+    std::memcpy(&pos, slot.key, sizeof(pos));
+    return (long_keys_[pos] == id);
+  }
+  return (slot.length == id.size() &&
+          std::memcmp(slot.key, id.data(), id.size()) == 0);
+}
+
+void AccountIndex::EncodeKey(Slot *slot, std::string_view id) {
+  if (id.size() <= kInlineKey) {
+    slot->length = static_cast<uint8_t>(id.size());
+    std::memcpy(slot->key, id.data(), id.size());
+  } else {
+    uint32_t pos = static_cast<uint32_t>(long_keys_.size());
+    long_keys_.emplace_back(id);
+    slot->length = kLongKey;
+    std::memcpy(slot->key, &pos, sizeof(pos));
+  }
+}
+
+size_t AccountIndex::FindSlot(std::string_view id, uint64_t hash) const {
+  if (slots_.empty()) {
+    return (SIZE_MAX);
+  }
+
+  const size_t group_mask = slots_.size() / kGroupWidth - 1;
+  size_t group = (hash >> 7) & group_mask;
+  const int8_t tag = H2(hash);
+
+  for (size_t step = 1;; step++) {
+    const size_t base = group * kGroupWidth;
+    const int8_t *ctrl = ctrl_.data() + base;
+
+    for (uint32_t match = MatchGroup(ctrl, tag); match; match &= match - 1) {
+      const size_t pos = base + LowestBit(match);
+      if (slots_[pos].hash == hash && KeyEquals(slots_[pos], id)) {
+        return (pos);
+      }
+    }
+    if (MatchGroup(ctrl, kEmpty)) {
+      return (SIZE_MAX);
+    }
+    group = (group + step) & group_mask;
+  }
+}
+
+void AccountIndex::Place(uint64_t hash, const Slot &slot) {
+  const size_t group_mask = slots_.size() / kGroupWidth - 1;
+  size_t group = (hash >> 7) & group_mask;
+
+  for (size_t step = 1;; step++) {
+    const size_t base = group * kGroupWidth;
+    uint32_t free = MatchFree(ctrl_.data() + base);
+    if (free) {
+      const size_t pos = base + LowestBit(free);
+      if (ctrl_[pos] == kDeleted) {
+        tombstones_--;
+      }
+      ctrl_[pos] = H2(hash);
+      slots_[pos] = slot;
+      return;
+    }
+    group = (group + step) & group_mask;
+  }
+}
+
+void AccountIndex::Rehash(size_t capacity) {
+  std::vector<int8_t> old_ctrl(capacity, kEmpty);
+  std::vector<Slot> old_slots(capacity);
+  std::vector<std::string> old_long;
+  old_ctrl.swap(ctrl_);
+  old_slots.swap(slots_);
+  old_long.swap(long_keys_);
+  tombstones_ = 0;
+
+  for (size_t i = 0; i < old_ctrl.size(); i++) {
+    if (old_ctrl[i] < 0) {
+      continue;
+    }
+    Slot slot = old_slots[i];
+    if (slot.length == kLongKey) {
+      uint32_t pos;
+      std::memcpy(&pos, slot.key, sizeof(pos));
+      EncodeKey(&slot, old_long[pos]);
+    }
+    Place(slot.hash, slot);
+  }
+}
+
+void AccountIndex::Reserve(size_t count) {
+  size_t capacity = kGroupWidth;
+  while (capacity * 7 / 8 < count) {
+    capacity *= 2;
+  }
+  if (capacity > slots_.size()) {
+    Rehash(capacity);
+  }
+}
+
+uint32_t AccountIndex::Find(std::string_view id) const {
+  return (Find(id, Hash(id)));
+}
+
+uint32_t AccountIndex::Find(std::string_view id, uint64_t hash) const {
+  size_t pos = FindSlot(id, hash);
+  return (pos == SIZE_MAX ? kNotFound : slots_[pos].handle);
+}
+
+bool AccountIndex::Insert(std::string_view id, uint32_t handle) {
+  const uint64_t hash = Hash(id);
+  if (FindSlot(id, hash) != SIZE_MAX) {
+    return (false);
+  }
+
+  if ((size_ + tombstones_ + 1) * 8 > slots_.size() * 7) {
+    // Mostly tombstones: rehash in place, otherwise double.
+    if ((size_ + 1) * 16 <= slots_.size() * 7) {
+      Rehash(slots_.size());
+    } else {
+      Reserve(size_ + 1 > size_ * 2 ? size_ + 1 : size_ * 2);
+    }
+  }
+
+  Slot slot{};
+  slot.hash = hash;
+  slot.handle = handle;
+  EncodeKey(&slot, id);
+  Place(hash, slot);
+  size_++;
+  return (true);
+}
+
+bool AccountIndex::Assign(std::string_view id, uint32_t handle) {
+  size_t pos = FindSlot(id, Hash(id));
+  if (pos == SIZE_MAX) {
+    return (false);
+  }
+  slots_[pos].handle = handle;
+  return (true);
+}
+
+bool AccountIndex::Erase(std::string_view id) {
+  size_t pos = FindSlot(id, Hash(id));
+  if (pos == SIZE_MAX) {
+    return (false);
+  }
+  ctrl_[pos] = kDeleted;
+  size_--;
+  tombstones_++;
+  return (true);
+}
+
+size_t AccountIndex::Size() const { return (size_); }
+
+void AccountIndex::Clear() {
+  ctrl_.clear();
+  slots_.clear();
+  long_keys_.clear();
+  size_ = 0;
+  tombstones_ = 0;
+}
@@ -0,0 +1,42 @@
+// Copyright 2025 Sara Saad
+
+/******************************************* INCLUDE PART
+ * **************************************** */
+#include "../Inc/AsyncPortfolio.hpp"
+
+#include <utility>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+AsyncPortfolio::AsyncPortfolio(Portfolio *portfolio, ThreadPool *pool,
+                               JournalSink sink)
+    : portfolio_(portfolio), pool_(pool), writer_(pool),
+      sink_(std::move(sink)) {}
+
+Task<void> AsyncPortfolio::ApplyAllAsync(std::vector<TxRecord> txs) {
+  co_await writer_.Enter();
+  portfolio_->ApplyAll(txs);
+  // Leave the strand before resuming the caller so it can run the next write.
+  co_await pool_->Schedule();
+}
+
+Task<bool> AsyncPortfolio::TransferAsync(TransferRecord txr) {
+  co_await writer_.Enter();
+  bool done = portfolio_->Transfer(std::move(txr));
+  co_await pool_->Schedule();
+  co_return done;
+}
+
+Task<int64_t> AsyncPortfolio::TotalExposureAsync() {
+  co_await pool_->Schedule();
+  co_return portfolio_->TotalExposure();
+}
+
+Task<size_t> AsyncPortfolio::FlushJournalAsync() {
+  co_await writer_.Enter();
+  std::vector<TxRecord> records = portfolio_->DrainBatchAudit();
+  co_await pool_->Schedule();
+  if (sink_ && !records.empty()) {
+    sink_(records);
+  }
+  co_return records.size();
+}
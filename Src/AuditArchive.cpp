@@ -0,0 +1,396 @@
+// Copyright 2025 Sara Saad
+
+/******************************************* INCLUDE PART
+ * **************************************** */
+#include "../Inc/AuditArchive.hpp"
+
+#include <algorithm>
+#include <cstring>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+namespace {
+
+constexpr char kMagic[8] = {'R', 'B', 'A', 'U', 'D', 'I', 'T', '1'};
+
+enum Column : size_t {
+  KACCOUNTS = 0,
+  KKINDS,
+  KTIMESTAMPS,
+  KAMOUNTS,
+  KNOTES,
+  KKEYS,
+};
+
+constexpr unsigned kKindBits = 3;
+
+void PutVarint(std::vector<uint8_t> *out, uint64_t v) {
+  while (v >= 0x80) {
+    out->push_back(static_cast<uint8_t>(v | 0x80));
+    v >>= 7;
+  }
+  out->push_back(static_cast<uint8_t>(v));
+}
+
+uint64_t Zigzag(int64_t v) {
+  return ((static_cast<uint64_t>(v) << 1) ^ static_cast<uint64_t>(v >> 63));
+}
+
+int64_t Unzigzag(uint64_t v) {
+  return (static_cast<int64_t>(v >> 1) ^ -static_cast<int64_t>(v & 1));
+}
+
+void PutString(std::vector<uint8_t> *out, const std::string &s) {
+  PutVarint(out, s.size());
+  out->insert(out->end(), s.begin(), s.end());
+}
+
+/**
+ * @struct: Cursor
+ * @brief : Bounds-checked reader over one column; a read past the end
+ * leaves ok false and returns zeros.
+ */
+struct Cursor {
+  const uint8_t *p;
+  const uint8_t *end;
+  bool ok;
+
+  uint64_t Varint() {
+    uint64_t v = 0;
+    for (unsigned shift = 0; shift < 64; shift += 7) {
+      if (p == end) {
+        ok = false;
+        return (0);
+      }
+      const uint8_t byte = *p++;
+      v |= static_cast<uint64_t>(byte & 0x7f) << shift;
+      if (byte < 0x80) {
+        return (v);
+      }
+    }
+    ok = false;
+    return (0);
+  }
+
+  bool String(std::string *s) {
+    const uint64_t n = Varint();
+    if (!ok || n > static_cast<uint64_t>(end - p)) {
+      ok = false;
+      return (false);
+    }
+    s->assign(reinterpret_cast<const char *>(p), n);
+    p += n;
+    return (true);
+  }
+};
+
+}  // namespace
+
+/************************************ AuditArchiveWriter
+ * ************************************ */
+AuditArchiveWriter::AuditArchiveWriter(FILE *file, size_t group_rows)
+    : file_(file),
+      group_rows_(std::max<size_t>(group_rows, 1024)),
+      rows_(0),
+      total_rows_(0),
+      bytes_(0),
+      ok_(true),
+      run_rows_(0),
+      kind_bits_(0),
+      kind_nbits_(0),
+      last_ts_(0),
+      last_key_row_(0),
+      keyed_rows_(0) {
+  Write(kMagic, sizeof(kMagic));
+}
+
+void AuditArchiveWriter::Add(const std::string &id,
+                             const std::vector<TxRecord> &audit) {
+  for (const TxRecord &rec : audit) {
+    if (run_rows_ == 0) {
+      account_dict_.push_back(id);
+    }
+    run_rows_++;
+
+    kind_bits_ |= static_cast<uint64_t>(rec.kind) << kind_nbits_;
+    kind_nbits_ += kKindBits;
+    if (kind_nbits_ >= 8) {
+      columns_[KKINDS].push_back(static_cast<uint8_t>(kind_bits_));
+      kind_bits_ >>= 8;
+      kind_nbits_ -= 8;
+    }
+    PutVarint(&columns_[KTIMESTAMPS], Zigzag(rec.timestamp - last_ts_));
+    last_ts_ = rec.timestamp;
+    PutVarint(&columns_[KAMOUNTS], Zigzag(rec.amount_cents));
+    PutVarint(&columns_[KNOTES], NoteId(rec.note));
+    if (rec.idempotency_key != 0) {
+      PutVarint(&columns_[KKEYS], rows_ - last_key_row_);
+      PutVarint(&columns_[KKEYS], rec.idempotency_key);
+      last_key_row_ = rows_;
+      keyed_rows_++;
+    }
+
+    if (++rows_ == group_rows_) {
+      FlushGroup();
+    }
+  }
+  CloseRun();
+}
+
+bool AuditArchiveWriter::Finish() {
+  FlushGroup();
+  const uint32_t end = 0;
+  Write(&end, sizeof(end));
+  if (std::fflush(file_) != 0) {
+    ok_ = false;
+  }
+  return (ok_);
+}
+
+size_t AuditArchiveWriter::Rows() const { return (total_rows_ + rows_); }
+
+uint64_t AuditArchiveWriter::Bytes() const { return (bytes_); }
+
+uint32_t AuditArchiveWriter::NoteId(const char *note) {
+  if (!note) {
+    return (0);
+  }
+  auto cached = note_ptrs_.find(note);
+  if (cached != note_ptrs_.end()) {
+    return (cached->second);
+  }
+  auto [it, inserted] = note_ids_.try_emplace(
+      note, static_cast<uint32_t>(note_dict_.size() + 1));
+  if (inserted) {
+    note_dict_.push_back(it->first);
+  }
+  note_ptrs_.emplace(note, it->second);
+  return (it->second);
+}
+
+void AuditArchiveWriter::CloseRun() {
+  if (run_rows_ > 0) {
+    account_runs_.push_back(run_rows_);
+    run_rows_ = 0;
+  }
+}
+
+void AuditArchiveWriter::FlushGroup() {
+  CloseRun();
+  if (rows_ == 0) {
+    return;
+  }
+
+  // The dictionaries and counts only become known at the end of the group;
+  // they are written in front of their columns.
+  std::vector<uint8_t> &accounts = columns_[KACCOUNTS];
+  PutVarint(&accounts, account_dict_.size());
+  for (const std::string &id : account_dict_) {
+    PutString(&accounts, id);
+  }
+  for (uint32_t run : account_runs_) {
+    PutVarint(&accounts, run);
+  }
+  if (kind_nbits_ > 0) {
+    columns_[KKINDS].push_back(static_cast<uint8_t>(kind_bits_));
+  }
+  std::vector<uint8_t> note_head;
+  PutVarint(&note_head, note_dict_.size());
+  for (const std::string &note : note_dict_) {
+    PutString(&note_head, note);
+  }
+  std::vector<uint8_t> key_head;
+  PutVarint(&key_head, keyed_rows_);
+
+  uint32_t header[1 + kColumns];
+  header[0] = static_cast<uint32_t>(rows_);
+  for (size_t c = 0; c < kColumns; c++) {
+    header[1 + c] = static_cast<uint32_t>(columns_[c].size());
+  }
+  header[1 + KNOTES] += static_cast<uint32_t>(note_head.size());
+  header[1 + KKEYS] += static_cast<uint32_t>(key_head.size());
+
+  Write(header, sizeof(header));
+  for (size_t c = 0; c < kColumns; c++) {
+    if (c == KNOTES) {
+      Write(note_head.data(), note_head.size());
+    } else if (c == KKEYS) {
+      Write(key_head.data(), key_head.size());
+    }
+    Write(columns_[c].data(), columns_[c].size());
+    columns_[c].clear();
+  }
+
+  total_rows_ += rows_;
+  rows_ = 0;
+  kind_bits_ = 0;
+  kind_nbits_ = 0;
+  last_ts_ = 0;
+  last_key_row_ = 0;
+  keyed_rows_ = 0;
+  account_dict_.clear();
+  account_runs_.clear();
+  note_dict_.clear();
+  note_ids_.clear();
+  note_ptrs_.clear();
+}
+
+void AuditArchiveWriter::Write(const void *data, size_t n) {
+  if (n == 0 || !ok_) {
+    return;
+  }
+  if (std::fwrite(data, 1, n, file_) != n) {
+    ok_ = false;
+    return;
+  }
+  bytes_ += n;
+}
+
+/************************************ AuditArchiveReader
+ * ************************************ */
+AuditArchiveReader::AuditArchiveReader(FILE *file)
+    : file_(file), ok_(true), done_(false) {
+  char magic[sizeof(kMagic)];
+  ok_ = std::fread(magic, 1, sizeof(magic), file_) == sizeof(magic) &&
+        std::memcmp(magic, kMagic, sizeof(kMagic)) == 0;
+}
+
+bool AuditArchiveReader::Next(AuditColumns *columns) {
+  constexpr size_t kColumns = 6;
+  if (!ok_ || done_) {
+    return (false);
+  }
+  uint32_t rows = 0;
+  if (std::fread(&rows, sizeof(rows), 1, file_) != 1) {
+    ok_ = false;
+    return (false);
+  }
+  if (rows == 0) {
+    done_ = true;
+    return (false);
+  }
+  uint32_t sizes[kColumns];
+  if (std::fread(sizes, sizeof(sizes), 1, file_) != 1) {
+    ok_ = false;
+    return (false);
+  }
+  size_t total = 0;
+  for (uint32_t size : sizes) {
+    total += size;
+  }
+  buffer_.resize(total);
+  if (total > 0 && std::fread(buffer_.data(), 1, total, file_) != total) {
+    ok_ = false;
+    return (false);
+  }
+
+  Cursor cols[kColumns];
+  const uint8_t *at = buffer_.data();
+  for (size_t c = 0; c < kColumns; c++) {
+    cols[c] = Cursor{at, at + sizes[c], true};
+    at += sizes[c];
+  }
+
+  // Accounts: dictionary, then the rows of each run.
+  Cursor &acc = cols[KACCOUNTS];
+  const uint64_t runs = acc.Varint();
+  if (runs > rows) {
+    ok_ = false;
+    return (false);
+  }
+  columns->accounts.resize(runs);
+  columns->account_rows.resize(runs);
+  for (std::string &id : columns->accounts) {
+    acc.String(&id);
+  }
+  uint64_t run_total = 0;
+  for (uint32_t &run : columns->account_rows) {
+    run = static_cast<uint32_t>(acc.Varint());
+    run_total += run;
+  }
+
+  // Kinds: 3 bits per row, little-endian bit order.
+  const Cursor &kinds = cols[KKINDS];
+  const size_t kind_bytes = (static_cast<size_t>(rows) * kKindBits + 7) / 8;
+  bool kinds_ok = static_cast<size_t>(kinds.end - kinds.p) == kind_bytes;
+  columns->kinds.resize(rows);
+  if (kinds_ok) {
+    for (size_t r = 0; r < rows; r++) {
+      const size_t bit = r * kKindBits;
+      unsigned v = kinds.p[bit / 8] >> (bit % 8);
+      if (bit % 8 > 8 - kKindBits) {
+        v |= kinds.p[bit / 8 + 1] << (8 - bit % 8);
+      }
+      v &= (1u << kKindBits) - 1;
+      kinds_ok = kinds_ok && v <= static_cast<unsigned>(TxKind::KTRANSFEROUT);
+      columns->kinds[r] = static_cast<TxKind>(v);
+    }
+  }
+
+  columns->timestamps.resize(rows);
+  int64_t ts = 0;
+  for (int64_t &t : columns->timestamps) {
+    ts += Unzigzag(cols[KTIMESTAMPS].Varint());
+    t = ts;
+  }
+  columns->amounts.resize(rows);
+  for (int64_t &amount : columns->amounts) {
+    amount = Unzigzag(cols[KAMOUNTS].Varint());
+  }
+
+  Cursor &notes = cols[KNOTES];
+  const uint64_t note_count = notes.Varint();
+  if (note_count > static_cast<uint64_t>(notes.end - notes.p)) {
+    ok_ = false;
+    return (false);
+  }
+  columns->notes.resize(note_count);
+  for (std::string &note : columns->notes) {
+    notes.String(&note);
+  }
+  columns->note_ids.resize(rows);
+  bool notes_ok = true;
+  for (uint32_t &id : columns->note_ids) {
+    const uint64_t v = notes.Varint();
+    notes_ok = notes_ok && v <= note_count;
+    id = static_cast<uint32_t>(v);
+  }
+
+  Cursor &keys = cols[KKEYS];
+  columns->idempotency_keys.assign(rows, 0);
+  const uint64_t keyed = keys.Varint();
+  uint64_t row = 0;
+  bool keys_ok = keyed <= rows;
+  for (uint64_t k = 0; keys_ok && k < keyed; k++) {
+    row += keys.Varint();
+    const uint64_t key = keys.Varint();
+    keys_ok = row < rows;
+    if (keys_ok) {
+      columns->idempotency_keys[row] = key;
+    }
+  }
+
+  bool cols_ok = true;
+  for (const Cursor &cursor : cols) {
+    cols_ok = cols_ok && cursor.ok;
+  }
+  ok_ = cols_ok && run_total == rows && kinds_ok && notes_ok && keys_ok;
+  return (ok_);
+}
+
+bool AuditArchiveReader::Ok() const { return (ok_); }
+
+void AuditArchiveReader::ToRecords(const AuditColumns &columns,
+                                   std::vector<TxRecord> *records) {
+  records->clear();
+  records->reserve(columns.kinds.size());
+  size_t row = 0;
+  for (size_t run = 0; run < columns.accounts.size(); run++) {
+    for (uint32_t i = 0; i < columns.account_rows[run]; i++, row++) {
+      const uint32_t note = columns.note_ids[row];
+      records->push_back(TxRecord{
+          columns.kinds[row], columns.amounts[row], columns.timestamps[row],
+          note == 0 ? nullptr : columns.notes[note - 1].c_str(),
+          columns.accounts[run], columns.idempotency_keys[row]});
+    }
+  }
+}
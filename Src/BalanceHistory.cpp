@@ -0,0 +1,393 @@
+// Copyright 2025 Sara Saad
+
+/******************************************* INCLUDE PART
+ * **************************************** */
+#include "../Inc/BalanceHistory.hpp"
+
+#include <algorithm>
+#include <iterator>
+#include <limits>
+#include <map>
+#include <utility>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+namespace {
+
+/// Start of the segment that contains ts (floor, also for negative times).
+int64_t SegmentStart(int64_t ts, int64_t span) {
+  int64_t q = ts / span;
+  if (ts % span < 0) {
+    q--;
+  }
+  return (q * span);
+}
+
+void PutVarint(std::vector<uint8_t> *out, uint64_t v) {
+  while (v >= 0x80) {
+    out->push_back(static_cast<uint8_t>(v | 0x80));
+    v >>= 7;
+  }
+  out->push_back(static_cast<uint8_t>(v));
+}
+
+uint64_t GetVarint(const uint8_t **p) {
+  uint64_t v = 0;
+  for (int shift = 0;; shift += 7) {
+    uint8_t byte = *(*p)++;
+    v |= static_cast<uint64_t>(byte & 0x7F) << shift;
+    if (!(byte & 0x80)) {
+      return (v);
+    }
+  }
+}
+
+uint64_t ZigZag(int64_t v) {
+  return ((static_cast<uint64_t>(v) << 1) ^ static_cast<uint64_t>(v >> 63));
+}
+
+int64_t UnZigZag(uint64_t v) {
+  return (static_cast<int64_t>(v >> 1) ^ -static_cast<int64_t>(v & 1));
+}
+
+}  // namespace
+
+size_t BalanceHistory::Segment::GroupEnd(size_t group) const {
+  return (group + 1 < ck_pos.size() ? ck_pos[group + 1] : bytes.size());
+}
+
+BalanceHistory::BalanceHistory(int64_t segment_seconds)
+    : segment_seconds_(segment_seconds),
+      horizon_(std::numeric_limits<int64_t>::min()),
+      latest_ts_(std::numeric_limits<int64_t>::min()), opening_exposure_(0),
+      sealed_delta_(0) {}
+
+void BalanceHistory::AddAccount(uint32_t handle, int64_t opening_cents) {
+  (void)handle;
+  opening_.push_back(opening_cents);
+  settled_.push_back(opening_cents);
+  tail_.emplace_back();
+  touched_.emplace_back();
+  dirty_.push_back(0);
+  folded_.push_back(0);
+  opening_exposure_ += opening_cents;
+}
+
+void BalanceHistory::Truncate(size_t count) {
+  for (size_t h = count; h < opening_.size(); h++) {
+    opening_exposure_ -= opening_[h];
+  }
+  opening_.resize(std::min(count, opening_.size()));
+  settled_.resize(opening_.size());
+  tail_.resize(opening_.size());
+  touched_.resize(opening_.size());
+  dirty_.resize(opening_.size());
+  folded_.resize(opening_.size());
+}
+
+void BalanceHistory::Record(uint32_t handle, int64_t new_cents, int64_t ts) {
+  std::vector<Change> &tail = tail_[handle];
+  ts = std::max(ts, horizon_);
+  if (!tail.empty()) {
+    ts = std::max(ts, tail.back().ts);
+  }
+  tail.push_back({ts, new_cents});
+  // Only this thread records for handle, so the flag needs no atomics; the
+  // shared list is locked once per account between two folds.
+  if (!dirty_[handle]) {
+    dirty_[handle] = 1;
+    std::lock_guard<std::mutex> lock(dirty_mutex_);
+    dirty_list_.push_back(handle);
+  }
+
+  int64_t latest = latest_ts_.load(std::memory_order_relaxed);
+  while (ts > latest &&
+         !latest_ts_.compare_exchange_weak(latest, ts,
+                                           std::memory_order_relaxed)) {
+  }
+}
+
+void BalanceHistory::Seal() {
+  const int64_t latest = latest_ts_.load(std::memory_order_relaxed);
+  if (latest == std::numeric_limits<int64_t>::min()) {
+    return;
+  }
+  const int64_t horizon = SegmentStart(latest, segment_seconds_);
+  if (horizon <= horizon_) {
+    return;
+  }
+  // Fold first, so that every tail entry about to be sealed is in exposure_.
+  Fold();
+
+  // Segment start -> segment being built, and its (offset, delta) pairs.
+  std::map<int64_t, std::pair<Segment, std::vector<std::pair<uint32_t, int64_t>>>>
+      building;
+
+  for (uint32_t h = 0; h < tail_.size(); h++) {
+    std::vector<Change> &tail = tail_[h];
+    auto end = std::lower_bound(
+        tail.begin(), tail.end(), horizon,
+        [](const Change &c, int64_t t) { return (c.ts < t); });
+    if (end == tail.begin()) {
+      continue;
+    }
+
+    int64_t balance = settled_[h];
+    Segment *seg = nullptr;
+    std::vector<std::pair<uint32_t, int64_t>> *moves = nullptr;
+    uint32_t in_run = 0;
+    uint32_t prev_offset = 0;
+    for (auto it = tail.begin(); it != end; ++it) {
+      const int64_t start = SegmentStart(it->ts, segment_seconds_);
+      if (!seg || seg->start != start) {
+        auto &slot = building[start];
+        seg = &slot.first;
+        moves = &slot.second;
+        seg->start = start;
+        seg->handles.push_back(h);
+        seg->first_ck.push_back(static_cast<uint32_t>(seg->ck_offset.size()));
+        touched_[h].push_back(start);
+        in_run = 0;
+      }
+
+      const uint32_t offset = static_cast<uint32_t>(it->ts - start);
+      if (in_run % kCheckpointEvery == 0) {
+        seg->ck_offset.push_back(offset);
+        seg->ck_pos.push_back(static_cast<uint32_t>(seg->bytes.size()));
+        seg->ck_balance.push_back(balance);
+        prev_offset = offset;
+      }
+      const int64_t delta = it->balance - balance;
+      PutVarint(&seg->bytes, offset - prev_offset);
+      PutVarint(&seg->bytes, ZigZag(delta));
+      moves->push_back({offset, delta});
+
+      prev_offset = offset;
+      balance = it->balance;
+      in_run++;
+    }
+    settled_[h] = balance;
+    folded_[h] -= static_cast<uint32_t>(end - tail.begin());
+    tail.erase(tail.begin(), end);
+  }
+
+  for (auto &entry : building) {
+    Segment &seg = entry.second.first;
+    auto &moves = entry.second.second;
+    seg.first_ck.push_back(static_cast<uint32_t>(seg.ck_offset.size()));
+    seg.delta_open = sealed_delta_;
+
+    std::sort(moves.begin(), moves.end(),
+              [](const auto &a, const auto &b) { return (a.first < b.first); });
+    for (const auto &move : moves) {
+      sealed_delta_ += move.second;
+      if (!seg.exp_offset.empty() && seg.exp_offset.back() == move.first) {
+        seg.exp_delta.back() = sealed_delta_;
+      } else {
+        seg.exp_offset.push_back(move.first);
+        seg.exp_delta.push_back(sealed_delta_);
+      }
+    }
+    seg.bytes.shrink_to_fit();
+    segments_.push_back(std::move(seg));
+  }
+  horizon_ = horizon;
+
+  // The steps left keep their values: the ones sealed add up to the growth of
+  // sealed_delta_.
+  exposure_.erase(exposure_.begin(),
+                  std::lower_bound(exposure_.begin(), exposure_.end(), horizon,
+                                   [](const ExposureStep &step, int64_t t) {
+                                     return (step.ts < t);
+                                   }));
+}
+
+void BalanceHistory::Fold() const {
+  if (dirty_list_.empty()) {
+    return;
+  }
+  std::vector<ExposureStep> added;
+  for (uint32_t h : dirty_list_) {
+    const std::vector<Change> &tail = tail_[h];
+    int64_t balance = folded_[h] ? tail[folded_[h] - 1].balance : settled_[h];
+    for (size_t i = folded_[h]; i < tail.size(); i++) {
+      added.push_back({tail[i].ts, tail[i].balance - balance});
+      balance = tail[i].balance;
+    }
+    folded_[h] = static_cast<uint32_t>(tail.size());
+    dirty_[h] = 0;
+  }
+  dirty_list_.clear();
+  auto by_ts = [](const ExposureStep &a, const ExposureStep &b) {
+    return (a.ts < b.ts);
+  };
+  std::stable_sort(added.begin(), added.end(), by_ts);
+
+  // Usually time only moves forward and the changes are appended; changes
+  // stamped earlier are merged with the steps after them, which are turned
+  // back into plain deltas first.
+  auto from = std::upper_bound(exposure_.begin(), exposure_.end(),
+                               added.front(), by_ts);
+  const size_t at = static_cast<size_t>(from - exposure_.begin());
+  int64_t total = at ? exposure_[at - 1].delta : sealed_delta_;
+  if (at < exposure_.size()) {
+    for (size_t i = exposure_.size() - 1; i > at; i--) {
+      exposure_[i].delta -= exposure_[i - 1].delta;
+    }
+    exposure_[at].delta -= total;
+    std::vector<ExposureStep> merged;
+    merged.reserve(exposure_.size() - at + added.size());
+    std::merge(exposure_.begin() + at, exposure_.end(), added.begin(),
+               added.end(), std::back_inserter(merged), by_ts);
+    added.swap(merged);
+    exposure_.resize(at);
+  }
+  for (ExposureStep &step : added) {
+    total += step.delta;
+    exposure_.push_back({step.ts, total});
+  }
+}
+
+template <typename Emit>
+void BalanceHistory::DecodeRun(const Segment &seg, size_t run, Emit emit) {
+  for (size_t g = seg.first_ck[run]; g < seg.first_ck[run + 1]; g++) {
+    const uint8_t *p = seg.bytes.data() + seg.ck_pos[g];
+    const uint8_t *end = seg.bytes.data() + seg.GroupEnd(g);
+    int64_t offset = seg.ck_offset[g];
+    int64_t balance = seg.ck_balance[g];
+    while (p < end) {
+      offset += static_cast<int64_t>(GetVarint(&p));
+      balance += UnZigZag(GetVarint(&p));
+      emit(seg.start + offset, balance);
+    }
+  }
+}
+
+int64_t BalanceHistory::SegmentBalance(const Segment &seg, size_t run,
+                                       int64_t t) {
+  const auto first = seg.ck_offset.begin() + seg.first_ck[run];
+  const auto last = seg.ck_offset.begin() + seg.first_ck[run + 1];
+  auto it = std::upper_bound(first, last, t, [](int64_t v, uint32_t offset) {
+    return (v < static_cast<int64_t>(offset));
+  });
+  if (it == first) {
+    return (seg.ck_balance[seg.first_ck[run]]);
+  }
+
+  const size_t g = static_cast<size_t>(it - seg.ck_offset.begin()) - 1;
+  const uint8_t *p = seg.bytes.data() + seg.ck_pos[g];
+  const uint8_t *end = seg.bytes.data() + seg.GroupEnd(g);
+  int64_t offset = seg.ck_offset[g];
+  int64_t balance = seg.ck_balance[g];
+  while (p < end) {
+    offset += static_cast<int64_t>(GetVarint(&p));
+    int64_t delta = UnZigZag(GetVarint(&p));
+    if (offset > t) {
+      break;
+    }
+    balance += delta;
+  }
+  return (balance);
+}
+
+ptrdiff_t BalanceHistory::SegmentAt(int64_t ts) const {
+  auto it = std::upper_bound(
+      segments_.begin(), segments_.end(), ts,
+      [](int64_t t, const Segment &seg) { return (t < seg.start); });
+  return ((it - segments_.begin()) - 1);
+}
+
+int64_t BalanceHistory::BalanceAt(uint32_t handle, int64_t ts) const {
+  const std::vector<Change> &tail = tail_[handle];
+  auto it = std::upper_bound(
+      tail.begin(), tail.end(), ts,
+      [](int64_t t, const Change &c) { return (t < c.ts); });
+  if (it != tail.begin()) {
+    return ((it - 1)->balance);
+  }
+  if (ts >= horizon_) {
+    return (settled_[handle]);
+  }
+
+  const std::vector<int64_t> &starts = touched_[handle];
+  auto seg_it = std::upper_bound(starts.begin(), starts.end(), ts);
+  if (seg_it == starts.begin()) {
+    return (opening_[handle]);
+  }
+  const Segment &seg = segments_[SegmentAt(*(seg_it - 1))];
+  const size_t run = static_cast<size_t>(
+      std::lower_bound(seg.handles.begin(), seg.handles.end(), handle) -
+      seg.handles.begin());
+  return (SegmentBalance(seg, run, ts - seg.start));
+}
+
+void BalanceHistory::BalancesBetween(uint32_t handle, int64_t from, int64_t to,
+                                     std::vector<BalancePoint> *out) const {
+  out->push_back({from, BalanceAt(handle, from)});
+
+  const std::vector<int64_t> &starts = touched_[handle];
+  auto seg_it = std::upper_bound(starts.begin(), starts.end(), from);
+  if (seg_it != starts.begin()) {
+    --seg_it;  // The segment containing from may hold later changes too.
+  }
+  for (; seg_it != starts.end() && *seg_it <= to; ++seg_it) {
+    const Segment &seg = segments_[SegmentAt(*seg_it)];
+    const size_t run = static_cast<size_t>(
+        std::lower_bound(seg.handles.begin(), seg.handles.end(), handle) -
+        seg.handles.begin());
+    DecodeRun(seg, run, [&](int64_t ts, int64_t balance) {
+      if (ts > from && ts <= to) {
+        out->push_back({ts, balance});
+      }
+    });
+  }
+
+  for (const Change &change : tail_[handle]) {
+    if (change.ts > to) {
+      break;
+    }
+    if (change.ts > from) {
+      out->push_back({change.ts, change.balance});
+    }
+  }
+}
+
+int64_t BalanceHistory::ExposureAt(int64_t ts) const {
+  if (ts < horizon_) {
+    const ptrdiff_t s = SegmentAt(ts);
+    if (s < 0) {
+      return (opening_exposure_);
+    }
+    const Segment &seg = segments_[s];
+    auto it = std::upper_bound(
+        seg.exp_offset.begin(), seg.exp_offset.end(), ts - seg.start,
+        [](int64_t t, uint32_t offset) {
+          return (t < static_cast<int64_t>(offset));
+        });
+    const int64_t delta = (it == seg.exp_offset.begin())
+                              ? seg.delta_open
+                              : seg.exp_delta[it - seg.exp_offset.begin() - 1];
+    return (opening_exposure_ + delta);
+  }
+
+  std::lock_guard<std::mutex> lock(fold_mutex_);
+  Fold();
+  auto it = std::upper_bound(
+      exposure_.begin(), exposure_.end(), ts,
+      [](int64_t t, const ExposureStep &step) { return (t < step.ts); });
+  return (opening_exposure_ +
+          (it == exposure_.begin() ? sealed_delta_ : (it - 1)->delta));
+}
+
+size_t BalanceHistory::SealedSegments() const { return (segments_.size()); }
+
+size_t BalanceHistory::SealedBytes() const {
+  size_t bytes = 0;
+  for (const Segment &seg : segments_) {
+    bytes += sizeof(Segment) + seg.handles.capacity() * 4 +
+             seg.first_ck.capacity() * 4 + seg.ck_offset.capacity() * 4 +
+             seg.ck_pos.capacity() * 4 + seg.ck_balance.capacity() * 8 +
+             seg.bytes.capacity() + seg.exp_offset.capacity() * 4 +
+             seg.exp_delta.capacity() * 8;
+  }
+  return (bytes);
+}
@@ -0,0 +1,89 @@
+// Copyright 2025 Sara Saad
+
+/******************************************* INCLUDE PART
+ * **************************************** */
+#include "../Inc/BalanceVersion.hpp"
+
+#include <thread>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+EpochClock::WriteScope::WriteScope(EpochClock *clock)
+    : clock_(nullptr), epoch_(0), outer_clock_(t_write_clock),
+      outer_epoch_(t_write_epoch) {
+  if (t_write_clock == clock) {
+    return;
+  }
+
+  // Register first, then confirm the epoch did not move underneath us. A
+  // reader that bumped the epoch in between either sees our registration and
+  // waits for us, or we see its bump and register again in the new epoch.
+  uint64_t epoch = clock->epoch_.load();
+  for (;;) {
+    clock->active_[epoch & 1].fetch_add(1);
+    uint64_t now = clock->epoch_.load();
+    if (now == epoch) {
+      break;
+    }
+    clock->active_[epoch & 1].fetch_sub(1);
+    epoch = now;
+  }
+
+  clock_ = clock;
+  epoch_ = epoch;
+  t_write_clock = clock;
+  t_write_epoch = epoch;
+}
+
+EpochClock::WriteScope::~WriteScope() {
+  if (clock_) {
+    t_write_clock = outer_clock_;
+    t_write_epoch = outer_epoch_;
+    clock_->active_[epoch_ & 1].fetch_sub(1, std::memory_order_release);
+  }
+}
+
+uint64_t EpochClock::OpenSnapshot() {
+  // A second snapshot opened while this one drains would move the epoch to
+  // S + 2, which shares S's counter, and the writers registering there could
+  // starve us. Holding the lock keeps the epoch at S + 1 until we return.
+  std::lock_guard<std::mutex> lock(snapshot_mutex_);
+  uint64_t snapshot = epoch_.fetch_add(1);
+  while (active_[snapshot & 1].load() != 0) {
+    std::this_thread::yield();
+  }
+  return (snapshot);
+}
+
+VersionedBalance::VersionedBalance(int64_t cents)
+    : current_(cents), current_epoch_(0), previous_(cents),
+      previous_epoch_(0) {}
+
+bool VersionedBalance::LoadAsOf(uint64_t epoch, int64_t *cents) const {
+  for (;;) {
+    uint32_t before = seq_.load(std::memory_order_acquire);
+    if (before & 1) {
+      std::this_thread::yield();
+      continue;
+    }
+
+    int64_t current = current_.load(std::memory_order_relaxed);
+    uint64_t current_epoch = current_epoch_.load(std::memory_order_relaxed);
+    int64_t previous = previous_.load(std::memory_order_relaxed);
+    uint64_t previous_epoch = previous_epoch_.load(std::memory_order_relaxed);
+
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (seq_.load(std::memory_order_relaxed) != before) {
+      continue;
+    }
+
+    if (current_epoch <= epoch) {
+      *cents = current;
+      return (true);
+    }
+    if (previous_epoch <= epoch) {
+      *cents = previous;
+      return (true);
+    }
+    return (false);
+  }
+}
@@ -0,0 +1,95 @@
+// Copyright 2025 Sara Saad
+
+/******************************************* INCLUDE PART
+ * **************************************** */
+#include "../Inc/BookChecksum.hpp"
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+namespace {
+
+inline uint64_t Mix(uint64_t x) {
+  // splitmix64 finalizer
+  x += 0x9e3779b97f4a7c15ULL;
+  x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+  x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+  return (x ^ (x >> 31));
+}
+
+inline uint64_t Contribution(uint64_t id_hash, int64_t balance) {
+  return (Mix(id_hash ^ Mix(static_cast<uint64_t>(balance))));
+}
+
+}  // namespace
+
+BookDigest::BookDigest(const std::array<uint64_t, kShards> &leaves) {
+  nodes_[0] = 0;
+  for (size_t i = 0; i < kShards; i++) {
+    nodes_[kShards + i] = Mix(leaves[i] ^ i);
+  }
+  for (size_t k = kShards - 1; k >= 1; k--) {
+    nodes_[k] = Mix(nodes_[2 * k] * 31 ^ nodes_[2 * k + 1]);
+  }
+}
+
+uint64_t BookDigest::Root() const { return (nodes_[1]); }
+
+uint64_t BookDigest::Node(size_t index) const { return (nodes_[index]); }
+
+std::vector<size_t> BookDigest::DivergentShards(const BookDigest &other) const {
+  std::vector<size_t> shards;
+  std::vector<size_t> stack;
+  if (nodes_[1] != other.nodes_[1]) {
+    stack.push_back(1);
+  }
+
+  while (!stack.empty()) {
+    size_t k = stack.back();
+    stack.pop_back();
+    if (k >= kShards) {
+      shards.push_back(k - kShards);
+      continue;
+    }
+    // Push the right child first so that shards come out in ascending order.
+    for (size_t child : {2 * k + 1, 2 * k}) {
+      if (nodes_[child] != other.nodes_[child]) {
+        stack.push_back(child);
+      }
+    }
+  }
+  return (shards);
+}
+
+BookChecksum::BookChecksum() {
+  for (auto &leaf : leaves_) {
+    leaf.store(0, std::memory_order_relaxed);
+  }
+}
+
+size_t BookChecksum::ShardOf(uint64_t id_hash) {
+  return (static_cast<size_t>(id_hash >> 56) % BookDigest::kShards);
+}
+
+void BookChecksum::Add(uint64_t id_hash, int64_t balance) {
+  leaves_[ShardOf(id_hash)].fetch_add(Contribution(id_hash, balance),
+                                      std::memory_order_relaxed);
+}
+
+void BookChecksum::Remove(uint64_t id_hash, int64_t balance) {
+  leaves_[ShardOf(id_hash)].fetch_sub(Contribution(id_hash, balance),
+                                      std::memory_order_relaxed);
+}
+
+void BookChecksum::Update(uint64_t id_hash, int64_t old_cents,
+                          int64_t new_cents) {
+  leaves_[ShardOf(id_hash)].fetch_add(
+      Contribution(id_hash, new_cents) - Contribution(id_hash, old_cents),
+      std::memory_order_relaxed);
+}
+
+BookDigest BookChecksum::Digest() const {
+  std::array<uint64_t, BookDigest::kShards> leaves;
+  for (size_t i = 0; i < BookDigest::kShards; i++) {
+    leaves[i] = leaves_[i].load(std::memory_order_relaxed);
+  }
+  return (BookDigest(leaves));
+}
@@ -7,21 +7,18 @@
 //////////////////////////////////////////////////////////////////
 
 int64_t Calculator::Deposit(int64_t balance, int64_t amount) {
-  return balance + amount;
+  return (InlineCalculator::Deposit(balance, amount));
 }
 
 int64_t Calculator::Withdraw(int64_t balance, int64_t amount) {
-  return balance - amount;
+  return (InlineCalculator::Withdraw(balance, amount));
 }
 
 int64_t Calculator::Fee(int64_t balance, int64_t fee_amount) {
-  return balance - fee_amount;
+  return (InlineCalculator::Fee(balance, fee_amount));
 }
 
 int64_t Calculator::Interest(int64_t balance, double apr, int32_t days,
                                int32_t basis) {
-  double fraction = (static_cast<double>(days) / basis);
-  double interest_value = balance * apr * fraction;
-
-  return static_cast<int64_t>(interest_value);
-}
\ No newline at end of file
+  return (InlineCalculator::Interest(balance, apr, days, basis));
+}
@@ -0,0 +1,416 @@
+// Copyright 2025 Sara Saad
+
+/******************************************* INCLUDE PART
+ * **************************************** */
+#include "../Inc/ColdStore.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <utility>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+namespace {
+
+/// Offsets of the fixed head of a blob.
+constexpr size_t kTypeAt = 0;
+constexpr size_t kAccrualFlagsAt = 1;
+constexpr size_t kCycleDaysAt = 2;
+constexpr size_t kInterestAnchorAt = 6;
+constexpr size_t kFeeAnchorAt = 14;
+constexpr size_t kAuditCountAt = 22;
+constexpr size_t kLastTsAt = 24;
+constexpr size_t kHeadBytes = 32;
+
+/// Audit records an account keeps, as BaseAccount::Record().
+constexpr size_t kMaxAuditRecords = 1000;
+
+/// States of the cold flag of a handle.
+constexpr uint8_t kResident = 0;
+constexpr uint8_t kCold = 1;
+constexpr uint8_t kHeld = 2;
+
+void PutVarint(std::vector<uint8_t> *out, uint64_t v) {
+  while (v >= 0x80) {
+    out->push_back(static_cast<uint8_t>(v | 0x80));
+    v >>= 7;
+  }
+  out->push_back(static_cast<uint8_t>(v));
+}
+
+uint64_t GetVarint(const uint8_t **p) {
+  uint64_t v = 0;
+  for (int shift = 0;; shift += 7) {
+    uint8_t byte = *(*p)++;
+    v |= static_cast<uint64_t>(byte & 0x7F) << shift;
+    if (!(byte & 0x80)) {
+      return (v);
+    }
+  }
+}
+
+uint64_t ZigZag(int64_t v) {
+  return ((static_cast<uint64_t>(v) << 1) ^ static_cast<uint64_t>(v >> 63));
+}
+
+int64_t UnZigZag(uint64_t v) {
+  return (static_cast<int64_t>(v >> 1) ^ -static_cast<int64_t>(v & 1));
+}
+
+void PutString(std::vector<uint8_t> *out, const std::string &s) {
+  PutVarint(out, s.size());
+  out->insert(out->end(), s.begin(), s.end());
+}
+
+std::string GetString(const uint8_t **p) {
+  const size_t len = static_cast<size_t>(GetVarint(p));
+  std::string s(reinterpret_cast<const char *>(*p), len);
+  *p += len;
+  return (s);
+}
+
+template <typename T>
+void PutFixed(uint8_t *at, T v) {
+  std::memcpy(at, &v, sizeof(v));
+}
+
+template <typename T>
+T GetFixed(const uint8_t *at) {
+  T v;
+  std::memcpy(&v, at, sizeof(v));
+  return (v);
+}
+
+uint8_t AccrualFlags(const AccrualPolicy &policy) {
+  return (static_cast<uint8_t>((policy.lazy_interest ? 1 : 0) |
+                               (policy.lazy_fees ? 2 : 0)));
+}
+
+std::atomic_ref<uint8_t> Flag(const std::vector<uint8_t> &cold,
+                              uint32_t handle) {
+  return (std::atomic_ref<uint8_t>(const_cast<uint8_t &>(cold[handle])));
+}
+
+std::atomic_ref<int64_t> Cents(const std::vector<int64_t> &balance,
+                               uint32_t handle) {
+  return (std::atomic_ref<int64_t>(const_cast<int64_t &>(balance[handle])));
+}
+
+}  // namespace
+
+ColdStore::ColdStore() : cold_count_(0), blob_bytes_(0), notes_{nullptr} {}
+
+void ColdStore::Resize(size_t count) {
+  for (size_t h = count; h < cold_.size(); h++) {
+    if (cold_[h]) {
+      Release(static_cast<uint32_t>(h));
+    }
+  }
+  cold_.resize(count, kResident);
+  balance_.resize(count, 0);
+  epoch_.resize(count, 0);
+  blobs_.resize(count);
+  sizes_.resize(count, 0);
+}
+
+void ColdStore::Reserve(size_t count) {
+  cold_.reserve(count);
+  balance_.reserve(count);
+  epoch_.reserve(count);
+  blobs_.reserve(count);
+  sizes_.reserve(count);
+}
+
+bool ColdStore::IsCold(uint32_t handle) const {
+  return (Flag(cold_, handle).load(std::memory_order_acquire) != kResident);
+}
+
+int64_t ColdStore::Balance(uint32_t handle) const {
+  return (Cents(balance_, handle).load(std::memory_order_acquire));
+}
+
+bool ColdStore::BalanceAsOf(uint32_t handle, uint64_t epoch,
+                            int64_t *cents) const {
+  // Accrue() tags the epoch before it publishes the balance, so a reader that
+  // sees a newer balance also sees its epoch.
+  *cents = Balance(handle);
+  const uint64_t written =
+      std::atomic_ref<uint64_t>(const_cast<uint64_t &>(epoch_[handle]))
+          .load(std::memory_order_acquire);
+  return (written <= epoch);
+}
+
+bool ColdStore::Claim(uint32_t handle) const {
+  std::atomic_ref<uint8_t> flag = Flag(cold_, handle);
+  for (;;) {
+    uint8_t state = flag.load(std::memory_order_acquire);
+    if (state == kResident) {
+      return (false);
+    }
+    if (state == kCold &&
+        flag.compare_exchange_weak(state, kHeld, std::memory_order_acquire)) {
+      return (true);
+    }
+    std::this_thread::yield();
+  }
+}
+
+void ColdStore::Unclaim(uint32_t handle) const {
+  Flag(cold_, handle).store(kCold, std::memory_order_release);
+}
+
+uint32_t ColdStore::NoteId(const char *note) {
+  if (!note) {
+    return (0);
+  }
+  std::lock_guard<std::shared_mutex> lock(note_mutex_);
+  auto it = note_ids_.find(note);
+  if (it != note_ids_.end()) {
+    return (it->second);
+  }
+  const uint32_t id = static_cast<uint32_t>(notes_.size());
+  notes_.push_back(note);
+  note_ids_.emplace(note, id);
+  return (id);
+}
+
+void ColdStore::PutRecords(std::vector<uint8_t> *out, const TxRecord *begin,
+                           const TxRecord *end, int64_t *prev_ts) {
+  const char *last_note = nullptr;
+  uint32_t last_note_id = 0;
+  for (const TxRecord *rec = begin; rec != end; rec++) {
+    // Notes repeat a lot; only a new pointer takes the dictionary lock.
+    if (rec->note != last_note) {
+      last_note = rec->note;
+      last_note_id = NoteId(rec->note);
+    }
+    out->push_back(static_cast<uint8_t>(rec->kind));
+    PutVarint(out, ZigZag(rec->amount_cents));
+    PutVarint(out, ZigZag(rec->timestamp - *prev_ts));
+    PutVarint(out, last_note_id);
+    PutString(out, rec->account_id);
+    PutVarint(out, rec->idempotency_key);
+    *prev_ts = rec->timestamp;
+  }
+}
+
+TxRecord ColdStore::GetRecord(const uint8_t **p, int64_t *ts) const {
+  TxRecord rec;
+  rec.kind = static_cast<TxKind>(*(*p)++);
+  rec.amount_cents = UnZigZag(GetVarint(p));
+  *ts += UnZigZag(GetVarint(p));
+  rec.timestamp = *ts;
+  rec.note = notes_[GetVarint(p)];
+  rec.account_id = GetString(p);
+  rec.idempotency_key = GetVarint(p);
+  return (rec);
+}
+
+void ColdStore::Freeze(uint32_t handle, const BaseAccount &acc) {
+  std::vector<uint8_t> out(kHeadBytes);
+  out[kTypeAt] = static_cast<uint8_t>(acc.setting_.account_type);
+  out[kAccrualFlagsAt] = AccrualFlags(acc.accrual_);
+  PutFixed(out.data() + kCycleDaysAt, acc.accrual_.fee_cycle_days);
+  PutFixed(out.data() + kInterestAnchorAt, acc.interest_anchor_ts_);
+  PutFixed(out.data() + kFeeAnchorAt, acc.fee_anchor_ts_);
+  PutFixed(out.data() + kAuditCountAt,
+           static_cast<uint16_t>(acc.audit_.size()));
+
+  const double apr = acc.setting_.apr;
+  out.resize(out.size() + sizeof(apr));
+  PutFixed(out.data() + out.size() - sizeof(apr), apr);
+  PutVarint(&out, ZigZag(acc.setting_.fee_flat_cents));
+  PutString(&out, acc.id_);
+
+  int64_t prev_ts = 0;
+  PutRecords(&out, acc.audit_.data(), acc.audit_.data() + acc.audit_.size(),
+             &prev_ts);
+  PutFixed(out.data() + kLastTsAt, prev_ts);
+
+  blobs_[handle].reset(new uint8_t[out.size()]);
+  std::memcpy(blobs_[handle].get(), out.data(), out.size());
+  sizes_[handle] = static_cast<uint32_t>(out.size());
+  balance_[handle] = acc.GetBalance();
+  epoch_[handle] = 0;
+  blob_bytes_.fetch_add(out.size(), std::memory_order_relaxed);
+  cold_count_.fetch_add(1, std::memory_order_relaxed);
+  Flag(cold_, handle).store(kCold, std::memory_order_release);
+}
+
+std::unique_ptr<IAccount> ColdStore::Thaw(uint32_t handle) const {
+  const uint8_t *blob = blobs_[handle].get();
+  const uint8_t *p = blob + kHeadBytes;
+
+  const double apr = GetFixed<double>(p);
+  p += sizeof(apr);
+  const int64_t fee = UnZigZag(GetVarint(&p));
+  std::string id = GetString(&p);
+
+  std::unique_ptr<BaseAccount> acc;
+  if (static_cast<AccountType>(blob[kTypeAt]) == AccountType::KSAVINGS) {
+    acc = std::make_unique<SavingAccount>(std::move(id), apr, Balance(handle));
+  } else {
+    acc = std::make_unique<CheckingAccount>(std::move(id), fee,
+                                            Balance(handle));
+  }
+  acc->setting_.apr = apr;
+  acc->setting_.fee_flat_cents = fee;
+  acc->accrual_.lazy_interest = (blob[kAccrualFlagsAt] & 1) != 0;
+  acc->accrual_.lazy_fees = (blob[kAccrualFlagsAt] & 2) != 0;
+  acc->accrual_.fee_cycle_days = GetFixed<int32_t>(blob + kCycleDaysAt);
+  acc->interest_anchor_ts_ = GetFixed<int64_t>(blob + kInterestAnchorAt);
+  acc->fee_anchor_ts_ = GetFixed<int64_t>(blob + kFeeAnchorAt);
+
+  const size_t count = GetFixed<uint16_t>(blob + kAuditCountAt);
+  acc->audit_.reserve(count);
+  std::shared_lock<std::shared_mutex> lock(note_mutex_);
+  int64_t ts = 0;
+  for (size_t i = 0; i < count; i++) {
+    acc->audit_.push_back(GetRecord(&p, &ts));
+  }
+  return (acc);
+}
+
+std::unique_ptr<IAccount> ColdStore::Copy(uint32_t handle) const {
+  if (!Claim(handle)) {
+    return (nullptr);
+  }
+  std::unique_ptr<IAccount> acc = Thaw(handle);
+  Unclaim(handle);
+  return (acc);
+}
+
+void ColdStore::Release(uint32_t handle) {
+  Flag(cold_, handle).store(kResident, std::memory_order_release);
+  blob_bytes_.fetch_sub(sizes_[handle], std::memory_order_relaxed);
+  cold_count_.fetch_sub(1, std::memory_order_relaxed);
+  blobs_[handle].reset();
+  sizes_[handle] = 0;
+}
+
+bool ColdStore::Accrue(const AccountLink &link, int64_t ts) {
+  return (Post(link, ts, nullptr, nullptr));
+}
+
+bool ColdStore::ChargeFee(const AccountLink &link, int64_t fee_cents,
+                          int64_t ts, const char *note, std::string *id) {
+  const TxRecord fee{TxKind::KFEE, fee_cents, ts, note};
+  return (Post(link, ts, &fee, id));
+}
+
+bool ColdStore::Post(const AccountLink &link, int64_t ts, const TxRecord *fee,
+                     std::string *id) {
+  const uint32_t handle = link.handle;
+  if (!Claim(handle)) {
+    return (false);
+  }
+
+  uint8_t *blob = blobs_[handle].get();
+  const AccrualPolicy policy{(blob[kAccrualFlagsAt] & 1) != 0,
+                             (blob[kAccrualFlagsAt] & 2) != 0,
+                             GetFixed<int32_t>(blob + kCycleDaysAt)};
+  const uint8_t *p = blob + kHeadBytes;
+  const double apr = GetFixed<double>(p);
+  p += sizeof(apr);
+  const int64_t flat_fee = UnZigZag(GetVarint(&p));
+  const size_t id_len = static_cast<size_t>(GetVarint(&p));
+  if (id) {
+    id->assign(reinterpret_cast<const char *>(p), id_len);
+  }
+  p += id_len;
+  const size_t records_at = static_cast<size_t>(p - blob);
+  const AccountSettings setting{static_cast<AccountType>(blob[kTypeAt]), apr,
+                                flat_fee};
+
+  int64_t interest_anchor = GetFixed<int64_t>(blob + kInterestAnchorAt);
+  int64_t fee_anchor = GetFixed<int64_t>(blob + kFeeAnchorAt);
+  int64_t balance = balance_[handle];
+  const uint64_t epoch = link.clock ? link.clock->WriteEpoch() : 0;
+  std::vector<TxRecord> posted;
+  auto post = [&](const TxRecord &rec, int64_t cents) {
+    const int64_t old_cents = balance_[handle];
+    std::atomic_ref<uint64_t>(epoch_[handle])
+        .store(epoch, std::memory_order_release);
+    Cents(balance_, handle).store(cents, std::memory_order_release);
+    if (link.listener) {
+      link.listener->OnBalanceChange(handle, old_cents, cents,
+                                     rec.timestamp);
+    }
+    if (link.velocity) {
+      link.velocity->Record(handle, rec);
+    }
+    posted.push_back(rec);
+  };
+  BaseAccount::WalkAccrual(policy, setting, &interest_anchor, &fee_anchor, ts,
+                           &balance, post);
+  // An explicit fee is posted after the accrual, as BaseAccount::ChargeFee();
+  // with cycle fees the accrual has charged it already.
+  if (fee && !(policy.lazy_fees && policy.fee_cycle_days > 0)) {
+    balance = Calculator::Fee(balance, fee->amount_cents);
+    post(*fee, balance);
+  }
+  PutFixed(blob + kInterestAnchorAt, interest_anchor);
+  PutFixed(blob + kFeeAnchorAt, fee_anchor);
+  if (posted.empty()) {
+    Unclaim(handle);
+    return (true);
+  }
+
+  // Append the postings. Once the trail is full the oldest records go, as in
+  // BaseAccount::Record(); that path decodes and re-encodes the trail.
+  const size_t count = GetFixed<uint16_t>(blob + kAuditCountAt);
+  const size_t kept = std::min(count + posted.size(), kMaxAuditRecords);
+  std::vector<uint8_t> out;
+  int64_t prev_ts = GetFixed<int64_t>(blob + kLastTsAt);
+  if (count + posted.size() <= kMaxAuditRecords) {
+    out.reserve(sizes_[handle] + posted.size() * 12);
+    out.assign(blob, blob + sizes_[handle]);
+  } else {
+    std::vector<TxRecord> audit;
+    audit.reserve(count + posted.size());
+    const uint8_t *rec_p = blob + records_at;
+    int64_t rec_ts = 0;
+    {
+      std::shared_lock<std::shared_mutex> lock(note_mutex_);
+      for (size_t i = 0; i < count; i++) {
+        audit.push_back(GetRecord(&rec_p, &rec_ts));
+      }
+    }
+    audit.insert(audit.end(), posted.begin(), posted.end());
+    posted.assign(audit.end() - kept, audit.end());
+    out.assign(blob, blob + records_at);
+    prev_ts = 0;
+  }
+  PutRecords(&out, posted.data(), posted.data() + posted.size(), &prev_ts);
+  PutFixed(out.data() + kAuditCountAt, static_cast<uint16_t>(kept));
+  PutFixed(out.data() + kLastTsAt, prev_ts);
+
+  blob_bytes_.fetch_add(out.size(), std::memory_order_relaxed);
+  blob_bytes_.fetch_sub(sizes_[handle], std::memory_order_relaxed);
+  blobs_[handle].reset(new uint8_t[out.size()]);
+  std::memcpy(blobs_[handle].get(), out.data(), out.size());
+  sizes_[handle] = static_cast<uint32_t>(out.size());
+  Unclaim(handle);
+  return (true);
+}
+
+void ColdStore::SetAccrual(uint32_t handle, const AccrualPolicy &policy,
+                           int64_t anchor_ts) {
+  uint8_t *blob = blobs_[handle].get();
+  blob[kAccrualFlagsAt] = AccrualFlags(policy);
+  PutFixed(blob + kCycleDaysAt, policy.fee_cycle_days);
+  PutFixed(blob + kInterestAnchorAt, anchor_ts);
+  PutFixed(blob + kFeeAnchorAt, anchor_ts);
+}
+
+size_t ColdStore::ColdCount() const {
+  return (cold_count_.load(std::memory_order_relaxed));
+}
+
+size_t ColdStore::Bytes() const {
+  std::shared_lock<std::shared_mutex> lock(note_mutex_);
+  return (blob_bytes_.load(std::memory_order_relaxed) +
+          notes_.capacity() * sizeof(const char *) +
+          note_ids_.size() * (sizeof(const char *) + 2 * sizeof(void *)));
+}
@@ -0,0 +1,223 @@
+// Copyright 2025 Sara Saad
+
+/******************************************* INCLUDE PART
+ * **************************************** */
+#include "../Inc/DedupIndex.hpp"
+
+#include <algorithm>
+#include <utility>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+namespace {
+
+constexpr size_t kBlockWords = 8;     ///< 512-bit filter blocks
+constexpr size_t kBitsPerKey = 10;    ///< ~1% false positives with 4 probes
+constexpr int kProbes = 4;
+
+uint64_t Mix(uint64_t x) {
+  x ^= x >> 33;
+  x *= 0xff51afd7ed558ccdULL;
+  x ^= x >> 33;
+  x *= 0xc4ceb9fe1a85ec53ULL;
+  x ^= x >> 33;
+  return (x);
+}
+
+size_t PowerOfTwoAtLeast(size_t n) {
+  size_t p = 1;
+  while (p < n) {
+    p <<= 1;
+  }
+  return (p);
+}
+
+/// Start of the window containing ts (floor, also for negative times).
+int64_t WindowStart(int64_t ts, int64_t span) {
+  int64_t q = ts / span;
+  if (ts % span < 0) {
+    q--;
+  }
+  return (q * span);
+}
+
+}  // namespace
+
+bool DedupIndex::Generation::MayContain(uint64_t hash) const {
+  const uint64_t *block =
+      filter.data() + (hash % (filter.size() / kBlockWords)) * kBlockWords;
+  uint64_t bits = hash >> 20;
+  for (int i = 0; i < kProbes; i++, bits >>= 9) {
+    const uint32_t bit = bits & 511;
+    if (!(block[bit >> 6] & (1ULL << (bit & 63)))) {
+      return (false);
+    }
+  }
+  return (true);
+}
+
+bool DedupIndex::Generation::Contains(uint64_t key, uint64_t hash) const {
+  const size_t mask = slots.size() - 1;
+  for (size_t i = hash & mask;; i = (i + 1) & mask) {
+    if (slots[i] == key) {
+      return (true);
+    }
+    if (slots[i] == 0) {
+      return (false);
+    }
+  }
+}
+
+bool DedupIndex::Generation::Insert(uint64_t key, uint64_t hash) {
+  if ((size + 1) * 2 > slots.size()) {
+    Grow();
+  }
+  const size_t mask = slots.size() - 1;
+  size_t i = hash & mask;
+  for (; slots[i] != 0; i = (i + 1) & mask) {
+    if (slots[i] == key) {
+      return (false);
+    }
+  }
+  slots[i] = key;
+  size++;
+
+  uint64_t *block =
+      filter.data() + (hash % (filter.size() / kBlockWords)) * kBlockWords;
+  uint64_t bits = hash >> 20;
+  for (int p = 0; p < kProbes; p++, bits >>= 9) {
+    const uint32_t bit = bits & 511;
+    block[bit >> 6] |= 1ULL << (bit & 63);
+  }
+  return (true);
+}
+
+bool DedupIndex::Generation::Erase(uint64_t key, uint64_t hash) {
+  if (slots.empty()) {
+    return (false);
+  }
+  const size_t mask = slots.size() - 1;
+  size_t i = hash & mask;
+  for (; slots[i] != key; i = (i + 1) & mask) {
+    if (slots[i] == 0) {
+      return (false);
+    }
+  }
+  // Backward-shift deletion: pull later keys of the probe run into the hole
+  // unless their home slot lies after it. The filter keeps the key's bits;
+  // they only cost a Contains() probe.
+  for (size_t j = (i + 1) & mask; slots[j] != 0; j = (j + 1) & mask) {
+    const size_t home = Mix(slots[j]) & mask;
+    if (((j - home) & mask) >= ((j - i) & mask)) {
+      slots[i] = slots[j];
+      i = j;
+    }
+  }
+  slots[i] = 0;
+  size--;
+  return (true);
+}
+
+void DedupIndex::Generation::Grow() {
+  std::vector<uint64_t> old(slots.size() * 2, 0);
+  old.swap(slots);
+  const size_t mask = slots.size() - 1;
+  for (uint64_t key : old) {
+    if (key == 0) {
+      continue;
+    }
+    size_t i = Mix(key) & mask;
+    while (slots[i] != 0) {
+      i = (i + 1) & mask;
+    }
+    slots[i] = key;
+  }
+}
+
+void DedupIndex::Generation::Clear(int64_t new_start) {
+  start = new_start;
+  if (size == 0) {
+    // Nothing to wipe; filter bits of forgotten keys only cost a probe. Keeps
+    // the catch-up after a long gap cheap.
+    return;
+  }
+  size = 0;
+  std::fill(slots.begin(), slots.end(), 0);
+  std::fill(filter.begin(), filter.end(), 0);
+}
+
+DedupIndex::DedupIndex(int64_t window_seconds, size_t expected_keys)
+    : window_seconds_(std::max<int64_t>(window_seconds, 1)),
+      expected_keys_(std::max<size_t>(expected_keys, 1)), started_(false),
+      admitted_(0), duplicates_(0), filter_skips_(0), clamped_jumps_(0) {}
+
+void DedupIndex::Start(int64_t ts) {
+  const size_t slots = PowerOfTwoAtLeast(expected_keys_ * 2);
+  const size_t blocks =
+      std::max<size_t>(1, expected_keys_ * kBitsPerKey / (kBlockWords * 64));
+  for (Generation *gen : {&current_, &previous_}) {
+    gen->slots.assign(slots, 0);
+    gen->filter.assign(blocks * kBlockWords, 0);
+    gen->size = 0;
+  }
+  current_.start = WindowStart(ts, window_seconds_);
+  previous_.start = current_.start - window_seconds_;
+  started_ = true;
+}
+
+void DedupIndex::Advance(int64_t ts) {
+  if (ts < current_.start + window_seconds_) {
+    return;
+  }
+  int64_t start = WindowStart(ts, window_seconds_);
+  if (start != current_.start + window_seconds_) {
+    // Step one window only, so the keys of the current window stay retained
+    // for another one however far ahead ts claims to be.
+    clamped_jumps_++;
+    start = current_.start + window_seconds_;
+  }
+  std::swap(current_, previous_);
+  current_.Clear(start);
+}
+
+bool DedupIndex::Admit(uint64_t key, int64_t ts) {
+  if (!started_) {
+    Start(ts);
+  }
+  Advance(ts);
+
+  const uint64_t hash = Mix(key);
+  bool duplicate = false;
+  if (previous_.size != 0) {
+    if (previous_.MayContain(hash)) {
+      duplicate = previous_.Contains(key, hash);
+    } else {
+      filter_skips_++;
+    }
+  }
+  if (!duplicate) {
+    duplicate = !current_.Insert(key, hash);
+  }
+
+  if (duplicate) {
+    duplicates_++;
+    return (false);
+  }
+  admitted_++;
+  return (true);
+}
+
+void DedupIndex::Forget(uint64_t key) {
+  const uint64_t hash = Mix(key);
+  if (current_.Erase(key, hash) || previous_.Erase(key, hash)) {
+    admitted_--;
+  }
+}
+
+DedupStats DedupIndex::Stats() const {
+  size_t bytes = 0;
+  for (const Generation *gen : {&current_, &previous_}) {
+    bytes += (gen->slots.capacity() + gen->filter.capacity()) * 8;
+  }
+  return (DedupStats{admitted_, duplicates_, filter_skips_,
+                     current_.size + previous_.size, bytes, clamped_jumps_});
+}
@@ -0,0 +1,301 @@
+// Copyright 2025 Sara Saad
+
+/******************************************* INCLUDE PART
+ * **************************************** */
+#include "../Inc/FlightRecorder.hpp"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+namespace {
+
+constexpr char kMagic[8] = {'R', 'B', 'T', 'R', 'A', 'C', 'E', '1'};
+
+/// Oldest events of a wrapped ring left out of a dump: the owner may be
+/// overwriting them while they are written.
+constexpr uint64_t kDumpMargin = 64;
+
+constexpr int kCrashSignals[] = {SIGSEGV, SIGBUS, SIGFPE, SIGILL, SIGABRT};
+
+char crash_path[256];
+
+uint64_t MonotonicNs() {
+  timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (static_cast<uint64_t>(now.tv_sec) * 1000000000ull +
+          static_cast<uint64_t>(now.tv_nsec));
+}
+
+/// write() until done; async-signal-safe.
+bool WriteAll(int fd, const void *data, size_t n) {
+  const char *p = static_cast<const char *>(data);
+  while (n > 0) {
+    const ssize_t written = write(fd, p, n);
+    if (written < 0 && errno == EINTR) {
+      continue;
+    }
+    if (written <= 0) {
+      return (false);
+    }
+    p += written;
+    n -= static_cast<size_t>(written);
+  }
+  return (true);
+}
+
+}  // namespace
+
+std::atomic<bool> FlightRecorder::enabled_{true};
+std::atomic<FlightRecorder::Ring *> FlightRecorder::rings_[kMaxRings];
+std::atomic<size_t> FlightRecorder::ring_count_{0};
+std::atomic<uint64_t> FlightRecorder::start_tsc_{0};
+std::atomic<uint64_t> FlightRecorder::start_ns_{0};
+thread_local FlightRecorder::Lease FlightRecorder::lease_;
+thread_local bool FlightRecorder::exiting_ = false;
+
+void FlightRecorder::SetEnabled(bool enabled) {
+  enabled_.store(enabled, std::memory_order_relaxed);
+}
+
+bool FlightRecorder::Enabled() {
+  return (enabled_.load(std::memory_order_relaxed));
+}
+
+FlightRecorder::Lease::~Lease() {
+  if (held && ring_) {
+    ring_->in_use.store(false, std::memory_order_release);
+    ring_ = nullptr;
+  }
+  exiting_ = true;
+}
+
+FlightRecorder::Ring *FlightRecorder::Attach() {
+  if (exiting_) {
+    return (nullptr);
+  }
+  if (start_tsc_.load(std::memory_order_relaxed) == 0) {
+    uint64_t expected = 0;
+    if (start_tsc_.compare_exchange_strong(expected, Now())) {
+      start_ns_.store(MonotonicNs(), std::memory_order_relaxed);
+    }
+  }
+
+  // Reuse the ring of a thread that has exited, else allocate one.
+  Ring *ring = nullptr;
+  uint32_t previous = 0;
+  const size_t count =
+      std::min(ring_count_.load(std::memory_order_acquire), kMaxRings);
+  for (size_t i = 0; i < count && !ring; i++) {
+    Ring *candidate = rings_[i].load(std::memory_order_acquire);
+    bool idle = false;
+    if (candidate &&
+        candidate->in_use.compare_exchange_strong(idle, true)) {
+      ring = candidate;
+      previous = ring->thread_id;
+    }
+  }
+  if (!ring) {
+    const size_t index = ring_count_.fetch_add(1);
+    if (index >= kMaxRings) {
+      return (nullptr);
+    }
+    ring = new Ring();
+    ring->head.store(0, std::memory_order_relaxed);
+    ring->in_use.store(true, std::memory_order_relaxed);
+    ring->index = static_cast<uint32_t>(index);
+    rings_[index].store(ring, std::memory_order_release);
+  }
+  ring->thread_id = static_cast<uint32_t>(syscall(SYS_gettid));
+  lease_.held = true;  // Registers the lease, so thread exit releases it.
+  ring_ = ring;
+  if (previous != 0) {
+    // The old owner's events stay; mark where the new owner's begin.
+    Record(TraceOp::KTHREAD, TracePhase::KPOINT, ring->thread_id, previous, 0);
+  }
+  return (ring);
+}
+
+bool FlightRecorder::DumpTo(int fd) {
+  Ring *rings[kMaxRings];
+  const size_t allocated =
+      std::min(ring_count_.load(std::memory_order_acquire), kMaxRings);
+  uint32_t count = 0;
+  for (size_t i = 0; i < allocated; i++) {
+    Ring *ring = rings_[i].load(std::memory_order_acquire);
+    if (ring) {
+      rings[count++] = ring;
+    }
+  }
+
+  const uint64_t header[4] = {start_tsc_.load(std::memory_order_relaxed),
+                              start_ns_.load(std::memory_order_relaxed),
+                              Now(), MonotonicNs()};
+  bool ok = WriteAll(fd, kMagic, sizeof(kMagic)) &&
+            WriteAll(fd, header, sizeof(header)) &&
+            WriteAll(fd, &count, sizeof(count));
+  for (uint32_t i = 0; ok && i < count; i++) {
+    const Ring *ring = rings[i];
+    const uint64_t head = ring->head.load(std::memory_order_acquire);
+    const uint64_t kept = head > kRingEvents ? kRingEvents - kDumpMargin
+                                             : head;
+    const uint64_t first = head - kept;
+    const uint32_t ring_header[3] = {ring->index, ring->thread_id,
+                                     static_cast<uint32_t>(kept)};
+    ok = WriteAll(fd, ring_header, sizeof(ring_header));
+
+    // At most two slices: up to the end of the array, then from its start.
+    const size_t begin = first & (kRingEvents - 1);
+    const size_t tail = std::min<uint64_t>(kept, kRingEvents - begin);
+    ok = ok && WriteAll(fd, &ring->events[begin], tail * sizeof(TraceEvent)) &&
+         WriteAll(fd, &ring->events[0], (kept - tail) * sizeof(TraceEvent));
+  }
+  return (ok);
+}
+
+bool FlightRecorder::Dump(const char *path) {
+  const int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+  if (fd < 0) {
+    return (false);
+  }
+  const bool ok = DumpTo(fd);
+  return (close(fd) == 0 && ok);
+}
+
+bool FlightRecorder::InstallCrashHandler(const char *path) {
+  const size_t length = std::strlen(path);
+  if (length >= sizeof(crash_path)) {
+    return (false);
+  }
+  std::memcpy(crash_path, path, length + 1);
+
+  struct sigaction action;
+  std::memset(&action, 0, sizeof(action));
+  sigemptyset(&action.sa_mask);
+  // The default action is restored first, so re-raising the signal after
+  // the dump ends the process as it would have without the recorder.
+  action.sa_flags = SA_RESETHAND;
+  action.sa_handler = [](int sig) {
+    Dump(crash_path);
+    raise(sig);
+  };
+  bool ok = true;
+  for (int sig : kCrashSignals) {
+    ok = sigaction(sig, &action, nullptr) == 0 && ok;
+  }
+  return (ok);
+}
+
+bool LoadTrace(const std::string &path, TraceDump *dump) {
+  FILE *file = std::fopen(path.c_str(), "rb");
+  if (!file) {
+    return (false);
+  }
+  char magic[sizeof(kMagic)];
+  uint64_t header[4];
+  uint32_t count = 0;
+  bool ok = std::fread(magic, sizeof(magic), 1, file) == 1 &&
+            std::memcmp(magic, kMagic, sizeof(kMagic)) == 0 &&
+            std::fread(header, sizeof(header), 1, file) == 1 &&
+            std::fread(&count, sizeof(count), 1, file) == 1 &&
+            count <= FlightRecorder::kMaxRings;
+
+  dump->start_tsc = ok ? header[0] : 0;
+  dump->ticks_per_ns =
+      ok && header[3] > header[1] && header[2] > header[0]
+          ? static_cast<double>(header[2] - header[0]) /
+                static_cast<double>(header[3] - header[1])
+          : 1.0;
+  dump->threads.clear();
+  for (uint32_t i = 0; ok && i < count; i++) {
+    uint32_t ring_header[3];
+    ok = std::fread(ring_header, sizeof(ring_header), 1, file) == 1 &&
+         ring_header[2] <= FlightRecorder::kRingEvents;
+    if (!ok) {
+      break;
+    }
+    std::vector<TraceEvent> events(ring_header[2]);
+    ok = events.empty() ||
+         std::fread(events.data(), sizeof(TraceEvent), events.size(), file) ==
+             events.size();
+
+    // One TraceThread per owner: the events before the first KTHREAD event
+    // belong to the owner it names as previous.
+    auto marker = [](const TraceEvent &event) {
+      return (event.op == TraceOp::KTHREAD);
+    };
+    auto it = std::find_if(events.begin(), events.end(), marker);
+    uint32_t owner = ring_header[1];
+    if (it != events.end()) {
+      owner = it == events.begin() ? it->handle
+                                   : static_cast<uint32_t>(it->amount);
+    }
+    if (events.empty()) {
+      dump->threads.push_back(TraceThread{ring_header[0], owner, {}});
+    }
+    auto from = events.begin();
+    while (from != events.end()) {
+      auto to = std::find_if(from + 1, events.end(), marker);
+      dump->threads.push_back(
+          TraceThread{ring_header[0], owner, std::vector<TraceEvent>(from, to)});
+      if (to != events.end()) {
+        owner = to->handle;
+      }
+      from = to;
+    }
+  }
+  std::fclose(file);
+  return (ok);
+}
+
+std::vector<TraceSpan> TraceSpans(const TraceDump &dump) {
+  std::vector<TraceSpan> spans;
+  const auto ns = [&dump](uint64_t tsc) {
+    return ((static_cast<double>(tsc) - static_cast<double>(dump.start_tsc)) /
+            dump.ticks_per_ns);
+  };
+
+  for (const TraceThread &thread : dump.threads) {
+    std::vector<const TraceEvent *> open;
+    for (const TraceEvent &event : thread.events) {
+      if (event.op == TraceOp::KTHREAD) {
+        open.clear();  // Begun by the previous owner of the ring.
+        continue;
+      }
+      if (event.phase == TracePhase::KBEGIN) {
+        open.push_back(&event);
+        continue;
+      }
+      if (event.phase != TracePhase::KEND) {
+        continue;
+      }
+      // The innermost open operation of the same kind; anything opened
+      // after it lost its end and is dropped.
+      auto it = std::find_if(open.rbegin(), open.rend(),
+                             [&event](const TraceEvent *begin) {
+                               return (begin->op == event.op);
+                             });
+      if (it == open.rend()) {
+        continue;  // Its begin fell out of the ring.
+      }
+      const TraceEvent *begin = *it;
+      open.erase(std::prev(it.base()), open.end());
+      spans.push_back(TraceSpan{event.op, thread.thread_id, ns(begin->tsc),
+                                ns(event.tsc) - ns(begin->tsc), begin->handle,
+                                begin->amount, event.amount, event.detail});
+    }
+  }
+  std::sort(spans.begin(), spans.end(),
+            [](const TraceSpan &a, const TraceSpan &b) {
+              return (a.begin_ns < b.begin_ns);
+            });
+  return (spans);
+}
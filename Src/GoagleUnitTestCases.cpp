@@ -1,8 +1,28 @@
 #include "Calculator.hpp"
 #include <gtest/gtest.h>
 #include <iostream>
+#include <algorithm>
+#include <mutex>
+#include <atomic>
+#include <cstdio>
+#include <fstream>
+#include <map>
+#include <sstream>
+#include <random>
+#include <thread>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
 #include "IAccount.hpp"
-#include  "Portofilo.hpp"
+#include "AccountIndex.hpp"
+#include "Replay.hpp"
+#include "AsyncPortfolio.hpp"
+#include "AuditArchive.hpp"
+#include "FlightRecorder.hpp"
+#include "HotPath.hpp"
+#include "Portfolio.hpp"
+#include "Replication.hpp"
+#include "ShardedPortfolio.hpp"
 
 TEST(CalculatorTest,DepositTest)
 {
@@ -115,7 +135,1930 @@ TEST(PortfolioTest, GetAccount_InvalidId)
     IAccount* found = portfolio.GetAccount("INVALID_ID");
     EXPECT_EQ(found, nullptr);
 }
+TEST(PortfolioTest, AddAccounts_BatchOnboarding)
+{
+    Portfolio portfolio;
+    AccountBatch batch;
+    batch.ids = {"CHK-001", "SAV-001", "CHK-002"};
+    batch.types = {AccountType::KCHECKING, AccountType::KSAVINGS,
+                   AccountType::KCHECKING};
+    batch.aprs = {0.0, 0.05, 0.0};
+    batch.fees_cents = {150, 0, 0};
+    batch.opening_balances = {1000, 5000, 0};
+
+    ASSERT_EQ(portfolio.AddAccounts(batch, DuplicatePolicy::KREJECT), 3u);
+    EXPECT_EQ(portfolio.CountAccounts(), 3u);
+    EXPECT_EQ(portfolio.GetAccount("SAV-001")->GetType(), AccountType::KSAVINGS);
+    EXPECT_EQ(portfolio.GetAccount("CHK-001")->GetSetting().fee_flat_cents, 150);
+    EXPECT_EQ(portfolio.TotalExposure(), 6000);
+}
+
+TEST(PortfolioTest, AddAccounts_DuplicatePolicies)
+{
+    Portfolio portfolio;
+    portfolio.AddAccount(std::make_unique<CheckingAccount>("CHK-001", 150, 1000));
+
+    AccountBatch batch;
+    batch.ids = {"CHK-002", "CHK-001"};
+    batch.types = {AccountType::KCHECKING, AccountType::KCHECKING};
+    batch.aprs = {0.0, 0.0};
+    batch.fees_cents = {0, 0};
+    batch.opening_balances = {200, 9999};
+
+    EXPECT_EQ(portfolio.AddAccounts(batch, DuplicatePolicy::KREJECT), 0u);
+    EXPECT_EQ(portfolio.CountAccounts(), 1u);
+    EXPECT_EQ(portfolio.GetAccount("CHK-002"), nullptr);
+
+    EXPECT_EQ(portfolio.AddAccounts(batch, DuplicatePolicy::KSKIP), 1u);
+    EXPECT_EQ(portfolio.GetAccount("CHK-001")->GetBalance(), 1000);
+
+    EXPECT_FALSE(portfolio.AddAccount(
+        std::make_unique<CheckingAccount>("CHK-002", 0, 1), DuplicatePolicy::KSKIP));
+    EXPECT_TRUE(portfolio.AddAccount(
+        std::make_unique<CheckingAccount>("CHK-002", 0, 1), DuplicatePolicy::KREPLACE));
+    EXPECT_EQ(portfolio.GetAccount("CHK-002")->GetBalance(), 1);
+}
+TEST(AccountIndexTest, InsertFindEraseAcrossRehash)
+{
+    AccountIndex index;
+    const std::string long_id = "SAV-" + std::string(40, 'x');
+
+    for (uint32_t i = 0; i < 5000; i++) {
+        ASSERT_TRUE(index.Insert("CHK-" + std::to_string(i), i));
+    }
+    ASSERT_TRUE(index.Insert(long_id, 5000));
+    EXPECT_FALSE(index.Insert("CHK-42", 7));
+    EXPECT_EQ(index.Size(), 5001u);
+
+    for (uint32_t i = 0; i < 5000; i += 2) {
+        ASSERT_TRUE(index.Erase("CHK-" + std::to_string(i)));
+    }
+    for (uint32_t i = 0; i < 5000; i++) {
+        uint32_t expected = (i % 2) ? i : AccountIndex::kNotFound;
+        ASSERT_EQ(index.Find("CHK-" + std::to_string(i)), expected);
+    }
+    EXPECT_EQ(index.Find(long_id), 5000u);
+    EXPECT_TRUE(index.Assign(long_id, 9));
+    EXPECT_EQ(index.Find(long_id, AccountIndex::Hash(long_id)), 9u);
+}
+TEST(PortfolioTest, Snapshot_ConsistentDuringTransfers)
+{
+    Portfolio portfolio;
+    portfolio.AddAccount(std::make_unique<CheckingAccount>("CHK-001", 0, 500000));
+    portfolio.AddAccount(std::make_unique<SavingAccount>("SAV-001", 0.0, 500000));
+
+    std::atomic<bool> done{false};
+    std::thread writer([&]() {
+        for (int i = 0; i < 20000; i++) {
+            TransferRecord tr{(i % 2) ? "CHK-001" : "SAV-001",
+                              (i % 2) ? "SAV-001" : "CHK-001", 100 + i % 7, i, ""};
+            portfolio.Transfer(tr);
+        }
+        done = true;
+    });
+
+    while (!done) {
+        ASSERT_EQ(portfolio.TotalExposure(), 1000000);
+        BookSnapshot snap = portfolio.Snapshot();
+        ASSERT_EQ(snap.balances.size(), 2u);
+        ASSERT_EQ(snap.balances[0] + snap.balances[1], 1000000);
+    }
+    writer.join();
+    EXPECT_EQ(portfolio.TotalExposure(), 1000000);
+}
+TEST(PortfolioTest, ConcurrentSnapshotsDrainOnlyTheirOwnEpoch)
+{
+    EpochClock clock;
+    std::atomic<bool> done{false};
+    std::atomic<uint64_t> inside[2] = {0, 0};
+
+    std::vector<std::thread> writers;
+    for (int w = 0; w < 2; w++) {
+        writers.emplace_back([&, w]() {
+            while (!done) {
+                EpochClock::WriteScope scope(&clock);
+                inside[w] = clock.WriteEpoch();
+                std::this_thread::yield();
+                inside[w] = 0;
+            }
+        });
+    }
+
+    std::vector<std::thread> readers;
+    std::atomic<int> stale{0};
+    for (int r = 0; r < 2; r++) {
+        readers.emplace_back([&]() {
+            uint64_t last = 0;
+            for (int i = 0; i < 2000; i++) {
+                uint64_t snapshot = clock.OpenSnapshot();
+                for (auto &epoch : inside) {
+                    uint64_t seen = epoch.load();
+                    if (seen != 0 && seen <= snapshot) {
+                        stale++;
+                    }
+                }
+                if (snapshot <= last) {
+                    stale++;
+                }
+                last = snapshot;
+            }
+        });
+    }
+    for (auto &reader : readers) {
+        reader.join();
+    }
+    done = true;
+    for (auto &writer : writers) {
+        writer.join();
+    }
+    EXPECT_EQ(stale.load(), 0);
+}
+TEST(ReplayTest, ParallelReplayMatchesAndReportsDivergence)
+{
+    AccountBatch opening;
+    for (int i = 0; i < 40; i++) {
+        opening.ids.push_back((i % 2 ? "SAV-" : "CHK-") + std::to_string(i));
+        opening.types.push_back(i % 2 ? AccountType::KSAVINGS : AccountType::KCHECKING);
+        opening.aprs.push_back(i % 2 ? 0.031 : 0.0);
+        opening.fees_cents.push_back(i % 2 ? 0 : 125);
+        opening.opening_balances.push_back(100000 + i);
+    }
+
+    std::vector<TxRecord> stream;
+    for (int i = 0; i < 3000; i++) {
+        TxKind kind = static_cast<TxKind>(i % 4);
+        int64_t amount = (kind == TxKind::KINTEREST) ? 30 : 100 + (i * 37) % 900;
+        stream.push_back({kind, amount, 1700000000 + i, "", opening.ids[(i * 7) % 40]});
+    }
+
+    Portfolio live;
+    live.AddAccounts(opening, DuplicatePolicy::KREJECT);
+    live.ApplyAll(stream);
+    ReplayManifest manifest = ReplayEngine::Record(live);
+
+    ReplayEngine engine(4);
+    ReplayReport ok = engine.Run(opening, stream, manifest);
+    EXPECT_TRUE(ok.matched);
+    EXPECT_EQ(ok.book_digest, manifest.book_digest);
+    EXPECT_EQ(ok.transactions, stream.size());
+
+    stream[1234].amount_cents += 1;
+    ReplayReport bad = engine.Run(opening, stream, manifest);
+    EXPECT_FALSE(bad.matched);
+    EXPECT_EQ(bad.divergent_id, stream[1234].account_id);
+    EXPECT_NE(bad.expected_balance, bad.actual_balance);
+    EXPECT_GE(bad.last_tx_index, 1234u);
+
+    // A stream naming an account the opening book lacks is reported, not
+    // applied.
+    stream[1234].amount_cents -= 1;
+    stream[2000].account_id = "CHK-GHOST";
+    stream[2500].account_id = "CHK-GHOST";
+    ReplayReport ghost = engine.Run(opening, stream, manifest);
+    EXPECT_FALSE(ghost.matched);
+    EXPECT_EQ(ghost.divergent_id, "CHK-GHOST");
+    EXPECT_EQ(ghost.last_tx_index, 2000u);
+    EXPECT_EQ(ghost.transactions, 0u);
+}
+TEST(PortfolioTest, Checksum_OrderIndependentAndLocatesDivergence)
+{
+    Portfolio a;
+    Portfolio b;
+    for (int i = 0; i < 100; i++) {
+        a.AddAccount(std::make_unique<CheckingAccount>("CHK-" + std::to_string(i), 0, i));
+        b.AddAccount(std::make_unique<CheckingAccount>("CHK-" + std::to_string(99 - i), 0, 99 - i));
+    }
+    EXPECT_EQ(a.Checksum().Root(), b.Checksum().Root());
+
+    a.ApplyAll({{TxKind::KDEPOSIT, 500, 1, "", "CHK-7"}});
+    b.Transfer({"CHK-8", "CHK-7", 500, 1, ""});
+    b.GetAccount("CHK-8")->Deposit(500, 2, "");
+    EXPECT_EQ(a.Checksum().Root(), b.Checksum().Root());
+
+    b.GetAccount("CHK-42")->Withdraw(1, 3, "");
+    BookDigest da = a.Checksum();
+    BookDigest db = b.Checksum();
+    EXPECT_NE(da.Root(), db.Root());
+    std::vector<size_t> shards = da.DivergentShards(db);
+    ASSERT_EQ(shards.size(), 1u);
+    EXPECT_EQ(shards[0], BookChecksum::ShardOf(AccountIndex::Hash("CHK-42")));
+}
+TEST(PortfolioTest, LazyAccrual_InterestAndFeesOnElapsedDays)
+{
+    const int64_t t0 = 1700000000;
+    const int64_t day = Calculator::kSecondsPerDay;
+
+    Portfolio portfolio;
+    portfolio.AddAccount(std::make_unique<SavingAccount>("SAV-001", 0.0365, 100000));
+    portfolio.SetAccrualPolicy({true, true, 30}, t0);
+    portfolio.AddAccount(std::make_unique<CheckingAccount>("CHK-001", 150, 1000));
+
+    int64_t balance = 0;
+    ASSERT_TRUE(portfolio.BalanceAt("SAV-001", t0 + 10 * day, &balance));
+    EXPECT_EQ(balance, 100100);
+    ASSERT_TRUE(portfolio.BalanceAt("SAV-001", t0 + 10 * day + 5, &balance));
+    EXPECT_EQ(balance, 100100);
+    ASSERT_TRUE(portfolio.BalanceAt("SAV-001", t0 + 30 * day, &balance));
+    EXPECT_EQ(balance, 100300);
+
+    portfolio.ApplyAll({{TxKind::KDEPOSIT, 500, t0 + 61 * day, "", "CHK-001"}});
+    EXPECT_EQ(portfolio.GetAccount("CHK-001")->GetBalance(), 1000 - 2 * 150 + 500);
+    EXPECT_FALSE(portfolio.BalanceAt("NOPE", t0, &balance));
+}
+
+TEST(PortfolioTest, LazyAccrual_ExplicitPostingsAreNotDoubled)
+{
+    const int64_t t0 = 1700000000;
+    const int64_t day = Calculator::kSecondsPerDay;
+
+    Portfolio portfolio;
+    portfolio.SetAccrualPolicy({true, true, 30}, t0);
+    portfolio.AddAccount(std::make_unique<SavingAccount>("SAV-001", 0.0365, 100000));
+    portfolio.AddAccount(std::make_unique<CheckingAccount>("CHK-001", 150, 1000));
+    portfolio.AddAccount(std::make_unique<CheckingAccount>("CHK-002", 150, 1000));
+
+    // 31 days of interest and one cycle fee are accrued; the explicit
+    // postings for the same period (both paths of ApplyAll, the account
+    // helpers and the sweep) add nothing on top.
+    portfolio.ApplyAll({{TxKind::KINTEREST, 0, t0 + 31 * day, "int", "SAV-001"},
+                        {TxKind::KFEE, 150, t0 + 31 * day, "fee", "CHK-001"}});
+    portfolio.ApplyPartitioned(
+        {{TxKind::KINTEREST, 30, t0 + 31 * day, "int", "SAV-001"},
+         {TxKind::KFEE, 150, t0 + 31 * day, "fee", "CHK-002"}},
+        2);
+    static_cast<SavingAccount *>(portfolio.GetAccount("SAV-001"))
+        ->ApplyInterest(t0 + 31 * day, "int");
+    static_cast<CheckingAccount *>(portfolio.GetAccount("CHK-001"))
+        ->ApplyFee(t0 + 31 * day, "fee");
+    const FeeSweepSummary sweep = portfolio.SweepFees(t0 + 31 * day, "fee", 2);
+    EXPECT_EQ(sweep.accounts_charged, 0u);
+    EXPECT_EQ(sweep.total_fees_cents, 0);
+
+    EXPECT_EQ(portfolio.GetAccount("SAV-001")->GetBalance(), 100310);
+    EXPECT_EQ(portfolio.GetAccount("CHK-001")->GetBalance(), 1000 - 150);
+    EXPECT_EQ(portfolio.GetAccount("CHK-002")->GetBalance(), 1000 - 150);
+    size_t fees = 0;
+    for (const TxRecord &rec : portfolio.GetAccount("CHK-001")->GetAudit())
+    {
+        fees += rec.kind == TxKind::KFEE;
+    }
+    EXPECT_EQ(fees, 1u);
+
+    // Without lazy fees an explicit fee is charged as before.
+    portfolio.SetAccrualPolicy({true, false, 0}, t0 + 31 * day);
+    portfolio.ApplyAll({{TxKind::KFEE, 40, t0 + 32 * day, "fee", "CHK-001"}});
+    EXPECT_EQ(portfolio.GetAccount("CHK-001")->GetBalance(), 1000 - 150 - 40);
+}
+
+TEST(PortfolioTest, SweepFees_ChargesCheckingAccountsOnly)
+{
+    Portfolio portfolio;
+    int64_t expected = 0;
+    for (int i = 0; i < 50; i++) {
+        portfolio.AddAccount(std::make_unique<CheckingAccount>(
+            "CHK-" + std::to_string(i), i % 5 == 0 ? 0 : 100 + i, 10000));
+        portfolio.AddAccount(std::make_unique<SavingAccount>(
+            "SAV-" + std::to_string(i), 0.02, 10000));
+        expected += (i % 5 == 0) ? 0 : 100 + i;
+    }
+
+    FeeSweepSummary summary = portfolio.SweepFees(1700000000, "Monthly fee", 3);
+    EXPECT_EQ(summary.total_fees_cents, expected);
+    EXPECT_EQ(summary.accounts_charged, 40u);
+    ASSERT_EQ(summary.fees_per_thread.size(), 3u);
+    EXPECT_EQ(summary.fees_per_thread[0] + summary.fees_per_thread[1] +
+              summary.fees_per_thread[2], expected);
+    EXPECT_EQ(portfolio.TotalExposure(), 100 * 10000 - expected);
+    EXPECT_EQ(portfolio.GetAccount("CHK-7")->GetBalance(), 10000 - 107);
+    EXPECT_EQ(portfolio.GetAccount("CHK-7")->GetAudit().back().kind, TxKind::KFEE);
+}
+static Task<int64_t> AsyncTransfers(AsyncPortfolio *ap, int count)
+{
+    std::vector<TxRecord> deposit(1);
+    deposit[0].kind = TxKind::KDEPOSIT;
+    deposit[0].amount_cents = 1000;
+    deposit[0].timestamp = 1;
+    deposit[0].note = "";
+    deposit[0].account_id = "CHK-001";
+    co_await ap->ApplyAllAsync(std::move(deposit));
+
+    for (int i = 0; i < count; i++) {
+        TransferRecord tr;
+        tr.from_id = "CHK-001";
+        tr.to_id = "SAV-001";
+        tr.amount_cents = 10;
+        tr.timestamp = i;
+        bool ok = co_await ap->TransferAsync(std::move(tr));
+        if (!ok) {
+            co_return -1;
+        }
+    }
+    co_return co_await ap->TotalExposureAsync();
+}
+
+TEST(AsyncPortfolioTest, AwaitableOperationsShareOneWriterStrand)
+{
+    Portfolio portfolio;
+    portfolio.AddAccount(std::make_unique<CheckingAccount>("CHK-001", 0, 0));
+    portfolio.AddAccount(std::make_unique<SavingAccount>("SAV-001", 0.0, 0));
+
+    ThreadPool pool(3);
+    std::atomic<size_t> flushed{0};
+    AsyncPortfolio ap(&portfolio, &pool, [&](const std::vector<TxRecord> &records) {
+        flushed += records.size();
+    });
+
+    std::vector<std::thread> clients;
+    for (int c = 0; c < 4; c++) {
+        clients.emplace_back([&ap]() { EXPECT_GT(SyncWait(AsyncTransfers(&ap, 50)), 0); });
+    }
+    for (auto &client : clients) {
+        client.join();
+    }
+
+    EXPECT_EQ(SyncWait(ap.TotalExposureAsync()), 4000);
+    EXPECT_EQ(portfolio.GetAccount("SAV-001")->GetBalance(), 4 * 50 * 10);
+    EXPECT_EQ(SyncWait(ap.FlushJournalAsync()), 4u);
+    EXPECT_EQ(flushed.load(), 4u);
+    EXPECT_EQ(SyncWait(ap.FlushJournalAsync()), 0u);
+}
+TEST(ThreadPoolTest, ParallelForRunsEveryShardAndNests)
+{
+    ThreadPool pool(3);
+    std::vector<int> hits(64, 0);
+    pool.ParallelFor(hits.size(), [&](size_t shard) {
+        std::atomic<int> inner{0};
+        pool.ParallelFor(4, [&](size_t) { inner++; });
+        hits[shard] = inner.load();
+    });
+    for (int h : hits) {
+        EXPECT_EQ(h, 4);
+    }
+}
+
+TEST(PortfolioTest, BulkOperationsOnInjectedPool)
+{
+    ThreadPool pool(4);
+    Portfolio portfolio(&pool);
+
+    AccountBatch batch;
+    const int count = 70000;
+    for (int i = 0; i < count; i++) {
+        batch.ids.push_back("CHK-" + std::to_string(i));
+        batch.types.push_back(AccountType::KCHECKING);
+        batch.aprs.push_back(0.0);
+        batch.fees_cents.push_back(1);
+        batch.opening_balances.push_back(10);
+    }
+    ASSERT_EQ(portfolio.AddAccounts(batch, DuplicatePolicy::KREJECT),
+              static_cast<size_t>(count));
+    EXPECT_EQ(portfolio.GetAccount("CHK-69999")->GetBalance(), 10);
+    EXPECT_EQ(portfolio.TotalExposure(), 10 * count);
+
+    std::vector<TxRecord> txs;
+    for (int i = 0; i < count; i += 7) {
+        txs.push_back({TxKind::KDEPOSIT, 5, 1, "", batch.ids[i]});
+    }
+    portfolio.ApplyPartitioned(txs, 8);
+    EXPECT_EQ(portfolio.SweepFees(2, "fee", 8).total_fees_cents, count);
+
+    BookSnapshot snap = portfolio.Snapshot();
+    EXPECT_EQ(snap.exposure, 9 * count + 5 * static_cast<int64_t>(txs.size()));
+    EXPECT_EQ(snap.balances[7], 14);
+}
+TEST(HotPathTest, MatchesVirtualApply)
+{
+    SavingAccount virt_sav("SAV-1", 0.05, 100000);
+    SavingAccount hot_sav("SAV-1", 0.05, 100000);
+    CheckingAccount virt_chk("CHK-1", 150, 5000);
+    CheckingAccount hot_chk("CHK-1", 150, 5000);
+    virt_sav.SetAccrual({true, false, 0}, 0);
+    hot_sav.SetAccrual({true, false, 0}, 0);
+
+    std::vector<TxRecord> txs = {
+        {TxKind::KDEPOSIT, 2500, 86400, "d", ""},
+        {TxKind::KINTEREST, 0, 2 * 86400, "i", ""},
+        {TxKind::KWITHDRAWAL, 700, 3 * 86400, "w", ""},
+        {TxKind::KFEE, 150, 4 * 86400, "f", ""},
+        {TxKind::KINTEREST, 12, 9 * 86400, "i", ""},
+        {TxKind::KTRANSFERIN, 40, 10 * 86400, "t", ""}};
+    for (const auto &tx : txs) {
+        virt_sav.Apply(tx);
+        virt_chk.Apply(tx);
+        HotPath<SavingAccount>::Apply(&hot_sav, tx);
+        HotPath<CheckingAccount>::Apply(&hot_chk, tx);
+    }
+
+    EXPECT_EQ(hot_sav.GetBalance(), virt_sav.GetBalance());
+    EXPECT_EQ(hot_chk.GetBalance(), virt_chk.GetBalance());
+    ASSERT_EQ(hot_sav.GetAudit().size(), virt_sav.GetAudit().size());
+    for (size_t i = 0; i < hot_sav.GetAudit().size(); i++) {
+        EXPECT_EQ(hot_sav.GetAudit()[i].kind, virt_sav.GetAudit()[i].kind);
+        EXPECT_EQ(hot_sav.GetAudit()[i].amount_cents,
+                  virt_sav.GetAudit()[i].amount_cents);
+    }
+
+    CheckingAccount quiet("CHK-2", 0, 100);
+    HotPath<CheckingAccount, BalanceOnlyPolicy>::Apply(&quiet, txs[0]);
+    EXPECT_EQ(quiet.GetBalance(), 2600);
+    EXPECT_TRUE(quiet.GetAudit().empty());
+}
+TEST(BalanceHistoryTest, AsOfQueriesMatchFullReplay)
+{
+    Portfolio portfolio;
+    const int accounts = 40;
+    for (int i = 0; i < accounts; i++) {
+        portfolio.AddAccount(std::make_unique<CheckingAccount>(
+            "CHK-" + std::to_string(i), 0, 1000 * i));
+    }
+    portfolio.EnableHistory(3600);
+
+    // Expected balance history: (time, balance) per account, in order.
+    std::vector<std::vector<std::pair<int64_t, int64_t>>> truth(accounts);
+    std::mt19937 rng(5);
+    int64_t ts = 0;
+    for (int batch = 0; batch < 200; batch++) {
+        std::vector<TxRecord> txs;
+        for (int k = 0; k < 10; k++) {
+            ts += rng() % 400;
+            int acc = rng() % accounts;
+            int64_t amount = rng() % 500;
+            TxKind kind = (rng() % 2) ? TxKind::KDEPOSIT : TxKind::KWITHDRAWAL;
+            txs.push_back({kind, amount, ts, "", "CHK-" + std::to_string(acc)});
+            int64_t before = truth[acc].empty() ? 1000 * acc
+                                                : truth[acc].back().second;
+            truth[acc].push_back({ts, kind == TxKind::KDEPOSIT
+                                          ? before + amount
+                                          : before - amount});
+        }
+        portfolio.ApplyAll(txs);
+    }
+
+    auto expected = [&](int acc, int64_t at) {
+        int64_t balance = 1000 * acc;
+        for (const auto &change : truth[acc]) {
+            if (change.first > at) {
+                break;
+            }
+            balance = change.second;
+        }
+        return balance;
+    };
+    for (int64_t at = -5; at <= ts + 10; at += 997) {
+        int64_t exposure_expected = 0;
+        for (int acc = 0; acc < accounts; acc++) {
+            int64_t cents = 0;
+            ASSERT_TRUE(portfolio.BalanceAsOf("CHK-" + std::to_string(acc), at,
+                                              &cents));
+            EXPECT_EQ(cents, expected(acc, at)) << acc << " @ " << at;
+            exposure_expected += expected(acc, at);
+        }
+        int64_t exposure = 0;
+        ASSERT_TRUE(portfolio.ExposureAsOf(at, &exposure));
+        EXPECT_EQ(exposure, exposure_expected) << "@ " << at;
+    }
+
+    std::vector<BalancePoint> range;
+    ASSERT_TRUE(portfolio.BalanceHistoryBetween("CHK-7", 5000, 60000, &range));
+    ASSERT_FALSE(range.empty());
+    EXPECT_EQ(range[0].balance_cents, expected(7, 5000));
+    size_t changes = 0;
+    for (const auto &change : truth[7]) {
+        changes += (change.first > 5000 && change.first <= 60000) ? 1 : 0;
+    }
+    EXPECT_EQ(range.size(), changes + 1);
+    for (size_t i = 1; i < range.size(); i++) {
+        EXPECT_EQ(range[i].balance_cents, expected(7, range[i].timestamp));
+    }
+
+    int64_t unused = 0;
+    EXPECT_FALSE(portfolio.BalanceAsOf("NOPE", 0, &unused));
+}
+TEST(BalanceHistoryTest, ExposureFollowsOutOfOrderUnsealedChanges)
+{
+    BalanceHistory history(1000);
+    const uint32_t accounts = 50;
+    for (uint32_t h = 0; h < accounts; h++) {
+        history.AddAccount(h, 100 * h);
+    }
+
+    // Accounts report out of order with each other; queries between batches
+    // fold the new changes into the log in pieces.
+    std::mt19937 rng(11);
+    std::vector<int64_t> balance(accounts);
+    for (uint32_t h = 0; h < accounts; h++) {
+        balance[h] = 100 * h;
+    }
+    int64_t now = 0;
+    for (int batch = 0; batch < 300; batch++) {
+        for (int k = 0; k < 8; k++) {
+            now += rng() % 40;
+            const uint32_t h = rng() % accounts;
+            balance[h] += static_cast<int64_t>(rng() % 200) - 100;
+            history.Record(h, balance[h], now - static_cast<int64_t>(rng() % 300));
+        }
+        if (batch % 7 == 0) {
+            history.Seal();
+        }
+        for (int64_t at = now - 400; at <= now + 5; at += 37) {
+            int64_t expected = 0;
+            for (uint32_t h = 0; h < accounts; h++) {
+                expected += history.BalanceAt(h, at);
+            }
+            ASSERT_EQ(history.ExposureAt(at), expected) << batch << " @ " << at;
+        }
+    }
+    EXPECT_GT(history.SealedSegments(), 0u);
+}
+TEST(StatementTest, StreamsPeriodPerPartition)
+{
+    Portfolio portfolio;
+    portfolio.AddAccount(std::make_unique<CheckingAccount>("CHK-1", 0, 1000));
+    portfolio.AddAccount(std::make_unique<CheckingAccount>("CHK-2", 0, 0));
+    portfolio.AddAccount(std::make_unique<SavingAccount>("SAV-3", 0.0, 500));
+    portfolio.ApplyAll({{TxKind::KDEPOSIT, 200, 5, "early", "CHK-1"},
+                        {TxKind::KWITHDRAWAL, 50, 10, "rent", "CHK-1"},
+                        {TxKind::KFEE, 7, 20, "fee", "CHK-1"},
+                        {TxKind::KDEPOSIT, 1, 30, "late", "CHK-1"}});
+    ASSERT_TRUE(portfolio.Transfer({"SAV-3", "CHK-2", 125, 15, "gift "}));
+
+    const std::string prefix = ::testing::TempDir() + "robobank_statements";
+    StatementRequest request{10, 20, StatementFormat::KTEXT, prefix, 2, 64};
+    StatementSummary summary;
+    ASSERT_TRUE(portfolio.WriteStatements(request, &summary));
+    EXPECT_EQ(summary.accounts, 3u);
+    EXPECT_EQ(summary.transactions, 4u);
+    ASSERT_EQ(summary.files.size(), 2u);
+
+    std::string text;
+    uint64_t bytes = 0;
+    for (const auto &file : summary.files) {
+        std::ifstream in(file);
+        std::stringstream all;
+        all << in.rdbuf();
+        text += all.str();
+        bytes += all.str().size();
+        std::remove(file.c_str());
+    }
+    EXPECT_EQ(bytes, summary.bytes);
+
+    std::istringstream lines(text);
+    std::vector<std::string> got;
+    for (std::string line; std::getline(lines, line);) {
+        got.push_back(line);
+    }
+    ASSERT_EQ(got.size(), 10u);
+    EXPECT_EQ(got[0], "S CHK-1                              10           20"
+                      "             1200");
+    EXPECT_EQ(got[1], "T           10 WDR               50             1150"
+                      " rent                    ");
+    EXPECT_EQ(got[2], "T           20 FEE                7             1143"
+                      " fee                     ");
+    EXPECT_EQ(got[3], "E CHK-1                           2             1143");
+    EXPECT_EQ(got[5], "T           15 DEP              125              125"
+                      " gift Teransfer In!.     ");
+    EXPECT_EQ(got[8], "T           15 WDR              125              375"
+                      " gift Transfer Out!      ");
+}
+TEST(StatementTest, FlagsPeriodsOlderThanTheRetainedTrail)
+{
+    Portfolio portfolio;
+    portfolio.AddAccount(std::make_unique<CheckingAccount>("CHK-FULL", 0, 0));
+    portfolio.AddAccount(std::make_unique<CheckingAccount>("CHK-SHORT", 0, 0));
+    std::vector<TxRecord> txs;
+    for (int i = 1; i <= 1005; i++)
+    {
+        txs.push_back({TxKind::KDEPOSIT, 1, i, "pay", "CHK-FULL"});
+    }
+    for (int i = 1; i <= 999; i++)
+    {
+        txs.push_back({TxKind::KDEPOSIT, 1, i, "pay", "CHK-SHORT"});
+    }
+    portfolio.ApplyAll(txs);
+
+    const std::string prefix = ::testing::TempDir() + "robobank_partial";
+    auto headers = [&](int64_t from, int64_t to, StatementSummary *summary)
+    {
+        StatementRequest request{from, to, StatementFormat::KTEXT, prefix, 1,
+                                 4096};
+        EXPECT_TRUE(portfolio.WriteStatements(request, summary));
+        std::ifstream in(summary->files[0]);
+        std::vector<std::string> got;
+        for (std::string line; std::getline(in, line);)
+        {
+            if (line[0] == 'S' || line[0] == 'P')
+            {
+                got.push_back(line);
+            }
+        }
+        std::remove(summary->files[0].c_str());
+        return got;
+    };
+
+    // CHK-FULL dropped its records at 1..5: a period from 3 is partial.
+    StatementSummary summary;
+    std::vector<std::string> got = headers(3, 2000, &summary);
+    ASSERT_EQ(got.size(), 2u);
+    EXPECT_EQ(got[0].substr(0, 11), "P CHK-FULL ");
+    EXPECT_EQ(got[1].substr(0, 11), "S CHK-SHORT");
+    EXPECT_EQ(summary.partial, 1u);
+
+    // A period inside the retained trail is complete.
+    got = headers(500, 600, &summary);
+    ASSERT_EQ(got.size(), 2u);
+    EXPECT_EQ(got[0], "S CHK-FULL                          500          600"
+                      "              499");
+    EXPECT_EQ(summary.partial, 0u);
+}
+
+TEST(DedupTest, RetriedBatchesAndTransfersApplyOnce)
+{
+    Portfolio portfolio;
+    portfolio.SetDedupWindow(100, 64);
+    portfolio.AddAccount(std::make_unique<CheckingAccount>("CHK-1", 0, 0));
+    portfolio.AddAccount(std::make_unique<CheckingAccount>("CHK-2", 0, 0));
+
+    std::vector<TxRecord> batch = {
+        {TxKind::KDEPOSIT, 100, 10, "a", "CHK-1", 1},
+        {TxKind::KDEPOSIT, 200, 11, "b", "CHK-2", 2},
+        {TxKind::KDEPOSIT, 5, 12, "unkeyed", "CHK-1"}};
+    portfolio.ApplyAll(batch);
+    portfolio.ApplyPartitioned(batch, 2);  // upstream retry
+    EXPECT_EQ(portfolio.GetAccount("CHK-1")->GetBalance(), 110);
+    EXPECT_EQ(portfolio.GetAccount("CHK-2")->GetBalance(), 200);
+    EXPECT_EQ(portfolio.DrainBatchAudit().size(), 4u);
+
+    TransferRecord move{"CHK-2", "CHK-1", 50, 20, "x", 3};
+    EXPECT_TRUE(portfolio.Transfer(move));
+    EXPECT_FALSE(portfolio.Transfer(move));
+    EXPECT_EQ(portfolio.GetAccount("CHK-1")->GetBalance(), 160);
+
+    DedupStats stats = portfolio.DeduplicationStats();
+    EXPECT_EQ(stats.admitted, 3u);
+    EXPECT_EQ(stats.duplicates, 3u);
+
+    // Two windows later the keys have expired and are accepted again.
+    portfolio.ApplyAll({{TxKind::KDEPOSIT, 1, 150, "tick", "CHK-2", 4}});
+    portfolio.ApplyAll({{TxKind::KDEPOSIT, 1, 250, "c", "CHK-1", 1}});
+    EXPECT_EQ(portfolio.GetAccount("CHK-1")->GetBalance(), 161);
+    EXPECT_EQ(portfolio.DeduplicationStats().keys_retained, 2u);
+    EXPECT_EQ(portfolio.DeduplicationStats().clamped_jumps, 0u);
+}
+
+TEST(DedupTest, IndexRemembersManyKeysAcrossGrowth)
+{
+    DedupIndex index(1000, 16);
+    for (uint64_t key = 1; key <= 5000; key++) {
+        ASSERT_TRUE(index.Admit(key * 7919, 10));
+    }
+    for (uint64_t key = 1; key <= 5000; key++) {
+        ASSERT_FALSE(index.Admit(key * 7919, 1500));
+    }
+    EXPECT_TRUE(index.Admit(3, 1500));
+    EXPECT_TRUE(index.Admit(7919, 2500));
+}
+
+TEST(DedupTest, FarFutureStampDoesNotFlushRetainedKeys)
+{
+    DedupIndex index(100, 16);
+    for (uint64_t key = 1; key <= 50; key++) {
+        ASSERT_TRUE(index.Admit(key, 10));
+    }
+    // One mis-stamped record far ahead, then the upstream retries.
+    EXPECT_TRUE(index.Admit(999, 1000000));
+    EXPECT_EQ(index.Stats().clamped_jumps, 1u);
+    for (uint64_t key = 1; key <= 50; key++) {
+        ASSERT_FALSE(index.Admit(key, 20)) << key;
+    }
+    EXPECT_EQ(index.Stats().duplicates, 50u);
+
+    // Ordinary time still expires them after the retention window.
+    EXPECT_TRUE(index.Admit(2000, 250));
+    EXPECT_TRUE(index.Admit(1, 260));
+    EXPECT_FALSE(index.Admit(999, 260));
+    EXPECT_EQ(index.Stats().clamped_jumps, 1u);
+}
+
+TEST(DedupTest, ForgottenKeysAreAdmittedAgain)
+{
+    DedupIndex index(1000, 16);
+    for (uint64_t key = 1; key <= 3000; key++) {
+        ASSERT_TRUE(index.Admit(key * 7919, 10));
+    }
+    for (uint64_t key = 3; key <= 3000; key += 3) {
+        index.Forget(key * 7919);
+    }
+    index.Forget(12345);  // Never admitted.
+    // Removing keys must not cut the probe runs of the keys left.
+    for (uint64_t key = 1; key <= 3000; key++) {
+        ASSERT_EQ(index.Admit(key * 7919, 20), key % 3 == 0) << key;
+    }
+    EXPECT_EQ(index.Stats().admitted, 3000u);
+}
+TEST(TieringTest, DormantAccountsRoundTripThroughColdTier)
+{
+    Portfolio portfolio;
+    portfolio.AddAccount(std::make_unique<CheckingAccount>("CHK-1", 250, 1000));
+    portfolio.AddAccount(std::make_unique<SavingAccount>("SAV-1", 0.05, 5000));
+    portfolio.AddAccount(std::make_unique<CheckingAccount>("CHK-2", 0, 0));
+
+    std::vector<TxRecord> txs;
+    for (int i = 0; i < 200; i++)
+    {
+        txs.push_back({TxKind::KDEPOSIT, 10 + i, 100 + i, "pay", "CHK-1"});
+        txs.push_back({TxKind::KWITHDRAWAL, 3, 100 + i, "atm", "SAV-1"});
+    }
+    txs.push_back({TxKind::KDEPOSIT, 7, 5000, "late", "CHK-2"});
+    portfolio.ApplyAll(txs);
+
+    const std::vector<AccountDigest> before = portfolio.Digest();
+    const uint64_t root = portfolio.Checksum().Root();
+    const size_t hot_audit_bytes =
+        400 * sizeof(TxRecord);  // audit vectors alone, before demotion
+
+    EXPECT_EQ(portfolio.DemoteIdle(5000, 1000), 2u);
+    TieringStats stats = portfolio.TierStats();
+    EXPECT_EQ(stats.resident, 1u);
+    EXPECT_EQ(stats.cold, 2u);
+    EXPECT_LT(stats.cold_bytes * 4, hot_audit_bytes);
+
+    // Reads that do not need the object leave the accounts cold.
+    EXPECT_EQ(portfolio.TotalExposure(), before[0].balance_cents +
+                                             before[1].balance_cents +
+                                             before[2].balance_cents);
+    const std::vector<AccountDigest> cold = portfolio.Digest();
+    ASSERT_EQ(cold.size(), before.size());
+    for (size_t i = 0; i < cold.size(); i++)
+    {
+        EXPECT_EQ(cold[i].account_id, before[i].account_id);
+        EXPECT_EQ(cold[i].balance_cents, before[i].balance_cents);
+        EXPECT_EQ(cold[i].audit_digest, before[i].audit_digest);
+    }
+    EXPECT_EQ(portfolio.Checksum().Root(), root);
+    EXPECT_EQ(portfolio.TierStats().cold, 2u);
+
+    // A transaction promotes transparently, audit and settings intact.
+    portfolio.ApplyAll({{TxKind::KFEE, 0, 6000, "fee", "CHK-1"}});
+    IAccount *chk = portfolio.GetAccount("CHK-1");
+    EXPECT_EQ(chk->GetAudit().size(), 201u);
+    EXPECT_STREQ(chk->GetAudit()[5].note, "pay");
+    EXPECT_EQ(chk->GetAudit()[5].timestamp, 105);
+    EXPECT_EQ(chk->GetSetting().fee_flat_cents, 250);
+
+    IAccount *sav = portfolio.GetAccount("SAV-1");
+    EXPECT_EQ(sav->GetType(), AccountType::KSAVINGS);
+    EXPECT_DOUBLE_EQ(sav->GetSetting().apr, 0.05);
+    EXPECT_EQ(sav->GetBalance(), 5000 - 600);
+    stats = portfolio.TierStats();
+    EXPECT_EQ(stats.cold, 0u);
+    EXPECT_EQ(stats.promotions, 2u);
+}
+
+TEST(TieringTest, ColdAccountsFollowAccrualAndParallelApply)
+{
+    Portfolio portfolio;
+    portfolio.AddAccount(std::make_unique<SavingAccount>("SAV-1", 0.10, 100000));
+    portfolio.AddAccount(std::make_unique<SavingAccount>("SAV-2", 0.10, 100000));
+    EXPECT_EQ(portfolio.DemoteIdle(0, 0), 2u);
 
+    // The policy reaches the cold blob; accrual posts there without thawing.
+    portfolio.SetAccrualPolicy({true, false, 0}, 0);
+    portfolio.AccrueAll(365 * Calculator::kSecondsPerDay);
+    EXPECT_EQ(portfolio.TierStats().cold, 2u);
+    EXPECT_EQ(portfolio.TotalExposure(), 220000);
+    EXPECT_EQ(portfolio.GetAccount("SAV-1")->GetBalance(), 110000);
+
+    EXPECT_EQ(portfolio.DemoteIdle(400 * Calculator::kSecondsPerDay, 0), 1u);
+    std::vector<TxRecord> txs;
+    for (int i = 0; i < 100; i++)
+    {
+        txs.push_back({TxKind::KDEPOSIT, 1, 365 * Calculator::kSecondsPerDay,
+                       "d", i % 2 ? "SAV-1" : "SAV-2"});
+    }
+    portfolio.ApplyPartitioned(txs, 2);
+    EXPECT_EQ(portfolio.TotalExposure(), 220100);
+    EXPECT_EQ(portfolio.TierStats().promotions, 3u);
+}
+
+TEST(TieringTest, ColdAccrualMatchesResidentAccrual)
+{
+    const int64_t t0 = 1700000000;
+    const int64_t day = Calculator::kSecondsPerDay;
+    Portfolio hot;
+    Portfolio cold;
+    for (Portfolio *book : {&hot, &cold})
+    {
+        book->AddAccount(std::make_unique<SavingAccount>("SAV-1", 0.05, 200000));
+        book->AddAccount(std::make_unique<CheckingAccount>("CHK-1", 100, 5000));
+        book->AddAccount(std::make_unique<CheckingAccount>("CHK-FULL", 25, 0));
+        std::vector<TxRecord> txs;
+        for (int i = 0; i < 998; i++)
+        {
+            txs.push_back({TxKind::KDEPOSIT, 10, t0 - 1000 + i, "pay",
+                           "CHK-FULL"});
+        }
+        txs.push_back({TxKind::KDEPOSIT, 70, t0 - 5, "pay", "SAV-1"});
+        book->ApplyAll(txs);
+        book->SetAccrualPolicy({true, true, 30}, t0);
+    }
+    EXPECT_EQ(cold.DemoteIdle(t0 + 1, 0), 3u);
+
+    // Three fee cycles and 95 days of interest; CHK-FULL's trail overflows.
+    hot.AccrueAll(t0 + 95 * day);
+    cold.AccrueAll(t0 + 95 * day);
+    TieringStats stats = cold.TierStats();
+    EXPECT_EQ(stats.cold, 3u);
+    EXPECT_EQ(stats.promotions, 0u);
+    EXPECT_EQ(cold.TotalExposure(), hot.TotalExposure());
+    EXPECT_EQ(cold.Checksum().Root(), hot.Checksum().Root());
+
+    const std::vector<AccountDigest> expected = hot.Digest();
+    std::vector<AccountDigest> actual = cold.Digest();
+    ASSERT_EQ(actual.size(), expected.size());
+    for (size_t i = 0; i < actual.size(); i++)
+    {
+        EXPECT_EQ(actual[i].balance_cents, expected[i].balance_cents);
+        EXPECT_EQ(actual[i].audit_digest, expected[i].audit_digest);
+    }
+
+    // Promotion picks up the patched anchors: nothing is accrued twice.
+    std::vector<TxRecord> txs;
+    for (const char *id : {"SAV-1", "CHK-1", "CHK-FULL"})
+    {
+        txs.push_back({TxKind::KDEPOSIT, 1, t0 + 100 * day, "late", id});
+    }
+    hot.ApplyAll(txs);
+    cold.ApplyAll(txs);
+    EXPECT_EQ(cold.TierStats().promotions, 3u);
+    EXPECT_EQ(cold.GetAccount("CHK-FULL")->GetAudit().size(), 1000u);
+    actual = cold.Digest();
+    const std::vector<AccountDigest> after = hot.Digest();
+    for (size_t i = 0; i < actual.size(); i++)
+    {
+        EXPECT_EQ(actual[i].balance_cents, after[i].balance_cents);
+        EXPECT_EQ(actual[i].audit_digest, after[i].audit_digest);
+    }
+    EXPECT_EQ(cold.GetAccount("CHK-1")->GetBalance(), 5000 - 3 * 100 + 1);
+}
+
+TEST(TieringTest, FeeSweepChargesColdAccountsInPlace)
+{
+    Portfolio hot;
+    Portfolio cold;
+    for (Portfolio *book : {&hot, &cold})
+    {
+        for (int i = 0; i < 40; i++)
+        {
+            const std::string id = std::to_string(i);
+            if (i % 4 == 3)
+            {
+                book->AddAccount(std::make_unique<SavingAccount>("SAV-" + id, 0.02,
+                                                                 10000 + i));
+            }
+            else
+            {
+                book->AddAccount(std::make_unique<CheckingAccount>("CHK-" + id,
+                                                                   100 + i, 5000));
+            }
+        }
+        book->ApplyAll({{TxKind::KDEPOSIT, 10, 50, "pay", "CHK-0"}});
+    }
+    EXPECT_EQ(cold.DemoteIdle(55, 10), 39u);
+
+    const FeeSweepSummary expected = hot.SweepFees(200, "monthly", 3);
+    const FeeSweepSummary actual = cold.SweepFees(200, "monthly", 3);
+    TieringStats stats = cold.TierStats();
+    EXPECT_EQ(stats.cold, 39u);
+    EXPECT_EQ(stats.promotions, 0u);
+    EXPECT_EQ(actual.accounts_charged, expected.accounts_charged);
+    EXPECT_EQ(actual.total_fees_cents, expected.total_fees_cents);
+    EXPECT_EQ(cold.TotalExposure(), hot.TotalExposure());
+    EXPECT_EQ(cold.Checksum().Root(), hot.Checksum().Root());
+
+    const std::vector<TxRecord> hot_audit = hot.DrainBatchAudit();
+    const std::vector<TxRecord> cold_audit = cold.DrainBatchAudit();
+    ASSERT_EQ(cold_audit.size(), hot_audit.size());
+    for (size_t i = 0; i < cold_audit.size(); i++)
+    {
+        EXPECT_EQ(cold_audit[i].account_id, hot_audit[i].account_id);
+        EXPECT_EQ(cold_audit[i].amount_cents, hot_audit[i].amount_cents);
+    }
+    const std::vector<AccountDigest> want = hot.Digest();
+    const std::vector<AccountDigest> got = cold.Digest();
+    ASSERT_EQ(got.size(), want.size());
+    for (size_t i = 0; i < got.size(); i++)
+    {
+        EXPECT_EQ(got[i].balance_cents, want[i].balance_cents);
+        EXPECT_EQ(got[i].audit_digest, want[i].audit_digest);
+    }
+    EXPECT_EQ(cold.TierStats().cold, 39u);
+
+    IAccount *chk = cold.GetAccount("CHK-5");
+    ASSERT_EQ(chk->GetAudit().size(), 1u);
+    EXPECT_EQ(chk->GetAudit()[0].kind, TxKind::KFEE);
+    EXPECT_STREQ(chk->GetAudit()[0].note, "monthly");
+    EXPECT_EQ(chk->GetBalance(), 5000 - 105);
+}
+
+TEST(TieringTest, ConcurrentGetAccountPromotesOnce)
+{
+    Portfolio portfolio;
+    for (int i = 0; i < 64; i++)
+    {
+        portfolio.AddAccount(std::make_unique<CheckingAccount>(
+            "CHK-" + std::to_string(i), 10, 100 + i));
+    }
+    EXPECT_EQ(portfolio.DemoteIdle(1, 0), 64u);
+
+    // Const readers racing on the same cold accounts.
+    const Portfolio &view = portfolio;
+    std::vector<std::vector<IAccount *>> seen(4, std::vector<IAccount *>(64));
+    std::vector<std::thread> readers;
+    for (size_t t = 0; t < seen.size(); t++)
+    {
+        readers.emplace_back([&view, &seen, t]() {
+            for (int i = 0; i < 64; i++)
+            {
+                seen[t][i] = view.GetAccount("CHK-" + std::to_string(i));
+            }
+        });
+    }
+    for (std::thread &reader : readers)
+    {
+        reader.join();
+    }
+
+    for (int i = 0; i < 64; i++)
+    {
+        for (size_t t = 1; t < seen.size(); t++)
+        {
+            EXPECT_EQ(seen[t][i], seen[0][i]);
+        }
+        EXPECT_EQ(seen[0][i]->GetBalance(), 100 + i);
+    }
+    const TieringStats stats = portfolio.TierStats();
+    EXPECT_EQ(stats.cold, 0u);
+    EXPECT_EQ(stats.promotions, 64u);
+}
+TEST(ShardedPortfolioTest, RoutesBatchesAndCommitsCrossShardTransfers)
+{
+    ShardedPortfolio book;
+    ASSERT_TRUE(book.Start(3));
+    EXPECT_FALSE(book.Start(2));
+
+    AccountBatch batch;
+    for (int i = 0; i < 30; i++)
+    {
+        batch.ids.push_back("ACC-" + std::to_string(i));
+        batch.types.push_back(i % 2 ? AccountType::KSAVINGS
+                                    : AccountType::KCHECKING);
+        batch.aprs.push_back(i % 2 ? 0.02 : 0.0);
+        batch.fees_cents.push_back(i % 2 ? 0 : 100);
+        batch.opening_balances.push_back(1000);
+    }
+    EXPECT_EQ(book.AddAccounts(batch, DuplicatePolicy::KREJECT), 30u);
+
+    std::vector<TxRecord> txs;
+    for (int i = 0; i < 30; i++)
+    {
+        txs.push_back({TxKind::KDEPOSIT, 10, 1, "dep", batch.ids[i]});
+    }
+    txs.push_back({TxKind::KDEPOSIT, 10, 1, "dep", "NO-SUCH-ACCOUNT"});
+    size_t applied = 0;
+    ASSERT_TRUE(book.ApplyAll(txs, &applied));
+    EXPECT_EQ(applied, 30u);
+
+    int64_t exposure = 0;
+    ASSERT_TRUE(book.TotalExposure(&exposure));
+    EXPECT_EQ(exposure, 30 * 1010);
+
+    // Pick one pair of accounts on different shards and one on the same.
+    std::string a = batch.ids[0], cross, local;
+    for (const std::string &id : batch.ids)
+    {
+        if (id == a)
+        {
+            continue;
+        }
+        if (book.ShardOf(id) != book.ShardOf(a) && cross.empty())
+        {
+            cross = id;
+        }
+        if (book.ShardOf(id) == book.ShardOf(a) && local.empty())
+        {
+            local = id;
+        }
+    }
+    ASSERT_FALSE(cross.empty());
+    ASSERT_FALSE(local.empty());
+
+    EXPECT_TRUE(book.Transfer({a, cross, 300, 2, "rent", 77}));
+    EXPECT_FALSE(book.Transfer({a, cross, 300, 2, "rent", 77}));
+    EXPECT_TRUE(book.Transfer({a, local, 100, 3, "gift"}));
+    EXPECT_FALSE(book.Transfer({a, "NO-SUCH-ACCOUNT", 50, 4, "lost"}));
+    EXPECT_EQ(book.CrossShardCommits(), 1u);
+
+    AccountView view;
+    ASSERT_TRUE(book.GetAccount(a, &view));
+    EXPECT_EQ(view.balance_cents, 1010 - 300 - 100);
+    EXPECT_EQ(view.audit_size, 3u);
+    ASSERT_TRUE(book.GetAccount(cross, &view));
+    EXPECT_EQ(view.balance_cents, 1010 + 300);
+    EXPECT_FALSE(book.GetAccount("NO-SUCH-ACCOUNT", &view));
+
+    ASSERT_TRUE(book.TotalExposure(&exposure));
+    EXPECT_EQ(exposure, 30 * 1010);
+    book.Stop();
+    EXPECT_EQ(book.Shards(), 0u);
+    EXPECT_FALSE(book.TotalExposure(&exposure));
+}
+TEST(ShardedPortfolioTest, AbortedTransferCanBeRetriedWithItsKey)
+{
+    ShardedPortfolio book;
+    ASSERT_TRUE(book.Start(2));
+    AccountBatch batch;
+    for (int i = 0; i < 20; i++)
+    {
+        batch.ids.push_back("ACC-" + std::to_string(i));
+        batch.types.push_back(AccountType::KCHECKING);
+        batch.aprs.push_back(0.0);
+        batch.fees_cents.push_back(0);
+        batch.opening_balances.push_back(1000);
+    }
+    // Keep back one account on the first account's shard and one on the
+    // other shard; transfers to them abort until they are added.
+    const std::string a = batch.ids[0];
+    AccountBatch later;
+    std::string local;
+    std::string cross;
+    for (size_t i = batch.ids.size(); i-- > 1;)
+    {
+        const bool same = book.ShardOf(batch.ids[i]) == book.ShardOf(a);
+        std::string &slot = same ? local : cross;
+        if (!slot.empty())
+        {
+            continue;
+        }
+        slot = batch.ids[i];
+        later.ids.push_back(batch.ids[i]);
+        later.types.push_back(AccountType::KCHECKING);
+        later.aprs.push_back(0.0);
+        later.fees_cents.push_back(0);
+        later.opening_balances.push_back(1000);
+        batch.aprs.erase(batch.aprs.begin() + i);
+        batch.ids.erase(batch.ids.begin() + i);
+        batch.types.erase(batch.types.begin() + i);
+        batch.fees_cents.erase(batch.fees_cents.begin() + i);
+        batch.opening_balances.erase(batch.opening_balances.begin() + i);
+    }
+    ASSERT_FALSE(local.empty());
+    ASSERT_FALSE(cross.empty());
+    EXPECT_EQ(book.AddAccounts(batch, DuplicatePolicy::KREJECT), 18u);
+
+    EXPECT_FALSE(book.Transfer({a, cross, 100, 5, "retry", 501}));
+    EXPECT_FALSE(book.Transfer({a, local, 100, 5, "retry", 502}));
+    EXPECT_EQ(book.CrossShardAborts(), 1u);
+
+    EXPECT_EQ(book.AddAccounts(later, DuplicatePolicy::KREJECT), 2u);
+    EXPECT_TRUE(book.Transfer({a, cross, 100, 6, "retry", 501}));
+    EXPECT_TRUE(book.Transfer({a, local, 100, 6, "retry", 502}));
+    // Once committed, the keys are spent.
+    EXPECT_FALSE(book.Transfer({a, cross, 100, 7, "retry", 501}));
+    EXPECT_FALSE(book.Transfer({a, local, 100, 7, "retry", 502}));
+
+    AccountView view;
+    ASSERT_TRUE(book.GetAccount(a, &view));
+    EXPECT_EQ(view.balance_cents, 800);
+    ASSERT_TRUE(book.GetAccount(cross, &view));
+    EXPECT_EQ(view.balance_cents, 1100);
+}
+
+TEST(ReplicationTest, FollowerProcessReplaysPrimaryExactly)
+{
+    std::unique_ptr<ReplicationRing> ring = ReplicationRing::Create(1 << 16);
+    ASSERT_NE(ring, nullptr);
+    ReplicationPublisher publisher(ring.get());
+
+    Portfolio primary;
+    primary.AddAccount(std::make_unique<CheckingAccount>("CHK-0", 100, 5000));
+    primary.SetReplicationSink(&publisher);
+
+    // The follower's standby book starts empty: the sink seeds CHK-0.
+    int pipe_fds[2];
+    ASSERT_EQ(pipe(pipe_fds), 0);
+    const pid_t pid = fork();
+    ASSERT_GE(pid, 0);
+    if (pid == 0)
+    {
+        ThreadPool pool(1);
+        Portfolio standby(&pool);
+        ReplicationFollower follower(ring.get(), &standby);
+        follower.Run();
+        const uint64_t root = standby.Checksum().Root();
+        const ssize_t written = write(pipe_fds[1], &root, sizeof(root));
+        _exit(written == sizeof(root) ? 0 : 1);
+    }
+
+    AccountBatch batch;
+    for (int i = 1; i <= 50; i++)
+    {
+        batch.ids.push_back("ACC-" + std::to_string(i));
+        batch.types.push_back(i % 2 ? AccountType::KSAVINGS
+                                    : AccountType::KCHECKING);
+        batch.aprs.push_back(0.03);
+        batch.fees_cents.push_back(150);
+        batch.opening_balances.push_back(10000 * i);
+    }
+    primary.AddAccounts(batch, DuplicatePolicy::KREJECT);
+
+    // More entries than the ring holds, so the primary waits on the follower.
+    std::vector<TxRecord> txs;
+    for (int i = 0; i < 5000; i++)
+    {
+        txs.push_back({i % 3 ? TxKind::KDEPOSIT : TxKind::KWITHDRAWAL, i % 97,
+                       1000 + i, i % 2 ? "card" : "wire",
+                       batch.ids[i % batch.ids.size()]});
+    }
+    primary.ApplyAll(txs);
+    primary.ApplyPartitioned(txs, 3);
+    EXPECT_TRUE(primary.Transfer({"ACC-1", "CHK-0", 700, 9000, "move"}));
+    primary.SweepFees(9500, "monthly fee", 2);
+    primary.SetAccrualPolicy({true, false, 0}, 10000);
+    primary.AccrueAll(10000 + 30 * Calculator::kSecondsPerDay);
+    int64_t cents = 0;
+    primary.BalanceAt("ACC-3", 10000 + 45 * Calculator::kSecondsPerDay,
+                      &cents);
+    ring->Close();
+
+    uint64_t standby_root = 0;
+    ASSERT_EQ(read(pipe_fds[0], &standby_root, sizeof(standby_root)),
+              static_cast<ssize_t>(sizeof(standby_root)));
+    int status = 0;
+    waitpid(pid, &status, 0);
+    close(pipe_fds[0]);
+    close(pipe_fds[1]);
+
+    EXPECT_EQ(standby_root, primary.Checksum().Root());
+    ReplicationStats stats = ring->Stats();
+    EXPECT_EQ(stats.lag_entries, 0u);
+    EXPECT_EQ(stats.applied, stats.published);
+    EXPECT_GT(stats.published_bytes, 1u << 16);  // The ring wrapped.
+}
+
+TEST(ReplicationTest, PromotedStandbyTakesOver)
+{
+    std::unique_ptr<ReplicationRing> ring = ReplicationRing::Create(1 << 20);
+    ASSERT_NE(ring, nullptr);
+    ReplicationPublisher publisher(ring.get());
+    Portfolio primary;
+    Portfolio standby;
+    primary.SetReplicationSink(&publisher);
+    ReplicationFollower follower(ring.get(), &standby);
+
+    primary.AddAccount(std::make_unique<SavingAccount>("SAV-1", 0.02, 100));
+    primary.ApplyAll({{TxKind::KDEPOSIT, 50, 1, "d", "SAV-1", 42}});
+    EXPECT_EQ(follower.Poll(1), 1u);
+    EXPECT_EQ(ring->Stats().lag_entries, 1u);
+
+    // The primary is lost here; promotion replays what it published.
+    EXPECT_EQ(follower.Promote(), 1u);
+    EXPECT_TRUE(follower.Promoted());
+    EXPECT_EQ(standby.GetAccount("SAV-1")->GetBalance(), 150);
+    EXPECT_DOUBLE_EQ(standby.GetAccount("SAV-1")->GetSetting().apr, 0.02);
+
+    // Its dedup index came along with the stream.
+    standby.ApplyAll({{TxKind::KDEPOSIT, 50, 2, "d", "SAV-1", 42}});
+    EXPECT_EQ(standby.GetAccount("SAV-1")->GetBalance(), 150);
+}
+
+TEST(ReplicationTest, OversizedEntriesNeverHangThePrimary)
+{
+    std::unique_ptr<ReplicationRing> ring = ReplicationRing::Create(1 << 16);
+    ASSERT_NE(ring, nullptr);
+    ReplicationPublisher publisher(ring.get());
+    Portfolio primary;
+    Portfolio standby;
+    primary.SetReplicationSink(&publisher);
+    ReplicationFollower follower(ring.get(), &standby);
+
+    primary.AddAccount(std::make_unique<SavingAccount>("SAV-1", 0.02, 100));
+    primary.AddAccount(std::make_unique<CheckingAccount>("CHK-1", 0, 100));
+    // Move the write offset to about 30 KB, then drain the ring.
+    std::vector<TxRecord> txs;
+    for (int i = 0; i < 540; i++)
+    {
+        txs.push_back({TxKind::KDEPOSIT, 1, i, "d", "SAV-1"});
+    }
+    primary.ApplyAll(txs);
+    follower.Poll(SIZE_MAX);
+    ASSERT_GT(ring->Stats().published_bytes, 30000u);
+
+    // Longer notes than the contiguous room left, or than the whole ring.
+    const std::string large(40000, 'n');
+    const std::string huge(100000, 'h');
+    primary.ApplyAll({{TxKind::KDEPOSIT, 7, 600, large.c_str(), "SAV-1"}});
+    follower.Poll(SIZE_MAX);
+    primary.ApplyAll({{TxKind::KDEPOSIT, 9, 601, huge.c_str(), "SAV-1"}});
+    follower.Poll(SIZE_MAX);
+    EXPECT_TRUE(primary.Transfer({"SAV-1", "CHK-1", 50, 602, huge}));
+    follower.Poll(SIZE_MAX);
+
+    // An ID that cannot fit is refused rather than waited on.
+    primary.AddAccount(std::make_unique<CheckingAccount>(huge, 0, 100));
+    follower.Poll(SIZE_MAX);
+
+    const ReplicationStats stats = ring->Stats();
+    EXPECT_EQ(stats.oversized, 1u);
+    EXPECT_EQ(stats.lag_entries, 0u);
+    EXPECT_EQ(standby.GetAccount("SAV-1")->GetBalance(),
+              primary.GetAccount("SAV-1")->GetBalance());
+    EXPECT_EQ(standby.GetAccount("CHK-1")->GetBalance(), 150);
+    EXPECT_EQ(standby.GetAccount(huge), nullptr);
+
+    // The notes arrived cut short to what one entry can carry.
+    const std::vector<TxRecord> audit = standby.GetAccount("SAV-1")->GetAudit();
+    ASSERT_GE(audit.size(), 3u);
+    const std::string replayed = audit[audit.size() - 3].note;
+    EXPECT_GT(replayed.size(), 30000u);
+    EXPECT_LE(replayed.size(), ring->MaxEntry());
+    EXPECT_EQ(replayed, large.substr(0, replayed.size()));
+}
+
+
+TEST(VelocityTest, CountsRecordsPerKindInTrailingWindows)
+{
+    Portfolio portfolio;
+    portfolio.AddAccount(std::make_unique<CheckingAccount>("CHK-1", 0, 100000));
+    portfolio.AddAccount(std::make_unique<SavingAccount>("SAV-1", 0.05, 100000));
+
+    VelocityStat stat{};
+    EXPECT_FALSE(portfolio.Velocity("CHK-1", TxKind::KDEPOSIT,
+                                    VelocityWindow::KMINUTE, 0, &stat));
+    portfolio.EnableVelocity();
+    EXPECT_FALSE(portfolio.Velocity("NOPE", TxKind::KDEPOSIT,
+                                    VelocityWindow::KMINUTE, 0, &stat));
+
+    const int64_t t0 = 7200 * 200;
+    portfolio.ApplyAll({{TxKind::KDEPOSIT, 100, t0, "a", "CHK-1"},
+                        {TxKind::KDEPOSIT, 100, t0 + 5, "b", "CHK-1"},
+                        {TxKind::KWITHDRAWAL, 40, t0 + 20, "c", "CHK-1"},
+                        {TxKind::KDEPOSIT, 100, t0 + 30, "d", "CHK-1"}});
+
+    ASSERT_TRUE(portfolio.Velocity("CHK-1", TxKind::KDEPOSIT,
+                                   VelocityWindow::KMINUTE, t0 + 30, &stat));
+    EXPECT_EQ(stat.count, 3u);
+    EXPECT_EQ(stat.sum_cents, 300);
+    portfolio.Velocity("CHK-1", TxKind::KWITHDRAWAL, VelocityWindow::KMINUTE,
+                       t0 + 30, &stat);
+    EXPECT_EQ(stat.count, 1u);
+    EXPECT_EQ(stat.sum_cents, 40);
+    portfolio.Velocity("SAV-1", TxKind::KDEPOSIT, VelocityWindow::KDAY, t0 + 30,
+                       &stat);
+    EXPECT_EQ(stat.count, 0u);
+
+    // Fifty minutes later the minute window has emptied, the hour has not.
+    portfolio.ApplyAll({{TxKind::KDEPOSIT, 50, t0 + 3000, "e", "CHK-1"}});
+    portfolio.Velocity("CHK-1", TxKind::KDEPOSIT, VelocityWindow::KMINUTE,
+                       t0 + 3000, &stat);
+    EXPECT_EQ(stat.count, 1u);
+    EXPECT_EQ(stat.sum_cents, 50);
+    portfolio.Velocity("CHK-1", TxKind::KDEPOSIT, VelocityWindow::KHOUR,
+                       t0 + 3000, &stat);
+    EXPECT_EQ(stat.count, 4u);
+    EXPECT_EQ(stat.sum_cents, 350);
+
+    // Demotion keeps the counters; the partitioned path feeds them as well.
+    EXPECT_EQ(portfolio.DemoteIdle(t0 + 7200, 0), 2u);
+    portfolio.ApplyPartitioned({{TxKind::KDEPOSIT, 25, t0 + 7200, "f", "CHK-1"},
+                                {TxKind::KDEPOSIT, 10, t0 + 7200, "g", "SAV-1"}},
+                               2);
+    portfolio.Velocity("CHK-1", TxKind::KDEPOSIT, VelocityWindow::KDAY,
+                       t0 + 7200, &stat);
+    EXPECT_EQ(stat.count, 5u);
+    EXPECT_EQ(stat.sum_cents, 375);
+    portfolio.Velocity("SAV-1", TxKind::KDEPOSIT, VelocityWindow::KDAY,
+                       t0 + 7200, &stat);
+    EXPECT_EQ(stat.count, 1u);
+
+    // Two days on, every window is empty.
+    portfolio.Velocity("CHK-1", TxKind::KDEPOSIT, VelocityWindow::KDAY,
+                       t0 + 2 * 86400, &stat);
+    EXPECT_EQ(stat.count, 0u);
+    EXPECT_EQ(stat.sum_cents, 0);
+}
+
+TEST(AuditArchiveTest, ExportRoundTripsEveryAuditRecord)
+{
+    Portfolio portfolio;
+    const char *notes[] = {"card", "atm", "payroll"};
+    std::vector<TxRecord> txs;
+    for (int a = 0; a < 6; a++)
+    {
+        const std::string id = "ACC-" + std::to_string(a);
+        portfolio.AddAccount(std::make_unique<CheckingAccount>(id, 0, 1000000));
+        // 700 records per account: groups of 1024 rows split some trails.
+        for (int i = 0; i < 700; i++)
+        {
+            txs.push_back({i % 3 ? TxKind::KDEPOSIT : TxKind::KWITHDRAWAL,
+                           (i * 37) % 5000, 1700000000 + i * 60 - a,
+                           notes[i % 3], id});
+        }
+    }
+    portfolio.ApplyAll(txs);
+    ASSERT_TRUE(portfolio.Transfer({"ACC-0", "ACC-5", 300, 1700100000, "rent"}));
+    EXPECT_EQ(portfolio.DemoteIdle(1800000000, 1000), 6u);
+
+    const std::string prefix = ::testing::TempDir() + "robobank_audit";
+    AuditExportSummary summary;
+    ASSERT_TRUE(portfolio.ExportAudit({prefix, 2, 1024}, &summary));
+    EXPECT_EQ(summary.accounts, 6u);
+    EXPECT_EQ(summary.rows, 6u * 700u + 2u);
+    ASSERT_EQ(summary.files.size(), 2u);
+    // Far below the 72-byte in-memory record.
+    EXPECT_LT(summary.bytes * 10, summary.rows * sizeof(TxRecord));
+    EXPECT_EQ(portfolio.TierStats().cold, 6u);
+
+    std::vector<TxRecord> read;
+    std::vector<AuditColumns> groups;
+    for (const std::string &file : summary.files)
+    {
+        FILE *in = std::fopen(file.c_str(), "rb");
+        ASSERT_NE(in, nullptr);
+        AuditArchiveReader reader(in);
+        AuditColumns columns;
+        while (reader.Next(&columns))
+        {
+            groups.push_back(columns);
+        }
+        EXPECT_TRUE(reader.Ok());
+        std::fclose(in);
+    }
+    EXPECT_GE(groups.size(), 4u);
+    for (const AuditColumns &group : groups)
+    {
+        std::vector<TxRecord> part;
+        AuditArchiveReader::ToRecords(group, &part);
+        read.insert(read.end(), part.begin(), part.end());
+    }
+
+    size_t row = 0;
+    for (int a = 0; a < 6; a++)
+    {
+        const std::string id = "ACC-" + std::to_string(a);
+        const std::vector<TxRecord> audit = portfolio.GetAccount(id)->GetAudit();
+        for (const TxRecord &rec : audit)
+        {
+            ASSERT_LT(row, read.size());
+            EXPECT_EQ(read[row].account_id, id);
+            EXPECT_EQ(read[row].kind, rec.kind);
+            EXPECT_EQ(read[row].amount_cents, rec.amount_cents);
+            EXPECT_EQ(read[row].timestamp, rec.timestamp);
+            EXPECT_STREQ(read[row].note, rec.note);
+            row++;
+        }
+    }
+    EXPECT_EQ(row, read.size());
+
+    // A truncated file is reported, not silently cut short.
+    FILE *in = std::fopen(summary.files[0].c_str(), "rb");
+    std::vector<char> bytes(1 << 20);
+    bytes.resize(std::fread(bytes.data(), 1, bytes.size(), in));
+    std::fclose(in);
+    FILE *cut = std::tmpfile();
+    std::fwrite(bytes.data(), 1, bytes.size() / 2, cut);
+    std::rewind(cut);
+    AuditArchiveReader reader(cut);
+    AuditColumns columns;
+    while (reader.Next(&columns))
+    {
+    }
+    EXPECT_FALSE(reader.Ok());
+    std::fclose(cut);
+    for (const std::string &file : summary.files)
+    {
+        std::remove(file.c_str());
+    }
+}
+
+TEST(AuditArchiveTest, WriterKeepsKeysNullNotesAndNegativeDeltas)
+{
+    FILE *file = std::tmpfile();
+    ASSERT_NE(file, nullptr);
+    AuditArchiveWriter writer(file, 0);
+    writer.Add("A", {{TxKind::KTRANSFEROUT, -5, 100, nullptr, "", 42},
+                     {TxKind::KINTEREST, 7, 50, "x", "", 0}});
+    writer.Add("B", {{TxKind::KFEE, 0, -10, "x", "", (1ull << 63) + 1}});
+    ASSERT_TRUE(writer.Finish());
+    EXPECT_EQ(writer.Rows(), 3u);
+
+    std::rewind(file);
+    AuditArchiveReader reader(file);
+    AuditColumns columns;
+    ASSERT_TRUE(reader.Next(&columns));
+    EXPECT_EQ(columns.notes.size(), 1u);
+    std::vector<TxRecord> records;
+    AuditArchiveReader::ToRecords(columns, &records);
+    ASSERT_EQ(records.size(), 3u);
+    EXPECT_EQ(records[0].kind, TxKind::KTRANSFEROUT);
+    EXPECT_EQ(records[0].amount_cents, -5);
+    EXPECT_EQ(records[0].note, nullptr);
+    EXPECT_EQ(records[0].idempotency_key, 42u);
+    EXPECT_EQ(records[1].timestamp, 50);
+    EXPECT_STREQ(records[1].note, "x");
+    EXPECT_EQ(records[1].idempotency_key, 0u);
+    EXPECT_EQ(records[2].account_id, "B");
+    EXPECT_EQ(records[2].timestamp, -10);
+    EXPECT_EQ(records[2].idempotency_key, (1ull << 63) + 1);
+    EXPECT_FALSE(reader.Next(&columns));
+    EXPECT_TRUE(reader.Ok());
+    std::fclose(file);
+}
+
+TEST(FlightRecorderTest, DumpReconstructsOperationsAndLatencies)
+{
+    ASSERT_TRUE(FlightRecorder::Enabled());
+    Portfolio portfolio;
+    portfolio.AddAccount(std::make_unique<CheckingAccount>("CHK-1", 0, 1000));
+    portfolio.AddAccount(std::make_unique<CheckingAccount>("CHK-2", 0, 1000));
+    std::vector<TxRecord> txs;
+    for (int i = 0; i < 100; i++)
+    {
+        txs.push_back({TxKind::KDEPOSIT, 10 + i, i, "pay", "CHK-1"});
+    }
+    portfolio.ApplyAll(txs);
+    ASSERT_TRUE(portfolio.Transfer({"CHK-1", "CHK-2", 123, 200, "rent"}));
+    EXPECT_FALSE(portfolio.Transfer({"CHK-1", "NOPE", 5, 201, "lost"}));
+
+    // A thread that wraps its ring, then one that records a single event.
+    std::thread([] {
+        for (size_t i = 0; i < FlightRecorder::kRingEvents + 10; i++)
+        {
+            FlightRecorder::Record(TraceOp::KPROMOTE, TracePhase::KPOINT,
+                                   static_cast<uint32_t>(i), 0, 7);
+        }
+    }).join();
+    std::thread([] {
+        FlightRecorder::Record(TraceOp::KPROMOTE, TracePhase::KPOINT, 0, 0, 8);
+    }).join();
+
+    const std::string path = ::testing::TempDir() + "robobank_trace.bin";
+    ASSERT_TRUE(FlightRecorder::Dump(path.c_str()));
+    TraceDump dump;
+    ASSERT_TRUE(LoadTrace(path, &dump));
+    std::remove(path.c_str());
+    EXPECT_GT(dump.ticks_per_ns, 0.0);
+
+    // The wrapped ring keeps its newest events, minus the dump margin (the
+    // second thread may have reused it, and then owns its newest ones).
+    const TraceThread *wrapped = nullptr;
+    bool second = false;
+    for (const TraceThread &thread : dump.threads)
+    {
+        if (!thread.events.empty() && thread.events.front().detail == 7 &&
+            thread.events.front().op == TraceOp::KPROMOTE)
+        {
+            wrapped = &thread;
+        }
+        for (const TraceEvent &event : thread.events)
+        {
+            second = second || (event.op == TraceOp::KPROMOTE &&
+                                event.detail == 8);
+        }
+    }
+    ASSERT_NE(wrapped, nullptr);
+    size_t kept = 0;
+    for (const TraceThread &thread : dump.threads)
+    {
+        kept += thread.ring == wrapped->ring ? thread.events.size() : 0;
+    }
+    EXPECT_EQ(kept, FlightRecorder::kRingEvents - 64);
+    EXPECT_TRUE(second);
+
+    size_t applied = 0;
+    for (const TraceThread &thread : dump.threads)
+    {
+        for (const TraceEvent &event : thread.events)
+        {
+            applied += event.op == TraceOp::KAPPLYTX ? 1 : 0;
+        }
+    }
+    EXPECT_GE(applied, txs.size());
+
+    const std::vector<TraceSpan> spans = TraceSpans(dump);
+    const TraceSpan *apply = nullptr;
+    std::vector<const TraceSpan *> transfers;
+    for (const TraceSpan &span : spans)
+    {
+        if (span.op == TraceOp::KAPPLYALL && span.amount == 100)
+        {
+            apply = &span;
+        }
+        if (span.op == TraceOp::KTRANSFER)
+        {
+            transfers.push_back(&span);
+        }
+    }
+    ASSERT_NE(apply, nullptr);
+    EXPECT_GT(apply->duration_ns, 0.0);
+    ASSERT_GE(transfers.size(), 2u);
+    const TraceSpan &ok = *transfers[transfers.size() - 2];
+    const TraceSpan &failed = *transfers.back();
+    EXPECT_EQ(ok.amount, 123);
+    EXPECT_EQ(ok.detail, 1);
+    EXPECT_EQ(ok.handle, 0u);
+    EXPECT_EQ(ok.result, 1);
+    EXPECT_EQ(failed.amount, 5);
+    EXPECT_EQ(failed.detail, 0);
+    EXPECT_GE(failed.begin_ns, ok.begin_ns + ok.duration_ns);
+}
+
+TEST(FlightRecorderTest, ReusedRingsKeepOwnersApart)
+{
+    // Rings outlive the test, so its handles are unique to each run.
+    static uint32_t runs = 0;
+    const uint32_t begun = 1000000 + 2 * runs++;
+    const uint32_t ended = begun + 1;
+
+    // The first thread exits inside an operation; the next one reuses its
+    // ring and ends an operation of the same kind that it began itself.
+    std::thread([begun] {
+        FlightRecorder::Record(TraceOp::KSWEEPFEES, TracePhase::KBEGIN, begun,
+                               0, 0);
+    }).join();
+    std::thread([ended] {
+        FlightRecorder::Record(TraceOp::KSWEEPFEES, TracePhase::KEND, ended, 1,
+                               0);
+        TraceScope scope(TraceOp::KSWEEPFEES, ended, 2);
+    }).join();
+
+    const std::string path = ::testing::TempDir() + "robobank_reuse.bin";
+    ASSERT_TRUE(FlightRecorder::Dump(path.c_str()));
+    TraceDump dump;
+    ASSERT_TRUE(LoadTrace(path, &dump));
+    std::remove(path.c_str());
+
+    const TraceThread *first = nullptr;
+    const TraceThread *second = nullptr;
+    for (const TraceThread &thread : dump.threads)
+    {
+        for (const TraceEvent &event : thread.events)
+        {
+            if (event.op == TraceOp::KSWEEPFEES && event.handle == begun)
+            {
+                first = &thread;
+            }
+            if (event.op == TraceOp::KSWEEPFEES && event.handle == ended)
+            {
+                second = &thread;
+            }
+        }
+    }
+    ASSERT_NE(first, nullptr);
+    ASSERT_NE(second, nullptr);
+    ASSERT_EQ(first->ring, second->ring);
+    EXPECT_NE(first, second);
+    EXPECT_NE(first->thread_id, second->thread_id);
+    EXPECT_EQ(second->events.front().op, TraceOp::KTHREAD);
+    EXPECT_EQ(second->events.front().handle, second->thread_id);
+
+    size_t own = 0;
+    for (const TraceSpan &span : TraceSpans(dump))
+    {
+        if (span.op != TraceOp::KSWEEPFEES)
+        {
+            continue;
+        }
+        EXPECT_NE(span.handle, begun);
+        if (span.handle == ended)
+        {
+            own++;
+            EXPECT_EQ(span.amount, 2);
+            EXPECT_EQ(span.thread_id, second->thread_id);
+        }
+    }
+    EXPECT_EQ(own, 1u);
+
+    // Without the split the marker alone keeps the owners apart.
+    TraceDump merged = dump;
+    merged.threads = {*first};
+    merged.threads[0].events.insert(merged.threads[0].events.end(),
+                                    second->events.begin(),
+                                    second->events.end());
+    for (const TraceSpan &span : TraceSpans(merged))
+    {
+        EXPECT_NE(span.handle, begun);
+    }
+}
+
+TEST(FlightRecorderTest, CrashHandlerDumpsBeforeTheProcessDies)
+{
+    const std::string path = ::testing::TempDir() + "robobank_crash.bin";
+    std::remove(path.c_str());
+    const pid_t pid = fork();
+    ASSERT_GE(pid, 0);
+    if (pid == 0)
+    {
+        if (!FlightRecorder::InstallCrashHandler(path.c_str()))
+        {
+            _exit(3);
+        }
+        Portfolio portfolio;
+        portfolio.AddAccount(std::make_unique<CheckingAccount>("CHK-1", 0, 0));
+        portfolio.ApplyAll({{TxKind::KDEPOSIT, 4242, 1, "last", "CHK-1"}});
+        std::abort();
+    }
+    int status = 0;
+    ASSERT_EQ(waitpid(pid, &status, 0), pid);
+    ASSERT_TRUE(WIFSIGNALED(status));
+    EXPECT_EQ(WTERMSIG(status), SIGABRT);
+
+    TraceDump dump;
+    ASSERT_TRUE(LoadTrace(path, &dump));
+    std::remove(path.c_str());
+    bool found = false;
+    for (const TraceThread &thread : dump.threads)
+    {
+        for (const TraceEvent &event : thread.events)
+        {
+            found = found || (event.op == TraceOp::KAPPLYTX &&
+                              event.amount == 4242);
+        }
+    }
+    EXPECT_TRUE(found);
+}
+
+namespace
+{
+class CollectingSink : public IReconcileSink
+{
+public:
+    void OnMatched(size_t, const ReconEntry &) override
+    {
+        std::lock_guard<std::mutex> lock(mu);
+        matched++;
+    }
+    void OnMissingFromBook(size_t, const ReconEntry &external) override
+    {
+        std::lock_guard<std::mutex> lock(mu);
+        missing_from_book.push_back(external);
+    }
+    void OnMissingFromExternal(size_t, const ReconEntry &book) override
+    {
+        std::lock_guard<std::mutex> lock(mu);
+        missing_from_external.push_back(book);
+    }
+    void OnMismatched(size_t, const ReconEntry &external,
+                      const ReconEntry &book) override
+    {
+        std::lock_guard<std::mutex> lock(mu);
+        mismatched.push_back({external, book});
+    }
+
+    std::mutex mu;
+    size_t matched = 0;
+    std::vector<ReconEntry> missing_from_book;
+    std::vector<ReconEntry> missing_from_external;
+    std::vector<std::pair<ReconEntry, ReconEntry>> mismatched;
+};
+}  // namespace
+
+TEST(ReconcileTest, SpilledSortMergeFindsEveryDifference)
+{
+    Portfolio portfolio;
+    std::vector<TxRecord> txs;
+    for (int a = 0; a < 8; a++)
+    {
+        const std::string id = "ACC-" + std::to_string(a);
+        portfolio.AddAccount(std::make_unique<CheckingAccount>(id, 0, 0));
+        for (int i = 0; i < 300; i++)
+        {
+            txs.push_back({TxKind::KDEPOSIT, 100 + i, 1700000000 + i * 60,
+                           nullptr, id});
+        }
+    }
+    portfolio.ApplyAll(txs);
+    EXPECT_EQ(portfolio.DemoteIdle(1800000000, 1000), 8u);
+
+    // The external side is the book with a few differences, shuffled.
+    std::vector<TxRecord> external = txs;
+    external.erase(external.begin() + 10);   // ACC-0, i = 10
+    external.erase(external.begin() + 700);  // ACC-2, i = 101 after the shift
+    external[1000].amount_cents += 1;        // ACC-3, i = 102
+    external.push_back({TxKind::KWITHDRAWAL, 5, 1700000120, nullptr, "ACC-7"});
+    external.push_back({TxKind::KDEPOSIT, 5, 1700000000, nullptr, "ACC-9"});
+    external.push_back({TxKind::KDEPOSIT, 5, 1600000000, nullptr, "ACC-1"});
+    std::shuffle(external.begin(), external.end(), std::mt19937(7));
+
+    size_t next = 0;
+    CollectingSink sink;
+    ReconcileSummary summary;
+    // 16 KiB of buffers for ~4800 records: many spilled runs.
+    ASSERT_TRUE(portfolio.Reconcile(
+        {1700000000, 1800000000, 3, 16 * 1024},
+        [&](TxRecord *rec)
+        {
+            if (next == external.size())
+            {
+                return false;
+            }
+            *rec = external[next++];
+            return true;
+        },
+        &sink, &summary));
+
+    EXPECT_GT(summary.runs_spilled, 6u);
+    EXPECT_GT(summary.bytes_spilled, 0u);
+    EXPECT_EQ(summary.matched, 8u * 300u - 3u);
+    EXPECT_EQ(sink.matched, summary.matched);
+
+    // ACC-3 i = 102 differs in amount. The extra withdrawal of ACC-7 shares
+    // its timestamp with i = 2, but that deposit matches exactly, so the
+    // withdrawal is left missing rather than paired.
+    ASSERT_EQ(summary.mismatched, 1u);
+    ASSERT_EQ(sink.mismatched.size(), 1u);
+    EXPECT_EQ(sink.mismatched[0].first.account_id, "ACC-3");
+    EXPECT_EQ(sink.mismatched[0].first.amount_cents, 203);
+    EXPECT_EQ(sink.mismatched[0].second.amount_cents, 202);
+
+    ASSERT_EQ(summary.missing_from_book, 2u);
+    ASSERT_EQ(sink.missing_from_book.size(), 2u);
+    std::sort(sink.missing_from_book.begin(), sink.missing_from_book.end(),
+              [](const ReconEntry &x, const ReconEntry &y)
+              { return x.account_id < y.account_id; });
+    EXPECT_EQ(sink.missing_from_book[0].account_id, "ACC-7");
+    EXPECT_EQ(sink.missing_from_book[0].kind, TxKind::KWITHDRAWAL);
+    EXPECT_EQ(sink.missing_from_book[1].account_id, "ACC-9");
+
+    ASSERT_EQ(summary.missing_from_external, 2u);
+    ASSERT_EQ(sink.missing_from_external.size(), 2u);
+    std::sort(sink.missing_from_external.begin(),
+              sink.missing_from_external.end(),
+              [](const ReconEntry &x, const ReconEntry &y)
+              { return x.account_id < y.account_id; });
+    EXPECT_EQ(sink.missing_from_external[0].account_id, "ACC-0");
+    EXPECT_EQ(sink.missing_from_external[0].amount_cents, 110);
+    EXPECT_EQ(sink.missing_from_external[1].account_id, "ACC-2");
+    EXPECT_EQ(sink.missing_from_external[1].amount_cents, 201);
+
+    // Reconciling reads cold accounts in place.
+    EXPECT_EQ(portfolio.TierStats().cold, 8u);
+}
+
+TEST(ReconcileTest, SpilledRunsAreMergedWithinTheFileLimit)
+{
+    // Hundreds of spills per side under a limit of 32 open files: the runs
+    // have to be merged on disk as they pile up.
+    const pid_t pid = fork();
+    ASSERT_GE(pid, 0);
+    if (pid == 0)
+    {
+        const rlimit limit{32, 32};
+        if (setrlimit(RLIMIT_NOFILE, &limit) != 0)
+        {
+            _exit(3);
+        }
+        std::vector<TxRecord> audit;
+        for (int i = 0; i < 6000; i++)
+        {
+            audit.push_back({TxKind::KDEPOSIT, i, 1700000000 + i, nullptr,
+                             "ACC-1"});
+        }
+        ThreadPool pool(1);
+        Reconciler reconciler({1700000000, 1800000000, 1, 1024, 4}, &pool);
+        for (size_t i = audit.size(); i-- > 0;)
+        {
+            reconciler.AddExternal(audit[i]);
+        }
+        reconciler.AddBook("ACC-1", audit);
+        CollectingSink sink;
+        ReconcileSummary summary;
+        const bool ok = reconciler.Run(&sink, &summary);
+        _exit(ok && summary.matched == audit.size() &&
+                      summary.runs_spilled > 200 && summary.merge_passes > 50
+                  ? 0
+                  : 1);
+    }
+    int status = 0;
+    ASSERT_EQ(waitpid(pid, &status, 0), pid);
+    ASSERT_TRUE(WIFEXITED(status));
+    EXPECT_EQ(WEXITSTATUS(status), 0);
+}
+
+TEST(GroupTest, RollsUpBalancesAndRegroupsIncrementally)
+{
+    Portfolio portfolio;
+    for (int a = 0; a < 12; a++)
+    {
+        portfolio.AddAccount(std::make_unique<CheckingAccount>(
+            "ACC-" + std::to_string(a), 0, 1000 * (a + 1)));
+    }
+    ASSERT_TRUE(portfolio.AddGroup("branch", "north", ""));
+    ASSERT_TRUE(portfolio.AddGroup("branch", "south", ""));
+    ASSERT_TRUE(portfolio.AddGroup("branch", "b0", "north"));
+    ASSERT_TRUE(portfolio.AddGroup("branch", "b1", "north"));
+    ASSERT_TRUE(portfolio.AddGroup("branch", "b2", "south"));
+    ASSERT_TRUE(portfolio.AddGroup("branch", "b3", "south"));
+    EXPECT_FALSE(portfolio.AddGroup("branch", "b3", "north"));
+    EXPECT_FALSE(portfolio.AddGroup("branch", "b4", "west"));
+    EXPECT_FALSE(portfolio.AddGroup("product", "premium", "gold"));
+    ASSERT_TRUE(portfolio.AddGroup("product", "premium", ""));
+
+    std::map<std::string, std::string> branch_of;
+    std::vector<GroupAssignment> moves;
+    for (int a = 0; a < 12; a++)
+    {
+        const std::string id = "ACC-" + std::to_string(a);
+        branch_of[id] = "b" + std::to_string(a % 4);
+        moves.push_back({id, branch_of[id]});
+    }
+    moves.push_back({"ACC-99", "b0"});
+    moves.push_back({"ACC-0", "b9"});
+    EXPECT_EQ(portfolio.Regroup("branch", moves), 12u);
+    EXPECT_EQ(portfolio.Regroup("product", {{"ACC-3", "premium"}}), 1u);
+
+    std::map<std::string, std::string> parent = {
+        {"b0", "north"}, {"b1", "north"}, {"b2", "south"}, {"b3", "south"}};
+    auto check = [&]()
+    {
+        std::map<std::string, GroupTotal> expected;
+        for (const auto &[id, branch] : branch_of)
+        {
+            const int64_t balance = portfolio.GetAccount(id)->GetBalance();
+            for (const std::string &g : {branch, parent[branch]})
+            {
+                expected[g].exposure += balance;
+                expected[g].accounts++;
+            }
+        }
+        for (const std::string g : {"north", "south", "b0", "b1", "b2", "b3"})
+        {
+            GroupTotal total;
+            ASSERT_TRUE(portfolio.GroupExposure("branch", g, &total));
+            EXPECT_EQ(total.exposure, expected[g].exposure) << g;
+            EXPECT_EQ(total.accounts, expected[g].accounts) << g;
+        }
+        if (branch_of.size() == 12)
+        {
+            EXPECT_EQ(expected["north"].exposure + expected["south"].exposure,
+                      portfolio.TotalExposure());
+        }
+    };
+    check();
+
+    // Every path that changes a balance is rolled up.
+    std::vector<TxRecord> txs;
+    for (int i = 0; i < 600; i++)
+    {
+        txs.push_back({i % 4 ? TxKind::KDEPOSIT : TxKind::KWITHDRAWAL,
+                       (i * 53) % 700, 1700000000 + i, nullptr,
+                       "ACC-" + std::to_string(i % 12)});
+    }
+    portfolio.ApplyAll(txs);
+    check();
+    portfolio.ApplyPartitioned(txs, 3);
+    check();
+    ASSERT_TRUE(portfolio.Transfer({"ACC-1", "ACC-2", 250, 1700001000, "rent"}));
+    check();
+
+    // Cold accounts keep their place and are rolled up when they wake up.
+    EXPECT_EQ(portfolio.DemoteIdle(1800000000, 1000), 12u);
+    portfolio.ApplyAll({{TxKind::KDEPOSIT, 77, 1800000001, nullptr, "ACC-5"}});
+    check();
+
+    // Bulk regrouping and moving a whole branch touch only their paths.
+    moves.clear();
+    for (int a = 0; a < 12; a += 3)
+    {
+        const std::string id = "ACC-" + std::to_string(a);
+        branch_of[id] = "b3";
+        moves.push_back({id, "b3"});
+    }
+    EXPECT_EQ(portfolio.Regroup("branch", moves), 4u);
+    check();
+    ASSERT_TRUE(portfolio.MoveGroup("branch", "b1", "south"));
+    parent["b1"] = "south";
+    check();
+    EXPECT_FALSE(portfolio.MoveGroup("branch", "south", "b1"));
+    EXPECT_FALSE(portfolio.MoveGroup("branch", "south", "south"));
+    EXPECT_FALSE(portfolio.MoveGroup("branch", "b1", "east"));
+    check();
+
+    // An ungrouped account leaves every total; a replaced one keeps its group.
+    EXPECT_EQ(portfolio.Regroup("branch", {{"ACC-4", ""}}), 1u);
+    branch_of.erase("ACC-4");
+    check();
+    ASSERT_TRUE(portfolio.AddAccount(
+        std::make_unique<CheckingAccount>("ACC-7", 0, 123456),
+        DuplicatePolicy::KREPLACE));
+    check();
+
+    GroupTotal premium;
+    ASSERT_TRUE(portfolio.GroupExposure("product", "premium", &premium));
+    EXPECT_EQ(premium.accounts, 1u);
+    EXPECT_EQ(premium.exposure, portfolio.GetAccount("ACC-3")->GetBalance());
+    EXPECT_FALSE(portfolio.GroupExposure("product", "basic", &premium));
+    EXPECT_FALSE(portfolio.GroupExposure("region", "north", &premium));
+}
 
 int main (int argc, char *argv[])
 {
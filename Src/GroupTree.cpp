@@ -0,0 +1,70 @@
+// Copyright 2025 Sara Saad
+
+/******************************************* INCLUDE PART
+ * **************************************** */
+#include "../Inc/GroupTree.hpp"
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+GroupTree::GroupTree(const std::string &name) : name_(name) {}
+
+const std::string &GroupTree::Name() const { return (name_); }
+
+uint32_t GroupTree::AddGroup(const std::string &group, uint32_t parent) {
+  if (parent != kNone && parent >= nodes_.size()) {
+    return (kNone);
+  }
+  const uint32_t id = static_cast<uint32_t>(nodes_.size());
+  if (!names_.emplace(group, id).second) {
+    return (kNone);
+  }
+  nodes_.push_back(Node{0, parent, 0});
+  return (id);
+}
+
+uint32_t GroupTree::Find(const std::string &group) const {
+  auto it = names_.find(group);
+  return (it == names_.end() ? kNone : it->second);
+}
+
+void GroupTree::Resize(size_t count) { group_of_.resize(count, kNone); }
+
+void GroupTree::Assign(uint32_t handle, uint32_t group, int64_t balance) {
+  const uint32_t old_group = group_of_[handle];
+  if (old_group == group) {
+    return;
+  }
+  AddToPath(old_group, -balance, -1);
+  AddToPath(group, balance, 1);
+  group_of_[handle] = group;
+}
+
+bool GroupTree::Move(uint32_t group, uint32_t new_parent) {
+  for (uint32_t g = new_parent; g != kNone; g = nodes_[g].parent) {
+    if (g == group) {
+      return (false);
+    }
+  }
+  Node &node = nodes_[group];
+  const int64_t total = node.total;
+  const int64_t accounts = node.accounts;
+  AddToPath(node.parent, -total, -accounts);
+  AddToPath(new_parent, total, accounts);
+  node.parent = new_parent;
+  return (true);
+}
+
+GroupTotal GroupTree::Total(uint32_t group) const {
+  const Node &node = nodes_[group];
+  // Apply() may be adding to the total concurrently.
+  int64_t &total = const_cast<int64_t &>(node.total);
+  return (GroupTotal{
+      std::atomic_ref<int64_t>(total).load(std::memory_order_relaxed),
+      node.accounts});
+}
+
+void GroupTree::AddToPath(uint32_t group, int64_t balance, int64_t accounts) {
+  for (uint32_t g = group; g != kNone; g = nodes_[g].parent) {
+    nodes_[g].total += balance;
+    nodes_[g].accounts += static_cast<uint32_t>(accounts);
+  }
+}
@@ -5,30 +5,44 @@
 #include "../Inc/Calculator.hpp"
 
 BaseAccount::BaseAccount(std::string id, AccountSettings settings,
-                         int64_t opening_balnce) {
+                         int64_t opening_balnce)
+    : balance_cent_(opening_balnce), link_{nullptr, nullptr, 0, nullptr},
+      accrual_{false, false, 0}, interest_anchor_ts_(-1), fee_anchor_ts_(-1) {
   id_ = id;
   setting_ = settings;
-  balance_cent_ = opening_balnce;
-}
-
-void BaseAccount::Record(const TxRecord &rec) {
-  if (audit_.size() >= 1000) {
-    audit_.erase(audit_.begin());
-  }
-
-  audit_.push_back(rec);
 }
 
 std::string BaseAccount::GetId() { return (id_); }
 
-void BaseAccount::UpdateBalance(int64_t cents)
+void BaseAccount::UpdateBalance(int64_t cents, int64_t ts)
 {
-  balance_cent_ = Calculator::Deposit(balance_cent_,cents);
+  StoreBalance(Calculator::Deposit(balance_cent_.Load(), cents), ts);
 }
 
 int64_t BaseAccount::GetBalance() const 
 {
-    return(balance_cent_);
+    return(balance_cent_.Load());
+}
+
+bool BaseAccount::GetBalanceAsOf(uint64_t epoch, int64_t *cents) const {
+  return (balance_cent_.LoadAsOf(epoch, cents));
+}
+
+void BaseAccount::Attach(const AccountLink &link) { link_ = link; }
+
+void BaseAccount::SetAccrual(const AccrualPolicy &policy, int64_t anchor_ts) {
+  accrual_ = policy;
+  interest_anchor_ts_ = anchor_ts;
+  fee_anchor_ts_ = anchor_ts;
+}
+
+void BaseAccount::AccrueTo(int64_t ts) {
+  int64_t balance = balance_cent_.Load();
+  WalkAccrual(accrual_, setting_, &interest_anchor_ts_, &fee_anchor_ts_, ts,
+              &balance, [this](const TxRecord &rec, int64_t cents) {
+                StoreBalance(cents, rec.timestamp);
+                Record(rec);
+              });
 }
 
 AccountSettings BaseAccount::GetSetting() { return (setting_); }
@@ -37,26 +51,45 @@ const std::vector<TxRecord> &BaseAccount::GetAudit() { return (audit_); }
 
 void BaseAccount::Deposit(int64_t amount_cents, int64_t ts,
                           const char *note) {
-  balance_cent_ = Calculator::Deposit(balance_cent_, amount_cents);
+  AccrueTo(ts);
+  StoreBalance(Calculator::Deposit(balance_cent_.Load(), amount_cents), ts);
   Record({TxKind::KDEPOSIT, amount_cents, ts, note});
 }
 void BaseAccount::Withdraw(int64_t amount_cents, int64_t ts, const char *note) {
-  balance_cent_ = Calculator::Withdraw(balance_cent_, amount_cents);
+  AccrueTo(ts);
+  StoreBalance(Calculator::Withdraw(balance_cent_.Load(), amount_cents), ts);
   Record({TxKind::KWITHDRAWAL, amount_cents, ts, note});
 }
 void BaseAccount::ChargeFee(int64_t fee_cents, int64_t ts, const char *note) {
-  balance_cent_ = Calculator::Fee(balance_cent_, fee_cents);
+  AccrueTo(ts);
+  if (LazyFees()) {
+    return;  // AccrueTo() charged the cycle fees up to ts.
+  }
+  PostFee(fee_cents, ts, note);
+}
+void BaseAccount::PostFee(int64_t fee_cents, int64_t ts, const char *note) {
+  StoreBalance(Calculator::Fee(balance_cent_.Load(), fee_cents), ts);
   Record({TxKind::KFEE, fee_cents, ts, note});
 }
 void BaseAccount::PostSimpleInterest(int32_t days, int32_t basis, int64_t ts,
                                      const char *note) {
+  AccrueTo(ts);
+  if (accrual_.lazy_interest) {
+    return;  // AccrueTo() credited every day up to ts.
+  }
+  PostInterest(days, basis, ts, note);
+}
+void BaseAccount::PostInterest(int32_t days, int32_t basis, int64_t ts,
+                               const char *note) {
   int64_t interest =
-      Calculator::Interest(balance_cent_, setting_.apr, days, basis);
-  UpdateBalance(interest);
+      Calculator::Interest(balance_cent_.Load(), setting_.apr, days, basis);
+  UpdateBalance(interest, ts);
   Record({TxKind::KINTEREST, interest, ts, note});
 }
 
 void BaseAccount::Apply(const TxRecord &tx) {
+  AccrueTo(tx.timestamp);
+
   switch (tx.kind) {
     case TxKind::KDEPOSIT:
       this->Deposit(tx.amount_cents, tx.timestamp, tx.note);
@@ -71,17 +104,24 @@ void BaseAccount::Apply(const TxRecord &tx) {
       break;
 
     case TxKind::KINTEREST:
-      this->PostSimpleInterest(30, 365, tx.timestamp, tx.note);
+      // amount_cents carries the number of days, 0 means one default period.
+      this->PostSimpleInterest(
+          tx.amount_cents > 0 ? static_cast<int32_t>(tx.amount_cents)
+                              : Calculator::kInterestPeriodDays,
+          Calculator::kDayCountBasis, tx.timestamp, tx.note);
       break;
 
     case TxKind::KTRANSFERIN:
-      balance_cent_ = Calculator::Deposit(balance_cent_, tx.amount_cents);
+      StoreBalance(Calculator::Deposit(balance_cent_.Load(), tx.amount_cents),
+                   tx.timestamp);
       Record(TxRecord{TxKind::KTRANSFERIN, tx.amount_cents, tx.timestamp,
                       tx.note});
       break;
 
     case TxKind::KTRANSFEROUT:
-      balance_cent_ = Calculator::Withdraw(balance_cent_, tx.amount_cents);
+      StoreBalance(
+          Calculator::Withdraw(balance_cent_.Load(), tx.amount_cents),
+          tx.timestamp);
       Record(TxRecord{TxKind::KTRANSFEROUT, tx.amount_cents, tx.timestamp,
                       tx.note});
       break;
@@ -109,9 +149,12 @@ SavingAccount::SavingAccount(std::string id, double apr,
 AccountType SavingAccount::GetType() { return (AccountType::KSAVINGS); }
 
 void SavingAccount::ApplyInterest(int64_t timestamp, const char *note) {
-  this->PostSimpleInterest(30, 365, timestamp, note);
+  this->PostSimpleInterest(Calculator::kInterestPeriodDays,
+                           Calculator::kDayCountBasis, timestamp, note);
 }
 
 
 IAccount::~IAccount() {}
 
+IBalanceListener::~IBalanceListener() {}
+
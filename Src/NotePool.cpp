@@ -0,0 +1,16 @@
+// Copyright 2025 Sara Saad
+
+/******************************************* INCLUDE PART
+ * **************************************** */
+#include "../Inc/NotePool.hpp"
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+const char *NotePool::Intern(const std::string &note) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return (notes_.insert(note).first->c_str());
+}
+
+size_t NotePool::Size() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return (notes_.size());
+}
@@ -4,22 +4,92 @@
  * **************************************** */
 #include "../Inc/Portfolio.hpp"
 
+#include <algorithm>
+#include <limits>
+#include <typeinfo>
+
+#include "../Inc/AuditArchive.hpp"
+#include "../Inc/FlightRecorder.hpp"
+#include "../Inc/HotPath.hpp"
+#include "../Inc/Statement.hpp"
+
 ////////////////////////////////////////////////////////////////////////////////////////////////////
+namespace {
+
+/**
+ * @brief: Shards are contiguous handle ranges: handle h belongs to shard
+ * h * shards / count, and ShardBegin() is the first handle of a shard. Every
+ * bulk operation uses the same mapping, so a shard keeps its pool worker.
+ */
+inline size_t ShardOf(size_t handle, size_t count, size_t shards) {
+  return (handle * shards / count);
+}
+
+inline size_t ShardBegin(size_t shard, size_t count, size_t shards) {
+  return ((shard * count + shards - 1) / shards);
+}
+
+/// Books smaller than this are scanned on the calling thread.
+constexpr size_t kParallelScanMin = 1 << 16;
+
+/// Onboarding batches smaller than this build accounts on the calling thread.
+constexpr size_t kParallelBuildMin = 1 << 14;
+
+}  // namespace
+
+Portfolio::Portfolio() : Portfolio(ThreadPool::Shared()) {}
+
+Portfolio::Portfolio(ThreadPool *pool) : pool_(pool) {}
+
 IAccount * Portfolio::GetAccount(const std::string &id) const {
-  auto i = accounts_.find(id);
+  uint32_t handle = index_.Find(id);
 
-  if (i != accounts_.end()) {
-    return (i->second.get());
+  if (handle != AccountIndex::kNotFound) {
+    // Promotion does not change what the caller observes, and concurrent
+    // callers serialize on the cold flag (see Resident()).
+    return (const_cast<Portfolio *>(this)->Resident(handle));
   } else {
     return (nullptr);
   }
 }
 
 void Portfolio::ApplyTx(const TxRecord &tx) {
-  IAccount *acc = GetAccount(tx.account_id);
-  if (!acc) {
+  uint32_t handle = index_.Find(tx.account_id);
+  if (handle == AccountIndex::kNotFound) {
     exit(1);
   }
+  if (tx.idempotency_key != 0 && !dedup_.Admit(tx.idempotency_key,
+                                               tx.timestamp)) {
+    FlightRecorder::Record(TraceOp::KDUPLICATE, TracePhase::KPOINT, handle,
+                           tx.amount_cents, static_cast<uint16_t>(tx.kind));
+    return;
+  }
+  if (sink_) {
+    sink_->OnApplied(tx);
+  }
+
+  ApplyToAccount(handle, tx);
+  batch_audit_.push_back(tx);
+}
+
+void Portfolio::ApplyToAccount(uint32_t handle, const TxRecord &tx) {
+  FlightRecorder::Record(TraceOp::KAPPLYTX, TracePhase::KPOINT, handle,
+                         tx.amount_cents, static_cast<uint16_t>(tx.kind));
+  EpochClock::WriteScope scope(&clock_);
+  IAccount *acc = Resident(handle);
+
+  // Transfer legs only ever come in through Transfer().
+  if (tx.kind == TxKind::KTRANSFERIN || tx.kind == TxKind::KTRANSFEROUT) {
+    return;
+  }
+  if (dispatch_[handle] == Dispatch::KCHECKING) {
+    HotPath<CheckingAccount>::Apply(static_cast<CheckingAccount *>(acc), tx);
+    return;
+  }
+  if (dispatch_[handle] == Dispatch::KSAVING) {
+    HotPath<SavingAccount>::Apply(static_cast<SavingAccount *>(acc), tx);
+    return;
+  }
 
   switch (tx.kind) {
     case TxKind::KDEPOSIT:
@@ -35,26 +105,297 @@ void Portfolio::ApplyTx(const TxRecord &tx) {
       break;
 
     case TxKind::KINTEREST:
-      acc->PostSimpleInterest(tx.amount_cents, 356, tx.timestamp, tx.note);
+      // amount_cents carries the number of days, 0 means one default period.
+      acc->PostSimpleInterest(
+          tx.amount_cents > 0 ? static_cast<int32_t>(tx.amount_cents)
+                              : Calculator::kInterestPeriodDays,
+          Calculator::kDayCountBasis, tx.timestamp, tx.note);
       break;
 
     default:
 
       break;
   }
-  batch_audit_.push_back(tx);
 }
 
 void Portfolio::AddAccount(std::unique_ptr<IAccount> acc) {
-  accounts_[acc->GetId()] = std::move(acc);
+  AddAccount(std::move(acc), DuplicatePolicy::KREPLACE);
+}
+
+bool Portfolio::AddAccount(std::unique_ptr<IAccount> acc,
+                           DuplicatePolicy policy) {
+  const std::string id = acc->GetId();
+  const uint64_t hash = AccountIndex::Hash(id);
+  uint32_t handle = index_.Find(id, hash);
+
+  if (handle != AccountIndex::kNotFound) {
+    if (policy != DuplicatePolicy::KREPLACE) {
+      return (false);
+    }
+  } else {
+    handle = NewSlot(id, hash);
+  }
+  Install(handle, std::move(acc));
+  if (sink_) {
+    PublishAccount(handle);
+  }
+  return (true);
+}
+
+uint32_t Portfolio::NewSlot(const std::string &id, uint64_t hash) {
+  uint32_t handle = static_cast<uint32_t>(accounts_.size());
+  index_.Insert(id, handle);
+  accounts_.emplace_back();
+  id_hashes_.push_back(hash);
+  fees_cents_.push_back(0);
+  dispatch_.push_back(Dispatch::KVIRTUAL);
+  last_active_.push_back(std::numeric_limits<int64_t>::min());
+  cold_.Resize(accounts_.size());
+  if (velocity_) {
+    velocity_->Resize(accounts_.size());
+  }
+  for (const std::unique_ptr<GroupTree> &tree : groups_) {
+    tree->Resize(accounts_.size());
+  }
+  return (handle);
+}
+
+void Portfolio::Install(uint32_t handle, std::unique_ptr<IAccount> acc) {
+  if (accounts_[handle] || cold_.IsCold(handle)) {
+    checksum_.Remove(id_hashes_[handle], BalanceOf(handle));
+    // The replacement keeps the groups of the account it replaces.
+    for (const std::unique_ptr<GroupTree> &tree : groups_) {
+      tree->Apply(handle, acc->GetBalance() - BalanceOf(handle));
+    }
+    if (cold_.IsCold(handle)) {
+      cold_.Release(handle);
+    }
+    if (history_) {
+      // A replacement has no time of its own; it lands after the account's
+      // last recorded change.
+      history_->Record(handle, acc->GetBalance(),
+                       std::numeric_limits<int64_t>::min());
+    }
+  } else if (history_) {
+    history_->AddAccount(handle, acc->GetBalance());
+  }
+  acc->Attach({&clock_, this, handle, velocity_.get()});
+  if (velocity_) {
+    velocity_->Reset(handle);
+  }
+  if (accrual_.lazy_interest || accrual_.lazy_fees) {
+    acc->SetAccrual(accrual_, accrual_anchor_ts_);
+  }
+  checksum_.Add(id_hashes_[handle], acc->GetBalance());
+  fees_cents_[handle] = acc->GetType() == AccountType::KCHECKING
+                            ? acc->GetSetting().fee_flat_cents
+                            : 0;
+  // Only the exact types: a subclass may override the mutators.
+  const std::type_info &type = typeid(*acc);
+  dispatch_[handle] = type == typeid(CheckingAccount) ? Dispatch::KCHECKING
+                      : type == typeid(SavingAccount) ? Dispatch::KSAVING
+                                                      : Dispatch::KVIRTUAL;
+  accounts_[handle] = std::move(acc);
+}
+
+IAccount *Portfolio::Resident(uint32_t handle) {
+  // Const callers may promote the same account at once: the first to claim it
+  // thaws it, the others wait in Claim() and then find it resident.
+  if (cold_.IsCold(handle) && cold_.Claim(handle)) {
+    std::unique_ptr<IAccount> acc = cold_.Thaw(handle);
+    acc->Attach({&clock_, this, handle, velocity_.get()});
+    accounts_[handle] = std::move(acc);
+    cold_.Release(handle);
+    promotions_.fetch_add(1, std::memory_order_relaxed);
+    FlightRecorder::Record(TraceOp::KPROMOTE, TracePhase::KPOINT, handle, 0, 0);
+  }
+  return (accounts_[handle].get());
+}
+
+void Portfolio::PublishAccount(uint32_t handle) {
+  IAccount *acc = accounts_[handle].get();
+  sink_->OnAccountAdded(acc->GetSetting(), acc->GetId(), acc->GetBalance());
+}
+
+int64_t Portfolio::BalanceOf(uint32_t handle) const {
+  return (cold_.IsCold(handle) ? cold_.Balance(handle)
+                               : accounts_[handle]->GetBalance());
+}
+
+void Portfolio::OnBalanceChange(uint32_t handle, int64_t old_cents,
+                                int64_t new_cents, int64_t timestamp) {
+  checksum_.Update(id_hashes_[handle], old_cents, new_cents);
+  last_active_[handle] = std::max(last_active_[handle], timestamp);
+  if (history_) {
+    history_->Record(handle, new_cents, timestamp);
+  }
+  for (const std::unique_ptr<GroupTree> &tree : groups_) {
+    tree->Apply(handle, new_cents - old_cents);
+  }
+}
+
+void Portfolio::SealHistory() {
+  if (history_) {
+    history_->Seal();
+  }
+}
+
+void Portfolio::Reserve(size_t count_hint) {
+  accounts_.reserve(count_hint);
+  id_hashes_.reserve(count_hint);
+  fees_cents_.reserve(count_hint);
+  dispatch_.reserve(count_hint);
+  last_active_.reserve(count_hint);
+  cold_.Reserve(count_hint);
+  index_.Reserve(count_hint);
+}
+
+size_t Portfolio::AddAccounts(const AccountBatch &batch,
+                              DuplicatePolicy policy) {
+  const size_t count = batch.ids.size();
+
+  if (batch.types.size() != count || batch.aprs.size() != count ||
+      batch.fees_cents.size() != count ||
+      batch.opening_balances.size() != count) {
+    return (0);
+  }
+
+  Reserve(accounts_.size() + count);
+
+  // Large batches build their account objects in parallel first; the index
+  // is still filled in one sequential pass below.
+  auto build = [&batch](size_t i) -> std::unique_ptr<IAccount> {
+    if (batch.types[i] == AccountType::KSAVINGS) {
+      return (std::make_unique<SavingAccount>(batch.ids[i], batch.aprs[i],
+                                              batch.opening_balances[i]));
+    }
+    return (std::make_unique<CheckingAccount>(
+        batch.ids[i], batch.fees_cents[i], batch.opening_balances[i]));
+  };
+  std::vector<std::unique_ptr<IAccount>> built;
+  if (count >= kParallelBuildMin && pool_->Size() > 1) {
+    built.resize(count);
+    const size_t shards = pool_->Size();
+    pool_->ParallelFor(shards, [&](size_t s) {
+      const size_t end = ShardBegin(s + 1, count, shards);
+      for (size_t i = ShardBegin(s, count, shards); i < end; i++) {
+        built[i] = build(i);
+      }
+    });
+  }
+
+  // New accounts are only ever appended, so a rejected batch is undone by
+  // trimming everything past first_new.
+  const size_t first_new = accounts_.size();
+  size_t stored = 0;
+  std::vector<uint32_t> installed;  // Only kept for the replication sink.
+
+  for (size_t i = 0; i < count; i++) {
+    const std::string &id = batch.ids[i];
+    const uint64_t hash = AccountIndex::Hash(id);
+    uint32_t handle = index_.Find(id, hash);
+
+    if (handle != AccountIndex::kNotFound) {
+      if (policy == DuplicatePolicy::KSKIP) {
+        continue;
+      }
+      if (policy == DuplicatePolicy::KREJECT) {
+        for (size_t h = first_new; h < accounts_.size(); h++) {
+          checksum_.Remove(id_hashes_[h], accounts_[h]->GetBalance());
+          index_.Erase(accounts_[h]->GetId());
+        }
+        accounts_.resize(first_new);
+        id_hashes_.resize(first_new);
+        fees_cents_.resize(first_new);
+        dispatch_.resize(first_new);
+        last_active_.resize(first_new);
+        cold_.Resize(first_new);
+        if (velocity_) {
+          velocity_->Resize(first_new);
+        }
+        for (const std::unique_ptr<GroupTree> &tree : groups_) {
+          tree->Resize(first_new);
+        }
+        if (history_) {
+          history_->Truncate(first_new);
+        }
+        return (0);
+      }
+    } else {
+      handle = NewSlot(id, hash);
+    }
+
+    Install(handle, built.empty() ? build(i) : std::move(built[i]));
+    if (sink_) {
+      installed.push_back(handle);
+    }
+    stored++;
+  }
+  // Published only now: a rejected batch must not reach the sink.
+  for (uint32_t handle : installed) {
+    PublishAccount(handle);
+  }
+  return (stored);
 }
 
 size_t Portfolio::CountAccounts() { return (accounts_.size()); }
 
 void Portfolio::ApplyAll(const std::vector<TxRecord> &txs) {
+  TraceScope trace(TraceOp::KAPPLYALL, 0, static_cast<int64_t>(txs.size()));
   for (const auto &tx : txs) {
     ApplyTx(tx);
   }
+  SealHistory();
+}
+
+void Portfolio::ApplyPartitioned(const std::vector<TxRecord> &txs,
+                                 size_t partitions) {
+  if (partitions < 2 || txs.size() < 2) {
+    ApplyAll(txs);
+    return;
+  }
+  TraceScope trace(TraceOp::KAPPLYPARTITIONED, 0,
+                   static_cast<int64_t>(txs.size()));
+
+  std::vector<std::vector<std::pair<uint32_t, const TxRecord *>>> work(
+      partitions);
+  std::vector<size_t> duplicates;
+  for (const auto &tx : txs) {
+    uint32_t handle = index_.Find(tx.account_id);
+    if (handle == AccountIndex::kNotFound) {
+      exit(1);
+    }
+    if (tx.idempotency_key != 0 && !dedup_.Admit(tx.idempotency_key,
+                                                 tx.timestamp)) {
+      FlightRecorder::Record(TraceOp::KDUPLICATE, TracePhase::KPOINT, handle,
+                             tx.amount_cents, static_cast<uint16_t>(tx.kind));
+      duplicates.push_back(static_cast<size_t>(&tx - txs.data()));
+      continue;
+    }
+    if (sink_) {
+      sink_->OnApplied(tx);
+    }
+    work[ShardOf(handle, accounts_.size(), partitions)].push_back(
+        {handle, &tx});
+  }
+
+  pool_->ParallelFor(partitions, [this, &work](size_t p) {
+    TraceScope shard(TraceOp::KAPPLYSHARD, static_cast<uint32_t>(p),
+                     static_cast<int64_t>(work[p].size()));
+    for (const auto &item : work[p]) {
+      ApplyToAccount(item.first, *item.second);
+    }
+  });
+
+  // The batch audit keeps the input order, minus the rejected repeats.
+  size_t next = 0;
+  for (size_t skip : duplicates) {
+    batch_audit_.insert(batch_audit_.end(), txs.begin() + next,
+                        txs.begin() + skip);
+    next = skip + 1;
+  }
+  batch_audit_.insert(batch_audit_.end(), txs.begin() + next, txs.end());
+  SealHistory();
 }
 
 void Portfolio::ApplyFromLedger(const std::string *account_ids,
@@ -69,26 +410,579 @@ void Portfolio::ApplyFromLedger(const std::string *account_ids,
 }
 
 bool Portfolio::Transfer(TransferRecord txr) {
-  IAccount *from = GetAccount(txr.from_id);
-  IAccount *to = GetAccount(txr.to_id);
+  const uint32_t from_handle = index_.Find(txr.from_id);
+  const uint32_t to_handle = index_.Find(txr.to_id);
+  TraceScope trace(TraceOp::KTRANSFER, from_handle, txr.amount_cents);
 
-  if (!from || !to) {
+  if (from_handle == AccountIndex::kNotFound ||
+      to_handle == AccountIndex::kNotFound) {
+    return (false);
+  }
+  IAccount *from = Resident(from_handle);
+  IAccount *to = Resident(to_handle);
+  if (txr.idempotency_key != 0 && !dedup_.Admit(txr.idempotency_key,
+                                                txr.timestamp)) {
     return (false);
   }
-  from->Withdraw(txr.amount_cents, txr.timestamp, (\
-    txr.note + "Transfer Out!").c_str());
-  to->Deposit(txr.amount_cents, txr.timestamp, (\
-     txr.note + "Teransfer In!.").c_str());
+
+  EpochClock::WriteScope scope(&clock_);
+  // The audit keeps the note pointers, so the notes must be interned.
+  from->Withdraw(txr.amount_cents, txr.timestamp,
+                 notes_.Intern(txr.note + "Transfer Out!"));
+  to->Deposit(txr.amount_cents, txr.timestamp,
+              notes_.Intern(txr.note + "Teransfer In!."));
+  if (sink_) {
+    sink_->OnTransfer(txr);
+  }
+  SealHistory();
+  trace.Result(to_handle, 1);
   return (true);
 }
 
+uint64_t Portfolio::ReadConsistent(std::vector<int64_t> *out,
+                                   int64_t *total) const {
+  const size_t count = accounts_.size();
+  const size_t shards =
+      count < kParallelScanMin ? 1 : std::min(pool_->Size(), count);
+  std::vector<int64_t> sums(shards);
+  std::vector<char> complete(shards);
+
+  for (;;) {
+    const uint64_t epoch = clock_.OpenSnapshot();
+
+    pool_->ParallelFor(shards, [&](size_t s) {
+      const size_t end = ShardBegin(s + 1, count, shards);
+      int64_t sum = 0;
+      complete[s] = 1;
+      for (size_t h = ShardBegin(s, count, shards); h < end; h++) {
+        int64_t cents = 0;
+        bool valid = true;
+        if (cold_.IsCold(static_cast<uint32_t>(h))) {
+          valid = cold_.BalanceAsOf(static_cast<uint32_t>(h), epoch, &cents);
+        } else {
+          valid = accounts_[h]->GetBalanceAsOf(epoch, &cents);
+        }
+        if (!valid) {
+          complete[s] = 0;
+          return;
+        }
+        sum += cents;
+        if (out) {
+          (*out)[h] = cents;
+        }
+      }
+      sums[s] = sum;
+    });
+
+    // A newer snapshot overwrote a version we still needed; start over.
+    if (std::find(complete.begin(), complete.end(), 0) == complete.end()) {
+      int64_t sum = 0;
+      for (int64_t part : sums) {
+        sum += part;
+      }
+      *total = sum;
+      return (epoch);
+    }
+  }
+}
+
 int64_t Portfolio::TotalExposure() const {
   int64_t total = 0;
-  Calculator calc;
-  for (const auto &pair : accounts_) {
-    total += pair.second->GetBalance();
-  }
+  ReadConsistent(nullptr, &total);
   return (total);
 }
 
+std::vector<AccountDigest> Portfolio::Digest() const {
+  std::vector<AccountDigest> digests;
+  digests.reserve(accounts_.size());
+
+  for (size_t handle = 0; handle < accounts_.size(); handle++) {
+    std::unique_ptr<IAccount> thawed =
+        cold_.Copy(static_cast<uint32_t>(handle));
+    IAccount *acc = thawed ? thawed.get() : accounts_[handle].get();
+    uint64_t h = 1469598103934665603ULL;
+    for (const TxRecord &rec : acc->GetAudit()) {
+      const uint64_t fields[3] = {static_cast<uint64_t>(rec.kind),
+                                  static_cast<uint64_t>(rec.amount_cents),
+                                  static_cast<uint64_t>(rec.timestamp)};
+      for (uint64_t field : fields) {
+        h = (h ^ field) * 1099511628211ULL;
+        h ^= h >> 29;
+      }
+    }
+    digests.push_back({acc->GetId(), acc->GetBalance(), h});
+  }
+
+  std::sort(digests.begin(), digests.end(),
+            [](const AccountDigest &a, const AccountDigest &b) {
+              return (a.account_id < b.account_id);
+            });
+  return (digests);
+}
+
+BookDigest Portfolio::Checksum() const { return (checksum_.Digest()); }
+
+void Portfolio::SetAccrualPolicy(const AccrualPolicy &policy,
+                                 int64_t anchor_ts) {
+  accrual_ = policy;
+  accrual_anchor_ts_ = anchor_ts;
+  for (size_t h = 0; h < accounts_.size(); h++) {
+    if (cold_.IsCold(static_cast<uint32_t>(h))) {
+      cold_.SetAccrual(static_cast<uint32_t>(h), policy, anchor_ts);
+    } else {
+      accounts_[h]->SetAccrual(policy, anchor_ts);
+    }
+  }
+  if (sink_) {
+    sink_->OnAccrualPolicy(policy, anchor_ts);
+  }
+}
+
+bool Portfolio::BalanceAt(const std::string &id, int64_t ts, int64_t *cents) {
+  IAccount *acc = GetAccount(id);
+  if (!acc) {
+    return (false);
+  }
+
+  EpochClock::WriteScope scope(&clock_);
+  acc->AccrueTo(ts);
+  *cents = acc->GetBalance();
+  if (sink_) {
+    sink_->OnAccrue(id, ts);
+  }
+  SealHistory();
+  return (true);
+}
+
+void Portfolio::AccrueAll(int64_t ts) {
+  TraceScope trace(TraceOp::KACCRUEALL, 0, ts);
+  const size_t count = accounts_.size();
+  const size_t shards = std::min(pool_->Size(), count);
+  // Without lazy accrual there is nothing to post, so cold accounts stay cold.
+  const bool lazy = accrual_.lazy_interest || accrual_.lazy_fees;
+
+  pool_->ParallelFor(shards, [this, ts, count, shards, lazy](size_t s) {
+    const size_t end = ShardBegin(s + 1, count, shards);
+    for (size_t h = ShardBegin(s, count, shards); h < end; h++) {
+      if (!lazy && cold_.IsCold(static_cast<uint32_t>(h))) {
+        continue;
+      }
+      EpochClock::WriteScope scope(&clock_);
+      // Cold accounts accrue inside their blob and stay cold.
+      if (!cold_.Accrue({&clock_, this, static_cast<uint32_t>(h),
+                         velocity_.get()},
+                        ts)) {
+        accounts_[h]->AccrueTo(ts);
+      }
+    }
+  });
+  if (sink_) {
+    sink_->OnAccrueAll(ts);
+  }
+  SealHistory();
+}
+
+FeeSweepSummary Portfolio::SweepFees(int64_t ts, const char *note,
+                                     size_t partitions) {
+  TraceScope trace(TraceOp::KSWEEPFEES, 0, ts);
+  const size_t count = accounts_.size();
+  if (partitions == 0) {
+    partitions = 1;
+  }
+
+  FeeSweepSummary summary{0, 0, std::vector<int64_t>(partitions, 0)};
+  std::vector<std::vector<TxRecord>> postings(partitions);
+  if (accrual_.lazy_fees && accrual_.fee_cycle_days > 0) {
+    // Every account charges its own cycle fees; a sweep would double them.
+    return (summary);
+  }
+
+  pool_->ParallelFor(partitions, [&](size_t p) {
+    const size_t end = ShardBegin(p + 1, count, partitions);
+    int64_t collected = 0;
+    for (size_t h = ShardBegin(p, count, partitions); h < end; h++) {
+      const int64_t fee = fees_cents_[h];
+      if (fee == 0) {
+        continue;
+      }
+      EpochClock::WriteScope scope(&clock_);
+      // Cold accounts are charged inside their blob and stay cold.
+      std::string id;
+      if (!cold_.ChargeFee({&clock_, this, static_cast<uint32_t>(h),
+                            velocity_.get()},
+                           fee, ts, note, &id)) {
+        accounts_[h]->ChargeFee(fee, ts, note);
+        id = accounts_[h]->GetId();
+      }
+      postings[p].push_back({TxKind::KFEE, fee, ts, note, std::move(id)});
+      collected += fee;
+    }
+    summary.fees_per_thread[p] = collected;
+  });
+
+  size_t charged = 0;
+  for (size_t p = 0; p < partitions; p++) {
+    summary.total_fees_cents += summary.fees_per_thread[p];
+    charged += postings[p].size();
+  }
+  summary.accounts_charged = charged;
+  trace.Result(static_cast<int64_t>(charged), 0);
+
+  batch_audit_.reserve(batch_audit_.size() + charged);
+  for (auto &part : postings) {
+    if (sink_) {
+      for (const TxRecord &posting : part) {
+        sink_->OnApplied(posting);
+      }
+    }
+    batch_audit_.insert(batch_audit_.end(),
+                        std::make_move_iterator(part.begin()),
+                        std::make_move_iterator(part.end()));
+  }
+  SealHistory();
+  return (summary);
+}
+
+std::vector<TxRecord> Portfolio::DrainBatchAudit() {
+  std::vector<TxRecord> drained;
+  drained.swap(batch_audit_);
+  return (drained);
+}
+
+BookSnapshot Portfolio::Snapshot() const {
+  BookSnapshot snap;
+  snap.balances.resize(accounts_.size());
+  snap.epoch = ReadConsistent(&snap.balances, &snap.exposure);
+  return (snap);
+}
+
 /////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void Portfolio::EnableHistory(int64_t segment_seconds) {
+  if (history_) {
+    return;
+  }
+  history_ = std::make_unique<BalanceHistory>(segment_seconds);
+  for (size_t h = 0; h < accounts_.size(); h++) {
+    history_->AddAccount(static_cast<uint32_t>(h),
+                         BalanceOf(static_cast<uint32_t>(h)));
+  }
+}
+
+bool Portfolio::BalanceAsOf(const std::string &id, int64_t ts,
+                            int64_t *cents) const {
+  uint32_t handle = index_.Find(id);
+  if (!history_ || handle == AccountIndex::kNotFound) {
+    return (false);
+  }
+  *cents = history_->BalanceAt(handle, ts);
+  return (true);
+}
+
+bool Portfolio::BalanceHistoryBetween(const std::string &id, int64_t from,
+                                      int64_t to,
+                                      std::vector<BalancePoint> *out) const {
+  uint32_t handle = index_.Find(id);
+  if (!history_ || handle == AccountIndex::kNotFound) {
+    return (false);
+  }
+  history_->BalancesBetween(handle, from, to, out);
+  return (true);
+}
+
+bool Portfolio::ExposureAsOf(int64_t ts, int64_t *cents) const {
+  if (!history_) {
+    return (false);
+  }
+  *cents = history_->ExposureAt(ts);
+  return (true);
+}
+
+bool Portfolio::WriteStatements(const StatementRequest &request,
+                                StatementSummary *summary) const {
+  const size_t count = accounts_.size();
+  const size_t partitions = std::max<size_t>(request.partitions, 1);
+  *summary = StatementSummary{0, 0, 0, {}, 0};
+
+  std::vector<FILE *> files(partitions, nullptr);
+  bool opened = true;
+  for (size_t p = 0; p < partitions; p++) {
+    summary->files.push_back(request.path_prefix + "." + std::to_string(p));
+    files[p] = std::fopen(summary->files[p].c_str(), "wb");
+    opened = opened && files[p];
+  }
+  if (!opened) {
+    for (FILE *file : files) {
+      if (file) {
+        std::fclose(file);
+      }
+    }
+    return (false);
+  }
+
+  std::vector<size_t> transactions(partitions, 0);
+  std::vector<size_t> partial(partitions, 0);
+  std::vector<uint64_t> bytes(partitions, 0);
+  std::vector<char> ok(partitions, 0);
+  pool_->ParallelFor(partitions, [&](size_t p) {
+    StatementWriter writer(files[p], request.format, request.buffer_bytes);
+    const size_t end = ShardBegin(p + 1, count, partitions);
+    for (size_t h = ShardBegin(p, count, partitions); h < end; h++) {
+      std::unique_ptr<IAccount> thawed =
+          cold_.Copy(static_cast<uint32_t>(h));
+      IAccount *acc = thawed ? thawed.get() : accounts_[h].get();
+      writer.Write(acc->GetId(), acc->GetBalance(), acc->GetAudit(),
+                   request.from_ts, request.to_ts);
+    }
+    ok[p] = writer.Finish();
+    transactions[p] = writer.Transactions();
+    partial[p] = writer.Partial();
+    bytes[p] = writer.Bytes();
+  });
+
+  bool all_ok = true;
+  for (size_t p = 0; p < partitions; p++) {
+    all_ok = (std::fclose(files[p]) == 0) && ok[p] && all_ok;
+    summary->transactions += transactions[p];
+    summary->partial += partial[p];
+    summary->bytes += bytes[p];
+  }
+  summary->accounts = count;
+  return (all_ok);
+}
+
+bool Portfolio::ExportAudit(const AuditExportRequest &request,
+                            AuditExportSummary *summary) const {
+  const size_t count = accounts_.size();
+  const size_t partitions = std::max<size_t>(request.partitions, 1);
+  const size_t group_rows = request.group_rows
+                                ? request.group_rows
+                                : AuditArchiveWriter::kDefaultGroupRows;
+  *summary = AuditExportSummary{0, 0, 0, {}};
+
+  std::vector<FILE *> files(partitions, nullptr);
+  bool opened = true;
+  for (size_t p = 0; p < partitions; p++) {
+    summary->files.push_back(request.path_prefix + "." + std::to_string(p));
+    files[p] = std::fopen(summary->files[p].c_str(), "wb");
+    opened = opened && files[p];
+  }
+  if (!opened) {
+    for (FILE *file : files) {
+      if (file) {
+        std::fclose(file);
+      }
+    }
+    return (false);
+  }
+
+  std::vector<size_t> rows(partitions, 0);
+  std::vector<uint64_t> bytes(partitions, 0);
+  std::vector<char> ok(partitions, 0);
+  pool_->ParallelFor(partitions, [&](size_t p) {
+    AuditArchiveWriter writer(files[p], group_rows);
+    const size_t end = ShardBegin(p + 1, count, partitions);
+    for (size_t h = ShardBegin(p, count, partitions); h < end; h++) {
+      std::unique_ptr<IAccount> thawed =
+          cold_.Copy(static_cast<uint32_t>(h));
+      IAccount *acc = thawed ? thawed.get() : accounts_[h].get();
+      writer.Add(acc->GetId(), acc->GetAudit());
+    }
+    ok[p] = writer.Finish();
+    rows[p] = writer.Rows();
+    bytes[p] = writer.Bytes();
+  });
+
+  bool all_ok = true;
+  for (size_t p = 0; p < partitions; p++) {
+    all_ok = (std::fclose(files[p]) == 0) && ok[p] && all_ok;
+    summary->rows += rows[p];
+    summary->bytes += bytes[p];
+  }
+  summary->accounts = count;
+  return (all_ok);
+}
+
+bool Portfolio::Reconcile(const ReconcileRequest &request,
+                          const Reconciler::ExternalSource &external,
+                          IReconcileSink *sink,
+                          ReconcileSummary *summary) const {
+  Reconciler reconciler(request, pool_);
+  TxRecord rec;
+  while (external(&rec)) {
+    reconciler.AddExternal(rec);
+  }
+  for (size_t h = 0; h < accounts_.size(); h++) {
+    std::unique_ptr<IAccount> thawed =
+        cold_.Copy(static_cast<uint32_t>(h));
+    IAccount *acc = thawed ? thawed.get() : accounts_[h].get();
+    reconciler.AddBook(acc->GetId(), acc->GetAudit());
+  }
+  return (reconciler.Run(sink, summary));
+}
+
+void Portfolio::SetDedupWindow(int64_t window_seconds, size_t expected_keys) {
+  dedup_ = DedupIndex(window_seconds, expected_keys);
+}
+
+DedupStats Portfolio::DeduplicationStats() const { return (dedup_.Stats()); }
+
+size_t Portfolio::DemoteIdle(int64_t now, int64_t idle_seconds) {
+  TraceScope trace(TraceOp::KDEMOTEIDLE, 0, idle_seconds);
+  const size_t count = accounts_.size();
+  const int64_t cutoff = now - idle_seconds;
+  const size_t shards =
+      count < kParallelBuildMin ? 1 : std::min(pool_->Size(), count);
+  std::vector<size_t> demoted(shards, 0);
+
+  pool_->ParallelFor(shards, [&](size_t s) {
+    const size_t end = ShardBegin(s + 1, count, shards);
+    for (size_t h = ShardBegin(s, count, shards); h < end; h++) {
+      if (!accounts_[h] || dispatch_[h] == Dispatch::KVIRTUAL ||
+          last_active_[h] >= cutoff) {
+        continue;
+      }
+      cold_.Freeze(static_cast<uint32_t>(h),
+                   *static_cast<BaseAccount *>(accounts_[h].get()));
+      accounts_[h].reset();
+      demoted[s]++;
+    }
+  });
+
+  size_t total = 0;
+  for (size_t part : demoted) {
+    total += part;
+  }
+  demotions_ += total;
+  trace.Result(static_cast<int64_t>(total), 0);
+  return (total);
+}
+
+TieringStats Portfolio::TierStats() const {
+  const size_t cold = cold_.ColdCount();
+  return (TieringStats{accounts_.size() - cold, cold, cold_.Bytes(),
+                       demotions_,
+                       promotions_.load(std::memory_order_relaxed)});
+}
+
+void Portfolio::SetReplicationSink(IReplicationSink *sink) {
+  sink_ = sink;
+  if (!sink_) {
+    return;
+  }
+  for (size_t h = 0; h < accounts_.size(); h++) {
+    std::unique_ptr<IAccount> thawed = cold_.Copy(static_cast<uint32_t>(h));
+    if (thawed) {
+      sink_->OnAccountAdded(thawed->GetSetting(), thawed->GetId(),
+                            thawed->GetBalance());
+    } else {
+      PublishAccount(static_cast<uint32_t>(h));
+    }
+  }
+}
+
+void Portfolio::EnableVelocity() {
+  if (velocity_) {
+    return;
+  }
+  velocity_ = std::make_unique<VelocityTracker>();
+  velocity_->Resize(accounts_.size());
+  // Cold accounts pick the tracker up when they are promoted.
+  for (size_t h = 0; h < accounts_.size(); h++) {
+    if (accounts_[h]) {
+      accounts_[h]->Attach(
+          {&clock_, this, static_cast<uint32_t>(h), velocity_.get()});
+    }
+  }
+}
+
+bool Portfolio::Velocity(const std::string &id, TxKind kind,
+                         VelocityWindow window, int64_t now,
+                         VelocityStat *stat) const {
+  uint32_t handle = index_.Find(id);
+  if (!velocity_ || handle == AccountIndex::kNotFound) {
+    return (false);
+  }
+  *stat = velocity_->Get(handle, kind, window, now);
+  return (true);
+}
+
+GroupTree *Portfolio::Hierarchy(const std::string &name) const {
+  for (const std::unique_ptr<GroupTree> &tree : groups_) {
+    if (tree->Name() == name) {
+      return (tree.get());
+    }
+  }
+  return (nullptr);
+}
+
+bool Portfolio::AddGroup(const std::string &hierarchy, const std::string &group,
+                         const std::string &parent) {
+  GroupTree *tree = Hierarchy(hierarchy);
+  if (!tree) {
+    if (!parent.empty()) {
+      return (false);
+    }
+    groups_.push_back(std::make_unique<GroupTree>(hierarchy));
+    tree = groups_.back().get();
+    tree->Resize(accounts_.size());
+  }
+  uint32_t parent_group = GroupTree::kNone;
+  if (!parent.empty()) {
+    parent_group = tree->Find(parent);
+    if (parent_group == GroupTree::kNone) {
+      return (false);
+    }
+  }
+  return (tree->AddGroup(group, parent_group) != GroupTree::kNone);
+}
+
+size_t Portfolio::Regroup(const std::string &hierarchy,
+                          const std::vector<GroupAssignment> &moves) {
+  GroupTree *tree = Hierarchy(hierarchy);
+  if (!tree) {
+    return (0);
+  }
+  size_t applied = 0;
+  for (const GroupAssignment &move : moves) {
+    const uint32_t handle = index_.Find(move.account_id);
+    const uint32_t group =
+        move.group.empty() ? GroupTree::kNone : tree->Find(move.group);
+    if (handle == AccountIndex::kNotFound ||
+        (group == GroupTree::kNone && !move.group.empty())) {
+      continue;
+    }
+    tree->Assign(handle, group, BalanceOf(handle));
+    applied++;
+  }
+  return (applied);
+}
+
+bool Portfolio::MoveGroup(const std::string &hierarchy,
+                          const std::string &group,
+                          const std::string &new_parent) {
+  GroupTree *tree = Hierarchy(hierarchy);
+  if (!tree) {
+    return (false);
+  }
+  const uint32_t moved = tree->Find(group);
+  const uint32_t parent =
+      new_parent.empty() ? GroupTree::kNone : tree->Find(new_parent);
+  if (moved == GroupTree::kNone ||
+      (parent == GroupTree::kNone && !new_parent.empty())) {
+    return (false);
+  }
+  return (tree->Move(moved, parent));
+}
+
+bool Portfolio::GroupExposure(const std::string &hierarchy,
+                              const std::string &group,
+                              GroupTotal *total) const {
+  const GroupTree *tree = Hierarchy(hierarchy);
+  const uint32_t found = tree ? tree->Find(group) : GroupTree::kNone;
+  if (found == GroupTree::kNone) {
+    return (false);
+  }
+  *total = tree->Total(found);
+  return (true);
+}
@@ -0,0 +1,427 @@
+// Copyright 2025 Sara Saad
+
+/******************************************* INCLUDE PART
+ * **************************************** */
+#include "../Inc/Reconciler.hpp"
+
+#include <algorithm>
+#include <queue>
+#include <tuple>
+#include <utility>
+
+#include "../Inc/AccountIndex.hpp"
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+namespace {
+
+enum Side : int { KEXTERNAL = 0, KBOOK = 1 };
+
+constexpr size_t kRunBuffer = 64 * 1024;  ///< stdio buffer per run file
+
+/// Runs merged per pass when the request leaves it open.
+constexpr size_t kDefaultMergeFanIn = 16;
+
+bool Less(const ReconEntry &a, const ReconEntry &b) {
+  return (std::tie(a.account_id, a.timestamp, a.kind, a.amount_cents) <
+          std::tie(b.account_id, b.timestamp, b.kind, b.amount_cents));
+}
+
+bool SameGroup(const ReconEntry &a, const ReconEntry &b) {
+  return (a.timestamp == b.timestamp && a.account_id == b.account_id);
+}
+
+/// Memory held by one buffered entry, heap part of the ID included.
+size_t EntryBytes(const ReconEntry &e) {
+  const size_t heap = e.account_id.capacity() > 15
+                          ? e.account_id.capacity() + 1
+                          : 0;
+  return (sizeof(ReconEntry) + heap);
+}
+
+bool WriteEntry(FILE *file, const ReconEntry &e) {
+  const uint8_t kind = static_cast<uint8_t>(e.kind);
+  const uint16_t length = static_cast<uint16_t>(
+      std::min<size_t>(e.account_id.size(), UINT16_MAX));
+  return (std::fwrite(&kind, 1, 1, file) == 1 &&
+          std::fwrite(&length, sizeof(length), 1, file) == 1 &&
+          std::fwrite(e.account_id.data(), 1, length, file) == length &&
+          std::fwrite(&e.timestamp, sizeof(e.timestamp), 1, file) == 1 &&
+          std::fwrite(&e.amount_cents, sizeof(e.amount_cents), 1, file) == 1);
+}
+
+/// Reads the next entry; false at the end of the run or, with *ok cleared,
+/// on a truncated one.
+bool ReadEntry(FILE *file, ReconEntry *e, bool *ok) {
+  uint8_t kind = 0;
+  if (std::fread(&kind, 1, 1, file) != 1) {
+    return (false);
+  }
+  uint16_t length = 0;
+  bool read = std::fread(&length, sizeof(length), 1, file) == 1;
+  e->account_id.resize(length);
+  read = read && std::fread(e->account_id.data(), 1, length, file) == length &&
+         std::fread(&e->timestamp, sizeof(e->timestamp), 1, file) == 1 &&
+         std::fread(&e->amount_cents, sizeof(e->amount_cents), 1, file) == 1;
+  e->kind = static_cast<TxKind>(kind);
+  *ok = *ok && read;
+  return (read);
+}
+
+/**
+ * @class: SortedStream
+ * @brief: K-way merge of sorted runs and one sorted in-memory vector.
+ */
+class SortedStream {
+ public:
+  SortedStream(const std::vector<FILE *> &runs,
+               std::vector<ReconEntry> *memory)
+      : memory_(memory), next_memory_(0), ok_(true) {
+    for (FILE *run : runs) {
+      std::setvbuf(run, nullptr, _IOFBF, kRunBuffer);
+      heads_.emplace_back();
+      files_.push_back(run);
+      if (ReadEntry(run, &heads_.back(), &ok_)) {
+        heap_.push(files_.size() - 1);
+      }
+    }
+    if (next_memory_ < memory_->size()) {
+      heap_.push(kMemory);
+    }
+  }
+
+  /// Moves the smallest remaining entry to *out; false when drained.
+  bool Next(ReconEntry *out) {
+    if (heap_.empty()) {
+      return (false);
+    }
+    const size_t source = heap_.top();
+    heap_.pop();
+    if (source == kMemory) {
+      *out = std::move((*memory_)[next_memory_++]);
+      if (next_memory_ < memory_->size()) {
+        heap_.push(kMemory);
+      }
+    } else {
+      *out = std::move(heads_[source]);
+      if (ReadEntry(files_[source], &heads_[source], &ok_)) {
+        heap_.push(source);
+      }
+    }
+    return (true);
+  }
+
+  bool Ok() const { return (ok_); }
+
+ private:
+  static constexpr size_t kMemory = SIZE_MAX;  ///< The in-memory source
+
+  const ReconEntry &Head(size_t source) const {
+    return (source == kMemory ? (*memory_)[next_memory_] : heads_[source]);
+  }
+
+  struct Greater {
+    const SortedStream *stream;
+    bool operator()(size_t a, size_t b) const {
+      return (Less(stream->Head(b), stream->Head(a)));
+    }
+  };
+
+  std::vector<ReconEntry> *memory_;
+  size_t next_memory_;
+  std::vector<FILE *> files_;
+  std::vector<ReconEntry> heads_;
+  std::priority_queue<size_t, std::vector<size_t>, Greater> heap_{
+      Greater{this}};
+  bool ok_;
+};
+
+/**
+ * @brief       : Merge runs into one new run and close them.
+ * @param runs  : The runs, each rewound.
+ * @param bytes : Incremented by the bytes written.
+ * @param ok    : Cleared on a write or read error.
+ * @return      : FILE * The merged run, rewound; nullptr, with the runs left
+ * open, if no temporary file could be created.
+ */
+FILE *MergeRuns(const std::vector<FILE *> &runs, uint64_t *bytes, bool *ok) {
+  FILE *merged = std::tmpfile();
+  if (!merged) {
+    *ok = false;
+    return (nullptr);
+  }
+  std::setvbuf(merged, nullptr, _IOFBF, kRunBuffer);
+  std::vector<ReconEntry> none;
+  SortedStream stream(runs, &none);
+  ReconEntry e;
+  bool written = true;
+  while (stream.Next(&e)) {
+    written = written && WriteEntry(merged, e);
+  }
+  written = written && std::fflush(merged) == 0;
+  *bytes += static_cast<uint64_t>(std::ftell(merged));
+  std::rewind(merged);
+  *ok = *ok && written && stream.Ok();
+  for (FILE *run : runs) {
+    std::fclose(run);
+  }
+  return (merged);
+}
+
+/**
+ * @brief       : Merge the newest runs of a side while fan_in of them share a
+ * level or, with down_to_fan_in, while the side holds more than fan_in runs.
+ * @return      : size_t The merge passes made.
+ */
+size_t MergeNewest(std::vector<FILE *> *runs, std::vector<uint32_t> *levels,
+                   size_t fan_in, bool down_to_fan_in, uint64_t *bytes,
+                   bool *ok) {
+  size_t passes = 0;
+  while (runs->size() >= fan_in) {
+    size_t first = runs->size() - fan_in;
+    if (down_to_fan_in) {
+      if (runs->size() == fan_in) {
+        break;
+      }
+      // Merge no more than it takes to get down to fan_in runs.
+      first = std::max(first, fan_in - 1);
+    } else if ((*levels)[first] != levels->back()) {
+      break;
+    }
+    const std::vector<FILE *> batch(runs->begin() + first, runs->end());
+    FILE *merged = MergeRuns(batch, bytes, ok);
+    if (!merged) {
+      break;
+    }
+    const uint32_t level = levels->back() + 1;
+    runs->resize(first);
+    levels->resize(first);
+    runs->push_back(merged);
+    levels->push_back(level);
+    passes++;
+  }
+  return (passes);
+}
+
+/**
+ * @brief : Settle one (account, timestamp) group; both sides sorted by
+ * (kind, amount).
+ */
+void SettleGroup(size_t partition, const std::vector<ReconEntry> &ext,
+                 const std::vector<ReconEntry> &book, IReconcileSink *sink,
+                 ReconcileSummary *counts) {
+  std::vector<const ReconEntry *> ext_left;
+  std::vector<const ReconEntry *> book_left;
+  size_t i = 0;
+  size_t j = 0;
+  while (i < ext.size() && j < book.size()) {
+    if (Less(ext[i], book[j])) {
+      ext_left.push_back(&ext[i++]);
+    } else if (Less(book[j], ext[i])) {
+      book_left.push_back(&book[j++]);
+    } else {
+      sink->OnMatched(partition, ext[i]);
+      counts->matched++;
+      i++;
+      j++;
+    }
+  }
+  for (; i < ext.size(); i++) {
+    ext_left.push_back(&ext[i]);
+  }
+  for (; j < book.size(); j++) {
+    book_left.push_back(&book[j]);
+  }
+
+  const size_t pairs = std::min(ext_left.size(), book_left.size());
+  for (size_t k = 0; k < pairs; k++) {
+    sink->OnMismatched(partition, *ext_left[k], *book_left[k]);
+  }
+  counts->mismatched += pairs;
+  for (size_t k = pairs; k < ext_left.size(); k++) {
+    sink->OnMissingFromBook(partition, *ext_left[k]);
+  }
+  counts->missing_from_book += ext_left.size() - pairs;
+  for (size_t k = pairs; k < book_left.size(); k++) {
+    sink->OnMissingFromExternal(partition, *book_left[k]);
+  }
+  counts->missing_from_external += book_left.size() - pairs;
+}
+
+}  // namespace
+
+IReconcileSink::~IReconcileSink() {}
+
+/**
+ * @struct: Reconciler::Partition
+ * @brief : Buffered records and spilled runs of one partition, per side.
+ */
+struct Reconciler::Partition {
+  std::vector<ReconEntry> buffer[2];
+  std::vector<FILE *> runs[2];
+  std::vector<uint32_t> levels[2];  ///< Merges behind each run
+};
+
+Reconciler::Reconciler(const ReconcileRequest &request, ThreadPool *pool)
+    : request_(request),
+      pool_(pool),
+      partitions_(std::max<size_t>(request.partitions, 1)),
+      buffered_bytes_(0),
+      fan_in_(request.merge_fan_in ? std::max<size_t>(request.merge_fan_in, 2)
+                                   : kDefaultMergeFanIn),
+      runs_(0),
+      spilled_bytes_(0),
+      merges_(0),
+      ok_(true) {}
+
+Reconciler::~Reconciler() {
+  for (Partition &part : partitions_) {
+    for (const std::vector<FILE *> &runs : part.runs) {
+      for (FILE *run : runs) {
+        std::fclose(run);
+      }
+    }
+  }
+}
+
+void Reconciler::AddExternal(const TxRecord &rec) {
+  Add(KEXTERNAL, rec.account_id, rec);
+}
+
+void Reconciler::AddBook(const std::string &id,
+                         const std::vector<TxRecord> &audit) {
+  for (const TxRecord &rec : audit) {
+    Add(KBOOK, id, rec);
+  }
+}
+
+void Reconciler::Add(int side, const std::string &id, const TxRecord &rec) {
+  if (rec.timestamp < request_.from_ts || rec.timestamp > request_.to_ts) {
+    return;
+  }
+  Partition &part = partitions_[AccountIndex::Hash(id) % partitions_.size()];
+  part.buffer[side].push_back(
+      ReconEntry{id, rec.timestamp, rec.kind, rec.amount_cents});
+  buffered_bytes_ += EntryBytes(part.buffer[side].back());
+  if (buffered_bytes_ > request_.memory_bytes) {
+    Spill();
+  }
+}
+
+void Reconciler::Spill() {
+  const size_t count = partitions_.size();
+  std::vector<size_t> runs(count, 0);
+  std::vector<uint64_t> bytes(count, 0);
+  std::vector<size_t> merges(count, 0);
+  std::vector<char> ok(count, 1);
+
+  pool_->ParallelFor(count, [&](size_t p) {
+    Partition &part = partitions_[p];
+    for (int side : {KEXTERNAL, KBOOK}) {
+      std::vector<ReconEntry> &buffer = part.buffer[side];
+      if (buffer.empty()) {
+        continue;
+      }
+      std::sort(buffer.begin(), buffer.end(), Less);
+      FILE *run = std::tmpfile();
+      if (!run) {
+        ok[p] = 0;
+        continue;
+      }
+      std::setvbuf(run, nullptr, _IOFBF, kRunBuffer);
+      bool written = true;
+      for (const ReconEntry &e : buffer) {
+        written = written && WriteEntry(run, e);
+      }
+      written = written && std::fflush(run) == 0;
+      bytes[p] += static_cast<uint64_t>(std::ftell(run));
+      std::rewind(run);
+      ok[p] = ok[p] && written;
+      part.runs[side].push_back(run);
+      part.levels[side].push_back(0);
+      runs[p]++;
+      // Hand the memory back, not just the elements.
+      std::vector<ReconEntry>().swap(buffer);
+
+      bool merged_ok = true;
+      merges[p] += MergeNewest(&part.runs[side], &part.levels[side], fan_in_,
+                               false, &bytes[p], &merged_ok);
+      ok[p] = ok[p] && merged_ok;
+    }
+  });
+
+  for (size_t p = 0; p < count; p++) {
+    runs_ += runs[p];
+    spilled_bytes_ += bytes[p];
+    merges_ += merges[p];
+    ok_ = ok_ && ok[p];
+  }
+  buffered_bytes_ = 0;
+}
+
+bool Reconciler::Run(IReconcileSink *sink, ReconcileSummary *summary) {
+  const size_t count = partitions_.size();
+  std::vector<ReconcileSummary> counts(count, ReconcileSummary{});
+  std::vector<char> ok(count, 1);
+
+  pool_->ParallelFor(count, [&](size_t p) {
+    Partition &part = partitions_[p];
+    bool merged_ok = true;
+    for (int side : {KEXTERNAL, KBOOK}) {
+      counts[p].merge_passes +=
+          MergeNewest(&part.runs[side], &part.levels[side], fan_in_, true,
+                      &counts[p].bytes_spilled, &merged_ok);
+    }
+    for (std::vector<ReconEntry> &buffer : part.buffer) {
+      std::sort(buffer.begin(), buffer.end(), Less);
+    }
+    SortedStream ext(part.runs[KEXTERNAL], &part.buffer[KEXTERNAL]);
+    SortedStream book(part.runs[KBOOK], &part.buffer[KBOOK]);
+
+    ReconEntry e;
+    ReconEntry b;
+    bool has_e = ext.Next(&e);
+    bool has_b = book.Next(&b);
+    std::vector<ReconEntry> ext_group;
+    std::vector<ReconEntry> book_group;
+    while (has_e || has_b) {
+      // The group is the smaller (account, timestamp) of the two heads.
+      const ReconEntry &lead =
+          !has_b || (has_e && std::tie(e.account_id, e.timestamp) <=
+                                  std::tie(b.account_id, b.timestamp))
+              ? e
+              : b;
+      const std::string account = lead.account_id;
+      const int64_t ts = lead.timestamp;
+      const ReconEntry key{account, ts, TxKind::KDEPOSIT, 0};
+
+      ext_group.clear();
+      while (has_e && SameGroup(e, key)) {
+        ext_group.push_back(std::move(e));
+        has_e = ext.Next(&e);
+      }
+      book_group.clear();
+      while (has_b && SameGroup(b, key)) {
+        book_group.push_back(std::move(b));
+        has_b = book.Next(&b);
+      }
+      SettleGroup(p, ext_group, book_group, sink, &counts[p]);
+    }
+    ok[p] = merged_ok && ext.Ok() && book.Ok();
+    for (std::vector<ReconEntry> &buffer : part.buffer) {
+      std::vector<ReconEntry>().swap(buffer);
+    }
+  });
+
+  *summary = ReconcileSummary{0, 0, 0, 0, runs_, spilled_bytes_, merges_};
+  bool all_ok = ok_;
+  for (size_t p = 0; p < count; p++) {
+    summary->bytes_spilled += counts[p].bytes_spilled;
+    summary->merge_passes += counts[p].merge_passes;
+    summary->matched += counts[p].matched;
+    summary->missing_from_book += counts[p].missing_from_book;
+    summary->missing_from_external += counts[p].missing_from_external;
+    summary->mismatched += counts[p].mismatched;
+    all_ok = all_ok && ok[p];
+  }
+  return (all_ok);
+}
@@ -0,0 +1,114 @@
+// Copyright 2025 Sara Saad
+
+/******************************************* INCLUDE PART
+ * **************************************** */
+#include "../Inc/Replay.hpp"
+
+#include <algorithm>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+ReplayEngine::ReplayEngine(size_t partitions)
+    : partitions_(partitions ? partitions : 1) {}
+
+uint64_t ReplayEngine::BookDigest(const std::vector<AccountDigest> &accounts) {
+  uint64_t h = 1469598103934665603ULL;
+  for (const AccountDigest &d : accounts) {
+    const uint64_t fields[3] = {AccountIndex::Hash(d.account_id),
+                                static_cast<uint64_t>(d.balance_cents),
+                                d.audit_digest};
+    for (uint64_t field : fields) {
+      h = (h ^ field) * 1099511628211ULL;
+      h ^= h >> 29;
+    }
+  }
+  return (h);
+}
+
+ReplayManifest ReplayEngine::Record(const Portfolio &portfolio) {
+  ReplayManifest manifest;
+  manifest.accounts = portfolio.Digest();
+  manifest.book_digest = BookDigest(manifest.accounts);
+  return (manifest);
+}
+
+ReplayReport ReplayEngine::Run(const AccountBatch &opening,
+                               const std::vector<TxRecord> &stream,
+                               const ReplayManifest &expected) const {
+  Portfolio book;
+  book.AddAccounts(opening, DuplicatePolicy::KREPLACE);
+
+  // A stream naming an account the opening book lacks cannot be applied at
+  // all; report it instead of re-executing anything.
+  for (size_t i = 0; i < stream.size(); i++) {
+    if (book.GetAccount(stream[i].account_id)) {
+      continue;
+    }
+    ReplayReport report{false, 0, 0, stream[i].account_id, 0, 0, i};
+    auto it = std::lower_bound(
+        expected.accounts.begin(), expected.accounts.end(),
+        report.divergent_id,
+        [](const AccountDigest &d, const std::string &id) {
+          return (d.account_id < id);
+        });
+    if (it != expected.accounts.end() &&
+        it->account_id == report.divergent_id) {
+      report.expected_balance = it->balance_cents;
+    }
+    return (report);
+  }
+  book.ApplyPartitioned(stream, partitions_);
+
+  std::vector<AccountDigest> actual = book.Digest();
+
+  ReplayReport report{true, BookDigest(actual), stream.size(), "", 0, 0,
+                      SIZE_MAX};
+  if (report.book_digest == expected.book_digest) {
+    return (report);
+  }
+
+  // Both sides are sorted by ID: walk them together to find the first
+  // account that differs or is missing on one side.
+  size_t e = 0;
+  size_t a = 0;
+  while (e < expected.accounts.size() || a < actual.size()) {
+    const AccountDigest *exp =
+        e < expected.accounts.size() ? &expected.accounts[e] : nullptr;
+    const AccountDigest *act = a < actual.size() ? &actual[a] : nullptr;
+
+    if (exp && act && exp->account_id == act->account_id) {
+      if (exp->balance_cents != act->balance_cents ||
+          exp->audit_digest != act->audit_digest) {
+        report.matched = false;
+        report.divergent_id = exp->account_id;
+        report.expected_balance = exp->balance_cents;
+        report.actual_balance = act->balance_cents;
+        break;
+      }
+      e++;
+      a++;
+    } else if (!act || (exp && exp->account_id < act->account_id)) {
+      report.matched = false;
+      report.divergent_id = exp->account_id;
+      report.expected_balance = exp->balance_cents;
+      break;
+    } else {
+      report.matched = false;
+      report.divergent_id = act->account_id;
+      report.actual_balance = act->balance_cents;
+      break;
+    }
+  }
+
+  if (report.matched) {
+    // Every account agrees, only the recorded checksum itself is off.
+    report.matched = false;
+    return (report);
+  }
+  for (size_t i = stream.size(); i > 0; i--) {
+    if (stream[i - 1].account_id == report.divergent_id) {
+      report.last_tx_index = i - 1;
+      break;
+    }
+  }
+  return (report);
+}
@@ -0,0 +1,473 @@
+// Copyright 2025 Sara Saad
+
+/******************************************* INCLUDE PART
+ * **************************************** */
+#include "../Inc/Replication.hpp"
+
+#include <sched.h>
+#include <sys/mman.h>
+#include <time.h>
+
+#include <algorithm>
+#include <cstring>
+#include <new>
+#include <utility>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+namespace {
+
+/// Entry types.
+enum Entry : uint8_t {
+  KPAD = 0,
+  KACCOUNT,
+  KTX,
+  KTRANSFER,
+  KPOLICY,
+  KACCRUE,
+  KACCRUEALL
+};
+
+constexpr size_t kEntryHeader = 16;
+constexpr size_t kMinCapacity = 1 << 16;
+constexpr size_t kMapAlign = 4096;
+
+/// Records per ApplyAll() on the follower.
+constexpr size_t kReplayBatch = 1024;
+
+inline size_t Align8(size_t n) { return ((n + 7) & ~static_cast<size_t>(7)); }
+
+uint64_t CoarseNowNs() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC_COARSE, &ts);
+  return (static_cast<uint64_t>(ts.tv_sec) * 1000000000ULL +
+          static_cast<uint64_t>(ts.tv_nsec));
+}
+
+/**
+ * @struct: Writer
+ * @brief : Appends fields into a reserved ring entry.
+ */
+struct Writer {
+  uint8_t *p;
+
+  template <typename T>
+  void Put(T v) {
+    std::memcpy(p, &v, sizeof(v));
+    p += sizeof(v);
+  }
+
+  void PutString(const char *s, size_t len) {
+    Put<uint32_t>(static_cast<uint32_t>(len));
+    std::memcpy(p, s, len);
+    p += len;
+  }
+};
+
+/**
+ * @struct: Reader
+ * @brief : Reads fields back from an entry payload.
+ */
+struct Reader {
+  const uint8_t *p;
+
+  template <typename T>
+  T Get() {
+    T v;
+    std::memcpy(&v, p, sizeof(v));
+    p += sizeof(v);
+    return (v);
+  }
+
+  std::string GetString() {
+    const uint32_t len = Get<uint32_t>();
+    std::string s(reinterpret_cast<const char *>(p), len);
+    p += len;
+    return (s);
+  }
+};
+
+/// Bytes a string field takes.
+inline size_t StringBytes(size_t len) { return (sizeof(uint32_t) + len); }
+
+}  // namespace
+
+IReplicationSink::~IReplicationSink() {}
+
+/**
+ * @struct: ReplicationRing::Shared
+ * @brief : The part of the ring both processes write; each side's fields
+ * have their own cache line.
+ */
+struct ReplicationRing::Shared {
+  alignas(64) std::atomic<uint64_t> head;  ///< Producer: bytes published
+  std::atomic<uint64_t> published;         ///< Producer: entries published
+  std::atomic<uint64_t> stalls;            ///< Producer: waits for space
+  std::atomic<uint64_t> oversized;         ///< Producer: entries refused
+  std::atomic<uint32_t> closed;            ///< Producer: Close() called
+  alignas(64) std::atomic<uint64_t> tail;  ///< Consumer: bytes consumed
+  std::atomic<uint64_t> applied;           ///< Consumer: entries consumed
+  std::atomic<uint64_t> last_lag_ns;       ///< Consumer: delay of last one
+};
+
+std::unique_ptr<ReplicationRing> ReplicationRing::Create(
+    size_t capacity_bytes) {
+  size_t capacity = kMinCapacity;
+  while (capacity < capacity_bytes) {
+    capacity <<= 1;
+  }
+  const size_t header = (sizeof(Shared) + kMapAlign - 1) & ~(kMapAlign - 1);
+  const size_t mapped = header + capacity;
+  void *base = mmap(nullptr, mapped, PROT_READ | PROT_WRITE,
+                    MAP_SHARED | MAP_ANONYMOUS | MAP_POPULATE, -1, 0);
+  if (base == MAP_FAILED) {
+    return (nullptr);
+  }
+  Shared *shared = new (base) Shared();
+  return (std::unique_ptr<ReplicationRing>(new ReplicationRing(
+      shared, static_cast<uint8_t *>(base) + header, capacity, mapped)));
+}
+
+ReplicationRing::ReplicationRing(Shared *shared, uint8_t *data,
+                                 size_t capacity, size_t mapped)
+    : shared_(shared), data_(data), capacity_(capacity), mapped_(mapped),
+      head_(0), cached_tail_(0), reserved_at_(0), published_(0), tail_(0),
+      cached_head_(0), peeked_size_(0), peeked_ns_(0), applied_(0) {}
+
+ReplicationRing::~ReplicationRing() {
+  shared_->~Shared();
+  munmap(shared_, mapped_);
+}
+
+size_t ReplicationRing::MaxEntry() const {
+  return (capacity_ / 2 - kEntryHeader);
+}
+
+uint8_t *ReplicationRing::Reserve(size_t n) {
+  if (n > MaxEntry()) {
+    // Even a drained ring could not take it: waiting would never end.
+    shared_->oversized.store(
+        shared_->oversized.load(std::memory_order_relaxed) + 1,
+        std::memory_order_relaxed);
+    return (nullptr);
+  }
+  const size_t need = Align8(kEntryHeader + n);
+  const size_t offset = head_ & (capacity_ - 1);
+  const size_t contiguous = capacity_ - offset;
+  const size_t total = need > contiguous ? contiguous + need : need;
+
+  if (head_ + total - cached_tail_ > capacity_) {
+    cached_tail_ = shared_->tail.load(std::memory_order_acquire);
+    if (head_ + total - cached_tail_ > capacity_) {
+      shared_->stalls.store(shared_->stalls.load(std::memory_order_relaxed) + 1,
+                            std::memory_order_relaxed);
+      do {
+        sched_yield();
+        cached_tail_ = shared_->tail.load(std::memory_order_acquire);
+      } while (head_ + total - cached_tail_ > capacity_);
+    }
+  }
+
+  if (need > contiguous) {
+    // Skip the end of the ring; the pad is published with the entry.
+    const uint32_t pad = static_cast<uint32_t>(contiguous);
+    std::memcpy(data_ + offset, &pad, sizeof(pad));
+    data_[offset + 4] = KPAD;
+    head_ += contiguous;
+  }
+  reserved_at_ = head_;
+  return (data_ + (head_ & (capacity_ - 1)) + kEntryHeader);
+}
+
+void ReplicationRing::Commit(uint8_t type, size_t n) {
+  uint8_t *entry = data_ + (reserved_at_ & (capacity_ - 1));
+  const uint32_t size = static_cast<uint32_t>(Align8(kEntryHeader + n));
+  const uint64_t now = CoarseNowNs();
+  std::memcpy(entry, &size, sizeof(size));
+  entry[4] = type;
+  std::memcpy(entry + 8, &now, sizeof(now));
+
+  head_ = reserved_at_ + size;
+  published_++;
+  shared_->head.store(head_, std::memory_order_release);
+  shared_->published.store(published_, std::memory_order_relaxed);
+}
+
+bool ReplicationRing::Peek(uint8_t *type, const uint8_t **data, size_t *n) {
+  for (;;) {
+    if (tail_ == cached_head_) {
+      cached_head_ = shared_->head.load(std::memory_order_acquire);
+      if (tail_ == cached_head_) {
+        return (false);
+      }
+    }
+    const uint8_t *entry = data_ + (tail_ & (capacity_ - 1));
+    uint32_t size = 0;
+    std::memcpy(&size, entry, sizeof(size));
+    if (entry[4] == KPAD) {
+      tail_ += size;
+      continue;
+    }
+    *type = entry[4];
+    *data = entry + kEntryHeader;
+    *n = size - kEntryHeader;
+    peeked_size_ = size;
+    std::memcpy(&peeked_ns_, entry + 8, sizeof(peeked_ns_));
+    return (true);
+  }
+}
+
+void ReplicationRing::Release() {
+  tail_ += peeked_size_;
+  applied_++;
+  shared_->tail.store(tail_, std::memory_order_release);
+  shared_->applied.store(applied_, std::memory_order_relaxed);
+  const uint64_t now = CoarseNowNs();
+  shared_->last_lag_ns.store(now > peeked_ns_ ? now - peeked_ns_ : 0,
+                             std::memory_order_relaxed);
+}
+
+void ReplicationRing::Close() {
+  shared_->closed.store(1, std::memory_order_release);
+}
+
+bool ReplicationRing::Closed() const {
+  return (shared_->closed.load(std::memory_order_acquire) != 0);
+}
+
+ReplicationStats ReplicationRing::Stats() const {
+  ReplicationStats stats;
+  stats.applied = shared_->applied.load(std::memory_order_relaxed);
+  const uint64_t tail = shared_->tail.load(std::memory_order_relaxed);
+  stats.published = shared_->published.load(std::memory_order_relaxed);
+  stats.published_bytes = shared_->head.load(std::memory_order_relaxed);
+  stats.lag_entries =
+      stats.published > stats.applied ? stats.published - stats.applied : 0;
+  stats.lag_bytes =
+      stats.published_bytes > tail ? stats.published_bytes - tail : 0;
+  stats.stalls = shared_->stalls.load(std::memory_order_relaxed);
+  stats.oversized = shared_->oversized.load(std::memory_order_relaxed);
+  stats.last_lag_ns = shared_->last_lag_ns.load(std::memory_order_relaxed);
+  return (stats);
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+ReplicationPublisher::ReplicationPublisher(ReplicationRing *ring)
+    : ring_(ring) {}
+
+size_t ReplicationPublisher::NoteRoom(size_t fixed, size_t note_len) const {
+  const size_t max = ring_->MaxEntry();
+  const size_t room = max > fixed + StringBytes(0) ? max - fixed - StringBytes(0)
+                                                   : 0;
+  return (std::min(note_len, room));
+}
+
+void ReplicationPublisher::OnAccountAdded(const AccountSettings &settings,
+                                          const std::string &id,
+                                          int64_t balance) {
+  Writer out{ring_->Reserve(1 + 8 + 8 + 8 + StringBytes(id.size()))};
+  if (!out.p) {
+    return;
+  }
+  uint8_t *begin = out.p;
+  out.Put<uint8_t>(static_cast<uint8_t>(settings.account_type));
+  out.Put<double>(settings.apr);
+  out.Put<int64_t>(settings.fee_flat_cents);
+  out.Put<int64_t>(balance);
+  out.PutString(id.data(), id.size());
+  ring_->Commit(KACCOUNT, static_cast<size_t>(out.p - begin));
+}
+
+void ReplicationPublisher::OnApplied(const TxRecord &tx) {
+  const char *note = tx.note ? tx.note : "";
+  const size_t fixed = 1 + 8 + 8 + 8 + StringBytes(tx.account_id.size());
+  const size_t note_len = NoteRoom(fixed, std::strlen(note));
+  Writer out{ring_->Reserve(fixed + StringBytes(note_len))};
+  if (!out.p) {
+    return;
+  }
+  uint8_t *begin = out.p;
+  out.Put<uint8_t>(static_cast<uint8_t>(tx.kind));
+  out.Put<int64_t>(tx.amount_cents);
+  out.Put<int64_t>(tx.timestamp);
+  out.Put<uint64_t>(tx.idempotency_key);
+  out.PutString(tx.account_id.data(), tx.account_id.size());
+  out.PutString(note, note_len);
+  ring_->Commit(KTX, static_cast<size_t>(out.p - begin));
+}
+
+void ReplicationPublisher::OnTransfer(const TransferRecord &txr) {
+  const size_t fixed = 8 + 8 + 8 + StringBytes(txr.from_id.size()) +
+                       StringBytes(txr.to_id.size());
+  const size_t note_len = NoteRoom(fixed, txr.note.size());
+  Writer out{ring_->Reserve(fixed + StringBytes(note_len))};
+  if (!out.p) {
+    return;
+  }
+  uint8_t *begin = out.p;
+  out.Put<int64_t>(txr.amount_cents);
+  out.Put<int64_t>(txr.timestamp);
+  out.Put<uint64_t>(txr.idempotency_key);
+  out.PutString(txr.from_id.data(), txr.from_id.size());
+  out.PutString(txr.to_id.data(), txr.to_id.size());
+  out.PutString(txr.note.data(), note_len);
+  ring_->Commit(KTRANSFER, static_cast<size_t>(out.p - begin));
+}
+
+void ReplicationPublisher::OnAccrualPolicy(const AccrualPolicy &policy,
+                                           int64_t anchor_ts) {
+  Writer out{ring_->Reserve(1 + 1 + 4 + 8)};
+  uint8_t *begin = out.p;
+  out.Put<uint8_t>(policy.lazy_interest ? 1 : 0);
+  out.Put<uint8_t>(policy.lazy_fees ? 1 : 0);
+  out.Put<int32_t>(policy.fee_cycle_days);
+  out.Put<int64_t>(anchor_ts);
+  ring_->Commit(KPOLICY, static_cast<size_t>(out.p - begin));
+}
+
+void ReplicationPublisher::OnAccrue(const std::string &id, int64_t ts) {
+  Writer out{ring_->Reserve(8 + StringBytes(id.size()))};
+  if (!out.p) {
+    return;
+  }
+  uint8_t *begin = out.p;
+  out.Put<int64_t>(ts);
+  out.PutString(id.data(), id.size());
+  ring_->Commit(KACCRUE, static_cast<size_t>(out.p - begin));
+}
+
+void ReplicationPublisher::OnAccrueAll(int64_t ts) {
+  Writer out{ring_->Reserve(8)};
+  out.Put<int64_t>(ts);
+  ring_->Commit(KACCRUEALL, 8);
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+ReplicationFollower::ReplicationFollower(ReplicationRing *ring,
+                                         Portfolio *portfolio)
+    : ring_(ring), portfolio_(portfolio), promoted_(false) {
+  pending_.reserve(kReplayBatch);
+}
+
+void ReplicationFollower::Flush() {
+  if (pending_.empty()) {
+    return;
+  }
+  portfolio_->ApplyAll(pending_);
+  portfolio_->DrainBatchAudit();  // The primary keeps the batch audit.
+  pending_.clear();
+}
+
+void ReplicationFollower::Replay(uint8_t type, const uint8_t *data, size_t n) {
+  (void)n;
+  Reader in{data};
+  if (type == KTX) {
+    TxRecord tx;
+    tx.kind = static_cast<TxKind>(in.Get<uint8_t>());
+    tx.amount_cents = in.Get<int64_t>();
+    tx.timestamp = in.Get<int64_t>();
+    tx.idempotency_key = in.Get<uint64_t>();
+    tx.account_id = in.GetString();
+    tx.note = notes_.Intern(in.GetString());
+    pending_.push_back(std::move(tx));
+    if (pending_.size() >= kReplayBatch) {
+      Flush();
+    }
+    return;
+  }
+
+  // Every other entry must see the records published before it.
+  Flush();
+  switch (type) {
+    case KACCOUNT: {
+      AccountSettings settings;
+      settings.account_type = static_cast<AccountType>(in.Get<uint8_t>());
+      settings.apr = in.Get<double>();
+      settings.fee_flat_cents = in.Get<int64_t>();
+      const int64_t balance = in.Get<int64_t>();
+      std::string id = in.GetString();
+      if (settings.account_type == AccountType::KSAVINGS) {
+        portfolio_->AddAccount(
+            std::make_unique<SavingAccount>(id, settings.apr, balance));
+      } else {
+        portfolio_->AddAccount(std::make_unique<CheckingAccount>(
+            id, settings.fee_flat_cents, balance));
+      }
+      break;
+    }
+    case KTRANSFER: {
+      TransferRecord txr;
+      txr.amount_cents = in.Get<int64_t>();
+      txr.timestamp = in.Get<int64_t>();
+      txr.idempotency_key = in.Get<uint64_t>();
+      txr.from_id = in.GetString();
+      txr.to_id = in.GetString();
+      txr.note = in.GetString();
+      portfolio_->Transfer(txr);
+      break;
+    }
+    case KPOLICY: {
+      AccrualPolicy policy;
+      policy.lazy_interest = in.Get<uint8_t>() != 0;
+      policy.lazy_fees = in.Get<uint8_t>() != 0;
+      policy.fee_cycle_days = in.Get<int32_t>();
+      portfolio_->SetAccrualPolicy(policy, in.Get<int64_t>());
+      break;
+    }
+    case KACCRUE: {
+      const int64_t ts = in.Get<int64_t>();
+      int64_t ignored = 0;
+      portfolio_->BalanceAt(in.GetString(), ts, &ignored);
+      break;
+    }
+    case KACCRUEALL:
+      portfolio_->AccrueAll(in.Get<int64_t>());
+      break;
+    default:
+      break;
+  }
+}
+
+size_t ReplicationFollower::Poll(size_t max_entries) {
+  if (promoted_) {
+    return (0);
+  }
+  size_t done = 0;
+  uint8_t type = 0;
+  const uint8_t *data = nullptr;
+  size_t n = 0;
+  while (done < max_entries && ring_->Peek(&type, &data, &n)) {
+    Replay(type, data, n);
+    ring_->Release();
+    done++;
+  }
+  Flush();
+  return (done);
+}
+
+void ReplicationFollower::Run() {
+  while (!promoted_) {
+    if (Poll(kReplayBatch) != 0) {
+      continue;
+    }
+    if (ring_->Closed()) {
+      // Entries published before Close() are visible now.
+      while (Poll(kReplayBatch) != 0) {
+      }
+      return;
+    }
+    sched_yield();
+  }
+}
+
+size_t ReplicationFollower::Promote() {
+  size_t drained = 0;
+  for (size_t n = Poll(kReplayBatch); n != 0; n = Poll(kReplayBatch)) {
+    drained += n;
+  }
+  promoted_ = true;
+  return (drained);
+}
+
+bool ReplicationFollower::Promoted() const { return (promoted_); }
@@ -0,0 +1,630 @@
+// Copyright 2025 Sara Saad
+
+/******************************************* INCLUDE PART
+ * **************************************** */
+#include "../Inc/ShardedPortfolio.hpp"
+
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstring>
+#include <memory>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+
+#include "../Inc/AccountIndex.hpp"
+#include "../Inc/NotePool.hpp"
+#include "../Inc/Portfolio.hpp"
+#include "../Inc/ThreadPool.hpp"
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+namespace {
+
+/// Request opcodes.
+enum Op : uint8_t {
+  KADD = 1,   ///< AccountBatch slice and policy -> u64 stored
+  KAPPLY,     ///< TxRecords -> u64 applied
+  KGET,       ///< id -> AccountView, or KNO
+  KTRANSFER,  ///< Same-shard transfer -> KOK / KNO
+  KPREPARE,   ///< txid, debit, id, amount, ts, note -> vote KOK / KNO
+  KCOMMIT,    ///< txid -> KOK / KNO
+  KABORT,     ///< txid -> KOK
+  KEXPOSURE   ///< -> i64 total
+};
+
+/// Reply status.
+constexpr uint8_t KOK = 0;
+constexpr uint8_t KNO = 1;
+
+constexpr size_t kHeaderBytes = 5;  ///< u32 payload length, u8 op/status
+
+template <typename T>
+void Put(std::vector<uint8_t> *out, T v) {
+  const size_t at = out->size();
+  out->resize(at + sizeof(v));
+  std::memcpy(out->data() + at, &v, sizeof(v));
+}
+
+void PutString(std::vector<uint8_t> *out, const std::string &s) {
+  Put<uint32_t>(out, static_cast<uint32_t>(s.size()));
+  out->insert(out->end(), s.begin(), s.end());
+}
+
+/**
+ * @struct: Reader
+ * @brief : Bounds-checked cursor over a received payload; a short payload
+ * clears ok and yields zeros.
+ */
+struct Reader {
+  const uint8_t *p;
+  const uint8_t *end;
+  bool ok;
+
+  explicit Reader(const std::vector<uint8_t> &bytes)
+      : p(bytes.data()), end(bytes.data() + bytes.size()), ok(true) {}
+
+  template <typename T>
+  T Get() {
+    T v{};
+    if (static_cast<size_t>(end - p) < sizeof(v)) {
+      ok = false;
+      return (v);
+    }
+    std::memcpy(&v, p, sizeof(v));
+    p += sizeof(v);
+    return (v);
+  }
+
+  std::string GetString() {
+    const uint32_t len = Get<uint32_t>();
+    if (static_cast<size_t>(end - p) < len) {
+      ok = false;
+      return (std::string());
+    }
+    std::string s(reinterpret_cast<const char *>(p), len);
+    p += len;
+    return (s);
+  }
+};
+
+bool WriteFull(int fd, const uint8_t *data, size_t n) {
+  while (n > 0) {
+    const ssize_t done = ::send(fd, data, n, MSG_NOSIGNAL);
+    if (done < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      return (false);
+    }
+    data += done;
+    n -= static_cast<size_t>(done);
+  }
+  return (true);
+}
+
+bool ReadFull(int fd, uint8_t *data, size_t n) {
+  while (n > 0) {
+    const ssize_t done = ::read(fd, data, n);
+    if (done < 0 && errno == EINTR) {
+      continue;
+    }
+    if (done <= 0) {
+      return (false);
+    }
+    data += done;
+    n -= static_cast<size_t>(done);
+  }
+  return (true);
+}
+
+bool WriteFrame(int fd, uint8_t code, const std::vector<uint8_t> &payload) {
+  uint8_t header[kHeaderBytes];
+  const uint32_t len = static_cast<uint32_t>(payload.size());
+  std::memcpy(header, &len, sizeof(len));
+  header[4] = code;
+  return (WriteFull(fd, header, sizeof(header)) &&
+          WriteFull(fd, payload.data(), payload.size()));
+}
+
+bool ReadFrame(int fd, uint8_t *code, std::vector<uint8_t> *payload) {
+  uint8_t header[kHeaderBytes];
+  if (!ReadFull(fd, header, sizeof(header))) {
+    return (false);
+  }
+  uint32_t len = 0;
+  std::memcpy(&len, header, sizeof(len));
+  *code = header[4];
+  payload->resize(len);
+  return (ReadFull(fd, payload->data(), len));
+}
+
+/**
+ * @class: ShardWorker
+ * @brief: The Portfolio of one shard and its side of the two-phase protocol.
+ *
+ */
+class ShardWorker {
+ public:
+  explicit ShardWorker(int fd) : fd_(fd), pool_(1), portfolio_(&pool_) {}
+
+  /// Serve requests until the router closes its end.
+  void Run() {
+    uint8_t op = 0;
+    std::vector<uint8_t> request;
+    std::vector<uint8_t> reply;
+    while (ReadFrame(fd_, &op, &request)) {
+      reply.clear();
+      Reader in(request);
+      const uint8_t status = Handle(op, &in, &reply);
+      if (!WriteFrame(fd_, in.ok ? status : KNO, reply)) {
+        return;
+      }
+    }
+  }
+
+ private:
+  /**
+   * @struct: Pending
+   * @brief : A prepared, not yet committed transfer leg.
+   */
+  struct Pending {
+    std::string id;
+    int64_t amount_cents;
+    int64_t timestamp;
+    std::string note;
+    bool debit;
+  };
+
+  int fd_;
+  ThreadPool pool_;  ///< The parent's pool threads do not exist after fork()
+  Portfolio portfolio_;
+  NotePool notes_;  ///< Notes of applied records outlive the request buffer
+  std::unordered_map<uint64_t, Pending> pending_;  ///< By txid
+  std::unordered_set<std::string> locked_;  ///< Accounts in pending_
+
+  uint8_t Handle(uint8_t op, Reader *in, std::vector<uint8_t> *out) {
+    switch (op) {
+      case KADD:
+        return (Add(in, out));
+      case KAPPLY:
+        return (Apply(in, out));
+      case KGET:
+        return (Get(in, out));
+      case KTRANSFER: {
+        TransferRecord txr;
+        txr.from_id = in->GetString();
+        txr.to_id = in->GetString();
+        txr.amount_cents = in->Get<int64_t>();
+        txr.timestamp = in->Get<int64_t>();
+        txr.note = in->GetString();
+        return (in->ok && portfolio_.Transfer(txr) ? KOK : KNO);
+      }
+      case KPREPARE:
+        return (Prepare(in));
+      case KCOMMIT:
+        return (Finish(in->Get<uint64_t>(), true));
+      case KABORT:
+        return (Finish(in->Get<uint64_t>(), false));
+      case KEXPOSURE:
+        Put<int64_t>(out, portfolio_.TotalExposure());
+        return (KOK);
+      default:
+        return (KNO);
+    }
+  }
+
+  uint8_t Add(Reader *in, std::vector<uint8_t> *out) {
+    AccountBatch batch;
+    const auto policy = static_cast<DuplicatePolicy>(in->Get<uint8_t>());
+    const uint32_t count = in->Get<uint32_t>();
+    for (uint32_t i = 0; i < count && in->ok; i++) {
+      batch.ids.push_back(in->GetString());
+      batch.types.push_back(static_cast<AccountType>(in->Get<uint8_t>()));
+      batch.aprs.push_back(in->Get<double>());
+      batch.fees_cents.push_back(in->Get<int64_t>());
+      batch.opening_balances.push_back(in->Get<int64_t>());
+    }
+    if (!in->ok) {
+      return (KNO);
+    }
+    Put<uint64_t>(out, portfolio_.AddAccounts(batch, policy));
+    return (KOK);
+  }
+
+  uint8_t Apply(Reader *in, std::vector<uint8_t> *out) {
+    std::vector<TxRecord> txs;
+    const uint32_t count = in->Get<uint32_t>();
+    txs.reserve(count);
+    for (uint32_t i = 0; i < count && in->ok; i++) {
+      TxRecord tx;
+      tx.kind = static_cast<TxKind>(in->Get<uint8_t>());
+      tx.amount_cents = in->Get<int64_t>();
+      tx.timestamp = in->Get<int64_t>();
+      tx.idempotency_key = in->Get<uint64_t>();
+      tx.account_id = in->GetString();
+      tx.note = notes_.Intern(in->GetString());
+      // Portfolio::ApplyAll() treats an unknown account as fatal; a worker
+      // must survive a bad record, so it is dropped here instead.
+      if (portfolio_.GetAccount(tx.account_id)) {
+        txs.push_back(std::move(tx));
+      }
+    }
+    if (!in->ok) {
+      return (KNO);
+    }
+    portfolio_.ApplyAll(txs);
+    // The workers keep no batch audit; what was applied is only counted.
+    Put<uint64_t>(out, portfolio_.DrainBatchAudit().size());
+    return (KOK);
+  }
+
+  uint8_t Get(Reader *in, std::vector<uint8_t> *out) {
+    IAccount *acc = portfolio_.GetAccount(in->GetString());
+    if (!acc) {
+      return (KNO);
+    }
+    const AccountSettings settings = acc->GetSetting();
+    Put<uint8_t>(out, static_cast<uint8_t>(settings.account_type));
+    Put<double>(out, settings.apr);
+    Put<int64_t>(out, settings.fee_flat_cents);
+    Put<int64_t>(out, acc->GetBalance());
+    Put<uint64_t>(out, acc->GetAudit().size());
+    return (KOK);
+  }
+
+  uint8_t Prepare(Reader *in) {
+    const uint64_t txid = in->Get<uint64_t>();
+    Pending leg;
+    leg.debit = in->Get<uint8_t>() != 0;
+    leg.id = in->GetString();
+    leg.amount_cents = in->Get<int64_t>();
+    leg.timestamp = in->Get<int64_t>();
+    leg.note = in->GetString();
+    if (!in->ok || !portfolio_.GetAccount(leg.id) ||
+        locked_.count(leg.id) != 0 || pending_.count(txid) != 0) {
+      return (KNO);
+    }
+    locked_.insert(leg.id);
+    pending_.emplace(txid, std::move(leg));
+    return (KOK);
+  }
+
+  uint8_t Finish(uint64_t txid, bool commit) {
+    auto it = pending_.find(txid);
+    if (it == pending_.end()) {
+      return (commit ? KNO : KOK);
+    }
+    const Pending &leg = it->second;
+    if (commit) {
+      // Same notes as Portfolio::Transfer() writes for a local transfer.
+      IAccount *acc = portfolio_.GetAccount(leg.id);
+      if (leg.debit) {
+        acc->Withdraw(leg.amount_cents, leg.timestamp,
+                      notes_.Intern(leg.note + "Transfer Out!"));
+      } else {
+        acc->Deposit(leg.amount_cents, leg.timestamp,
+                     notes_.Intern(leg.note + "Teransfer In!."));
+      }
+    }
+    locked_.erase(leg.id);
+    pending_.erase(it);
+    return (KOK);
+  }
+};
+
+}  // namespace
+
+ShardedPortfolio::ShardedPortfolio()
+    : next_txid_(1), commits_(0), aborts_(0) {}
+
+ShardedPortfolio::~ShardedPortfolio() { Stop(); }
+
+bool ShardedPortfolio::Start(size_t shards) {
+  if (!workers_.empty() || shards == 0) {
+    return (false);
+  }
+  for (size_t s = 0; s < shards; s++) {
+    int sv[2];
+    if (::socketpair(AF_UNIX, SOCK_STREAM, 0, sv) != 0) {
+      Stop();
+      return (false);
+    }
+    const pid_t pid = ::fork();
+    if (pid < 0) {
+      ::close(sv[0]);
+      ::close(sv[1]);
+      Stop();
+      return (false);
+    }
+    if (pid == 0) {
+      // The worker must not hold the router's end of any shard, or that
+      // shard would never see end-of-file when the router stops.
+      ::close(sv[0]);
+      for (const Worker &w : workers_) {
+        ::close(w.fd);
+      }
+      {
+        ShardWorker worker(sv[1]);
+        worker.Run();
+      }
+      ::_exit(0);
+    }
+    ::close(sv[1]);
+    workers_.push_back({pid, sv[0], false});
+  }
+  return (true);
+}
+
+void ShardedPortfolio::Stop() {
+  for (const Worker &w : workers_) {
+    ::close(w.fd);
+  }
+  for (const Worker &w : workers_) {
+    int status = 0;
+    while (::waitpid(w.pid, &status, 0) < 0 && errno == EINTR) {
+    }
+  }
+  workers_.clear();
+}
+
+size_t ShardedPortfolio::Shards() const { return (workers_.size()); }
+
+size_t ShardedPortfolio::ShardOf(const std::string &id) const {
+  return (AccountIndex::Hash(id) % workers_.size());
+}
+
+bool ShardedPortfolio::Send(size_t shard, uint8_t op,
+                            const std::vector<uint8_t> &payload) {
+  Worker &worker = workers_[shard];
+  if (worker.broken) {
+    return (false);
+  }
+  // A partial frame would leave the worker reading garbage.
+  worker.broken = !WriteFrame(worker.fd, op, payload);
+  return (!worker.broken);
+}
+
+bool ShardedPortfolio::Receive(size_t shard, uint8_t *status,
+                               std::vector<uint8_t> *payload) {
+  Worker &worker = workers_[shard];
+  if (worker.broken) {
+    return (false);
+  }
+  std::vector<uint8_t> ignored;
+  // After a failed read the next frame boundary is unknown.
+  worker.broken = !ReadFrame(worker.fd, status, payload ? payload : &ignored);
+  return (!worker.broken);
+}
+
+bool ShardedPortfolio::Call(size_t shard, uint8_t op,
+                            const std::vector<uint8_t> &payload,
+                            uint8_t *status, std::vector<uint8_t> *reply) {
+  return (Send(shard, op, payload) && Receive(shard, status, reply));
+}
+
+size_t ShardedPortfolio::AddAccounts(const AccountBatch &batch,
+                                     DuplicatePolicy policy) {
+  const size_t count = batch.ids.size();
+  if (workers_.empty() || batch.types.size() != count ||
+      batch.aprs.size() != count || batch.fees_cents.size() != count ||
+      batch.opening_balances.size() != count) {
+    return (0);
+  }
+
+  std::vector<std::vector<uint8_t>> parts(workers_.size());
+  std::vector<uint32_t> counts(workers_.size(), 0);
+  for (auto &part : parts) {
+    Put<uint8_t>(&part, static_cast<uint8_t>(policy));
+    Put<uint32_t>(&part, 0);  // Patched below.
+  }
+  for (size_t i = 0; i < count; i++) {
+    const size_t s = ShardOf(batch.ids[i]);
+    PutString(&parts[s], batch.ids[i]);
+    Put<uint8_t>(&parts[s], static_cast<uint8_t>(batch.types[i]));
+    Put<double>(&parts[s], batch.aprs[i]);
+    Put<int64_t>(&parts[s], batch.fees_cents[i]);
+    Put<int64_t>(&parts[s], batch.opening_balances[i]);
+    counts[s]++;
+  }
+
+  // A shard that got its part owes a reply, even if another send failed.
+  std::vector<char> sent(workers_.size(), 0);
+  bool ok = true;
+  for (size_t s = 0; s < workers_.size(); s++) {
+    std::memcpy(parts[s].data() + 1, &counts[s], sizeof(counts[s]));
+    sent[s] = Send(s, KADD, parts[s]);
+    ok = sent[s] && ok;
+  }
+  size_t stored = 0;
+  for (size_t s = 0; s < workers_.size(); s++) {
+    if (!sent[s]) {
+      continue;
+    }
+    uint8_t status = KNO;
+    std::vector<uint8_t> reply;
+    ok = Receive(s, &status, &reply) && status == KOK && ok;
+    Reader in(reply);
+    stored += static_cast<size_t>(in.Get<uint64_t>());
+  }
+  return (ok ? stored : 0);
+}
+
+bool ShardedPortfolio::ApplyAll(const std::vector<TxRecord> &txs,
+                                size_t *applied) {
+  if (workers_.empty()) {
+    return (false);
+  }
+  std::vector<std::vector<uint8_t>> parts(workers_.size());
+  std::vector<uint32_t> counts(workers_.size(), 0);
+  for (auto &part : parts) {
+    Put<uint32_t>(&part, 0);  // Patched below.
+  }
+  for (const TxRecord &tx : txs) {
+    const size_t s = ShardOf(tx.account_id);
+    std::vector<uint8_t> &part = parts[s];
+    Put<uint8_t>(&part, static_cast<uint8_t>(tx.kind));
+    Put<int64_t>(&part, tx.amount_cents);
+    Put<int64_t>(&part, tx.timestamp);
+    Put<uint64_t>(&part, tx.idempotency_key);
+    PutString(&part, tx.account_id);
+    PutString(&part, tx.note ? tx.note : "");
+    counts[s]++;
+  }
+
+  // Every worker gets its part before any reply is awaited, so the shards
+  // apply in parallel.
+  std::vector<char> sent(workers_.size(), 0);
+  bool ok = true;
+  for (size_t s = 0; s < workers_.size(); s++) {
+    std::memcpy(parts[s].data(), &counts[s], sizeof(counts[s]));
+    sent[s] = Send(s, KAPPLY, parts[s]);
+    ok = sent[s] && ok;
+  }
+  size_t total = 0;
+  for (size_t s = 0; s < workers_.size(); s++) {
+    if (!sent[s]) {
+      continue;
+    }
+    uint8_t status = KNO;
+    std::vector<uint8_t> reply;
+    ok = Receive(s, &status, &reply) && status == KOK && ok;
+    Reader in(reply);
+    total += static_cast<size_t>(in.Get<uint64_t>());
+  }
+  if (applied) {
+    *applied = total;
+  }
+  return (ok);
+}
+
+bool ShardedPortfolio::Transfer(const TransferRecord &txr) {
+  if (workers_.empty()) {
+    return (false);
+  }
+  // Admitted now so that a repeat is refused before any leg is prepared,
+  // forgotten again below unless the transfer commits.
+  if (txr.idempotency_key != 0 &&
+      !transfer_keys_.Admit(txr.idempotency_key, txr.timestamp)) {
+    return (false);
+  }
+
+  const size_t from = ShardOf(txr.from_id);
+  const size_t to = ShardOf(txr.to_id);
+  uint8_t status = KNO;
+  if (from == to) {
+    std::vector<uint8_t> payload;
+    PutString(&payload, txr.from_id);
+    PutString(&payload, txr.to_id);
+    Put<int64_t>(&payload, txr.amount_cents);
+    Put<int64_t>(&payload, txr.timestamp);
+    PutString(&payload, txr.note);
+    const bool applied =
+        Call(from, KTRANSFER, payload, &status, nullptr) && status == KOK;
+    if (!applied && txr.idempotency_key != 0) {
+      transfer_keys_.Forget(txr.idempotency_key);
+    }
+    return (applied);
+  }
+
+  // Phase one: both legs are prepared concurrently.
+  const uint64_t txid = next_txid_++;
+  std::vector<uint8_t> debit;
+  std::vector<uint8_t> credit;
+  for (auto *leg : {&debit, &credit}) {
+    Put<uint64_t>(leg, txid);
+    Put<uint8_t>(leg, leg == &debit ? 1 : 0);
+    PutString(leg, leg == &debit ? txr.from_id : txr.to_id);
+    Put<int64_t>(leg, txr.amount_cents);
+    Put<int64_t>(leg, txr.timestamp);
+    PutString(leg, txr.note);
+  }
+  uint8_t vote_from = KNO;
+  uint8_t vote_to = KNO;
+  const bool sent_from = Send(from, KPREPARE, debit);
+  const bool sent_to = sent_from && Send(to, KPREPARE, credit);
+  // A shard whose vote was read is in step and may hold a prepared leg.
+  const bool heard_from = sent_from && Receive(from, &vote_from, nullptr);
+  const bool heard_to = sent_to && Receive(to, &vote_to, nullptr);
+
+  // Phase two: commit both, or abort whichever leg was prepared.
+  std::vector<uint8_t> id;
+  Put<uint64_t>(&id, txid);
+  const bool commit = heard_from && heard_to && vote_from == KOK &&
+                      vote_to == KOK;
+  const uint8_t op = commit ? KCOMMIT : KABORT;
+  bool ok = heard_from && heard_to;
+  bool told[2] = {false, false};
+  const size_t legs[2] = {from, to};
+  const bool heard[2] = {heard_from, heard_to};
+  for (int leg = 0; leg < 2; leg++) {
+    told[leg] = heard[leg] && Send(legs[leg], op, id);
+    ok = told[leg] && ok;
+  }
+  for (int leg = 0; leg < 2; leg++) {
+    if (told[leg]) {
+      ok = Receive(legs[leg], &status, nullptr) && status == KOK && ok;
+    }
+  }
+  if (commit) {
+    commits_++;
+  } else {
+    aborts_++;
+    if (txr.idempotency_key != 0) {
+      transfer_keys_.Forget(txr.idempotency_key);
+    }
+  }
+  return (commit && ok);
+}
+
+bool ShardedPortfolio::GetAccount(const std::string &id, AccountView *view) {
+  if (workers_.empty()) {
+    return (false);
+  }
+  std::vector<uint8_t> payload;
+  std::vector<uint8_t> reply;
+  PutString(&payload, id);
+  uint8_t status = KNO;
+  if (!Call(ShardOf(id), KGET, payload, &status, &reply) || status != KOK) {
+    return (false);
+  }
+  Reader in(reply);
+  view->account_id = id;
+  view->settings.account_type = static_cast<AccountType>(in.Get<uint8_t>());
+  view->settings.apr = in.Get<double>();
+  view->settings.fee_flat_cents = in.Get<int64_t>();
+  view->balance_cents = in.Get<int64_t>();
+  view->audit_size = static_cast<size_t>(in.Get<uint64_t>());
+  return (in.ok);
+}
+
+bool ShardedPortfolio::TotalExposure(int64_t *cents) {
+  if (workers_.empty()) {
+    return (false);
+  }
+  std::vector<char> sent(workers_.size(), 0);
+  bool ok = true;
+  for (size_t s = 0; s < workers_.size(); s++) {
+    sent[s] = Send(s, KEXPOSURE, {});
+    ok = sent[s] && ok;
+  }
+  int64_t total = 0;
+  for (size_t s = 0; s < workers_.size(); s++) {
+    if (!sent[s]) {
+      continue;
+    }
+    uint8_t status = KNO;
+    std::vector<uint8_t> reply;
+    ok = Receive(s, &status, &reply) && status == KOK && ok;
+    Reader in(reply);
+    total += in.Get<int64_t>();
+  }
+  *cents = total;
+  return (ok);
+}
+
+uint64_t ShardedPortfolio::CrossShardCommits() const { return (commits_); }
+
+uint64_t ShardedPortfolio::CrossShardAborts() const { return (aborts_); }
@@ -0,0 +1,236 @@
+// Copyright 2025 Sara Saad
+
+/******************************************* INCLUDE PART
+ * **************************************** */
+#include "../Inc/Statement.hpp"
+
+#include <algorithm>
+#include <cstring>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+namespace {
+
+constexpr size_t kMinBuffer = 4096;
+
+/// Effect of an audited transaction on the balance.
+int64_t SignedAmount(const TxRecord &rec) {
+  switch (rec.kind) {
+    case TxKind::KDEPOSIT:
+    case TxKind::KINTEREST:
+    case TxKind::KTRANSFERIN:
+      return (rec.amount_cents);
+    case TxKind::KWITHDRAWAL:
+    case TxKind::KFEE:
+    case TxKind::KTRANSFEROUT:
+      return (-rec.amount_cents);
+    default:
+      return (0);
+  }
+}
+
+const char *KindCode(TxKind kind) {
+  static const char *const kCodes[] = {"DEP", "WDR", "FEE",
+                                       "INT", "TIN", "TOU"};
+  size_t k = static_cast<size_t>(kind);
+  return (k < 6 ? kCodes[k] : "???");
+}
+
+/// Right-align v in a field of width characters; returns the field end.
+char *PutNumber(char *p, int64_t v, size_t width) {
+  char digits[24];
+  size_t n = 0;
+  uint64_t u = v < 0 ? 0 - static_cast<uint64_t>(v) : static_cast<uint64_t>(v);
+  do {
+    digits[n++] = static_cast<char>('0' + u % 10);
+    u /= 10;
+  } while (u != 0);
+  if (v < 0) {
+    digits[n++] = '-';
+  }
+  for (size_t i = n; i < width; i++) {
+    *p++ = ' ';
+  }
+  while (n > 0) {
+    *p++ = digits[--n];
+  }
+  return (p);
+}
+
+/// Left-align text in a field of width characters (longer text is kept
+/// whole when keep is set, cut otherwise); returns the field end.
+char *PutText(char *p, const char *text, size_t len, size_t width,
+              bool keep) {
+  if (!keep) {
+    len = std::min(len, width);
+  }
+  std::memcpy(p, text, len);
+  p += len;
+  for (size_t i = len; i < width; i++) {
+    *p++ = ' ';
+  }
+  return (p);
+}
+
+template <typename T>
+char *PutRaw(char *p, T v) {
+  std::memcpy(p, &v, sizeof(v));
+  return (p + sizeof(v));
+}
+
+}  // namespace
+
+StatementWriter::StatementWriter(FILE *file, StatementFormat format,
+                                 size_t buffer_bytes)
+    : file_(file), format_(format),
+      buffer_(std::max(buffer_bytes, kMinBuffer)), used_(0), bytes_(0),
+      transactions_(0), partial_(0), ok_(true) {}
+
+char *StatementWriter::Reserve(size_t n) {
+  if (buffer_.size() - used_ < n) {
+    Flush();
+    if (buffer_.size() < n) {
+      buffer_.resize(n);  // Only for an id longer than the whole buffer.
+    }
+  }
+  return (buffer_.data() + used_);
+}
+
+void StatementWriter::Commit(char *end) {
+  used_ = static_cast<size_t>(end - buffer_.data());
+}
+
+void StatementWriter::Flush() {
+  if (used_ == 0) {
+    return;
+  }
+  if (std::fwrite(buffer_.data(), 1, used_, file_) != used_) {
+    ok_ = false;
+  }
+  bytes_ += used_;
+  used_ = 0;
+}
+
+bool StatementWriter::Finish() {
+  Flush();
+  if (std::fflush(file_) != 0) {
+    ok_ = false;
+  }
+  return (ok_);
+}
+
+size_t StatementWriter::Transactions() const { return (transactions_); }
+
+size_t StatementWriter::Partial() const { return (partial_); }
+
+uint64_t StatementWriter::Bytes() const { return (bytes_); }
+
+bool StatementWriter::Write(const std::string &id, int64_t balance,
+                            const std::vector<TxRecord> &audit, int64_t from,
+                            int64_t to) {
+  // A full trail may have dropped records at or after from.
+  const bool partial = audit.size() >= kAuditCapacity &&
+                       audit.front().timestamp >= from;
+  int64_t closing = balance;
+  int64_t opening = balance;
+  for (const TxRecord &rec : audit) {
+    if (rec.timestamp > to) {
+      closing -= SignedAmount(rec);
+      opening -= SignedAmount(rec);
+    } else if (rec.timestamp >= from) {
+      opening -= SignedAmount(rec);
+    }
+  }
+
+  WriteHeader(partial ? 'P' : 'S', id, from, to, opening);
+  uint32_t count = 0;
+  int64_t running = opening;
+  for (const TxRecord &rec : audit) {
+    if (rec.timestamp < from || rec.timestamp > to) {
+      continue;
+    }
+    running += SignedAmount(rec);
+    WriteLine(rec, running);
+    count++;
+  }
+  WriteFooter(id, count, closing);
+  transactions_ += count;
+  partial_ += partial ? 1 : 0;
+  return (!partial);
+}
+
+void StatementWriter::WriteHeader(char tag, const std::string &id,
+                                  int64_t from, int64_t to, int64_t opening) {
+  char *p = Reserve(id.size() + 80);
+  if (format_ == StatementFormat::KTEXT) {
+    *p++ = tag;
+    *p++ = ' ';
+    p = PutText(p, id.data(), id.size(), kIdWidth, true);
+    *p++ = ' ';
+    p = PutNumber(p, from, 12);
+    *p++ = ' ';
+    p = PutNumber(p, to, 12);
+    *p++ = ' ';
+    p = PutNumber(p, opening, 16);
+    *p++ = '\n';
+  } else {
+    const size_t len = std::min<size_t>(id.size(), 255);
+    *p++ = tag;
+    *p++ = static_cast<char>(len);
+    std::memcpy(p, id.data(), len);
+    p += len;
+    p = PutRaw(p, from);
+    p = PutRaw(p, to);
+    p = PutRaw(p, opening);
+  }
+  Commit(p);
+}
+
+void StatementWriter::WriteLine(const TxRecord &rec, int64_t balance) {
+  const char *note = rec.note ? rec.note : "";
+  const size_t note_len = strnlen(note, kNoteWidth);
+  char *p = Reserve(128);
+  if (format_ == StatementFormat::KTEXT) {
+    *p++ = 'T';
+    *p++ = ' ';
+    p = PutNumber(p, rec.timestamp, 12);
+    *p++ = ' ';
+    p = PutText(p, KindCode(rec.kind), 3, 3, false);
+    *p++ = ' ';
+    p = PutNumber(p, rec.amount_cents, 16);
+    *p++ = ' ';
+    p = PutNumber(p, balance, 16);
+    *p++ = ' ';
+    p = PutText(p, note, note_len, kNoteWidth, false);
+    *p++ = '\n';
+  } else {
+    *p++ = 'T';
+    *p++ = static_cast<char>(rec.kind);
+    p = PutRaw(p, rec.timestamp);
+    p = PutRaw(p, rec.amount_cents);
+    p = PutRaw(p, balance);
+    *p++ = static_cast<char>(note_len);
+    std::memcpy(p, note, note_len);
+    p += note_len;
+  }
+  Commit(p);
+}
+
+void StatementWriter::WriteFooter(const std::string &id, uint32_t count,
+                                  int64_t closing) {
+  char *p = Reserve(id.size() + 64);
+  if (format_ == StatementFormat::KTEXT) {
+    *p++ = 'E';
+    *p++ = ' ';
+    p = PutText(p, id.data(), id.size(), kIdWidth, true);
+    *p++ = ' ';
+    p = PutNumber(p, count, 8);
+    *p++ = ' ';
+    p = PutNumber(p, closing, 16);
+    *p++ = '\n';
+  } else {
+    *p++ = 'E';
+    p = PutRaw(p, count);
+    p = PutRaw(p, closing);
+  }
+  Commit(p);
+}
@@ -0,0 +1,234 @@
+// Copyright 2025 Sara Saad
+
+/******************************************* INCLUDE PART
+ * **************************************** */
+#include "../Inc/ThreadPool.hpp"
+
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <utility>
+
+#if defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#endif
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+namespace {
+
+thread_local const ThreadPool *t_pool = nullptr;  ///< Pool of this worker
+thread_local size_t t_index = 0;                  ///< Its queue index
+
+#if defined(__linux__)
+/**
+ * @brief: CPUs listed node by node, so consecutive workers share a node.
+ */
+std::vector<int> CpusByNumaNode() {
+  std::vector<int> cpus;
+  for (int node = 0;; node++) {
+    std::ifstream list("/sys/devices/system/node/node" +
+                       std::to_string(node) + "/cpulist");
+    if (!list) {
+      break;
+    }
+    std::string ranges;
+    std::getline(list, ranges);
+    std::stringstream parts(ranges);
+    std::string part;
+    while (std::getline(parts, part, ',')) {
+      size_t dash = part.find('-');
+      int first = std::stoi(part.substr(0, dash));
+      int last = dash == std::string::npos ? first
+                                           : std::stoi(part.substr(dash + 1));
+      for (int cpu = first; cpu <= last; cpu++) {
+        cpus.push_back(cpu);
+      }
+    }
+  }
+  if (cpus.empty()) {
+    for (unsigned cpu = 0; cpu < std::thread::hardware_concurrency(); cpu++) {
+      cpus.push_back(static_cast<int>(cpu));
+    }
+  }
+  return (cpus);
+}
+#endif
+
+}  // namespace
+
+ThreadPool::ThreadPool(size_t threads, bool pin_workers) {
+  if (threads == 0) {
+    threads = std::thread::hardware_concurrency();
+  }
+  if (threads == 0) {
+    threads = 1;
+  }
+  for (size_t i = 0; i < threads; i++) {
+    queues_.push_back(std::make_unique<Queue>());
+  }
+  workers_.reserve(threads);
+  for (size_t i = 0; i < threads; i++) {
+    workers_.emplace_back([this, i, pin_workers]() {
+      if (pin_workers) {
+        PinToCpu(i);
+      }
+      WorkerLoop(i);
+    });
+  }
+}
+
+ThreadPool::~ThreadPool() {
+  {
+    std::lock_guard<std::mutex> lock(sleep_mutex_);
+    stopping_ = true;
+  }
+  wake_.notify_all();
+  for (auto &worker : workers_) {
+    worker.join();
+  }
+}
+
+ThreadPool *ThreadPool::Shared() {
+  static ThreadPool pool(0);
+  return (&pool);
+}
+
+void ThreadPool::PinToCpu(size_t index) {
+#if defined(__linux__)
+  static const std::vector<int> cpus = CpusByNumaNode();
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  CPU_SET(cpus[index % cpus.size()], &set);
+  pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+#else
+  (void)index;
+#endif
+}
+
+void ThreadPool::Push(size_t queue, std::function<void()> job) {
+  {
+    std::lock_guard<std::mutex> lock(queues_[queue]->mutex);
+    queues_[queue]->jobs.push_back(std::move(job));
+  }
+  pending_.fetch_add(1);
+  {
+    // Taking the lock orders this wake-up after a sleeper's predicate check.
+    std::lock_guard<std::mutex> lock(sleep_mutex_);
+  }
+  wake_.notify_one();
+}
+
+void ThreadPool::Post(std::function<void()> job) {
+  size_t queue = (t_pool == this) ? t_index
+                                  : next_.fetch_add(1) % queues_.size();
+  Push(queue, std::move(job));
+}
+
+void ThreadPool::Post(std::function<void()> job, size_t affinity) {
+  Push(affinity % queues_.size(), std::move(job));
+}
+
+bool ThreadPool::TryRunOne(size_t home) {
+  std::function<void()> job;
+  const size_t count = queues_.size();
+
+  for (size_t k = 0; k < count && !job; k++) {
+    Queue &queue = *queues_[(home + k) % count];
+    std::lock_guard<std::mutex> lock(queue.mutex);
+    if (queue.jobs.empty()) {
+      continue;
+    }
+    if (k == 0) {
+      job = std::move(queue.jobs.back());
+      queue.jobs.pop_back();
+    } else {
+      job = std::move(queue.jobs.front());
+      queue.jobs.pop_front();
+    }
+  }
+  if (!job) {
+    return (false);
+  }
+  pending_.fetch_sub(1);
+  job();
+  return (true);
+}
+
+void ThreadPool::WorkerLoop(size_t index) {
+  t_pool = this;
+  t_index = index;
+  for (;;) {
+    if (TryRunOne(index)) {
+      continue;
+    }
+    std::unique_lock<std::mutex> lock(sleep_mutex_);
+    wake_.wait(lock, [this]() { return (stopping_ || pending_.load() > 0); });
+    if (stopping_ && pending_.load() == 0) {
+      return;
+    }
+  }
+}
+
+void ThreadPool::ParallelFor(size_t count,
+                             const std::function<void(size_t)> &body) {
+  if (count == 0) {
+    return;
+  }
+  if (count == 1) {
+    body(0);
+    return;
+  }
+
+  std::atomic<size_t> remaining(count);
+  for (size_t shard = 0; shard < count; shard++) {
+    Post(
+        [&body, &remaining, shard]() {
+          body(shard);
+          remaining.fetch_sub(1, std::memory_order_release);
+        },
+        shard);
+  }
+
+  const size_t home = (t_pool == this) ? t_index : 0;
+  while (remaining.load(std::memory_order_acquire) != 0) {
+    if (!TryRunOne(home)) {
+      std::this_thread::yield();
+    }
+  }
+}
+
+size_t ThreadPool::Size() const { return (workers_.size()); }
+
+Strand::Strand(ThreadPool *pool) : pool_(pool) {}
+
+void Strand::Post(std::function<void()> job) {
+  bool start = false;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    jobs_.push_back(std::move(job));
+    if (!running_) {
+      running_ = true;
+      start = true;
+    }
+  }
+  if (start) {
+    pool_->Post([this]() { Drain(); });
+  }
+}
+
+void Strand::Drain() {
+  for (;;) {
+    std::function<void()> job;
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      if (jobs_.empty()) {
+        running_ = false;
+        return;
+      }
+      job = std::move(jobs_.front());
+      jobs_.pop_front();
+    }
+    job();
+  }
+}
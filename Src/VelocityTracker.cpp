@@ -0,0 +1,114 @@
+// Copyright 2025 Sara Saad
+
+/******************************************* INCLUDE PART
+ * **************************************** */
+#include "../Inc/VelocityTracker.hpp"
+
+#include <algorithm>
+#include <limits>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+namespace {
+
+/**
+ * @struct: Ring
+ * @brief : Where one window's cells sit in VelocityTracker::Rings.
+ */
+struct Ring {
+  int64_t width;  ///< Seconds per bucket
+  int64_t size;   ///< Buckets: the window's span plus one partial bucket
+  size_t first;   ///< Index of the first cell
+};
+
+constexpr Ring kRings[] = {
+    {10, 7, 0},     // Minute: 6 full buckets and the current one.
+    {600, 7, 7},    // Hour.
+    {7200, 13, 14}  // Day.
+};
+
+/// Time slot of ts (floor, also for negative times), clamped to 32 bits
+/// above the unused marker.
+int32_t SlotOf(int64_t ts, int64_t width) {
+  int64_t q = ts / width;
+  if (ts % width < 0) {
+    q--;
+  }
+  q = std::clamp<int64_t>(q, std::numeric_limits<int32_t>::min() + 1,
+                          std::numeric_limits<int32_t>::max());
+  return (static_cast<int32_t>(q));
+}
+
+/// Cell index of a slot within its ring.
+size_t CellOf(const Ring &ring, int32_t slot) {
+  int64_t r = slot % ring.size;
+  if (r < 0) {
+    r += ring.size;
+  }
+  return (ring.first + static_cast<size_t>(r));
+}
+
+}  // namespace
+
+void VelocityTracker::Resize(size_t count) { rings_.resize(count * kKinds); }
+
+void VelocityTracker::Reset(uint32_t handle) {
+  for (size_t k = 0; k < kKinds; k++) {
+    rings_[handle * kKinds + k].reset();
+  }
+}
+
+void VelocityTracker::Record(uint32_t handle, const TxRecord &rec) {
+  std::unique_ptr<Rings> &rings =
+      rings_[handle * kKinds + static_cast<size_t>(rec.kind)];
+  if (!rings) {
+    rings = std::make_unique<Rings>();
+    for (Cell &cell : rings->cells) {
+      cell = Cell{std::numeric_limits<int32_t>::min(), 0, 0};
+    }
+  }
+
+  for (const Ring &ring : kRings) {
+    const int32_t slot = SlotOf(rec.timestamp, ring.width);
+    Cell &cell = rings->cells[CellOf(ring, slot)];
+    if (cell.slot != slot) {
+      if (cell.slot > slot) {
+        continue;  // Older than the whole ring.
+      }
+      cell = Cell{slot, 0, 0};
+    }
+    cell.count++;
+    cell.sum += rec.amount_cents;
+  }
+}
+
+VelocityStat VelocityTracker::Get(uint32_t handle, TxKind kind,
+                                  VelocityWindow window, int64_t now) const {
+  VelocityStat stat{0, 0};
+  const Rings *rings =
+      rings_[handle * kKinds + static_cast<size_t>(kind)].get();
+  if (!rings) {
+    return (stat);
+  }
+
+  const Ring &ring = kRings[static_cast<size_t>(window)];
+  const int64_t oldest = SlotOf(now, ring.width) - (ring.size - 1);
+  for (size_t c = ring.first; c < ring.first + ring.size; c++) {
+    // Slots past now are counted too: a record may be stamped slightly ahead
+    // of the clock the caller queries with.
+    const Cell &cell = rings->cells[c];
+    if (cell.slot >= oldest) {
+      stat.count += cell.count;
+      stat.sum_cents += cell.sum;
+    }
+  }
+  return (stat);
+}
+
+size_t VelocityTracker::Bytes() const {
+  size_t allocated = 0;
+  for (const std::unique_ptr<Rings> &rings : rings_) {
+    allocated += rings ? 1 : 0;
+  }
+  return (rings_.capacity() * sizeof(std::unique_ptr<Rings>) +
+          allocated * sizeof(Rings));
+}
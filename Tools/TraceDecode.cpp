@@ -0,0 +1,119 @@
+// Copyright 2025 Sara Saad
+
+/**
+ * @file : TraceDecode.cpp
+ * @brief: Prints a flight recorder dump as a latency table and a timeline.
+ *
+ * Usage: robobank_trace <dump> [timeline_events]   (default: 50)
+ *
+ * The latency table times every operation whose begin and end events are
+ * both in the dump; the timeline lists the newest events of all threads,
+ * merged by time.
+ *
+ */
+/*************************** include part ****************************** */
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <map>
+#include <vector>
+
+#include "../Inc/FlightRecorder.hpp"
+///////////////////////////////////////////////////////////////////////////////////////////////////////
+
+namespace {
+
+const char *OpName(TraceOp op) {
+  static const char *const kNames[] = {
+      "ApplyAll",  "ApplyPartitioned", "ApplyShard", "ApplyTx",
+      "Duplicate", "Transfer",         "SweepFees",  "AccrueAll",
+      "DemoteIdle", "Promote",         "Thread"};
+  const size_t i = static_cast<size_t>(op);
+  return (i < sizeof(kNames) / sizeof(kNames[0]) ? kNames[i] : "?");
+}
+
+const char *PhaseName(TracePhase phase) {
+  switch (phase) {
+    case TracePhase::KBEGIN:
+      return ("begin");
+    case TracePhase::KEND:
+      return ("end");
+    default:
+      return ("point");
+  }
+}
+
+/// Value at quantile q of sorted values.
+double Quantile(const std::vector<double> &sorted, double q) {
+  return (sorted[static_cast<size_t>(q * (sorted.size() - 1))]);
+}
+
+}  // namespace
+
+int main(int argc, char *argv[]) {
+  if (argc < 2) {
+    std::fprintf(stderr, "usage: %s <dump> [timeline_events]\n", argv[0]);
+    return (2);
+  }
+  const size_t timeline = argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 50;
+
+  TraceDump dump;
+  if (!LoadTrace(argv[1], &dump)) {
+    std::fprintf(stderr, "%s: not a readable flight recorder dump\n", argv[1]);
+    return (1);
+  }
+  size_t events = 0;
+  for (const TraceThread &thread : dump.threads) {
+    events += thread.events.size();
+  }
+  std::printf("threads %zu events %zu ticks_per_ns %.3f\n",
+              dump.threads.size(), events, dump.ticks_per_ns);
+
+  // Latency per operation.
+  std::map<TraceOp, std::vector<double>> latencies;
+  for (const TraceSpan &span : TraceSpans(dump)) {
+    latencies[span.op].push_back(span.duration_ns / 1000.0);
+  }
+  std::printf("\n%-18s %8s %12s %12s %12s %12s\n", "operation", "count",
+              "mean_us", "p50_us", "p99_us", "max_us");
+  for (auto &[op, values] : latencies) {
+    std::sort(values.begin(), values.end());
+    double sum = 0.0;
+    for (double v : values) {
+      sum += v;
+    }
+    std::printf("%-18s %8zu %12.3f %12.3f %12.3f %12.3f\n", OpName(op),
+                values.size(), sum / values.size(), Quantile(values, 0.5),
+                Quantile(values, 0.99), values.back());
+  }
+
+  // The newest events of every thread, merged by time.
+  struct Line {
+    uint32_t thread_id;
+    const TraceEvent *event;
+  };
+  std::vector<Line> lines;
+  for (const TraceThread &thread : dump.threads) {
+    for (const TraceEvent &event : thread.events) {
+      lines.push_back({thread.thread_id, &event});
+    }
+  }
+  std::sort(lines.begin(), lines.end(), [](const Line &a, const Line &b) {
+    return (a.event->tsc < b.event->tsc);
+  });
+  const size_t first = lines.size() > timeline ? lines.size() - timeline : 0;
+  std::printf("\n%14s %8s %-18s %-6s %10s %16s %6s\n", "time_us", "thread",
+              "operation", "phase", "handle", "amount", "detail");
+  for (size_t i = first; i < lines.size(); i++) {
+    const TraceEvent &event = *lines[i].event;
+    const double us = (static_cast<double>(event.tsc) -
+                       static_cast<double>(dump.start_tsc)) /
+                      dump.ticks_per_ns / 1000.0;
+    std::printf("%14.3f %8u %-18s %-6s %10u %16lld %6u\n", us,
+                lines[i].thread_id, OpName(event.op), PhaseName(event.phase),
+                event.handle, static_cast<long long>(event.amount),
+                event.detail);
+  }
+  return (0);
+}
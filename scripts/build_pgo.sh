@@ -0,0 +1,43 @@
+#!/usr/bin/env bash
+# Copyright 2025 Sara Saad
+#
+# Profile-guided build: instrument, train on the PortfolioBench workload,
+# then rebuild with the collected profile.
+#
+# Usage: scripts/build_pgo.sh [build-dir] [extra cmake args...]
+#   e.g. scripts/build_pgo.sh build-pgo -DROBOBANK_LTO=ON -DROBOBANK_MARCH=native
+#
+# The same build directory is used for both passes, so GCC finds the .gcda
+# files under the object paths it recorded them for.
+
+set -euo pipefail
+
+ROOT="$(cd "$(dirname "$0")/.." && pwd)"
+BUILD="${1:-${ROOT}/build-pgo}"
+shift || true
+PROFILES="${BUILD}/pgo-profiles"
+JOBS="$(nproc 2>/dev/null || echo 2)"
+
+rm -rf "${PROFILES}"
+mkdir -p "${PROFILES}"
+
+echo "== instrumented build"
+cmake -S "${ROOT}" -B "${BUILD}" -DCMAKE_BUILD_TYPE=Release \
+  -DROBOBANK_PGO=GENERATE -DROBOBANK_PGO_DIR="${PROFILES}" "$@" >/dev/null
+cmake --build "${BUILD}" -j"${JOBS}" --target PortfolioBench AccountIndexBench
+
+echo "== training run"
+"${BUILD}/PortfolioBench" >/dev/null
+"${BUILD}/AccountIndexBench" 200000 >/dev/null
+
+# Clang writes raw profiles that have to be merged; GCC reads .gcda directly.
+if ls "${PROFILES}"/*.profraw >/dev/null 2>&1; then
+  llvm-profdata merge -output="${PROFILES}/merged.profdata" "${PROFILES}"/*.profraw
+fi
+
+echo "== optimized build"
+cmake -S "${ROOT}" -B "${BUILD}" -DROBOBANK_PGO=USE "$@" >/dev/null
+# Object files must be rebuilt even though no source changed.
+cmake --build "${BUILD}" --target clean
+cmake --build "${BUILD}" -j"${JOBS}"
+echo "PGO build ready in ${BUILD}"
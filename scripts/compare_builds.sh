@@ -0,0 +1,62 @@
+#!/usr/bin/env bash
+# Copyright 2025 Sara Saad
+#
+# Build every release configuration and report its PortfolioBench time and
+# speedup relative to the plain -O3 build.
+#
+# Usage: scripts/compare_builds.sh [runs] [bench args...]
+#   runs: repetitions per configuration, the best time is kept (default 3)
+#
+# Build directories are created under build-compare/.
+
+set -euo pipefail
+
+ROOT="$(cd "$(dirname "$0")/.." && pwd)"
+OUT="${ROOT}/build-compare"
+RUNS="${1:-3}"
+shift || true
+JOBS="$(nproc 2>/dev/null || echo 2)"
+MARCH="${ROBOBANK_MARCH:-native}"
+
+build() {  # name, cmake args...
+  local name="$1"
+  shift
+  cmake -S "${ROOT}" -B "${OUT}/${name}" -DROBOBANK_BUILD_TESTS=OFF "$@" >/dev/null
+  cmake --build "${OUT}/${name}" -j"${JOBS}" --target PortfolioBench >/dev/null
+}
+
+best_time() {  # build dir, bench args...
+  local dir="$1"
+  shift
+  local best=""
+  for _ in $(seq "${RUNS}"); do
+    local t
+    t="$("${dir}/PortfolioBench" "$@" | sed -n 's/^total_seconds //p')"
+    if [ -z "${best}" ] || awk -v a="${t}" -v b="${best}" 'BEGIN{exit !(a<b)}'; then
+      best="${t}"
+    fi
+  done
+  echo "${best}"
+}
+
+echo "building configurations (march=${MARCH})..."
+build debug -DCMAKE_BUILD_TYPE=Debug
+build o3 -DCMAKE_BUILD_TYPE=Release
+build o3-march -DCMAKE_BUILD_TYPE=Release -DROBOBANK_MARCH="${MARCH}"
+build o3-march-lto -DCMAKE_BUILD_TYPE=Release -DROBOBANK_MARCH="${MARCH}" \
+  -DROBOBANK_LTO=ON
+"${ROOT}/scripts/build_pgo.sh" "${OUT}/o3-march-lto-pgo" \
+  -DROBOBANK_BUILD_TESTS=OFF -DROBOBANK_MARCH="${MARCH}" -DROBOBANK_LTO=ON \
+  >/dev/null
+
+BASE="$(best_time "${OUT}/o3" "$@")"
+printf '%-20s %10s %9s\n' configuration seconds speedup
+for name in debug o3 o3-march o3-march-lto o3-march-lto-pgo; do
+  if [ "${name}" = o3 ]; then
+    t="${BASE}"
+  else
+    t="$(best_time "${OUT}/${name}" "$@")"
+  fi
+  printf '%-20s %10s %8.2fx\n' "${name}" "${t}" \
+    "$(awk -v b="${BASE}" -v t="${t}" 'BEGIN{print b/t}')"
+done